@@ -1,6 +1,17 @@
 #include "Anonymization.h" // 必须首先包含，以检查头文件的自包含性
 #include "log/log.h"       // 确保 log.h 与 C++ 兼容或有 extern "C"
 #include "YOLOv8_face.h"   // 现在可以在 .cpp 文件中包含
+#include "VideoPipeline.h"
+#include "FrameConvert.h"
+#include "StreamSession.h"
+#include "MultiStreamScheduler.h"
+#include "ImageBatch.h"
+#include "JpegCodec.h"
+#include "TiledImage.h"
+#include "PerfStats.h"
+#include "Trace.h"
+#include "SimdKernels.h"
+#include "Sidecar.h"
 #include <opencv2/opencv.hpp>
 
 #include <iostream>
@@ -8,6 +19,14 @@
 #include <vector>
 #include <string>
 #include <memory> // 用于 std::unique_ptr (可选，但推荐)
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <sys/stat.h>
 
 
 // 全局日志文件指针 (保持，但其管理将改进)
@@ -16,6 +35,11 @@ static FILE *g_log_file = nullptr; // 使用 g_ 前缀表示全局，并初始
 // AnonymizationContext 结构体的实际定义
 struct AnonymizationContext {
     YOLOv8_face model; // 模型实例现在是 context 的一部分
+    std::vector<double> sceneCuts; // 最近一次视频处理检测到的场景切换时间点（毫秒）
+    int id = 0;                    // 句柄序号，用作统计输出的默认标签
+    RecognizeType recognizeType = RECOGNIZE_FACE; // 写入检测结果旁路文件的类别名
+    PerfCounters perf;             // 分阶段性能统计，模型及其派生实例共享
+    std::unique_ptr<PerfDumper> perfDumper; // 在 perf 之后声明，析构时先停止输出线程
     // 可以在这里添加其他每个实例需要的状态信息
     // 例如，特定的配置参数等
 };
@@ -48,6 +72,13 @@ const char* map_error_to_string(int errorCode) {
         case LOAD_LOG_ERROR: return "Failed to open log file";
         case INTERNAL_ERROR: return "An internal error occurred";
         case HANDLE_INVALID: return "The provided handle is invalid";
+        case CHECKPOINT_MISMATCH: return "Checkpoint does not match the input or options";
+        case OPERATION_CANCELLED: return "Operation cancelled";
+        case STREAM_TIMEOUT: return "Timed out waiting on the stream";
+        case STREAM_END: return "End of stream";
+        case BUFFER_TOO_SMALL: return "Output buffer is too small";
+        case DAEMON_UNAVAILABLE: return "Anonymization daemon is not reachable";
+        case SIDECAR_ERROR: return "Detection sidecar is unreadable or does not match the input";
         default: return "Unknown error code";
     }
 }
@@ -57,7 +88,7 @@ const char* map_error_to_string(int errorCode) {
 
 // --- API Function Implementations ---
 
-const char* Anonymization_API get_version() {
+Anonymization_API const char* get_version() {
     return "v1.1.0"; // 版本可以更新
 }
 
@@ -91,6 +122,11 @@ int Anonymization_API set_log_filelevel(IN const char* logPath, IN LOG_LEVEL log
     return ANO_OK;
 }
 
+int Anonymization_API set_log_stderr(IN bool enable) {
+    log_set_stderr(enable ? 1 : 0);
+    return ANO_OK;
+}
+
 int Anonymization_API init(IN const char* modelPathDir_c_str, IN RecognizeType recognizeType, OUT AnonymizationHandle *handle) {
     if (modelPathDir_c_str == nullptr || handle == nullptr) {
         log_error("init: Invalid parameter (modelPathDir or handle is NULL).");
@@ -141,6 +177,11 @@ int Anonymization_API init(IN const char* modelPathDir_c_str, IN RecognizeType r
         return INTERNAL_ERROR;
     }
 
+    static std::atomic<int> nextId(0);
+    context->id = ++nextId;
+    context->recognizeType = recognizeType;
+    context->model.set_perf_counters(&context->perf);
+
     *handle = context.release(); // 转移所有权给调用者
     log_info("init: SDK initialized successfully. Handle: %p", static_cast<void*>(*handle));
     return ANO_OK;
@@ -175,16 +216,56 @@ int Anonymization_API image_anonymization(IN AnonymizationHandle handle,
                                           IN const char* inputFile,
                                           OUT const char* outputFile,
                                           IN BlurType blurType) {
+    return image_anonymization_ex(handle, inputFile, outputFile, blurType, nullptr);
+}
+
+void Anonymization_API init_image_options(OUT ImageOptions *options) {
+    if (options == nullptr) return;
+    memset(options, 0, sizeof(*options));
+    options->tileMode = 0;
+    options->tileThresholdMP = 64;
+    options->tileSize = 1024;
+    options->tileOverlap = 128;
+    options->memoryLimitMB = 256;
+    options->jpegQuality = 0;
+}
+
+int Anonymization_API image_anonymization_ex(IN AnonymizationHandle handle,
+                                             IN const char* inputFile,
+                                             OUT const char* outputFile,
+                                             IN BlurType blurType,
+                                             IN const ImageOptions *options) {
     if (!isValidHandle(handle)) return HANDLE_INVALID;
     if (inputFile == nullptr || outputFile == nullptr) {
         log_error("image_anonymization: inputFile or outputFile is NULL.");
         return INVALID_PARAMETER;
     }
+    ImageOptions opts;
+    init_image_options(&opts);
+    if (options != nullptr) opts = *options;
+    if (opts.tileMode < -1 || opts.tileMode > 1 || opts.tileThresholdMP < 0 || opts.tileSize < 64 || opts.tileOverlap < 0
+        || opts.tileOverlap >= opts.tileSize || opts.memoryLimitMB <= 0 || opts.jpegQuality < 0 || opts.jpegQuality > 100) {
+        log_error("image_anonymization: Invalid tileMode (%d), tileThresholdMP (%d), tileSize (%d), tileOverlap (%d), memoryLimitMB (%d) or jpegQuality (%d).",
+                  opts.tileMode, opts.tileThresholdMP, opts.tileSize, opts.tileOverlap, opts.memoryLimitMB, opts.jpegQuality);
+        return INVALID_PARAMETER;
+    }
     AnonymizationContext* context = static_cast<AnonymizationContext*>(handle);
     log_info("image_anonymization: Processing file '%s' to '%s', blur type: %d", inputFile, outputFile, static_cast<int>(blurType));
+    PerfTimer total(&context->perf, PERF_STAGE_IMAGE_TOTAL);
+
+    // 超大图像按条带流式处理，不适用时回到整图路径
+    int tiledResult = tiled_image_anonymization(context->model, inputFile, outputFile, blurType, opts);
+    if (tiledResult != UNSUPPORTED_FORMAT) return tiledResult;
+
+#ifdef ANONYMIZATION_WITH_LIBJPEG
+    // JPEG 输入先走缩小解码的快速路径，不适用时回到通用路径
+    int fastResult = jpeg_image_anonymization(context->model, inputFile, outputFile, blurType);
+    if (fastResult != UNSUPPORTED_FORMAT) return fastResult;
+#endif
 
     cv::Mat frame;
     try {
+        PerfTimer timer(&context->perf, PERF_STAGE_DECODE);
         frame = cv::imread(inputFile, cv::IMREAD_COLOR);
     } catch (const cv::Exception& e) {
         log_error("image_anonymization: OpenCV exception during imread for '%s': %s", inputFile, e.what());
@@ -209,6 +290,7 @@ int Anonymization_API image_anonymization(IN AnonymizationHandle handle,
 
     bool result = false;
     try {
+        PerfTimer timer(&context->perf, PERF_STAGE_ENCODE);
         result = cv::imwrite(outputFile, frame);
     } catch (const cv::Exception& e) {
         log_error("image_anonymization: OpenCV exception during imwrite for '%s': %s", outputFile, e.what());
@@ -224,125 +306,284 @@ int Anonymization_API image_anonymization(IN AnonymizationHandle handle,
     }
 }
 
-int Anonymization_API mem_anonymization(IN AnonymizationHandle handle,
-                                      IN_OUT ImageFrame *image,
-                                      IN BlurType blurType) {
+void Anonymization_API init_encode_options(OUT EncodeOptions *options) {
+    if (options == nullptr) return;
+    memset(options, 0, sizeof(*options));
+    options->format = ENCODED_FORMAT_SAME;
+    options->quality = 0;
+}
+
+namespace {
+
+// 按文件头识别编码格式，无法识别时返回 ENCODED_FORMAT_SAME
+EncodedFormat sniff_encoded_format(const uint8_t* data, size_t size) {
+    if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF) return ENCODED_FORMAT_JPEG;
+    if (size >= 8 && memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0) return ENCODED_FORMAT_PNG;
+    if (size >= 12 && memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WEBP", 4) == 0) return ENCODED_FORMAT_WEBP;
+    return ENCODED_FORMAT_SAME;
+}
+
+// 结果写入调用者缓冲区，或在 *output 为 NULL 时分配新缓冲区
+int deliver_buffer(const std::vector<uint8_t>& encoded, uint8_t** output, size_t* outputSize) {
+    if (*output != nullptr) {
+        const size_t capacity = *outputSize;
+        *outputSize = encoded.size();
+        if (capacity < encoded.size()) {
+            log_error("buffer_anonymization: Output buffer too small (%zu < %zu bytes).", capacity, encoded.size());
+            return BUFFER_TOO_SMALL;
+        }
+    } else {
+        *output = static_cast<uint8_t*>(malloc(std::max<size_t>(encoded.size(), 1)));
+        if (*output == nullptr) return MEMORY_ALLOCATION_ERROR;
+        *outputSize = encoded.size();
+    }
+    if (!encoded.empty()) memcpy(*output, encoded.data(), encoded.size());
+    return ANO_OK;
+}
+
+} // namespace
+
+int Anonymization_API buffer_anonymization(IN AnonymizationHandle handle,
+                                           IN const uint8_t *input,
+                                           IN size_t inputSize,
+                                           IN BlurType blurType,
+                                           IN const EncodeOptions *options,
+                                           IN_OUT uint8_t **output,
+                                           IN_OUT size_t *outputSize) {
     if (!isValidHandle(handle)) return HANDLE_INVALID;
-    if (image == nullptr || image->data[0] == nullptr) {
-        log_error("mem_anonymization: Invalid parameter - image or image->data[0] is NULL.");
+    if (input == nullptr || inputSize == 0 || output == nullptr || outputSize == nullptr) {
+        log_error("buffer_anonymization: Invalid parameter (input=%p, size=%zu, output=%p, outputSize=%p).",
+                  static_cast<const void*>(input), inputSize, static_cast<void*>(output), static_cast<void*>(outputSize));
         return INVALID_PARAMETER;
     }
-    if (image->width <= 0 || image->height <= 0) {
-        log_error("mem_anonymization: Invalid image dimensions (width=%d, height=%d).", image->width, image->height);
+    // 解码时把输入包装成 1 行的 cv::Mat，列数是 int
+    if (inputSize > static_cast<size_t>(INT_MAX)) {
+        log_error("buffer_anonymization: Input of %zu bytes exceeds the %d byte limit.", inputSize, INT_MAX);
+        return INVALID_PARAMETER;
+    }
+    EncodeOptions opts;
+    init_encode_options(&opts);
+    if (options != nullptr) opts = *options;
+    if (opts.quality < 0 || opts.quality > 100 || opts.format < ENCODED_FORMAT_SAME || opts.format > ENCODED_FORMAT_WEBP) {
+        log_error("buffer_anonymization: Invalid format (%d) or quality (%d).", static_cast<int>(opts.format), opts.quality);
         return INVALID_PARAMETER;
     }
     AnonymizationContext* context = static_cast<AnonymizationContext*>(handle);
-    log_debug("mem_anonymization: Input image format: %d, WxH: %dx%d, blur: %d",
-              static_cast<int>(image->format), image->width, image->height, static_cast<int>(blurType));
+    const EncodedFormat inputFormat = sniff_encoded_format(input, inputSize);
+    EncodedFormat format = opts.format;
+    if (format == ENCODED_FORMAT_SAME) format = inputFormat == ENCODED_FORMAT_SAME ? ENCODED_FORMAT_PNG : inputFormat;
 
-    cv::Mat frame_bgr; // The goal is to convert any input format to BGR for the model.
+    std::vector<uint8_t> encoded;
+    cv::Mat frame;
+#ifdef ANONYMIZATION_WITH_LIBJPEG
+    // 指定了质量时需要按新的量化表重新编码，只有默认质量才能保留原系数
+    if (inputFormat == ENCODED_FORMAT_JPEG) {
+        int ret = jpeg_anonymize_buffer(context->model, input, inputSize, blurType,
+                                        format == ENCODED_FORMAT_JPEG && opts.quality == 0, encoded, frame);
+        if (ret != ANO_OK && ret != UNSUPPORTED_FORMAT) return ret;
+    }
+#endif
+    if (encoded.empty() && frame.empty()) {
+        try {
+            PerfTimer timer(&context->perf, PERF_STAGE_DECODE);
+            frame = cv::imdecode(cv::Mat(1, static_cast<int>(inputSize), CV_8UC1, const_cast<uint8_t*>(input)), cv::IMREAD_COLOR);
+        } catch (const cv::Exception& e) {
+            log_error("buffer_anonymization: OpenCV exception during imdecode: %s", e.what());
+            return LOAD_IMAGE_ERROR;
+        }
+        if (frame.empty()) {
+            log_error("buffer_anonymization: Failed to decode %zu input bytes.", inputSize);
+            return LOAD_IMAGE_ERROR;
+        }
+        try {
+            context->model.detect(frame, blurType);
+        } catch (const std::exception& e) {
+            log_error("buffer_anonymization: Exception during model detection: %s", e.what());
+            return INTERNAL_ERROR;
+        }
+    }
+    if (encoded.empty()) {
+        const char* ext = format == ENCODED_FORMAT_JPEG ? ".jpg" : format == ENCODED_FORMAT_WEBP ? ".webp" : ".png";
+        std::vector<int> params;
+        if (opts.quality > 0 && format != ENCODED_FORMAT_PNG) {
+            params.push_back(format == ENCODED_FORMAT_JPEG ? cv::IMWRITE_JPEG_QUALITY : cv::IMWRITE_WEBP_QUALITY);
+            params.push_back(opts.quality);
+        }
+        bool ok = false;
+        try {
+            PerfTimer timer(&context->perf, PERF_STAGE_ENCODE);
+            ok = cv::imencode(ext, frame, encoded, params);
+        } catch (const cv::Exception& e) {
+            log_error("buffer_anonymization: OpenCV exception during imencode: %s", e.what());
+        }
+        if (!ok) {
+            log_error("buffer_anonymization: Failed to encode output as '%s'.", ext);
+            return SAVE_IMAGE_ERROR;
+        }
+    }
+    log_debug("buffer_anonymization: %zu bytes in, %zu bytes out.", inputSize, encoded.size());
+    return deliver_buffer(encoded, output, outputSize);
+}
 
-    // --- Convert ImageFrame To cv::Mat (BGR) ---
-    switch (image->format) {
-        case IMG_FORMAT_BGR:
-            if (image->strides[0] < image->width * 3) {
-                log_error("mem_anonymization: BGR stride[0] (%d) is less than width*channels (%d).", image->strides[0], image->width * 3);
-                return INVALID_PARAMETER;
-            }
-            frame_bgr = cv::Mat(image->height, image->width, CV_8UC3, image->data[0], image->strides[0]);
-            break;
+void Anonymization_API free_buffer(IN uint8_t *buffer) {
+    free(buffer);
+}
 
-        case IMG_FORMAT_RGB: // New case
-            if (image->strides[0] < image->width * 3) {
-                log_error("mem_anonymization: RGB stride[0] (%d) is less than width*channels (%d).", image->strides[0], image->width * 3);
-                return INVALID_PARAMETER;
-            }
-            {
-                cv::Mat rgbMat(image->height, image->width, CV_8UC3, image->data[0], image->strides[0]);
-                cv::cvtColor(rgbMat, frame_bgr, cv::COLOR_RGB2BGR);
-            }
-            break;
+void Anonymization_API init_batch_options(OUT BatchOptions *options) {
+    if (options == nullptr) return;
+    memset(options, 0, sizeof(*options));
+    options->blurType = BLUR_TYPE_GAUSSIAN;
+    options->workers = 0;
+    options->detectors = 2;
+    options->maxBatchSize = 4;
+    options->jpegQuality = 0;
+}
 
-        case IMG_FORMAT_ARGB:
-            if (image->strides[0] < image->width * 4) {
-                log_error("mem_anonymization: ARGB stride[0] (%d) is less than width*channels (%d).", image->strides[0], image->width * 4);
-                return INVALID_PARAMETER;
-            }
-            {
-                cv::Mat bgraMat(image->height, image->width, CV_8UC4, image->data[0], image->strides[0]);
-                if (bgraMat.empty()) {
-                    log_error("mem_anonymization: Failed to create BGRA cv::Mat from ImageFrame.");
-                    return LOAD_IMAGE_ERROR;
-                }
-                cv::cvtColor(bgraMat, frame_bgr, cv::COLOR_BGRA2BGR);
-            }
-            break;
+namespace {
 
-        case IMG_FORMAT_GRAY: // New case
-            if (image->strides[0] < image->width) {
-                log_error("mem_anonymization: GRAY stride[0] (%d) is less than width (%d).", image->strides[0], image->width);
-                return INVALID_PARAMETER;
-            }
-            {
-                cv::Mat grayMat(image->height, image->width, CV_8UC1, image->data[0], image->strides[0]);
-                cv::cvtColor(grayMat, frame_bgr, cv::COLOR_GRAY2BGR);
-            }
-            break;
+int resolve_batch_options(const BatchOptions *options, BatchOptions& opts) {
+    init_batch_options(&opts);
+    if (options != nullptr) opts = *options;
+    if (opts.workers == 0) opts.workers = static_cast<int32_t>(std::max(1u, std::thread::hardware_concurrency()));
+    if (opts.workers < 0 || opts.detectors <= 0 || opts.maxBatchSize <= 0 || opts.jpegQuality < 0 || opts.jpegQuality > 100) {
+        log_error("batch_image_anonymization: Invalid workers (%d), detectors (%d), maxBatchSize (%d) or jpegQuality (%d).",
+                  opts.workers, opts.detectors, opts.maxBatchSize, opts.jpegQuality);
+        return INVALID_PARAMETER;
+    }
+    return ANO_OK;
+}
 
-        case IMG_FORMAT_YUV420P:
-            if (!image->data[0] || !image->data[1] || !image->data[2]) {
-                log_error("mem_anonymization: YUV420P data planes are not all valid.");
-                return INVALID_PARAMETER;
-            }
-            if (image->strides[0] < image->width || image->strides[1] < image->width / 2 || image->strides[2] < image->width / 2) {
-                log_error("mem_anonymization: YUV420P strides are invalid for the given width.");
-                return INVALID_PARAMETER;
-            }
-            {
-                cv::Mat yuvMat(image->height * 3 / 2, image->width, CV_8UC1);
-                uint8_t* dst_y = yuvMat.data;
-                uint8_t* dst_u = dst_y + static_cast<size_t>(image->height) * image->width;
-                uint8_t* dst_v = dst_u + static_cast<size_t>(image->height / 2) * (image->width / 2);
-                // Copy Y, U, and V planes row by row to handle custom strides
-                for (int r = 0; r < image->height; ++r) memcpy(dst_y + r * image->width, image->data[0] + r * image->strides[0], image->width);
-                for (int r = 0; r < image->height / 2; ++r) memcpy(dst_u + r * (image->width / 2), image->data[1] + r * image->strides[1], image->width / 2);
-                for (int r = 0; r < image->height / 2; ++r) memcpy(dst_v + r * (image->width / 2), image->data[2] + r * image->strides[2], image->width / 2);
-                cv::cvtColor(yuvMat, frame_bgr, cv::COLOR_YUV2BGR_I420);
-            }
-            break;
+} // namespace
 
-        case IMG_FORMAT_YUV420SP: { // New case (assuming NV12: Y plane, then interleaved UV plane)
-            if (!image->data[0] || !image->data[1]) {
-                log_error("mem_anonymization: YUV420SP data planes are not valid.");
-                return INVALID_PARAMETER;
-            }
-            if (image->strides[0] < image->width || image->strides[1] < image->width) { // UV stride is usually width
-                log_error("mem_anonymization: YUV420SP strides are invalid for the given width.");
-                return INVALID_PARAMETER;
-            }
-            cv::Mat yuvMat(image->height * 3 / 2, image->width, CV_8UC1);
-            // Copy Y plane
-            for (int r = 0; r < image->height; ++r) {
-                memcpy(yuvMat.data + r * image->width, image->data[0] + r * image->strides[0], image->width);
-            }
-            // Copy interleaved UV plane
-            uint8_t* dst_uv = yuvMat.data + static_cast<size_t>(image->height) * image->width;
-            for (int r = 0; r < image->height / 2; ++r) {
-                memcpy(dst_uv + r * image->width, image->data[1] + r * image->strides[1], image->width);
-            }
-            cv::cvtColor(yuvMat, frame_bgr, cv::COLOR_YUV2BGR_NV12);
-            break;
+int Anonymization_API batch_image_anonymization(IN AnonymizationHandle handle,
+                                                IN const char* const* inputFiles,
+                                                IN const char* const* outputFiles,
+                                                IN int32_t count,
+                                                IN const BatchOptions *options,
+                                                OUT BatchFileResult *results,
+                                                OUT int32_t *failed) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    if (count < 0 || (count > 0 && (inputFiles == nullptr || outputFiles == nullptr))) {
+        log_error("batch_image_anonymization: Invalid file lists (count=%d).", count);
+        return INVALID_PARAMETER;
+    }
+    BatchOptions opts;
+    int ret = resolve_batch_options(options, opts);
+    if (ret != ANO_OK) return ret;
+
+    std::vector<std::string> inputs, outputs;
+    for (int32_t i = 0; i < count; ++i) {
+        if (inputFiles[i] == nullptr || outputFiles[i] == nullptr) {
+            log_error("batch_image_anonymization: File path %d is NULL.", i);
+            return INVALID_PARAMETER;
         }
+        inputs.push_back(inputFiles[i]);
+        outputs.push_back(outputFiles[i]);
+    }
 
-        default:
-            log_error("mem_anonymization: Unsupported input image format: %d", static_cast<int>(image->format));
-            return UNSUPPORTED_FORMAT;
+    AnonymizationContext* context = static_cast<AnonymizationContext*>(handle);
+    std::vector<BatchFileResult> fileResults;
+    ret = run_image_batch(context->model, inputs, outputs, opts, fileResults);
+    if (ret != ANO_OK) return ret;
+    int32_t failures = 0;
+    for (int32_t i = 0; i < count; ++i) {
+        if (fileResults[i].result != ANO_OK) failures++;
+        if (results != nullptr) results[i] = fileResults[i];
+    }
+    if (failed != nullptr) *failed = failures;
+    return ANO_OK;
+}
+
+int Anonymization_API directory_image_anonymization(IN AnonymizationHandle handle,
+                                                    IN const char* inputDir,
+                                                    IN const char* patterns,
+                                                    IN const char* outputDir,
+                                                    IN const BatchOptions *options,
+                                                    IN const char* reportFile,
+                                                    OUT int32_t *total,
+                                                    OUT int32_t *failed) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    if (inputDir == nullptr || outputDir == nullptr) {
+        log_error("directory_image_anonymization: inputDir or outputDir is NULL.");
+        return INVALID_PARAMETER;
     }
+    BatchOptions opts;
+    int ret = resolve_batch_options(options, opts);
+    if (ret != ANO_OK) return ret;
 
-    if (frame_bgr.empty()) {
-        log_error("mem_anonymization: Failed to convert ImageFrame to BGR cv::Mat. Input format was %d.", static_cast<int>(image->format));
+    std::vector<std::string> names;
+    if (!list_directory_images(inputDir, patterns != nullptr ? patterns : "*.jpg;*.jpeg;*.png;*.bmp;*.webp;*.tif;*.tiff", names))
         return LOAD_IMAGE_ERROR;
+    if (mkdir(outputDir, 0755) != 0 && errno != EEXIST) {
+        log_error("directory_image_anonymization: Cannot create output directory '%s'.", outputDir);
+        return SAVE_IMAGE_ERROR;
+    }
+    // 输出目录与输入目录相同（含符号链接、相对路径）时会原地覆盖原图，拒绝处理
+    char* inputReal = realpath(inputDir, nullptr);
+    char* outputReal = realpath(outputDir, nullptr);
+    const bool sameDir = inputReal != nullptr && outputReal != nullptr && strcmp(inputReal, outputReal) == 0;
+    free(inputReal);
+    free(outputReal);
+    if (sameDir) {
+        log_error("directory_image_anonymization: outputDir '%s' is the input directory '%s', originals would be overwritten.", outputDir, inputDir);
+        return INVALID_PARAMETER;
+    }
+    std::vector<std::string> inputs, outputs;
+    for (const std::string& name : names) {
+        inputs.push_back(std::string(inputDir) + "/" + name);
+        outputs.push_back(std::string(outputDir) + "/" + name);
+    }
+    log_info("directory_image_anonymization: %zu files matched in '%s', writing to '%s'.", names.size(), inputDir, outputDir);
+
+    AnonymizationContext* context = static_cast<AnonymizationContext*>(handle);
+    std::vector<BatchFileResult> fileResults;
+    ret = run_image_batch(context->model, inputs, outputs, opts, fileResults);
+    if (ret != ANO_OK) return ret;
+
+    int32_t failures = 0;
+    for (const BatchFileResult& r : fileResults) {
+        if (r.result != ANO_OK) failures++;
+    }
+    if (total != nullptr) *total = static_cast<int32_t>(names.size());
+    if (failed != nullptr) *failed = failures;
+
+    if (reportFile != nullptr) {
+        std::ofstream report(reportFile);
+        if (!report) {
+            log_error("directory_image_anonymization: Cannot write report '%s'.", reportFile);
+            return SAVE_IMAGE_ERROR;
+        }
+        report << "file\tresult\tboxes\telapsed_ms\n";
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            report << inputs[i] << '\t' << fileResults[i].result << '\t' << fileResults[i].boxCount << '\t'
+                   << fileResults[i].elapsedMs << '\n';
+        }
     }
+    return ANO_OK;
+}
+
+int Anonymization_API mem_anonymization(IN AnonymizationHandle handle,
+                                      IN_OUT ImageFrame *image,
+                                      IN BlurType blurType) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    if (image == nullptr || image->data[0] == nullptr) {
+        log_error("mem_anonymization: Invalid parameter - image or image->data[0] is NULL.");
+        return INVALID_PARAMETER;
+    }
+    if (image->width <= 0 || image->height <= 0) {
+        log_error("mem_anonymization: Invalid image dimensions (width=%d, height=%d).", image->width, image->height);
+        return INVALID_PARAMETER;
+    }
+    AnonymizationContext* context = static_cast<AnonymizationContext*>(handle);
+    log_debug("mem_anonymization: Input image format: %d, WxH: %dx%d, blur: %d",
+              static_cast<int>(image->format), image->width, image->height, static_cast<int>(blurType));
+
+    PerfTimer total(&context->perf, PERF_STAGE_MEM_TOTAL);
+    cv::Mat frame_bgr; // The goal is to convert any input format to BGR for the model.
+    PerfTimer convert(&context->perf, PERF_STAGE_CONVERT);
+    int ret = image_frame_to_bgr(image, frame_bgr);
+    convert.stop();
+    if (ret != ANO_OK) return ret;
 
     try {
         context->model.detect(frame_bgr, blurType); // Use the model from the context
@@ -355,241 +596,593 @@ int Anonymization_API mem_anonymization(IN AnonymizationHandle handle,
     }
 
     // --- Convert Processed cv::Mat (BGR) Back to Original ImageFrame Format ---
-    switch (image->format) {
-        case IMG_FORMAT_BGR:
-            if (static_cast<int>(frame_bgr.step[0]) != image->strides[0] || frame_bgr.data != image->data[0]) {
-                if (image->strides[0] < frame_bgr.cols * frame_bgr.channels()) return -2; // SAVE_IMAGE_ERROR
-                for (int i = 0; i < frame_bgr.rows; ++i) {
-                    memcpy(image->data[0] + i * image->strides[0], frame_bgr.data + i * frame_bgr.step[0], static_cast<size_t>(frame_bgr.cols) * frame_bgr.channels());
-                }
-            }
-            break;
-
-        case IMG_FORMAT_RGB: { // New case
-            cv::Mat rgbImage;
-            cv::cvtColor(frame_bgr, rgbImage, cv::COLOR_BGR2RGB);
-            if (image->strides[0] < rgbImage.cols * rgbImage.channels()) return -2; // SAVE_IMAGE_ERROR
-            for (int i = 0; i < rgbImage.rows; ++i) {
-                memcpy(image->data[0] + i * image->strides[0], rgbImage.data + i * rgbImage.step[0], static_cast<size_t>(rgbImage.cols) * rgbImage.channels());
-            }
-            break;
-        }
+    PerfTimer writeback(&context->perf, PERF_STAGE_WRITEBACK);
+    ret = bgr_to_image_frame(frame_bgr, image);
+    writeback.stop();
+    if (ret != ANO_OK) return ret;
 
-        case IMG_FORMAT_ARGB: {
-            cv::Mat bgraImage;
-            cv::cvtColor(frame_bgr, bgraImage, cv::COLOR_BGR2BGRA);
-            if (bgraImage.empty()) return -1; // INTERNAL_ERROR
-            if (image->strides[0] < bgraImage.cols * bgraImage.channels()) return -2; // SAVE_IMAGE_ERROR
-            for (int i = 0; i < bgraImage.rows; ++i) {
-                memcpy(image->data[0] + i * image->strides[0], bgraImage.data + i * bgraImage.step[0], static_cast<size_t>(bgraImage.cols) * bgraImage.channels());
-            }
-            break;
-        }
+    log_debug("mem_anonymization: In-memory processing complete.");
+    return ANO_OK;
+}
 
-        case IMG_FORMAT_GRAY: { // New case
-            cv::Mat grayImage;
-            cv::cvtColor(frame_bgr, grayImage, cv::COLOR_BGR2GRAY);
-            if (image->strides[0] < grayImage.cols) return -2; // SAVE_IMAGE_ERROR
-            for (int i = 0; i < grayImage.rows; ++i) {
-                memcpy(image->data[0] + i * image->strides[0], grayImage.data + i * grayImage.step[0], grayImage.cols);
-            }
-            break;
-        }
 
-        case IMG_FORMAT_YUV420P: {
-            cv::Mat yuv_I420_out;
-            cv::cvtColor(frame_bgr, yuv_I420_out, cv::COLOR_BGR2YUV_I420);
-            if (yuv_I420_out.empty()) return -1; // INTERNAL_ERROR
-            uint8_t* src_y = yuv_I420_out.data;
-            uint8_t* src_u = src_y + static_cast<size_t>(image->width) * image->height;
-            int chroma_w = image->width / 2;
-            int chroma_h = image->height / 2;
-            uint8_t* src_v = src_u + static_cast<size_t>(chroma_w) * chroma_h;
-            if (image->strides[0] < image->width || image->strides[1] < chroma_w || image->strides[2] < chroma_w) return -2; // SAVE_IMAGE_ERROR
-            // Copy Y, U, and V planes back to the ImageFrame buffers
-            for (int r = 0; r < image->height; ++r) memcpy(image->data[0] + r * image->strides[0], src_y + r * image->width, image->width);
-            for (int r = 0; r < chroma_h; ++r) memcpy(image->data[1] + r * image->strides[1], src_u + r * chroma_w, chroma_w);
-            for (int r = 0; r < chroma_h; ++r) memcpy(image->data[2] + r * image->strides[2], src_v + r * chroma_w, chroma_w);
-            break;
+int Anonymization_API set_roi_regions(IN AnonymizationHandle handle,
+                                      IN const RoiRegion *regions,
+                                      IN int32_t count) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    if (count < 0 || (count > 0 && regions == nullptr)) {
+        log_error("set_roi_regions: Invalid parameter (regions=%p, count=%d).", static_cast<const void*>(regions), count);
+        return INVALID_PARAMETER;
+    }
+    std::vector<std::vector<cv::Point2f>> include, exclude;
+    for (int32_t i = 0; i < count; ++i) {
+        const RoiRegion& region = regions[i];
+        if (region.pointCount < 3 || region.points == nullptr ||
+            (region.type != ROI_INCLUDE && region.type != ROI_EXCLUDE)) {
+            log_error("set_roi_regions: Invalid region %d (type=%d, pointCount=%d).", i, static_cast<int>(region.type), region.pointCount);
+            return INVALID_PARAMETER;
         }
-
-        case IMG_FORMAT_YUV420SP: { // New case (assuming NV12)
-            cv::Mat yuv_NV12_out;
-            // OpenCV doesn't have a direct BGR to NV12. A common way is BGR -> I420 -> NV12.
-            cv::Mat yuv_I420_temp;
-            cv::cvtColor(frame_bgr, yuv_I420_temp, cv::COLOR_BGR2YUV_I420);
-            if (yuv_I420_temp.empty()) return -1; // INTERNAL_ERROR
-
-            // Copy Y plane directly
-            uint8_t* src_y = yuv_I420_temp.data;
-             if (image->strides[0] < image->width) return -2; // SAVE_IMAGE_ERROR
-            for (int r = 0; r < image->height; ++r) {
-                memcpy(image->data[0] + r * image->strides[0], src_y + r * image->width, image->width);
-            }
-
-            // Interleave U and V planes into the UV plane of the ImageFrame
-            uint8_t* src_u = src_y + static_cast<size_t>(image->width) * image->height;
-            int chroma_w = image->width / 2;
-            int chroma_h = image->height / 2;
-            uint8_t* src_v = src_u + static_cast<size_t>(chroma_w) * chroma_h;
-            if (image->strides[1] < image->width) return -2; // SAVE_IMAGE_ERROR
-            for (int r = 0; r < chroma_h; ++r) {
-                uint8_t* dst_uv_row = image->data[1] + r * image->strides[1];
-                const uint8_t* src_u_row = src_u + r * chroma_w;
-                const uint8_t* src_v_row = src_v + r * chroma_w;
-                for (int c = 0; c < chroma_w; ++c) {
-                    dst_uv_row[c * 2] = src_u_row[c];     // U
-                    dst_uv_row[c * 2 + 1] = src_v_row[c]; // V
-                }
+        std::vector<cv::Point2f> poly;
+        poly.reserve(region.pointCount);
+        for (int32_t j = 0; j < region.pointCount; ++j) {
+            float x = region.points[j].x, y = region.points[j].y;
+            if (!(x >= 0.f && x <= 1.f && y >= 0.f && y <= 1.f)) {
+                log_error("set_roi_regions: Region %d point %d (%.3f, %.3f) is outside [0,1].", i, j, x, y);
+                return INVALID_PARAMETER;
             }
-            break;
+            poly.push_back(cv::Point2f(x, y));
         }
-
-        default:
-            log_error("mem_anonymization: Unsupported output format: %d", static_cast<int>(image->format));
-            return UNSUPPORTED_FORMAT;
+        (region.type == ROI_INCLUDE ? include : exclude).push_back(poly);
     }
-
-    log_debug("mem_anonymization: In-memory processing complete.");
+    AnonymizationContext* context = static_cast<AnonymizationContext*>(handle);
+    context->model.set_roi(include, exclude);
+    log_info("set_roi_regions: %zu include / %zu exclude regions set.", include.size(), exclude.size());
     return ANO_OK;
 }
 
+void Anonymization_API init_video_options(OUT VideoOptions *options) {
+    if (options == nullptr) return;
+    memset(options, 0, sizeof(*options));
+    options->detectInterval = 1;
+    options->sceneCutThreshold = 0.4f;
+    options->backend = VIDEO_BACKEND_AUTO;
+    options->codec = VIDEO_CODEC_AUTO;
+    options->decodeThreads = 0;
+    options->encodeThreads = 0;
+    options->crf = 23;
+    strncpy(options->preset, "veryfast", sizeof(options->preset) - 1);
+    options->copyAudio = 1;
+    options->gopPassthrough = 0;
+    options->segmentWorkers = 0;
+    options->segmentOverlapFrames = 0;
+    options->checkpointIntervalSec = 0;
+    options->progressCallback = nullptr;
+    options->progressUserData = nullptr;
+    options->progressIntervalMs = 500;
+    options->cancelFlag = nullptr;
+}
 
 int Anonymization_API video_anonymization(IN AnonymizationHandle handle,
                                           IN const char* inputFile,
                                           OUT const char* outputFile,
                                           IN BlurType blurType) {
+    return video_anonymization_ex(handle, inputFile, outputFile, blurType, nullptr);
+}
+
+namespace {
+
+// video_anonymization_ex / video_anonymization_resume 以及旁路文件检测、回放的公共实现
+int run_video_job(AnonymizationHandle handle, const char* inputFile, const char* outputFile,
+                  BlurType blurType, const VideoOptions* options, bool resume,
+                  const VideoSidecar& sidecar = VideoSidecar()) {
     if (!isValidHandle(handle)) return HANDLE_INVALID;
     if (inputFile == nullptr || outputFile == nullptr) {
         log_error("video_anonymization: inputFile or outputFile is NULL.");
         return INVALID_PARAMETER;
     }
+    VideoOptions opts;
+    init_video_options(&opts);
+    if (options != nullptr) opts = *options;
+    if (opts.detectInterval <= 0) {
+        log_error("video_anonymization: Invalid detectInterval: %d", opts.detectInterval);
+        return INVALID_PARAMETER;
+    }
     AnonymizationContext* context = static_cast<AnonymizationContext*>(handle);
-    log_info("video_anonymization: Processing video '%s' to '%s', blur type: %d", inputFile, outputFile, static_cast<int>(blurType));
+    log_info("video_anonymization: Processing video '%s' to '%s', blur type: %d, detect interval: %d, scene cut threshold: %.2f",
+             inputFile, outputFile, static_cast<int>(blurType), opts.detectInterval, opts.sceneCutThreshold);
+    context->sceneCuts.clear();
+    PerfTimer total(&context->perf, PERF_STAGE_VIDEO_TOTAL);
+
+    VideoBackend backend = opts.backend;
+    if (backend == VIDEO_BACKEND_AUTO) {
+#ifdef ANONYMIZATION_WITH_FFMPEG
+        backend = VIDEO_BACKEND_FFMPEG;
+#else
+        backend = VIDEO_BACKEND_OPENCV;
+#endif
+    }
 
-    cv::VideoCapture videoCapture;
-    try {
-        if (!videoCapture.open(inputFile)) {
-            log_error("video_anonymization: Failed to open input video: %s", inputFile);
-            return LOAD_VIDEO_ERROR;
+    VideoJobResult result;
+    VideoProgressReporter progress(opts);
+    int ret = ANO_OK;
+    const bool sidecarPass = sidecar.record != nullptr || sidecar.replay != nullptr;
+    if (backend == VIDEO_BACKEND_FFMPEG) {
+#ifdef ANONYMIZATION_WITH_FFMPEG
+        if (sidecarPass) {
+            if (opts.gopPassthrough || opts.segmentWorkers > 1 || opts.checkpointIntervalSec > 0)
+                log_warn("video_anonymization: GOP passthrough, segment workers and checkpoints are ignored for sidecar passes.");
+            ret = run_video_ffmpeg(context->model, inputFile, outputFile, blurType, opts, progress, result, sidecar);
+        } else if (opts.gopPassthrough && !resume) {
+            if (opts.segmentWorkers > 1 || opts.checkpointIntervalSec > 0)
+                log_warn("video_anonymization: Segment workers and checkpoints are ignored in GOP passthrough mode.");
+            ret = run_video_ffmpeg_passthrough(context->model, inputFile, outputFile, blurType, opts, progress, result);
+        } else if (resume || opts.segmentWorkers > 1 || opts.checkpointIntervalSec > 0) {
+            ret = run_video_ffmpeg_segmented(context->model, inputFile, outputFile, blurType, opts, resume, progress, result);
+        } else {
+            ret = run_video_ffmpeg(context->model, inputFile, outputFile, blurType, opts, progress, result);
         }
-    } catch (const cv::Exception& e) {
-        log_error("video_anonymization: OpenCV exception during video open for '%s': %s", inputFile, e.what());
-        return LOAD_VIDEO_ERROR;
+#else
+        log_error("video_anonymization: FFmpeg backend requested but the SDK was built without it (WITH_FFMPEG=1).");
+        return UNSUPPORTED_FORMAT;
+#endif
+    } else if (backend == VIDEO_BACKEND_OPENCV) {
+        if (resume) {
+            log_error("video_anonymization: Resume requires the FFmpeg backend.");
+            return INVALID_PARAMETER;
+        }
+        if (opts.checkpointIntervalSec > 0) log_warn("video_anonymization: Checkpoints require the FFmpeg backend, ignored.");
+        if (opts.gopPassthrough) log_warn("video_anonymization: GOP passthrough requires the FFmpeg backend, ignored.");
+        if (opts.segmentWorkers > 1) log_warn("video_anonymization: Segment workers require the FFmpeg backend, ignored.");
+        ret = run_video_opencv(context->model, inputFile, outputFile, blurType, opts, progress, result, sidecar);
+    } else {
+        log_error("video_anonymization: Invalid backend: %d", static_cast<int>(opts.backend));
+        return INVALID_PARAMETER;
     }
+    context->sceneCuts.swap(result.sceneCuts);
+    return ret;
+}
 
+} // end anonymous namespace
 
-    int frameWidth = static_cast<int>(videoCapture.get(cv::CAP_PROP_FRAME_WIDTH));
-    int frameHeight = static_cast<int>(videoCapture.get(cv::CAP_PROP_FRAME_HEIGHT));
-    double fps = videoCapture.get(cv::CAP_PROP_FPS);
-    int inputFourcc = static_cast<int>(videoCapture.get(cv::CAP_PROP_FOURCC));
-    long long totalFrames = static_cast<long long>(videoCapture.get(cv::CAP_PROP_FRAME_COUNT));
+int Anonymization_API video_anonymization_ex(IN AnonymizationHandle handle,
+                                             IN const char* inputFile,
+                                             OUT const char* outputFile,
+                                             IN BlurType blurType,
+                                             IN const VideoOptions *options) {
+    return run_video_job(handle, inputFile, outputFile, blurType, options, false);
+}
 
+int Anonymization_API video_anonymization_resume(IN AnonymizationHandle handle,
+                                                 IN const char* inputFile,
+                                                 OUT const char* outputFile,
+                                                 IN BlurType blurType,
+                                                 IN const VideoOptions *options) {
+    return run_video_job(handle, inputFile, outputFile, blurType, options, true);
+}
 
-    char fourcc_str[5] = {0};
-    memcpy(fourcc_str, &inputFourcc, 4);
-    log_info("video_anonymization: Input video props - W:%d, H:%d, FPS:%.2f, FourCC:%s, TotalFrames:%lld (approx)",
-             frameWidth, frameHeight, fps, fourcc_str, totalFrames > 0 ? totalFrames : -1);
 
-    if (frameWidth <= 0 || frameHeight <= 0 || fps <= 0) {
-        log_error("video_anonymization: Invalid video properties from input file '%s'. W:%d, H:%d, FPS:%.2f",
-                  inputFile, frameWidth, frameHeight, fps);
-        videoCapture.release();
-        return LOAD_VIDEO_ERROR;
+int Anonymization_API get_scene_cuts(IN AnonymizationHandle handle,
+                                     OUT double *timestampsMs,
+                                     IN int32_t capacity,
+                                     OUT int32_t *count) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    if (count == nullptr || capacity < 0 || (timestampsMs == nullptr && capacity > 0)) {
+        log_error("get_scene_cuts: Invalid parameter.");
+        return INVALID_PARAMETER;
     }
+    AnonymizationContext* context = static_cast<AnonymizationContext*>(handle);
+    *count = static_cast<int32_t>(context->sceneCuts.size());
+    int32_t n = std::min(capacity, *count);
+    for (int32_t i = 0; i < n; ++i) timestampsMs[i] = context->sceneCuts[i];
+    return ANO_OK;
+}
 
-    cv::VideoWriter videoWriter;
-    // 尝试使用原始 FourCC，如果失败，则回退到 XVID
-    int outputFourcc = inputFourcc;
-    if (!videoWriter.open(outputFile, outputFourcc, fps, cv::Size(frameWidth, frameHeight), true)) {
-        log_warn("video_anonymization: Failed to open VideoWriter with original FourCC '%s'. Trying XVID.", fourcc_str);
-        outputFourcc = cv::VideoWriter::fourcc('X', 'V', 'I', 'D'); // Common fallback
-        if (!videoWriter.open(outputFile, outputFourcc, fps, cv::Size(frameWidth, frameHeight), true)) {
-            log_error("video_anonymization: Failed to open VideoWriter for output file '%s' with FourCC XVID.", outputFile);
-            videoCapture.release();
-            return SAVE_VIDEO_ERROR;
-        }
-        log_info("video_anonymization: VideoWriter opened with fallback FourCC XVID for '%s'.", outputFile);
-    } else {
-        log_info("video_anonymization: VideoWriter opened with FourCC '%s' for '%s'.", fourcc_str, outputFile);
+namespace {
+
+const char* recognize_class_name(RecognizeType recognizeType) {
+    switch (recognizeType) {
+        case RECOGNIZE_LICENSE_PLATE: return "plate";
+        case RECOGNIZE_ALL: return "all";
+        default: return "face";
     }
+}
 
+int read_image(AnonymizationContext* context, const char* caller, const char* inputFile, cv::Mat& frame) {
+    try {
+        PerfTimer timer(&context->perf, PERF_STAGE_DECODE);
+        frame = cv::imread(inputFile, cv::IMREAD_COLOR);
+    } catch (const cv::Exception& e) {
+        log_error("%s: OpenCV exception during imread for '%s': %s", caller, inputFile, e.what());
+        return LOAD_IMAGE_ERROR;
+    }
+    if (frame.empty()) {
+        log_error("%s: Failed to load image from '%s'.", caller, inputFile);
+        return LOAD_IMAGE_ERROR;
+    }
+    return ANO_OK;
+}
+
+} // end anonymous namespace
 
+int Anonymization_API image_detect_to_sidecar(IN AnonymizationHandle handle,
+                                              IN const char* inputFile,
+                                              IN const char* sidecarFile) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    if (inputFile == nullptr || sidecarFile == nullptr) {
+        log_error("image_detect_to_sidecar: inputFile or sidecarFile is NULL.");
+        return INVALID_PARAMETER;
+    }
+    AnonymizationContext* context = static_cast<AnonymizationContext*>(handle);
+    PerfTimer total(&context->perf, PERF_STAGE_IMAGE_TOTAL);
     cv::Mat frame;
-    long long currentFrameCount = 0;
-    int processedFrames = 0;
-    const int logInterval = (totalFrames > 200 || totalFrames <= 0) ? 100 : (totalFrames / 2 > 0 ? totalFrames / 2 : 1) ; // 每 100 帧或总帧数的一半记录一次日志
+    int ret = read_image(context, "image_detect_to_sidecar", inputFile, frame);
+    if (ret != ANO_OK) return ret;
 
-    while (true) {
-        try {
-            if (!videoCapture.read(frame)) {
-                if (currentFrameCount < totalFrames && totalFrames > 0) { // 如果帧数少于预期
-                    log_warn("video_anonymization: Early end of stream. Expected %lld frames, read %lld.", totalFrames, currentFrameCount);
-                } else {
-                    log_info("video_anonymization: End of video stream after %lld frames.", currentFrameCount);
-                }
-                break;
-            }
-        } catch (const cv::Exception& e) {
-            log_error("video_anonymization: OpenCV exception during videoCapture.read(): %s. Processed %d frames.", e.what(), processedFrames);
-            break; // 发生读取错误则停止
-        }
+    std::vector<cv::Rect> boxes;
+    std::vector<float> confidences;
+    try {
+        context->model.detect_boxes(frame, boxes, confidences);
+    } catch (const std::exception& e) {
+        log_error("image_detect_to_sidecar: Exception during model detection: %s", e.what());
+        return INTERNAL_ERROR;
+    }
 
-        if (frame.empty()) { // 双重检查，以防 read 返回 true 但帧为空
-            log_warn("video_anonymization: videoCapture.read() returned true but frame is empty at frame %lld.", currentFrameCount);
-            break;
-        }
-        currentFrameCount++;
+    SidecarWriter writer;
+    if (!writer.open(sidecarFile, inputFile, recognize_class_name(context->recognizeType))) return SIDECAR_ERROR;
+    writer.write_header(frame.cols, frame.rows, 0);
+    writer.write_frame(0, 0, true, boxes, confidences);
+    if (!writer.close()) return SIDECAR_ERROR;
+    log_info("image_detect_to_sidecar: %zu boxes from '%s' written to '%s'.", boxes.size(), inputFile, sidecarFile);
+    return ANO_OK;
+}
 
-        try {
-            context->model.detect(frame, blurType);
-        } catch (const std::exception& e) {
-            log_error("video_anonymization: Exception during model detection on frame %lld: %s", currentFrameCount, e.what());
-            // 可以选择跳过此帧或中止处理
-            continue; // 跳过此帧
-        } catch (...) {
-            log_error("video_anonymization: Unknown exception during model detection on frame %lld.", currentFrameCount);
-            continue; // 跳过此帧
-        }
+int Anonymization_API image_redact_from_sidecar(IN AnonymizationHandle handle,
+                                                IN const char* inputFile,
+                                                IN const char* sidecarFile,
+                                                OUT const char* outputFile,
+                                                IN BlurType blurType) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    if (inputFile == nullptr || sidecarFile == nullptr || outputFile == nullptr) {
+        log_error("image_redact_from_sidecar: inputFile, sidecarFile or outputFile is NULL.");
+        return INVALID_PARAMETER;
+    }
+    AnonymizationContext* context = static_cast<AnonymizationContext*>(handle);
+    PerfTimer total(&context->perf, PERF_STAGE_IMAGE_TOTAL);
+    SidecarBoxes sidecar;
+    int ret = sidecar.load(sidecarFile);
+    if (ret != ANO_OK) return ret;
+    cv::Mat frame;
+    ret = read_image(context, "image_redact_from_sidecar", inputFile, frame);
+    if (ret != ANO_OK) return ret;
+    if (!sidecar.matches(frame.cols, frame.rows)) return SIDECAR_ERROR;
 
+    context->model.redact(frame, sidecar.boxes(0), blurType);
+    try {
+        PerfTimer timer(&context->perf, PERF_STAGE_ENCODE);
+        if (cv::imwrite(outputFile, frame)) return ANO_OK;
+    } catch (const cv::Exception& e) {
+        log_error("image_redact_from_sidecar: OpenCV exception during imwrite for '%s': %s", outputFile, e.what());
+        return SAVE_IMAGE_ERROR;
+    }
+    log_error("image_redact_from_sidecar: Failed to save image to '%s'.", outputFile);
+    return SAVE_IMAGE_ERROR;
+}
 
-        try {
-            videoWriter.write(frame);
-            processedFrames++;
-        } catch (const cv::Exception& e) {
-            log_error("video_anonymization: OpenCV exception during videoWriter.write() for frame %lld: %s", currentFrameCount, e.what());
-            // 写入失败，可能需要中止
-            break;
-        }
+int Anonymization_API video_detect_to_sidecar(IN AnonymizationHandle handle,
+                                              IN const char* inputFile,
+                                              IN const char* sidecarFile,
+                                              IN const VideoOptions *options) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    if (inputFile == nullptr || sidecarFile == nullptr) {
+        log_error("video_detect_to_sidecar: inputFile or sidecarFile is NULL.");
+        return INVALID_PARAMETER;
+    }
+    AnonymizationContext* context = static_cast<AnonymizationContext*>(handle);
+    SidecarWriter writer;
+    if (!writer.open(sidecarFile, inputFile, recognize_class_name(context->recognizeType))) return SIDECAR_ERROR;
+    VideoSidecar sidecar;
+    sidecar.record = &writer;
+    // 只检测时不打开输出，outputFile 仅用于日志
+    int ret = run_video_job(handle, inputFile, sidecarFile, BLUR_TYPE_NONE, options, false, sidecar);
+    if (!writer.close() && ret == ANO_OK) ret = SIDECAR_ERROR;
+    if (ret != ANO_OK) {
+        remove(sidecarFile);
+        return ret;
+    }
+    log_info("video_detect_to_sidecar: %lld frames with boxes from '%s' written to '%s'.", writer.frames_written(), inputFile, sidecarFile);
+    return ANO_OK;
+}
 
+int Anonymization_API video_redact_from_sidecar(IN AnonymizationHandle handle,
+                                                IN const char* inputFile,
+                                                IN const char* sidecarFile,
+                                                OUT const char* outputFile,
+                                                IN BlurType blurType,
+                                                IN const VideoOptions *options) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    if (sidecarFile == nullptr) {
+        log_error("video_redact_from_sidecar: sidecarFile is NULL.");
+        return INVALID_PARAMETER;
+    }
+    SidecarBoxes boxes;
+    int ret = boxes.load(sidecarFile);
+    if (ret != ANO_OK) return ret;
+    VideoSidecar sidecar;
+    sidecar.replay = &boxes;
+    return run_video_job(handle, inputFile, outputFile, blurType, options, false, sidecar);
+}
 
-        if (currentFrameCount % logInterval == 0) {
-             if (totalFrames > 0) {
-                log_info("video_anonymization: Processed %lld / %lld frames (%.2f%%)...", currentFrameCount, totalFrames, (static_cast<double>(currentFrameCount) / totalFrames) * 100.0);
-             } else {
-                log_info("video_anonymization: Processed %lld frames...", currentFrameCount);
-             }
-             std::cout << "已处理 " << currentFrameCount << " 帧" << std::endl;
-        }
+
+void Anonymization_API init_stream_options(OUT StreamOptions *options) {
+    if (options == nullptr) return;
+    memset(options, 0, sizeof(*options));
+    options->blurType = BLUR_TYPE_GAUSSIAN;
+    options->detectInterval = 1;
+    options->sceneCutThreshold = 0.4f;
+    options->maxQueueFrames = 4;
+    options->dropWhenFull = 0;
+    options->latencyTargetMs = 0.0f;
+}
+
+int Anonymization_API open_stream(IN AnonymizationHandle handle,
+                                  IN const StreamOptions *options,
+                                  OUT StreamHandle *stream) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    if (stream == nullptr) {
+        log_error("open_stream: stream is NULL.");
+        return INVALID_PARAMETER;
+    }
+    *stream = nullptr;
+    StreamOptions opts;
+    init_stream_options(&opts);
+    if (options != nullptr) opts = *options;
+    if (opts.detectInterval <= 0 || opts.maxQueueFrames <= 0) {
+        log_error("open_stream: Invalid detectInterval (%d) or maxQueueFrames (%d).", opts.detectInterval, opts.maxQueueFrames);
+        return INVALID_PARAMETER;
+    }
+    AnonymizationContext* context = static_cast<AnonymizationContext*>(handle);
+    std::unique_ptr<StreamSession> session(new (std::nothrow) StreamSession(opts));
+    if (!session) return MEMORY_ALLOCATION_ERROR;
+    int ret = session->start(context->model);
+    if (ret != ANO_OK) return ret;
+    *stream = session.release();
+    return ANO_OK;
+}
+
+int Anonymization_API push_frame(IN StreamHandle stream,
+                                 IN const ImageFrame *frame,
+                                 IN int64_t pts,
+                                 IN int32_t timeoutMs) {
+    if (stream == nullptr || frame == nullptr) {
+        log_error("push_frame: stream or frame is NULL.");
+        return INVALID_PARAMETER;
+    }
+    return stream->push(*frame, pts, timeoutMs);
+}
+
+int Anonymization_API push_frame_fd(IN StreamHandle stream,
+                                    IN int fd,
+                                    IN ImageFormat format,
+                                    IN int32_t width,
+                                    IN int32_t height,
+                                    IN int64_t pts,
+                                    IN int32_t timeoutMs) {
+    if (stream == nullptr || fd < 0) {
+        log_error("push_frame_fd: Invalid stream or fd.");
+        return INVALID_PARAMETER;
+    }
+    return stream->push_fd(fd, format, width, height, pts, timeoutMs);
+}
+
+int Anonymization_API pull_frame(IN StreamHandle stream,
+                                 OUT ImageFrame *frame,
+                                 OUT int64_t *pts,
+                                 IN int32_t timeoutMs) {
+    if (stream == nullptr || frame == nullptr) {
+        log_error("pull_frame: stream or frame is NULL.");
+        return INVALID_PARAMETER;
+    }
+    return stream->pull(*frame, pts, timeoutMs);
+}
+
+int Anonymization_API end_stream(IN StreamHandle stream) {
+    if (stream == nullptr) return INVALID_PARAMETER;
+    stream->end();
+    return ANO_OK;
+}
+
+int Anonymization_API close_stream(IN StreamHandle stream) {
+    if (stream == nullptr) return INVALID_PARAMETER;
+    delete stream;
+    return ANO_OK;
+}
+
+void Anonymization_API init_multistream_options(OUT MultiStreamOptions *options) {
+    if (options == nullptr) return;
+    memset(options, 0, sizeof(*options));
+    options->detectorCount = 2;
+    options->maxBatchSize = 8;
+    options->batchTimeoutMs = 10;
+}
+
+void Anonymization_API init_stream_registration(OUT StreamRegistration *registration) {
+    if (registration == nullptr) return;
+    memset(registration, 0, sizeof(*registration));
+    registration->priority = 1;
+    registration->targetFps = 25.0f;
+    registration->blurType = BLUR_TYPE_GAUSSIAN;
+    registration->detectInterval = 1;
+    registration->sceneCutThreshold = 0.4f;
+    registration->maxQueueFrames = 4;
+}
+
+int Anonymization_API open_multistream(IN AnonymizationHandle handle,
+                                       IN const MultiStreamOptions *options,
+                                       OUT MultiStreamHandle *scheduler) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    if (scheduler == nullptr) {
+        log_error("open_multistream: scheduler is NULL.");
+        return INVALID_PARAMETER;
+    }
+    *scheduler = nullptr;
+    MultiStreamOptions opts;
+    init_multistream_options(&opts);
+    if (options != nullptr) opts = *options;
+    if (opts.detectorCount <= 0 || opts.maxBatchSize <= 0 || opts.batchTimeoutMs < 0) {
+        log_error("open_multistream: Invalid detectorCount (%d), maxBatchSize (%d) or batchTimeoutMs (%d).",
+                  opts.detectorCount, opts.maxBatchSize, opts.batchTimeoutMs);
+        return INVALID_PARAMETER;
+    }
+    AnonymizationContext* context = static_cast<AnonymizationContext*>(handle);
+    std::unique_ptr<MultiStreamScheduler> created(new (std::nothrow) MultiStreamScheduler(opts));
+    if (!created) return MEMORY_ALLOCATION_ERROR;
+    int ret = created->start(context->model);
+    if (ret != ANO_OK) return ret;
+    *scheduler = created.release();
+    return ANO_OK;
+}
+
+int Anonymization_API register_stream(IN MultiStreamHandle scheduler,
+                                      IN const StreamRegistration *registration,
+                                      OUT int32_t *streamId) {
+    if (scheduler == nullptr || streamId == nullptr) {
+        log_error("register_stream: scheduler or streamId is NULL.");
+        return INVALID_PARAMETER;
     }
+    StreamRegistration reg;
+    init_stream_registration(&reg);
+    if (registration != nullptr) reg = *registration;
+    if (reg.priority <= 0 || reg.targetFps <= 0 || reg.detectInterval <= 0 || reg.maxQueueFrames <= 0) {
+        log_error("register_stream: Invalid priority (%d), targetFps (%.2f), detectInterval (%d) or maxQueueFrames (%d).",
+                  reg.priority, reg.targetFps, reg.detectInterval, reg.maxQueueFrames);
+        return INVALID_PARAMETER;
+    }
+    return scheduler->register_stream(reg, streamId);
+}
 
-    log_info("video_anonymization: Releasing video resources. Total frames read: %lld. Frames successfully processed and written: %d.", currentFrameCount, processedFrames);
-    videoCapture.release();
-    videoWriter.release();
+int Anonymization_API unregister_stream(IN MultiStreamHandle scheduler, IN int32_t streamId) {
+    if (scheduler == nullptr) return INVALID_PARAMETER;
+    return scheduler->unregister_stream(streamId);
+}
+
+int Anonymization_API multistream_push(IN MultiStreamHandle scheduler,
+                                       IN int32_t streamId,
+                                       IN const ImageFrame *frame,
+                                       IN int64_t pts) {
+    if (scheduler == nullptr || frame == nullptr) {
+        log_error("multistream_push: scheduler or frame is NULL.");
+        return INVALID_PARAMETER;
+    }
+    return scheduler->push(streamId, *frame, pts);
+}
+
+int Anonymization_API multistream_pull(IN MultiStreamHandle scheduler,
+                                       IN int32_t streamId,
+                                       OUT ImageFrame *frame,
+                                       OUT int64_t *pts,
+                                       IN int32_t timeoutMs) {
+    if (scheduler == nullptr || frame == nullptr) {
+        log_error("multistream_pull: scheduler or frame is NULL.");
+        return INVALID_PARAMETER;
+    }
+    return scheduler->pull(streamId, *frame, pts, timeoutMs);
+}
+
+int Anonymization_API get_stream_stats(IN MultiStreamHandle scheduler,
+                                       IN int32_t streamId,
+                                       OUT StreamStats *stats) {
+    if (scheduler == nullptr || stats == nullptr) {
+        log_error("get_stream_stats: scheduler or stats is NULL.");
+        return INVALID_PARAMETER;
+    }
+    return scheduler->stats(streamId, stats);
+}
 
-    if (processedFrames > 0) {
-        log_info("video_anonymization: Video processing completed for '%s'. %d frames saved to '%s'.", inputFile, processedFrames, outputFile);
+int Anonymization_API close_multistream(IN MultiStreamHandle scheduler) {
+    if (scheduler == nullptr) return INVALID_PARAMETER;
+    delete scheduler;
+    return ANO_OK;
+}
+
+
+int Anonymization_API get_stats(IN AnonymizationHandle handle, OUT AnonymizationStats *stats) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    if (stats == nullptr) {
+        log_error("get_stats: stats is NULL.");
+        return INVALID_PARAMETER;
+    }
+    static_cast<AnonymizationContext*>(handle)->perf.snapshot(*stats);
+    return ANO_OK;
+}
+
+int Anonymization_API reset_stats(IN AnonymizationHandle handle) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    static_cast<AnonymizationContext*>(handle)->perf.reset();
+    return ANO_OK;
+}
+
+Anonymization_API const char* get_stage_name(IN PerfStage stage) {
+    return perf_stage_name(static_cast<int>(stage));
+}
+
+int Anonymization_API set_stats_dump(IN AnonymizationHandle handle,
+                                     IN const char* path,
+                                     IN int32_t intervalMs,
+                                     IN const char* label) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    AnonymizationContext* context = static_cast<AnonymizationContext*>(handle);
+    context->perfDumper.reset();
+    if (path == nullptr || path[0] == '\0') {
+        log_info("set_stats_dump: Stats dump stopped.");
         return ANO_OK;
-    } else if (currentFrameCount > 0 && processedFrames == 0) {
-        log_warn("video_anonymization: Video '%s' had frames (%lld), but none were successfully written to '%s'.", inputFile, currentFrameCount, outputFile);
-        return SAVE_VIDEO_ERROR; // 或更具体的错误
-    } else {
-        log_warn("video_anonymization: No frames were read or processed from video '%s'.", inputFile);
-        return LOAD_VIDEO_ERROR;
     }
+    if (intervalMs < 100) {
+        log_error("set_stats_dump: Invalid intervalMs: %d (>= 100).", intervalMs);
+        return INVALID_PARAMETER;
+    }
+    const std::string name = label != nullptr ? std::string(label) : std::to_string(context->id);
+    if (name.find_first_of("\"\\\n") != std::string::npos) {
+        log_error("set_stats_dump: Label must not contain quotes, backslashes or newlines.");
+        return INVALID_PARAMETER;
+    }
+    context->perfDumper.reset(new PerfDumper(context->perf, path, intervalMs, name));
+    log_info("set_stats_dump: Writing stats to '%s' every %d ms (handle=\"%s\").", path, intervalMs, name.c_str());
+    return ANO_OK;
+}
+
+int Anonymization_API start_trace(IN const char* path) {
+    if (path == nullptr || path[0] == '\0') {
+        log_error("start_trace: Invalid parameter (path is NULL or empty).");
+        return INVALID_PARAMETER;
+    }
+    if (!trace_start(path)) {
+        log_error("start_trace: Trace recording is already running.");
+        return INVALID_PARAMETER;
+    }
+    return ANO_OK;
 }
 
+int Anonymization_API stop_trace() {
+    if (!trace_enabled()) {
+        log_error("stop_trace: Trace recording is not running.");
+        return INVALID_PARAMETER;
+    }
+    return trace_stop() ? ANO_OK : INTERNAL_ERROR;
+}
+
+int Anonymization_API set_simd_variant(IN const char* variant) {
+    if (variant == nullptr || !simd_force_variant(variant)) {
+        log_error("set_simd_variant: Unknown or unsupported variant '%s', current is '%s'.",
+                  variant ? variant : "(null)", simd_variant_name());
+        return INVALID_PARAMETER;
+    }
+    return ANO_OK;
+}
+
+Anonymization_API const char* get_simd_variant() {
+    return simd_variant_name();
+}
 
-const char* Anonymization_API get_error_message(IN int errorCode) {
+Anonymization_API const char* get_error_message(IN int errorCode) {
     return map_error_to_string(errorCode);
 }
\ No newline at end of file
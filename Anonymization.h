@@ -40,6 +40,20 @@ typedef struct AnonymizationContext AnonymizationContext; // 前向声明
  */
 typedef AnonymizationContext* AnonymizationHandle;
 
+typedef struct StreamSession StreamSession; // 前向声明
+
+/**
+ * @brief 流式会话句柄，由 open_stream 创建
+ */
+typedef StreamSession* StreamHandle;
+
+typedef struct MultiStreamScheduler MultiStreamScheduler; // 前向声明
+
+/**
+ * @brief 多路流调度器句柄，由 open_multistream 创建
+ */
+typedef MultiStreamScheduler* MultiStreamHandle;
+
 
 // 返回值 (保持不变)
 #define ANO_OK                        0
@@ -55,6 +69,13 @@ typedef AnonymizationContext* AnonymizationHandle;
 #define LOAD_LOG_ERROR                109
 #define INTERNAL_ERROR                110 // 新增：通用内部错误
 #define HANDLE_INVALID                111 // 新增：句柄无效错误
+#define CHECKPOINT_MISMATCH           112 // 检查点与当前输入或参数不匹配，无法续跑
+#define OPERATION_CANCELLED           113 // 处理被调用者取消
+#define STREAM_TIMEOUT                114 // 流式会话：等待超时
+#define STREAM_END                    115 // 流式会话：输入已结束且所有帧已取出
+#define BUFFER_TOO_SMALL              116 // 调用者提供的输出缓冲区不足，所需大小已写回
+#define DAEMON_UNAVAILABLE            117 // 客户端库：无法连接 anonymizationd 或连接已断开
+#define SIDECAR_ERROR                 118 // 检测结果旁路文件无法读写、格式错误或与输入尺寸不一致
 
 
 // 脱敏识别类型 (保持不变)
@@ -69,6 +90,7 @@ typedef enum {
     BLUR_TYPE_NONE,
     BLUR_TYPE_RECTANGLE,
     BLUR_TYPE_GAUSSIAN,
+    BLUR_TYPE_MOSAIC,          // 马赛克，比高斯模糊开销小
 } BlurType;
 
 // 图像格式 (保持不变)
@@ -92,6 +114,186 @@ typedef struct {
     uint8_t *data[4];   // 增加到4
 } ImageFrame;
 
+// 检测区域类型
+typedef enum {
+    ROI_INCLUDE = 0,  // 只在该区域内检测
+    ROI_EXCLUDE = 1,  // 该区域内不检测（如天空、墙面、时间戳水印）
+} RoiType;
+
+// 检测区域顶点，归一化坐标 [0,1]，与图像分辨率无关
+typedef struct {
+    float x;
+    float y;
+} RoiPoint;
+
+// 检测区域多边形
+typedef struct {
+    RoiType type;
+    int32_t pointCount;      // 顶点数，至少 3 个
+    const RoiPoint *points;  // 顶点数组，调用返回后 SDK 不再引用
+} RoiRegion;
+
+// 视频读写后端
+typedef enum {
+    VIDEO_BACKEND_AUTO = 0,    // 编译了 FFmpeg 时使用 FFmpeg，否则使用 OpenCV
+    VIDEO_BACKEND_OPENCV,      // cv::VideoCapture/VideoWriter
+    VIDEO_BACKEND_FFMPEG,      // libavformat/libavcodec，需以 WITH_FFMPEG=1 编译
+} VideoBackend;
+
+// 输出视频编码（仅 FFmpeg 后端）
+typedef enum {
+    VIDEO_CODEC_AUTO = 0,      // H.265 输入输出 H.265，其余输出 H.264
+    VIDEO_CODEC_H264,          // libx264
+    VIDEO_CODEC_H265,          // libx265
+} VideoCodec;
+
+// 流式会话参数，使用前请先调用 init_stream_options 填充默认值
+typedef struct {
+    BlurType blurType;         // 模糊类型
+    int32_t detectInterval;    // 完整检测间隔（帧），中间帧复用上一次检测框
+    float sceneCutThreshold;   // 场景切换阈值，<=0 关闭
+    int32_t maxQueueFrames;    // 待处理队列和待取出队列各自的最大帧数，决定最大缓冲延迟
+    int32_t dropWhenFull;      // 非 0 时待处理队列满则丢弃最旧的帧（实时源），否则 push_frame 等待
+    float latencyTargetMs;     // >0 开启实时模式：按端到端延迟目标自动降低/恢复输入尺寸、检测间隔和脱敏方式
+} StreamOptions;
+
+// 编码输出格式
+typedef enum {
+    ENCODED_FORMAT_SAME = 0,   // 与输入相同，无法识别时为 PNG
+    ENCODED_FORMAT_JPEG,
+    ENCODED_FORMAT_PNG,
+    ENCODED_FORMAT_WEBP,
+} EncodedFormat;
+
+// 编码参数，使用前请先调用 init_encode_options 填充默认值
+typedef struct {
+    EncodedFormat format;      // 输出格式
+    int32_t quality;           // JPEG/WebP 质量 1-100，0 使用默认值；JPEG 输入输出且为 0 时保留原量化表，只重新编码目标所在的块
+} EncodeOptions;
+
+// 单张图片处理参数，使用前请先调用 init_image_options 填充默认值
+typedef struct {
+    int32_t tileMode;          // 分条带处理：0 自动（超过 tileThresholdMP 时启用），1 总是启用，-1 关闭
+    int32_t tileThresholdMP;   // 自动模式下启用分条带处理的像素数阈值（百万像素）
+    int32_t tileSize;          // 检测分块边长（像素），也是条带高度的上限
+    int32_t tileOverlap;       // 相邻分块、相邻条带之间的重叠像素，应不小于最大目标尺寸
+    int32_t memoryLimitMB;     // 条带缓冲区的内存上限（MB），条带高度按图像宽度据此收缩
+    int32_t jpegQuality;       // 分条带输出 JPEG 的质量 1-100，0 使用默认值 95
+} ImageOptions;
+
+// 批量图片处理参数，使用前请先调用 init_batch_options 填充默认值
+typedef struct {
+    BlurType blurType;         // 模糊类型
+    int32_t workers;           // 解码/编码线程数，0 表示 CPU 核数
+    int32_t detectors;         // 检测实例数，每个实例一个检测线程
+    int32_t maxBatchSize;      // 一次前向最多合并的图片数
+    int32_t jpegQuality;       // 输出 JPEG 质量 1-100，0 使用默认值
+} BatchOptions;
+
+// 批量处理中单个文件的结果
+typedef struct {
+    int32_t result;            // 错误码，ANO_OK 表示成功
+    int32_t boxCount;          // 检测到的目标数
+    double elapsedMs;          // 从开始解码到写出完成的耗时（毫秒，含排队）
+} BatchFileResult;
+
+// 多路流调度器参数，使用前请先调用 init_multistream_options 填充默认值
+typedef struct {
+    int32_t detectorCount;     // 共享的检测实例数，每个实例一个调度线程
+    int32_t maxBatchSize;      // 一次前向最多合并的帧数（每路每批至多一帧）
+    int32_t batchTimeoutMs;    // 凑不满一批时最早送入的帧最多等待的时间（毫秒），0 表示有帧就处理
+} MultiStreamOptions;
+
+// 注册到多路流调度器的一路流，使用前请先调用 init_stream_registration 填充默认值
+typedef struct {
+    int32_t priority;          // 优先级 >=1，越大越先被调度
+    float targetFps;           // 该路的目标帧率，决定每帧的截止时间
+    BlurType blurType;         // 模糊类型
+    int32_t detectInterval;    // 完整检测间隔（帧），中间帧复用上一次检测框
+    float sceneCutThreshold;   // 场景切换阈值，<=0 关闭
+    int32_t maxQueueFrames;    // 待处理队列和待取出队列各自的最大帧数，满时丢弃最旧的帧
+} StreamRegistration;
+
+// 多路流调度器中一路流的统计
+typedef struct {
+    int64_t framesIn;          // 已送入帧数
+    int64_t framesOut;         // 已取出帧数
+    int64_t framesDropped;     // 队列满被丢弃的帧数（待处理与待取出合计）
+    int32_t queuedFrames;      // 当前排队的帧数
+    double avgLatencyMs;       // 平均延迟：送入到处理完成（毫秒）
+    double maxLatencyMs;       // 最大延迟（毫秒）
+    double avgBatchSize;       // 该路的帧平均所在批次大小
+} StreamStats;
+
+// 性能统计的处理阶段
+typedef enum {
+    PERF_STAGE_DECODE = 0,     // 图片/视频帧解码
+    PERF_STAGE_CONVERT,        // 输入帧格式转换为 BGR
+    PERF_STAGE_LETTERBOX,      // 缩放、填充并生成网络输入
+    PERF_STAGE_FORWARD,        // 网络前向
+    PERF_STAGE_PROPOSALS,      // 解析网络输出为候选框
+    PERF_STAGE_NMS,            // 非极大值抑制
+    PERF_STAGE_REDACT,         // 脱敏
+    PERF_STAGE_WRITEBACK,      // BGR 结果转换回输入帧格式
+    PERF_STAGE_ENCODE,         // 图片/视频帧编码
+    PERF_STAGE_DETECT,         // 一次检测的总耗时（缩放 + 前向 + 解析 + NMS）
+    PERF_STAGE_MEM_TOTAL,      // 一次 mem_anonymization 调用
+    PERF_STAGE_IMAGE_TOTAL,    // 一次 image_anonymization 调用
+    PERF_STAGE_VIDEO_TOTAL,    // 一次 video_anonymization 调用
+    PERF_STAGE_COUNT
+} PerfStage;
+
+// 单个阶段的统计，分位数由对数分桶直方图估算（相对误差约 6%）
+typedef struct {
+    uint64_t count;            // 次数
+    double totalMs;            // 累计耗时（毫秒）
+    double meanMs;             // 平均耗时（毫秒）
+    double maxMs;              // 最大耗时（毫秒）
+    double p50Ms;
+    double p90Ms;
+    double p99Ms;
+} StageStats;
+
+// 句柄的性能统计，包括该句柄派生的并行工作实例
+typedef struct {
+    StageStats stages[PERF_STAGE_COUNT];  // 按 PerfStage 索引
+    double elapsedSec;         // 距上次重置（或初始化）的时间（秒）
+} AnonymizationStats;
+
+// 视频处理进度
+typedef struct {
+    int64_t framesDone;        // 已处理帧数（续跑时包含检查点中已完成的帧）
+    int64_t totalFrames;       // 总帧数，未知时为 0
+    double fps;                // 最近一个上报周期的处理速度（帧/秒）
+    double etaSeconds;         // 预计剩余时间（秒），未知时为 -1
+} VideoProgress;
+
+// 进度回调，返回非 0 请求取消处理；分段并行时可能在任意工作线程中调用，但不会并发调用
+typedef int (*VideoProgressCallback)(const VideoProgress *progress, void *userData);
+
+// 视频处理扩展参数，使用前请先调用 init_video_options 填充默认值
+typedef struct {
+    int32_t detectInterval;    // 完整检测间隔（帧），1 表示逐帧检测，中间帧复用上一次检测框
+    float sceneCutThreshold;   // 场景切换阈值 (0,1]，帧间亮度直方图差异超过该值时丢弃复用框并强制检测；<=0 关闭
+    VideoBackend backend;      // 读写后端
+    VideoCodec codec;          // 输出编码（FFmpeg 后端）
+    int32_t decodeThreads;     // 解码线程数，0 表示自动（FFmpeg 后端）
+    int32_t encodeThreads;     // 编码线程数，0 表示自动（FFmpeg 后端）
+    int32_t crf;               // x264/x265 CRF，<0 使用编码器默认值（FFmpeg 后端）
+    char preset[16];           // x264/x265 preset，如 "veryfast"（FFmpeg 后端）
+    int32_t copyAudio;         // 非 0 时原样复制音频流，不重新编码（FFmpeg 后端）
+    int32_t gopPassthrough;    // 非 0 时按 GOP 分析，没有检测目标的 GOP 原样复制、不重新编码（FFmpeg 后端，H.264/H.265 闭合 GOP 输入）
+    int32_t segmentWorkers;    // 分段并行数，>1 时在关键帧处切段并行处理后拼接，0/1 关闭（FFmpeg 后端）
+    int32_t segmentOverlapFrames; // 每段起点前额外解码用于预热检测状态的帧数（分段并行）
+    int32_t checkpointIntervalSec; // >0 时约每隔该秒数在关键帧处落一个检查点，中断后可用 video_anonymization_resume 续跑（FFmpeg 后端）
+    VideoProgressCallback progressCallback; // 进度回调，可为 NULL
+    void *progressUserData;    // 原样传给 progressCallback
+    int32_t progressIntervalMs; // 两次进度回调的最小间隔（毫秒），0 表示每帧回调
+    // 取消标志，可为 NULL；其他线程置为非 0 后在当前帧处理完时停止并返回 OPERATION_CANCELLED。
+    // SDK 以原子操作读取，写入方也必须原子写入（__atomic_store_n 或 C++20 std::atomic_ref），不能只靠 volatile 赋值
+    const volatile int32_t *cancelFlag;
+} VideoOptions;
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -117,6 +319,14 @@ Anonymization_API const char* get_version();
  */
 Anonymization_API int set_log_filelevel(IN const char* logPath, IN LOG_LEVEL logLevel);
 
+/**
+ * @brief 设置日志是否同时输出到 stderr（Android 上为 logcat）
+ * 日志由后台线程异步写出，默认只写日志文件；未设置日志文件时写 stderr，不会重复输出
+ * @param enable [in] true 表示同时输出到 stderr
+ * @return 成功返回ANO_OK
+ */
+Anonymization_API int set_log_stderr(IN bool enable);
+
 /**
  * @brief SDK初始化
  * @param modelPathDir [in] 模型路径
@@ -147,6 +357,110 @@ Anonymization_API int image_anonymization(
     OUT const char* outputFile,
     IN BlurType blurType);
 
+/**
+ * @brief 填充单张图片处理参数默认值
+ * @param options [out] 图片处理参数
+ */
+Anonymization_API void init_image_options(OUT ImageOptions *options);
+
+/**
+ * @brief 图片文件脱敏处理（带参数），超大图像按条带流式解码、分块检测、逐条带写出，
+ * 内存只与图像宽度和条带高度有关；分条带处理支持 JPEG（WITH_LIBJPEG）和 PNG（WITH_LIBPNG）
+ * @param handle [in] 匿名化句柄
+ * @param inputFile [in] 输入图片路径
+ * @param outputFile [out] 输出图片路径
+ * @param blurType [in] 模糊类型
+ * @param options [in] 图片处理参数，为 NULL 时使用默认值
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int image_anonymization_ex(
+    IN AnonymizationHandle handle,
+    IN const char* inputFile,
+    OUT const char* outputFile,
+    IN BlurType blurType,
+    IN const ImageOptions *options);
+
+/**
+ * @brief 填充编码参数默认值
+ * @param options [out] 编码参数
+ */
+Anonymization_API void init_encode_options(OUT EncodeOptions *options);
+
+/**
+ * @brief 编码图像内存脱敏：输入 JPEG/PNG/WebP 等编码后的数据，输出编码后的数据，不经过文件
+ * @param handle [in] 匿名化句柄
+ * @param input [in] 编码后的图像数据
+ * @param inputSize [in] 数据字节数，不超过 INT_MAX，否则返回 INVALID_PARAMETER
+ * @param blurType [in] 模糊类型
+ * @param options [in] 编码参数，为 NULL 时使用默认值
+ * @param output [in_out] *output 为 NULL 时由 SDK 分配，使用后调用 free_buffer 释放；
+ *                        否则为调用者提供的缓冲区，容量由 *outputSize 给出
+ * @param outputSize [in_out] 输入为调用者缓冲区容量，输出为结果字节数
+ * @return 成功返回ANO_OK；调用者缓冲区不足返回BUFFER_TOO_SMALL，*outputSize 为所需大小；失败返回错误码
+ */
+Anonymization_API int buffer_anonymization(
+    IN AnonymizationHandle handle,
+    IN const uint8_t *input,
+    IN size_t inputSize,
+    IN BlurType blurType,
+    IN const EncodeOptions *options,
+    IN_OUT uint8_t **output,
+    IN_OUT size_t *outputSize);
+
+/**
+ * @brief 释放 SDK 分配的输出缓冲区
+ * @param buffer [in] buffer_anonymization 返回的缓冲区，可为 NULL
+ */
+Anonymization_API void free_buffer(IN uint8_t *buffer);
+
+/**
+ * @brief 填充批量图片处理参数默认值
+ * @param options [out] 批量处理参数
+ */
+Anonymization_API void init_batch_options(OUT BatchOptions *options);
+
+/**
+ * @brief 批量图片脱敏：解码、检测（合批推理）、编码以多线程流水线并行执行
+ * @param handle [in] 匿名化句柄，模型与检测区域在开始时复制
+ * @param inputFiles [in] 输入文件路径数组
+ * @param outputFiles [in] 输出文件路径数组，与 inputFiles 一一对应
+ * @param count [in] 文件数
+ * @param options [in] 批量处理参数，为 NULL 时使用默认值
+ * @param results [out] 每个文件的处理结果，数组长度为 count，可为 NULL
+ * @param failed [out] 失败的文件数，可为 NULL
+ * @return 流水线正常运行返回ANO_OK（单个文件的错误见 results），失败返回错误码
+ */
+Anonymization_API int batch_image_anonymization(
+    IN AnonymizationHandle handle,
+    IN const char* const* inputFiles,
+    IN const char* const* outputFiles,
+    IN int32_t count,
+    IN const BatchOptions *options,
+    OUT BatchFileResult *results,
+    OUT int32_t *failed);
+
+/**
+ * @brief 目录批量图片脱敏，输出文件与输入文件同名
+ * @param handle [in] 匿名化句柄
+ * @param inputDir [in] 输入目录（不递归）
+ * @param patterns [in] 文件名通配符，以 ';' 分隔、不区分大小写，如 "*.jpg;*.png"，为 NULL 时匹配常见图片格式
+ * @param outputDir [in] 输出目录，不存在时创建；与 inputDir 是同一目录（按 realpath 比较）时返回 INVALID_PARAMETER，不会原地覆盖原图
+ * @param options [in] 批量处理参数，为 NULL 时使用默认值
+ * @param reportFile [in] 处理报告路径（制表符分隔：输入文件、错误码、目标数、耗时毫秒），为 NULL 时不写
+ * @param total [out] 匹配的文件数，可为 NULL
+ * @param failed [out] 失败的文件数，可为 NULL
+ * @return 流水线正常运行返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int directory_image_anonymization(
+    IN AnonymizationHandle handle,
+    IN const char* inputDir,
+    IN const char* patterns,
+    IN const char* outputDir,
+    IN const BatchOptions *options,
+    IN const char* reportFile,
+    OUT int32_t *total,
+    OUT int32_t *failed);
+
 /**
  * @brief 内存图像脱敏处理
  * @param handle [in] 匿名化句柄
@@ -173,6 +487,378 @@ Anonymization_API int video_anonymization(
     OUT const char* outputFile,
     IN BlurType blurType);
 
+/**
+ * @brief 设置句柄的检测区域，对之后的图片、内存、视频处理均生效
+ * 存在包含区域时，检测前先裁剪到所有包含区域的外接矩形，再丢弃中心点不在
+ * 包含区域内或落在排除区域内的候选框
+ * @param handle [in] 匿名化句柄
+ * @param regions [in] 区域数组，count 为 0 时可为 NULL
+ * @param count [in] 区域数量，0 表示取消限制
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int set_roi_regions(
+    IN AnonymizationHandle handle,
+    IN const RoiRegion *regions,
+    IN int32_t count);
+
+/**
+ * @brief 填充视频处理扩展参数的默认值
+ * @param options [out] 扩展参数结构体
+ */
+Anonymization_API void init_video_options(OUT VideoOptions *options);
+
+/**
+ * @brief 视频文件脱敏处理（扩展参数版本）
+ * @param handle [in] 匿名化句柄
+ * @param inputFile [in] 输入视频路径
+ * @param outputFile [out] 输出视频路径
+ * @param blurType [in] 模糊类型
+ * @param options [in] 扩展参数，为 NULL 时使用默认值
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int video_anonymization_ex(
+    IN AnonymizationHandle handle,
+    IN const char* inputFile,
+    OUT const char* outputFile,
+    IN BlurType blurType,
+    IN const VideoOptions *options);
+
+/**
+ * @brief 从检查点续跑被中断的视频脱敏任务
+ * 检查点文件为 outputFile + ".ckpt"，由开启 checkpointIntervalSec 的 video_anonymization_ex 生成；
+ * 不存在时从头开始处理，输入文件、模型、检测区域或影响输出的参数发生变化时返回 CHECKPOINT_MISMATCH
+ * @param handle [in] 匿名化句柄
+ * @param inputFile [in] 输入视频路径
+ * @param outputFile [out] 输出视频路径
+ * @param blurType [in] 模糊类型
+ * @param options [in] 扩展参数，须与中断前一致，checkpointIntervalSec 必须大于 0
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int video_anonymization_resume(
+    IN AnonymizationHandle handle,
+    IN const char* inputFile,
+    OUT const char* outputFile,
+    IN BlurType blurType,
+    IN const VideoOptions *options);
+
+/**
+ * @brief 获取该句柄最近一次视频处理中检测到的场景切换时间点
+ * @param handle [in] 匿名化句柄
+ * @param timestampsMs [out] 时间戳数组（毫秒），可为 NULL 仅查询数量
+ * @param capacity [in] 数组容量
+ * @param count [out] 场景切换总数（可能大于 capacity）
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int get_scene_cuts(
+    IN AnonymizationHandle handle,
+    OUT double *timestampsMs,
+    IN int32_t capacity,
+    OUT int32_t *count);
+
+/**
+ * @brief 图片只检测不脱敏，检测框写入旁路文件（JSON Lines），之后可用 image_redact_from_sidecar 不经推理重新输出
+ * @param handle [in] 匿名化句柄
+ * @param inputFile [in] 输入图片路径
+ * @param sidecarFile [in] 旁路文件路径，已存在时覆盖
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int image_detect_to_sidecar(
+    IN AnonymizationHandle handle,
+    IN const char* inputFile,
+    IN const char* sidecarFile);
+
+/**
+ * @brief 按旁路文件中的检测框对图片脱敏，不做检测
+ * @param handle [in] 匿名化句柄
+ * @param inputFile [in] 输入图片路径，尺寸须与旁路文件记录的一致
+ * @param sidecarFile [in] image_detect_to_sidecar 生成（或人工修改过）的旁路文件
+ * @param outputFile [out] 输出图片路径
+ * @param blurType [in] 模糊类型
+ * @return 成功返回ANO_OK，旁路文件无法读取、格式错误或尺寸不一致返回 SIDECAR_ERROR
+ */
+Anonymization_API int image_redact_from_sidecar(
+    IN AnonymizationHandle handle,
+    IN const char* inputFile,
+    IN const char* sidecarFile,
+    OUT const char* outputFile,
+    IN BlurType blurType);
+
+/**
+ * @brief 视频只解码和检测，不编码输出，每帧实际使用的检测框（含间隔复用的框）写入旁路文件
+ * @param handle [in] 匿名化句柄
+ * @param inputFile [in] 输入视频路径
+ * @param sidecarFile [in] 旁路文件路径，已存在时覆盖，失败或取消时删除
+ * @param options [in] 扩展参数，使用 detectInterval、sceneCutThreshold、backend、decodeThreads 与进度/取消设置，为 NULL 时使用默认值
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int video_detect_to_sidecar(
+    IN AnonymizationHandle handle,
+    IN const char* inputFile,
+    IN const char* sidecarFile,
+    IN const VideoOptions *options);
+
+/**
+ * @brief 按旁路文件中每帧的检测框对视频脱敏，不做检测；帧号须与生成旁路文件时使用同一后端解码
+ * @param handle [in] 匿名化句柄
+ * @param inputFile [in] 输入视频路径，尺寸须与旁路文件记录的一致
+ * @param sidecarFile [in] video_detect_to_sidecar 生成（或人工修改过）的旁路文件
+ * @param outputFile [out] 输出视频路径
+ * @param blurType [in] 模糊类型
+ * @param options [in] 扩展参数，使用后端、编码与进度/取消设置（GOP 直通、分段并行和检查点不适用），为 NULL 时使用默认值
+ * @return 成功返回ANO_OK，旁路文件无法读取、格式错误或尺寸不一致返回 SIDECAR_ERROR
+ */
+Anonymization_API int video_redact_from_sidecar(
+    IN AnonymizationHandle handle,
+    IN const char* inputFile,
+    IN const char* sidecarFile,
+    OUT const char* outputFile,
+    IN BlurType blurType,
+    IN const VideoOptions *options);
+
+/**
+ * @brief 填充流式会话参数默认值
+ * @param options [out] 会话参数
+ */
+Anonymization_API void init_stream_options(OUT StreamOptions *options);
+
+/**
+ * @brief 打开流式会话，适用于采集卡、解码流等逐帧到达的实时源
+ * 会话在后台线程中处理帧，跨帧保留检测调度状态（检测间隔、场景切换），
+ * 并拥有独立的模型实例，会话存续期间句柄仍可用于其他接口
+ * @param handle [in] 匿名化句柄，模型与检测区域在打开时复制
+ * @param options [in] 会话参数，为 NULL 时使用默认值
+ * @param stream [out] 会话句柄
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int open_stream(
+    IN AnonymizationHandle handle,
+    IN const StreamOptions *options,
+    OUT StreamHandle *stream);
+
+/**
+ * @brief 送入一帧，数据被复制后立即返回
+ * @param stream [in] 会话句柄
+ * @param frame [in] 图像帧，格式与 mem_anonymization 相同，各帧分辨率和格式可以不同
+ * @param pts [in] 调用者定义的时间戳，随处理结果原样返回
+ * @param timeoutMs [in] 队列满时最长等待时间（毫秒），<0 一直等待；dropWhenFull 时不等待
+ * @return 成功返回ANO_OK，超时返回STREAM_TIMEOUT，失败返回错误码
+ */
+Anonymization_API int push_frame(
+    IN StreamHandle stream,
+    IN const ImageFrame *frame,
+    IN int64_t pts,
+    IN int32_t timeoutMs);
+
+/**
+ * @brief 从文件描述符（管道、文件）读取一帧紧凑排列的原始图像并送入会话，便于测试
+ * 平面按 Y/U/V（YUV420P）、Y/UV（YUV420SP）或单平面顺序排列，行间无填充
+ * @param stream [in] 会话句柄
+ * @param fd [in] 可读的文件描述符
+ * @param format [in] 图像格式
+ * @param width [in] 宽度
+ * @param height [in] 高度
+ * @param pts [in] 时间戳
+ * @param timeoutMs [in] 同 push_frame
+ * @return 成功返回ANO_OK，fd 已到结尾返回STREAM_END，失败返回错误码
+ */
+Anonymization_API int push_frame_fd(
+    IN StreamHandle stream,
+    IN int fd,
+    IN ImageFormat format,
+    IN int32_t width,
+    IN int32_t height,
+    IN int64_t pts,
+    IN int32_t timeoutMs);
+
+/**
+ * @brief 取出一帧处理结果，按送入顺序返回
+ * @param stream [in] 会话句柄
+ * @param frame [out] 处理后的图像，数据由会话持有，在下一次 pull_frame 或 close_stream 前有效
+ * @param pts [out] 该帧送入时的时间戳，可为 NULL
+ * @param timeoutMs [in] 没有可取的帧时最长等待时间（毫秒），<0 一直等待，0 立即返回
+ * @return 成功返回ANO_OK，超时返回STREAM_TIMEOUT，end_stream 之后全部取完返回STREAM_END
+ */
+Anonymization_API int pull_frame(
+    IN StreamHandle stream,
+    OUT ImageFrame *frame,
+    OUT int64_t *pts,
+    IN int32_t timeoutMs);
+
+/**
+ * @brief 通知会话不再送入新帧，已送入的帧处理完后 pull_frame 返回 STREAM_END
+ * @param stream [in] 会话句柄
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int end_stream(IN StreamHandle stream);
+
+/**
+ * @brief 关闭会话并释放资源，未取出的帧被丢弃
+ * @param stream [in] 会话句柄
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int close_stream(IN StreamHandle stream);
+
+/**
+ * @brief 填充多路流调度器参数默认值
+ * @param options [out] 调度器参数
+ */
+Anonymization_API void init_multistream_options(OUT MultiStreamOptions *options);
+
+/**
+ * @brief 填充流注册参数默认值
+ * @param registration [out] 流注册参数
+ */
+Anonymization_API void init_stream_registration(OUT StreamRegistration *registration);
+
+/**
+ * @brief 打开多路流调度器：多路摄像头共享一组检测实例，跨流合批推理，结果送回各自的流
+ * @param handle [in] 匿名化句柄，模型与检测区域在打开时复制
+ * @param options [in] 调度器参数，为 NULL 时使用默认值
+ * @param scheduler [out] 调度器句柄
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int open_multistream(
+    IN AnonymizationHandle handle,
+    IN const MultiStreamOptions *options,
+    OUT MultiStreamHandle *scheduler);
+
+/**
+ * @brief 注册一路流
+ * @param scheduler [in] 调度器句柄
+ * @param registration [in] 流参数，为 NULL 时使用默认值
+ * @param streamId [out] 流编号
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int register_stream(
+    IN MultiStreamHandle scheduler,
+    IN const StreamRegistration *registration,
+    OUT int32_t *streamId);
+
+/**
+ * @brief 注销一路流，未处理和未取出的帧被丢弃，之前取出的帧数据随之失效
+ * @param scheduler [in] 调度器句柄
+ * @param streamId [in] 流编号
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int unregister_stream(
+    IN MultiStreamHandle scheduler,
+    IN int32_t streamId);
+
+/**
+ * @brief 向一路流送入一帧，数据被复制后立即返回，队列满时丢弃该路最旧的待处理帧
+ * @param scheduler [in] 调度器句柄
+ * @param streamId [in] 流编号
+ * @param frame [in] 图像帧，格式与 mem_anonymization 相同
+ * @param pts [in] 调用者定义的时间戳，随处理结果原样返回
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int multistream_push(
+    IN MultiStreamHandle scheduler,
+    IN int32_t streamId,
+    IN const ImageFrame *frame,
+    IN int64_t pts);
+
+/**
+ * @brief 从一路流取出一帧处理结果，按送入顺序返回
+ * @param scheduler [in] 调度器句柄
+ * @param streamId [in] 流编号
+ * @param frame [out] 处理后的图像，数据由调度器持有，在该路下一次取帧或注销前有效
+ * @param pts [out] 该帧送入时的时间戳，可为 NULL
+ * @param timeoutMs [in] 没有可取的帧时最长等待时间（毫秒），<0 一直等待，0 立即返回
+ * @return 成功返回ANO_OK，超时返回STREAM_TIMEOUT，流已注销返回STREAM_END
+ */
+Anonymization_API int multistream_pull(
+    IN MultiStreamHandle scheduler,
+    IN int32_t streamId,
+    OUT ImageFrame *frame,
+    OUT int64_t *pts,
+    IN int32_t timeoutMs);
+
+/**
+ * @brief 查询一路流的统计（帧数、丢帧、延迟、平均批大小）
+ * @param scheduler [in] 调度器句柄
+ * @param streamId [in] 流编号
+ * @param stats [out] 统计结果
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int get_stream_stats(
+    IN MultiStreamHandle scheduler,
+    IN int32_t streamId,
+    OUT StreamStats *stats);
+
+/**
+ * @brief 关闭调度器并释放资源，所有流的未取出帧被丢弃
+ * @param scheduler [in] 调度器句柄
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int close_multistream(IN MultiStreamHandle scheduler);
+
+/**
+ * @brief 读取句柄的分阶段性能统计
+ * @param handle [in] 匿名化句柄
+ * @param stats [out] 统计结果
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int get_stats(IN AnonymizationHandle handle, OUT AnonymizationStats *stats);
+
+/**
+ * @brief 清零句柄的性能统计
+ * @param handle [in] 匿名化句柄
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int reset_stats(IN AnonymizationHandle handle);
+
+/**
+ * @brief 阶段名称，与 Prometheus 输出中的 stage 标签一致
+ * @param stage [in] 阶段
+ * @return 名称字符串，无效阶段返回 "unknown"
+ */
+Anonymization_API const char* get_stage_name(IN PerfStage stage);
+
+/**
+ * @brief 按固定间隔把性能统计以 Prometheus 文本格式写入文件，供 node_exporter 的 textfile collector 采集
+ * 先写临时文件再重命名，采集时不会读到写了一半的文件；uninit 时停止
+ * @param handle [in] 匿名化句柄
+ * @param path [in] 输出文件路径（应以 .prom 结尾），为 NULL 时停止输出
+ * @param intervalMs [in] 输出间隔（毫秒），>= 100
+ * @param label [in] 写入 handle 标签的名称，为 NULL 时使用句柄序号
+ * @return 成功返回ANO_OK，失败返回错误码
+ */
+Anonymization_API int set_stats_dump(
+    IN AnonymizationHandle handle,
+    IN const char* path,
+    IN int32_t intervalMs,
+    IN const char* label);
+
+/**
+ * @brief 开始记录处理流水线时间线，stop_trace 时写出 Chrome trace-event JSON，可在 Perfetto（ui.perfetto.dev）中打开
+ * 进程级开关，对所有句柄生效；记录各阶段的起止时间、线程、帧号，以及工作线程的等待和锁竞争。
+ * 事件先写入各线程自己的缓冲区，未开启时各计时点只多一次原子读
+ * @param path [in] 输出文件路径（.json）
+ * @return 成功返回ANO_OK，已在记录时返回INVALID_PARAMETER
+ */
+Anonymization_API int start_trace(IN const char* path);
+
+/**
+ * @brief 停止记录并写出时间线文件
+ * @return 成功返回ANO_OK，未在记录时返回INVALID_PARAMETER，写文件失败返回INTERNAL_ERROR
+ */
+Anonymization_API int stop_trace();
+
+/**
+ * @brief 强制使用指定指令集版本的 SDK 内核（NV12 色度交织、候选框阈值筛选），用于基准对比
+ * 进程级设置；默认在库加载时按 CPU 选择支持的最高版本，也可在加载前用环境变量 ANONYMIZATION_SIMD 指定
+ * @param variant [in] "auto"、"scalar"、"sse4.2"、"avx2"、"avx512"（x86）或 "neon"（aarch64）；"auto" 恢复自动选择
+ * @return 成功返回ANO_OK，名称未知或当前 CPU 不支持返回INVALID_PARAMETER
+ */
+Anonymization_API int set_simd_variant(IN const char* variant);
+
+/**
+ * @brief 获取当前使用的内核版本名
+ * @return 版本名，调用者无需释放
+ */
+Anonymization_API const char* get_simd_variant();
+
 // const char* Anonymization_API get_error_message(IN int errorCode); // 保持不变
 
 #ifdef __cplusplus
@@ -0,0 +1,123 @@
+#include "DetectionScheduler.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+
+SceneCutDetector::SceneCutDetector(float threshold)
+	: threshold(threshold), lastScore(0.f), lastMean(0.f), hasPrev(false),
+	  prevHist(kHistBins, 0.f), curHist(kHistBins, 0.f)
+{
+}
+
+void SceneCutDetector::reset()
+{
+	this->hasPrev = false;
+	this->lastScore = 0.f;
+	this->lastMean = 0.f;
+}
+
+bool SceneCutDetector::update(const cv::Mat& frame_bgr)
+{
+	if (frame_bgr.empty())
+		return false;
+	// 先缩小再转灰度，只统计缩略图，开销与分辨率无关
+	cv::resize(frame_bgr, this->thumb, cv::Size(kThumbWidth, kThumbHeight), 0, 0, cv::INTER_AREA);
+	if (this->thumb.channels() == 1)
+		this->gray = this->thumb;
+	else
+		cv::cvtColor(this->thumb, this->gray, cv::COLOR_BGR2GRAY);
+	return this->update_luma(this->gray);
+}
+
+bool SceneCutDetector::update_luma(const cv::Mat& luma)
+{
+	if (luma.empty())
+		return false;
+	const cv::Mat* src = &luma;
+	if (luma.cols != kThumbWidth || luma.rows != kThumbHeight) {
+		cv::resize(luma, this->gray, cv::Size(kThumbWidth, kThumbHeight), 0, 0, cv::INTER_AREA);
+		src = &this->gray;
+	}
+
+	std::fill(this->curHist.begin(), this->curHist.end(), 0.f);
+	double total = 0;
+	for (int r = 0; r < src->rows; ++r) {
+		const uchar* row = src->ptr<uchar>(r);
+		for (int c = 0; c < src->cols; ++c) {
+			this->curHist[row[c] * kHistBins / 256] += 1.f;
+			total += row[c];
+		}
+	}
+	const float pixels = static_cast<float>(src->rows * src->cols);
+	for (int i = 0; i < kHistBins; ++i)
+		this->curHist[i] /= pixels;
+	float mean = static_cast<float>(total / pixels);
+
+	bool cut = false;
+	if (this->hasPrev) {
+		// 归一化 L1 距离 ∈ [0,1]，再叠加平均亮度跳变，避免相似直方图下的整体亮度突变被漏检
+		float dist = 0.f;
+		for (int i = 0; i < kHistBins; ++i)
+			dist += std::fabs(this->curHist[i] - this->prevHist[i]);
+		dist *= 0.5f;
+		float meanDelta = std::fabs(mean - this->lastMean) / 255.f;
+		this->lastScore = std::max(dist, meanDelta);
+		cut = this->threshold > 0.f && this->lastScore > this->threshold;
+	} else {
+		this->lastScore = 0.f;
+	}
+
+	this->prevHist.swap(this->curHist);
+	this->lastMean = mean;
+	this->hasPrev = true;
+	return cut;
+}
+
+DetectionScheduler::DetectionScheduler(int detectInterval, float sceneCutThreshold)
+	: interval(detectInterval > 0 ? detectInterval : 1),
+	  sceneCutEnabled(sceneCutThreshold > 0.f),
+	  framesSinceDetect(0), sceneCut(false), hasBoxes(false),
+	  sceneDetector(sceneCutThreshold)
+{
+}
+
+void DetectionScheduler::reset()
+{
+	this->framesSinceDetect = 0;
+	this->sceneCut = false;
+	this->hasBoxes = false;
+	this->boxes.clear();
+	this->sceneDetector.reset();
+}
+
+bool DetectionScheduler::need_detect(const cv::Mat& frame_bgr)
+{
+	return this->schedule(this->sceneCutEnabled && this->sceneDetector.update(frame_bgr));
+}
+
+bool DetectionScheduler::need_detect_luma(const cv::Mat& luma)
+{
+	return this->schedule(this->sceneCutEnabled && this->sceneDetector.update_luma(luma));
+}
+
+bool DetectionScheduler::schedule(bool cut)
+{
+	this->sceneCut = cut;
+	if (cut) {
+		// 硬切后旧框落在错误的内容上，直接丢弃
+		this->boxes.clear();
+		this->hasBoxes = false;
+	}
+	if (!this->hasBoxes || this->framesSinceDetect + 1 >= this->interval) {
+		this->framesSinceDetect = 0;
+		return true;
+	}
+	++this->framesSinceDetect;
+	return false;
+}
+
+void DetectionScheduler::update_boxes(const std::vector<cv::Rect>& newBoxes)
+{
+	this->boxes = newBoxes;
+	this->hasBoxes = true;
+}
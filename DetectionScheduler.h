@@ -0,0 +1,79 @@
+#ifndef DETECTION_SCHEDULER_H
+#define DETECTION_SCHEDULER_H
+
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * @brief 基于亮度直方图的场景切换检测器
+ * 在缩小后的灰度图上统计直方图，与上一帧做归一化 L1 距离比较，
+ * 距离超过阈值即认为发生硬切。
+ */
+class SceneCutDetector
+{
+public:
+	explicit SceneCutDetector(float threshold = 0.4f);
+
+	void set_threshold(float threshold) { this->threshold = threshold; }
+	float get_threshold() const { return this->threshold; }
+
+	// 输入 BGR 帧，返回该帧相对上一帧是否为场景切换；第一帧永远返回 false
+	bool update(const cv::Mat& frame_bgr);
+	// 输入单通道亮度平面（如 YUV 的 Y 平面）
+	bool update_luma(const cv::Mat& luma);
+	// 最近一次 update 计算出的差异值，范围 [0, 1]
+	float last_score() const { return this->lastScore; }
+	void reset();
+
+private:
+	static const int kHistBins = 32;
+	static const int kThumbWidth = 64;
+	static const int kThumbHeight = 36;
+
+	float threshold;
+	float lastScore;
+	float lastMean;
+	bool hasPrev;
+	std::vector<float> prevHist;
+	std::vector<float> curHist;
+	cv::Mat thumb;
+	cv::Mat gray;
+};
+
+/**
+ * @brief 视频帧检测调度
+ * 每 detectInterval 帧执行一次完整检测，中间帧复用上一次的检测框；
+ * 检测到场景切换时丢弃复用的框并强制重新检测。
+ */
+class DetectionScheduler
+{
+public:
+	DetectionScheduler(int detectInterval = 1, float sceneCutThreshold = 0.4f);
+
+	// 判断当前帧是否需要完整检测，并更新场景切换状态
+	bool need_detect(const cv::Mat& frame_bgr);
+	bool need_detect_luma(const cv::Mat& luma);
+	// 完整检测后回填结果，供后续帧复用
+	void update_boxes(const std::vector<cv::Rect>& boxes);
+	const std::vector<cv::Rect>& carried_boxes() const { return this->boxes; }
+	// 当前帧是否被判定为场景切换（在 need_detect 之后有效）
+	bool is_scene_cut() const { return this->sceneCut; }
+	float scene_score() const { return this->sceneDetector.last_score(); }
+	void reset();
+
+	void set_detect_interval(int detectInterval) { this->interval = detectInterval > 0 ? detectInterval : 1; }
+	int get_detect_interval() const { return this->interval; }
+
+private:
+	bool schedule(bool cut);
+
+	int interval;
+	bool sceneCutEnabled;
+	long long framesSinceDetect;
+	bool sceneCut;
+	bool hasBoxes;
+	std::vector<cv::Rect> boxes;
+	SceneCutDetector sceneDetector;
+};
+
+#endif // DETECTION_SCHEDULER_H
@@ -0,0 +1,892 @@
+#include "FFmpegVideo.h"
+
+#ifdef ANONYMIZATION_WITH_FFMPEG
+
+#include "log/log.h"
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+
+std::string ffmpeg_error_string(int errnum)
+{
+	char buf[AV_ERROR_MAX_STRING_SIZE] = {0};
+	av_strerror(errnum, buf, sizeof(buf));
+	return std::string(buf);
+}
+
+// --- FFmpegReader ---
+
+FFmpegReader::FFmpegReader()
+	: fmt(nullptr), dec(nullptr), sws(nullptr), decoded(nullptr), videoIndex(-1)
+{
+}
+
+FFmpegReader::~FFmpegReader()
+{
+	this->close();
+}
+
+void FFmpegReader::close()
+{
+	if (this->sws) {
+		sws_freeContext(this->sws);
+		this->sws = nullptr;
+	}
+	av_frame_free(&this->decoded);
+	avcodec_free_context(&this->dec);
+	if (this->fmt)
+		avformat_close_input(&this->fmt);
+	this->videoIndex = -1;
+}
+
+bool FFmpegReader::open(const char* path, int decodeThreads)
+{
+	this->close();
+	int ret = avformat_open_input(&this->fmt, path, nullptr, nullptr);
+	if (ret < 0) {
+		log_error("FFmpegReader: Failed to open '%s': %s", path, ffmpeg_error_string(ret).c_str());
+		return false;
+	}
+	ret = avformat_find_stream_info(this->fmt, nullptr);
+	if (ret < 0) {
+		log_error("FFmpegReader: Failed to read stream info of '%s': %s", path, ffmpeg_error_string(ret).c_str());
+		this->close();
+		return false;
+	}
+	this->videoIndex = av_find_best_stream(this->fmt, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+	if (this->videoIndex < 0) {
+		log_error("FFmpegReader: No video stream in '%s'.", path);
+		this->close();
+		return false;
+	}
+	AVStream* st = this->fmt->streams[this->videoIndex];
+	const AVCodec* codec = avcodec_find_decoder(st->codecpar->codec_id);
+	if (!codec) {
+		log_error("FFmpegReader: No decoder for codec id %d in '%s'.", static_cast<int>(st->codecpar->codec_id), path);
+		this->close();
+		return false;
+	}
+	this->dec = avcodec_alloc_context3(codec);
+	if (!this->dec || avcodec_parameters_to_context(this->dec, st->codecpar) < 0) {
+		log_error("FFmpegReader: Failed to set up decoder context for '%s'.", path);
+		this->close();
+		return false;
+	}
+	// 帧级 + 片级多线程解码，0 表示按 CPU 核数自动选择
+	this->dec->thread_count = decodeThreads > 0 ? decodeThreads : 0;
+	this->dec->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+	this->dec->pkt_timebase = st->time_base;
+	ret = avcodec_open2(this->dec, codec, nullptr);
+	if (ret < 0) {
+		log_error("FFmpegReader: Failed to open decoder %s: %s", codec->name, ffmpeg_error_string(ret).c_str());
+		this->close();
+		return false;
+	}
+	this->decoded = av_frame_alloc();
+	if (!this->decoded) {
+		this->close();
+		return false;
+	}
+	log_info("FFmpegReader: Opened '%s' - %s %dx%d, %.2f fps, decoder threads %d.",
+	         path, codec->name, this->dec->width, this->dec->height, this->fps(), this->dec->thread_count);
+	return true;
+}
+
+AVStream* FFmpegReader::video_stream() const
+{
+	return (this->fmt && this->videoIndex >= 0) ? this->fmt->streams[this->videoIndex] : nullptr;
+}
+
+int FFmpegReader::width() const { return this->dec ? this->dec->width : 0; }
+int FFmpegReader::height() const { return this->dec ? this->dec->height : 0; }
+const char* FFmpegReader::codec_name() const { return this->dec ? avcodec_get_name(this->dec->codec_id) : ""; }
+
+double FFmpegReader::fps() const
+{
+	AVStream* st = this->video_stream();
+	if (!st)
+		return 0;
+	AVRational rate = av_guess_frame_rate(this->fmt, st, nullptr);
+	return rate.num > 0 && rate.den > 0 ? av_q2d(rate) : 0;
+}
+
+long long FFmpegReader::frame_count() const
+{
+	AVStream* st = this->video_stream();
+	if (!st)
+		return 0;
+	if (st->nb_frames > 0)
+		return st->nb_frames;
+	if (this->fmt->duration > 0)
+		return static_cast<long long>(this->fmt->duration / (double)AV_TIME_BASE * this->fps());
+	return 0;
+}
+
+int FFmpegReader::read_packet(AVPacket* pkt)
+{
+	return av_read_frame(this->fmt, pkt);
+}
+
+int FFmpegReader::send_packet(const AVPacket* pkt)
+{
+	int ret = avcodec_send_packet(this->dec, pkt);
+	if (ret < 0 && ret != AVERROR_EOF && ret != AVERROR(EAGAIN)) {
+		log_warn("FFmpegReader: avcodec_send_packet failed: %s", ffmpeg_error_string(ret).c_str());
+	}
+	return ret;
+}
+
+int FFmpegReader::receive_frame(AVFrame* frame)
+{
+	int ret = avcodec_receive_frame(this->dec, this->decoded);
+	if (ret < 0)
+		return ret;
+
+	av_frame_unref(frame);
+	const AVPixelFormat pixfmt = static_cast<AVPixelFormat>(this->decoded->format);
+	if (pixfmt == AV_PIX_FMT_YUV420P || pixfmt == AV_PIX_FMT_YUVJ420P) {
+		// 绝大多数 H.264/H.265 内容已是 YUV420，直接转移引用，不做任何拷贝
+		av_frame_move_ref(frame, this->decoded);
+	} else {
+		this->sws = sws_getCachedContext(this->sws, this->decoded->width, this->decoded->height, pixfmt,
+		                                 this->decoded->width, this->decoded->height, AV_PIX_FMT_YUV420P,
+		                                 SWS_BILINEAR, nullptr, nullptr, nullptr);
+		if (!this->sws)
+			return AVERROR(EINVAL);
+		frame->format = AV_PIX_FMT_YUV420P;
+		frame->width = this->decoded->width;
+		frame->height = this->decoded->height;
+		ret = av_frame_get_buffer(frame, 0);
+		if (ret < 0)
+			return ret;
+		sws_scale(this->sws, this->decoded->data, this->decoded->linesize, 0, this->decoded->height,
+		          frame->data, frame->linesize);
+		av_frame_copy_props(frame, this->decoded);
+		av_frame_unref(this->decoded);
+	}
+	frame->pts = frame->best_effort_timestamp;
+	return 0;
+}
+
+void FFmpegReader::flush()
+{
+	if (this->dec)
+		avcodec_flush_buffers(this->dec);
+}
+
+bool FFmpegReader::seek(long long timestamp)
+{
+	int ret = av_seek_frame(this->fmt, this->videoIndex, timestamp, AVSEEK_FLAG_BACKWARD);
+	if (ret < 0) {
+		log_warn("FFmpegReader: Seek to %lld failed: %s", timestamp, ffmpeg_error_string(ret).c_str());
+		return false;
+	}
+	avcodec_flush_buffers(this->dec);
+	return true;
+}
+
+// --- FFmpegWriter ---
+
+FFmpegWriter::FFmpegWriter()
+	: fmt(nullptr), enc(nullptr), videoOut(nullptr), pkt(nullptr), inputFmt(nullptr),
+	  inputVideoIndex(-1), headerWritten(false), finished(false), lastPts(AV_NOPTS_VALUE), frameDuration(1)
+{
+}
+
+FFmpegWriter::~FFmpegWriter()
+{
+	this->close();
+}
+
+void FFmpegWriter::close()
+{
+	if (this->fmt) {
+		if (this->headerWritten && !this->finished)
+			av_write_trailer(this->fmt);
+		if (!(this->fmt->oformat->flags & AVFMT_NOFILE))
+			avio_closep(&this->fmt->pb);
+		avformat_free_context(this->fmt);
+		this->fmt = nullptr;
+	}
+	avcodec_free_context(&this->enc);
+	av_packet_free(&this->pkt);
+	this->videoOut = nullptr;
+	this->streamMap.clear();
+	this->headerWritten = false;
+	this->finished = false;
+}
+
+// 按输入视频参数创建并打开编码器；失败返回 nullptr
+static AVCodecContext* open_video_encoder(const FFmpegReader& input, const FFmpegEncodeConfig& config,
+                                          bool globalHeader, int maxBFrames, int gopSize, bool matchProfile)
+{
+	const AVCodec* codec = avcodec_find_encoder_by_name(config.encoder.c_str());
+	if (!codec) {
+		log_error("FFmpeg: Encoder '%s' is not available in this FFmpeg build.", config.encoder.c_str());
+		return nullptr;
+	}
+	AVCodecContext* enc = avcodec_alloc_context3(codec);
+	if (!enc)
+		return nullptr;
+	AVStream* inVideo = input.video_stream();
+	enc->width = input.width();
+	enc->height = input.height();
+	enc->pix_fmt = AV_PIX_FMT_YUV420P;
+	enc->time_base = inVideo->time_base;
+	enc->framerate = av_guess_frame_rate(input.format_context(), inVideo, nullptr);
+	enc->sample_aspect_ratio = inVideo->codecpar->sample_aspect_ratio;
+	enc->color_range = inVideo->codecpar->color_range;
+	enc->color_primaries = inVideo->codecpar->color_primaries;
+	enc->color_trc = inVideo->codecpar->color_trc;
+	enc->colorspace = inVideo->codecpar->color_space;
+	enc->thread_count = config.threads > 0 ? config.threads : 0;
+	enc->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+	if (maxBFrames >= 0)
+		enc->max_b_frames = maxBFrames;
+	if (gopSize > 0)
+		enc->gop_size = gopSize;
+	if (globalHeader)
+		enc->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+	// 拼接进原始码流的片段沿用输入的 profile/level，参数集才有可能与原 extradata 一致
+	if (matchProfile && codec->id == inVideo->codecpar->codec_id) {
+		enc->profile = inVideo->codecpar->profile;
+		enc->level = inVideo->codecpar->level;
+	}
+
+	AVDictionary* opts = nullptr;
+	if (!config.preset.empty())
+		av_dict_set(&opts, "preset", config.preset.c_str(), 0);
+	if (config.crf >= 0)
+		av_dict_set(&opts, "crf", std::to_string(config.crf).c_str(), 0);
+	int ret = avcodec_open2(enc, codec, &opts);
+	av_dict_free(&opts);
+	if (ret < 0) {
+		log_error("FFmpeg: Failed to open encoder %s: %s", codec->name, ffmpeg_error_string(ret).c_str());
+		avcodec_free_context(&enc);
+		return nullptr;
+	}
+	return enc;
+}
+
+bool FFmpegWriter::open(const char* path, const FFmpegReader& input, const FFmpegEncodeConfig& config)
+{
+	this->close();
+	this->inputFmt = input.format_context();
+	this->inputVideoIndex = input.video_stream_index();
+	AVStream* inVideo = input.video_stream();
+
+	int ret = avformat_alloc_output_context2(&this->fmt, nullptr, nullptr, path);
+	if (ret < 0 || !this->fmt) {
+		log_error("FFmpegWriter: Cannot determine container for '%s': %s", path, ffmpeg_error_string(ret).c_str());
+		return false;
+	}
+
+	// 容器不支持所选编码时直接报错，不做静默降级
+	AVCodecID videoCodec = inVideo->codecpar->codec_id;
+	if (!config.copyVideo) {
+		const AVCodec* codec = avcodec_find_encoder_by_name(config.encoder.c_str());
+		if (!codec) {
+			log_error("FFmpegWriter: Encoder '%s' is not available in this FFmpeg build.", config.encoder.c_str());
+			this->close();
+			return false;
+		}
+		videoCodec = codec->id;
+	}
+	if (avformat_query_codec(this->fmt->oformat, videoCodec, FF_COMPLIANCE_NORMAL) == 0) {
+		log_error("FFmpegWriter: Container '%s' cannot hold %s video.", this->fmt->oformat->name, avcodec_get_name(videoCodec));
+		this->close();
+		return false;
+	}
+
+	this->videoOut = avformat_new_stream(this->fmt, nullptr);
+	this->pkt = av_packet_alloc();
+	if (!this->videoOut || !this->pkt) {
+		this->close();
+		return false;
+	}
+	AVRational rate = av_guess_frame_rate(const_cast<AVFormatContext*>(this->inputFmt), inVideo, nullptr);
+	if (config.copyVideo) {
+		// 视频流原样复制，编码参数（含 extradata）沿用输入
+		if (avcodec_parameters_copy(this->videoOut->codecpar, inVideo->codecpar) < 0) {
+			this->close();
+			return false;
+		}
+		this->videoOut->codecpar->codec_tag = 0;
+		this->videoOut->time_base = inVideo->time_base;
+	} else {
+		this->enc = open_video_encoder(input, config, (this->fmt->oformat->flags & AVFMT_GLOBALHEADER) != 0, -1, 0, false);
+		if (!this->enc) {
+			this->close();
+			return false;
+		}
+		avcodec_parameters_from_context(this->videoOut->codecpar, this->enc);
+		this->videoOut->time_base = this->enc->time_base;
+		if (rate.num > 0 && rate.den > 0)
+			this->frameDuration = std::max<int64_t>(1, av_rescale_q(1, av_inv_q(rate), this->enc->time_base));
+	}
+	this->videoOut->avg_frame_rate = rate;
+
+	this->streamMap.assign(this->inputFmt->nb_streams, -1);
+	this->streamMap[this->inputVideoIndex] = this->videoOut->index;
+	for (unsigned i = 0; config.copyAudio && i < this->inputFmt->nb_streams; ++i) {
+		AVStream* in = this->inputFmt->streams[i];
+		if (in->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
+			continue;
+		if (avformat_query_codec(this->fmt->oformat, in->codecpar->codec_id, FF_COMPLIANCE_NORMAL) == 0) {
+			log_warn("FFmpegWriter: Container '%s' cannot hold %s audio, audio stream %u dropped.",
+			         this->fmt->oformat->name, avcodec_get_name(in->codecpar->codec_id), i);
+			continue;
+		}
+		AVStream* out = avformat_new_stream(this->fmt, nullptr);
+		if (!out || avcodec_parameters_copy(out->codecpar, in->codecpar) < 0) {
+			this->close();
+			return false;
+		}
+		out->codecpar->codec_tag = 0;
+		out->time_base = in->time_base;
+		this->streamMap[i] = out->index;
+	}
+
+	if (!(this->fmt->oformat->flags & AVFMT_NOFILE)) {
+		ret = avio_open(&this->fmt->pb, path, AVIO_FLAG_WRITE);
+		if (ret < 0) {
+			log_error("FFmpegWriter: Failed to open output '%s': %s", path, ffmpeg_error_string(ret).c_str());
+			this->close();
+			return false;
+		}
+	}
+	ret = avformat_write_header(this->fmt, nullptr);
+	if (ret < 0) {
+		log_error("FFmpegWriter: Failed to write header for '%s': %s", path, ffmpeg_error_string(ret).c_str());
+		this->close();
+		return false;
+	}
+	this->headerWritten = true;
+	if (config.copyVideo) {
+		log_info("FFmpegWriter: Opened '%s' (%s) - %s video stream copy.", path, this->fmt->oformat->name, avcodec_get_name(videoCodec));
+	} else {
+		log_info("FFmpegWriter: Opened '%s' (%s) - %s, preset '%s', crf %d, encoder threads %d.",
+		         path, this->fmt->oformat->name, config.encoder.c_str(), config.preset.c_str(), config.crf, this->enc->thread_count);
+	}
+	return true;
+}
+
+bool FFmpegWriter::has_output_stream(int inputStreamIndex) const
+{
+	return inputStreamIndex >= 0 && inputStreamIndex < static_cast<int>(this->streamMap.size()) &&
+	       this->streamMap[inputStreamIndex] >= 0;
+}
+
+int FFmpegWriter::drain_encoder()
+{
+	while (true) {
+		int ret = avcodec_receive_packet(this->enc, this->pkt);
+		if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+			return 0;
+		if (ret < 0)
+			return ret;
+		this->pkt->stream_index = this->videoOut->index;
+		av_packet_rescale_ts(this->pkt, this->enc->time_base, this->videoOut->time_base);
+		ret = av_interleaved_write_frame(this->fmt, this->pkt);
+		if (ret < 0)
+			return ret;
+	}
+}
+
+int FFmpegWriter::write_frame(AVFrame* frame)
+{
+	if (!this->enc)
+		return AVERROR(EINVAL);
+	if (frame) {
+		// 编码器要求 pts 严格递增，缺失或回退的时间戳按帧间隔补齐
+		if (frame->pts == AV_NOPTS_VALUE || (this->lastPts != AV_NOPTS_VALUE && frame->pts <= this->lastPts))
+			frame->pts = this->lastPts == AV_NOPTS_VALUE ? 0 : this->lastPts + this->frameDuration;
+		this->lastPts = frame->pts;
+	}
+	int ret = avcodec_send_frame(this->enc, frame);
+	if (ret < 0 && ret != AVERROR_EOF) {
+		log_error("FFmpegWriter: avcodec_send_frame failed: %s", ffmpeg_error_string(ret).c_str());
+		return ret;
+	}
+	return this->drain_encoder();
+}
+
+int FFmpegWriter::write_copied_packet(AVPacket* inPkt)
+{
+	if (!this->has_output_stream(inPkt->stream_index)) {
+		av_packet_unref(inPkt);
+		return 0;
+	}
+	AVStream* in = this->inputFmt->streams[inPkt->stream_index];
+	AVStream* out = this->fmt->streams[this->streamMap[inPkt->stream_index]];
+	av_packet_rescale_ts(inPkt, in->time_base, out->time_base);
+	inPkt->stream_index = out->index;
+	inPkt->pos = -1;
+	return av_interleaved_write_frame(this->fmt, inPkt);
+}
+
+int FFmpegWriter::finish()
+{
+	if (this->finished || !this->headerWritten)
+		return 0;
+	int ret = this->enc ? this->write_frame(nullptr) : 0;
+	int trailer = av_write_trailer(this->fmt);
+	this->finished = true;
+	return ret < 0 ? ret : trailer;
+}
+
+// --- FFmpegEncoder ---
+
+FFmpegEncoder::FFmpegEncoder()
+	: enc(nullptr), pkt(nullptr)
+{
+}
+
+FFmpegEncoder::~FFmpegEncoder()
+{
+	this->close();
+}
+
+void FFmpegEncoder::close()
+{
+	avcodec_free_context(&this->enc);
+	av_packet_free(&this->pkt);
+}
+
+bool FFmpegEncoder::open(const FFmpegReader& input, const FFmpegEncodeConfig& config, int maxBFrames, int gopSize)
+{
+	this->close();
+	// 不使用全局头：参数集随第一个关键帧带内输出，编码片段可以独立拼接进原始码流
+	this->enc = open_video_encoder(input, config, false, maxBFrames, gopSize, true);
+	this->pkt = av_packet_alloc();
+	if (!this->enc || !this->pkt) {
+		this->close();
+		return false;
+	}
+	return true;
+}
+
+int FFmpegEncoder::encode(const AVFrame* frame, std::vector<AVPacket*>& out)
+{
+	int ret = avcodec_send_frame(this->enc, frame);
+	if (ret < 0 && ret != AVERROR_EOF)
+		return ret;
+	while (true) {
+		ret = avcodec_receive_packet(this->enc, this->pkt);
+		if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+			return 0;
+		if (ret < 0)
+			return ret;
+		out.push_back(av_packet_clone(this->pkt));
+		av_packet_unref(this->pkt);
+	}
+}
+
+// --- 码流格式转换 ---
+
+int ffmpeg_nal_length_size(const AVCodecParameters* par)
+{
+	// extradata 以 1 开头为 avcC/hvcC（MP4/MKV 等），否则为 Annex B 起始码格式
+	if (!par->extradata || par->extradata_size < 7 || par->extradata[0] != 1)
+		return 0;
+	if (par->codec_id == AV_CODEC_ID_H264)
+		return (par->extradata[4] & 3) + 1;
+	if (par->codec_id == AV_CODEC_ID_HEVC && par->extradata_size >= 23)
+		return (par->extradata[21] & 3) + 1;
+	return 0;
+}
+
+// 找到 Annex B 数据中所有 NAL 单元（起始码 00 00 01 / 00 00 00 01），返回 (偏移, 长度)
+static std::vector<std::pair<int, int>> split_annexb(const uint8_t* data, int size)
+{
+	std::vector<std::pair<int, int>> nals;
+	int i = 0, start = -1;
+	while (i + 2 < size) {
+		if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+			if (start >= 0) {
+				int end = i;
+				while (end > start && data[end - 1] == 0)
+					--end;
+				nals.push_back(std::make_pair(start, end - start));
+			}
+			i += 3;
+			start = i;
+		} else {
+			++i;
+		}
+	}
+	if (start >= 0)
+		nals.push_back(std::make_pair(start, size - start));
+	return nals;
+}
+
+int ffmpeg_annexb_to_length_prefixed(AVPacket* pkt, int nalLengthSize)
+{
+	if (nalLengthSize <= 0)
+		return 0;
+	const uint8_t* data = pkt->data;
+	const std::vector<std::pair<int, int>> nals = split_annexb(data, pkt->size);
+	if (nals.empty())
+		return 0; // 已是长度前缀格式
+
+	int outSize = 0;
+	for (const auto& n : nals)
+		outSize += nalLengthSize + n.second;
+	AVPacket* out = av_packet_alloc();
+	if (!out || av_new_packet(out, outSize) < 0) {
+		av_packet_free(&out);
+		return AVERROR(ENOMEM);
+	}
+	uint8_t* dst = out->data;
+	for (const auto& n : nals) {
+		for (int b = nalLengthSize - 1; b >= 0; --b)
+			*dst++ = static_cast<uint8_t>((n.second >> (8 * b)) & 0xff);
+		memcpy(dst, data + n.first, n.second);
+		dst += n.second;
+	}
+	av_packet_copy_props(out, pkt);
+	av_packet_unref(pkt);
+	av_packet_move_ref(pkt, out);
+	av_packet_free(&out);
+	return 0;
+}
+
+static bool is_parameter_set(AVCodecID codecId, const uint8_t* nal, int size)
+{
+	if (size <= 0)
+		return false;
+	if (codecId == AV_CODEC_ID_HEVC) {
+		int type = (nal[0] >> 1) & 0x3f;
+		return type >= 32 && type <= 34; // VPS/SPS/PPS
+	}
+	int type = nal[0] & 0x1f;
+	return type == 7 || type == 8; // SPS/PPS
+}
+
+// 取出 extradata 中的全部参数集，支持 avcC、hvcC 和 Annex B 三种格式；格式错误时返回 false
+static bool extradata_parameter_sets(const AVCodecParameters* par, std::vector<std::vector<uint8_t>>& sets)
+{
+	const uint8_t* data = par->extradata;
+	const int size = par->extradata_size;
+	if (!data || size <= 0)
+		return true;
+	if (ffmpeg_nal_length_size(par) == 0) {
+		for (const auto& n : split_annexb(data, size)) {
+			if (is_parameter_set(par->codec_id, data + n.first, n.second))
+				sets.emplace_back(data + n.first, data + n.first + n.second);
+		}
+		return true;
+	}
+	// 读取一个 16 位长度前缀的 NAL 单元
+	int pos = 0;
+	auto read_nal = [&]() -> bool {
+		if (pos + 2 > size)
+			return false;
+		int len = (data[pos] << 8) | data[pos + 1];
+		pos += 2;
+		if (len > size - pos)
+			return false;
+		sets.emplace_back(data + pos, data + pos + len);
+		pos += len;
+		return true;
+	};
+	if (par->codec_id == AV_CODEC_ID_H264) {
+		// avcC：6 字节头，低 5 位为 SPS 个数，随后是 PPS 个数
+		pos = 6;
+		for (int n = data[5] & 0x1f; n > 0; --n)
+			if (!read_nal())
+				return false;
+		if (pos >= size)
+			return false;
+		for (int n = data[pos++]; n > 0; --n)
+			if (!read_nal())
+				return false;
+		return true;
+	}
+	// hvcC：22 字节头后为 NAL 数组个数，每个数组含类型和 NAL 个数
+	pos = 23;
+	for (int arrays = data[22]; arrays > 0; --arrays) {
+		if (pos + 3 > size)
+			return false;
+		int count = (data[pos + 1] << 8) | data[pos + 2];
+		pos += 3;
+		for (; count > 0; --count)
+			if (!read_nal())
+				return false;
+	}
+	return true;
+}
+
+bool ffmpeg_parameter_sets_match(const AVCodecParameters* par, const AVPacket* pkt)
+{
+	std::vector<std::vector<uint8_t>> expected;
+	if (!extradata_parameter_sets(par, expected))
+		return false;
+	int found = 0;
+	for (const auto& n : split_annexb(pkt->data, pkt->size)) {
+		const uint8_t* nal = pkt->data + n.first;
+		if (!is_parameter_set(par->codec_id, nal, n.second))
+			continue;
+		found++;
+		bool same = false;
+		for (const auto& e : expected)
+			same = same || (static_cast<int>(e.size()) == n.second && memcmp(e.data(), nal, e.size()) == 0);
+		if (!same)
+			return false;
+	}
+	// 编码器不设全局头时参数集一定带内输出，没有找到说明不是 IDR 首包
+	return found > 0;
+}
+
+// --- 分段拼接 ---
+
+bool ffmpeg_scan_keyframes(const char* path, std::vector<FFmpegKeyframe>& keyframes, long long& totalPackets)
+{
+	keyframes.clear();
+	totalPackets = 0;
+	AVFormatContext* fmt = nullptr;
+	int ret = avformat_open_input(&fmt, path, nullptr, nullptr);
+	if (ret < 0) {
+		log_error("FFmpeg: Failed to open '%s': %s", path, ffmpeg_error_string(ret).c_str());
+		return false;
+	}
+	int videoIndex = -1;
+	if (avformat_find_stream_info(fmt, nullptr) >= 0)
+		videoIndex = av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+	AVPacket* pkt = av_packet_alloc();
+	if (videoIndex < 0 || !pkt) {
+		log_error("FFmpeg: No video stream found in '%s'.", path);
+		av_packet_free(&pkt);
+		avformat_close_input(&fmt);
+		return false;
+	}
+	// 只读需要的流，其余流的包由解封装器直接跳过
+	for (unsigned i = 0; i < fmt->nb_streams; ++i)
+		fmt->streams[i]->discard = static_cast<int>(i) == videoIndex ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+	while (av_read_frame(fmt, pkt) >= 0) {
+		if (pkt->stream_index == videoIndex) {
+			if (pkt->flags & AV_PKT_FLAG_KEY) {
+				FFmpegKeyframe key;
+				key.pts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+				key.packetIndex = totalPackets;
+				keyframes.push_back(key);
+			}
+			totalPackets++;
+		}
+		av_packet_unref(pkt);
+	}
+	av_packet_free(&pkt);
+	avformat_close_input(&fmt);
+	return !keyframes.empty();
+}
+
+// 打开分段或源文件的输入上下文
+static int open_concat_input(const char* path, AVFormatContext** fmt)
+{
+	int ret = avformat_open_input(fmt, path, nullptr, nullptr);
+	if (ret < 0)
+		return ret;
+	ret = avformat_find_stream_info(*fmt, nullptr);
+	if (ret < 0)
+		avformat_close_input(fmt);
+	return ret;
+}
+
+int ffmpeg_concat_segments(const std::vector<std::string>& segments, const std::vector<long long>& startPts,
+                           const char* sourcePath, const char* outputFile, bool copyAudio)
+{
+	if (segments.empty() || segments.size() != startPts.size())
+		return AVERROR(EINVAL);
+
+	AVFormatContext* source = nullptr;
+	AVFormatContext* seg = nullptr;
+	AVFormatContext* out = nullptr;
+	AVPacket* pkt = av_packet_alloc();
+	AVPacket* audioPkt = av_packet_alloc();
+	std::vector<int> audioMap;   // 源文件流下标 -> 输出流下标，-1 表示丢弃
+	AVRational sourceVideoTb = {1, 1};
+	bool audioPending = false, audioEof = true;
+	int64_t lastDts = AV_NOPTS_VALUE;
+	int ret = pkt && audioPkt ? 0 : AVERROR(ENOMEM);
+
+	// 把源文件中时间不晚于 limit（输出视频时间基）的音频包写出；limit 为 AV_NOPTS_VALUE 时写完全部音频
+	auto write_audio_until = [&](int64_t limit, AVRational limitTb) -> int {
+		while (!audioEof) {
+			if (!audioPending) {
+				int err = av_read_frame(source, audioPkt);
+				if (err < 0) {
+					audioEof = true;
+					break;
+				}
+				if (audioPkt->stream_index >= static_cast<int>(audioMap.size()) || audioMap[audioPkt->stream_index] < 0) {
+					av_packet_unref(audioPkt);
+					continue;
+				}
+				audioPending = true;
+			}
+			AVStream* in = source->streams[audioPkt->stream_index];
+			int64_t ts = audioPkt->dts != AV_NOPTS_VALUE ? audioPkt->dts : audioPkt->pts;
+			if (limit != AV_NOPTS_VALUE && ts != AV_NOPTS_VALUE && av_compare_ts(ts, in->time_base, limit, limitTb) > 0)
+				break;
+			AVStream* o = out->streams[audioMap[audioPkt->stream_index]];
+			av_packet_rescale_ts(audioPkt, in->time_base, o->time_base);
+			audioPkt->stream_index = o->index;
+			audioPkt->pos = -1;
+			audioPending = false;
+			int err = av_interleaved_write_frame(out, audioPkt);
+			if (err < 0)
+				return err;
+		}
+		return 0;
+	};
+
+	// 以第 0 段的编码参数作为输出视频流参数
+	if (ret >= 0)
+		ret = open_concat_input(segments[0].c_str(), &seg);
+	int segVideo = ret >= 0 ? av_find_best_stream(seg, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0) : -1;
+	if (ret >= 0 && segVideo < 0)
+		ret = AVERROR_STREAM_NOT_FOUND;
+	if (ret >= 0)
+		ret = avformat_alloc_output_context2(&out, nullptr, nullptr, outputFile);
+	AVStream* videoOut = ret >= 0 ? avformat_new_stream(out, nullptr) : nullptr;
+	if (ret >= 0 && !videoOut)
+		ret = AVERROR(ENOMEM);
+	std::vector<uint8_t> extradata;
+	if (ret >= 0) {
+		AVStream* in = seg->streams[segVideo];
+		ret = avcodec_parameters_copy(videoOut->codecpar, in->codecpar);
+		videoOut->codecpar->codec_tag = 0;
+		videoOut->time_base = in->time_base;
+		videoOut->avg_frame_rate = in->avg_frame_rate;
+		if (in->codecpar->extradata_size > 0)
+			extradata.assign(in->codecpar->extradata, in->codecpar->extradata + in->codecpar->extradata_size);
+	}
+
+	if (ret >= 0) {
+		ret = open_concat_input(sourcePath, &source);
+		int sourceVideo = ret >= 0 ? av_find_best_stream(source, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0) : -1;
+		if (ret >= 0 && sourceVideo < 0)
+			ret = AVERROR_STREAM_NOT_FOUND;
+		if (ret >= 0) {
+			sourceVideoTb = source->streams[sourceVideo]->time_base;
+			audioMap.assign(source->nb_streams, -1);
+			for (unsigned i = 0; i < source->nb_streams; ++i) {
+				AVStream* in = source->streams[i];
+				if (!copyAudio || in->codecpar->codec_type != AVMEDIA_TYPE_AUDIO) {
+					in->discard = AVDISCARD_ALL;
+					continue;
+				}
+				if (avformat_query_codec(out->oformat, in->codecpar->codec_id, FF_COMPLIANCE_NORMAL) == 0) {
+					log_warn("FFmpeg: Container '%s' cannot hold %s audio, audio stream %u dropped.",
+					         out->oformat->name, avcodec_get_name(in->codecpar->codec_id), i);
+					in->discard = AVDISCARD_ALL;
+					continue;
+				}
+				AVStream* o = avformat_new_stream(out, nullptr);
+				if (!o || avcodec_parameters_copy(o->codecpar, in->codecpar) < 0) {
+					ret = AVERROR(ENOMEM);
+					break;
+				}
+				o->codecpar->codec_tag = 0;
+				o->time_base = in->time_base;
+				audioMap[i] = o->index;
+				audioEof = false;
+			}
+		}
+	}
+
+	if (ret >= 0 && !(out->oformat->flags & AVFMT_NOFILE))
+		ret = avio_open(&out->pb, outputFile, AVIO_FLAG_WRITE);
+	bool headerWritten = false;
+	if (ret >= 0) {
+		ret = avformat_write_header(out, nullptr);
+		headerWritten = ret >= 0;
+	}
+
+	for (size_t i = 0; ret >= 0 && i < segments.size(); ++i) {
+		if (i > 0) {
+			avformat_close_input(&seg);
+			ret = open_concat_input(segments[i].c_str(), &seg);
+			segVideo = ret >= 0 ? av_find_best_stream(seg, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0) : -1;
+			if (ret >= 0 && segVideo < 0)
+				ret = AVERROR_STREAM_NOT_FOUND;
+			if (ret < 0)
+				break;
+			// 各段独立编码，参数集必须一致才能共用同一个 extradata
+			const AVCodecParameters* par = seg->streams[segVideo]->codecpar;
+			if (par->extradata_size != static_cast<int>(extradata.size()) ||
+			    (par->extradata_size > 0 && memcmp(par->extradata, extradata.data(), extradata.size()) != 0) ||
+			    par->width != videoOut->codecpar->width || par->height != videoOut->codecpar->height) {
+				log_warn("FFmpeg: Segment '%s' has different codec parameters and cannot be concatenated.", segments[i].c_str());
+				ret = AVERROR(EINVAL);
+				break;
+			}
+		}
+		AVStream* in = seg->streams[segVideo];
+		// 段内时间戳可能被封装器平移过，以首个关键帧对齐到该段的计划起点
+		const int64_t anchor = av_rescale_q(startPts[i], sourceVideoTb, videoOut->time_base);
+		int64_t offset = AV_NOPTS_VALUE;
+		while (ret >= 0 && av_read_frame(seg, pkt) >= 0) {
+			if (pkt->stream_index != segVideo) {
+				av_packet_unref(pkt);
+				continue;
+			}
+			av_packet_rescale_ts(pkt, in->time_base, videoOut->time_base);
+			if (offset == AV_NOPTS_VALUE)
+				offset = pkt->pts != AV_NOPTS_VALUE ? anchor - pkt->pts : 0;
+			if (pkt->pts != AV_NOPTS_VALUE)
+				pkt->pts += offset;
+			if (pkt->dts != AV_NOPTS_VALUE)
+				pkt->dts += offset;
+			// 段与段交界处保证 dts 严格递增
+			if (pkt->dts != AV_NOPTS_VALUE) {
+				if (lastDts != AV_NOPTS_VALUE && pkt->dts <= lastDts)
+					pkt->dts = lastDts + 1;
+				if (pkt->pts != AV_NOPTS_VALUE && pkt->pts < pkt->dts)
+					pkt->pts = pkt->dts;
+				lastDts = pkt->dts;
+			}
+			// 先写出该视频包之前的音频；缺 dts 时退而用 pts 或上一个有效 dts，都没有时不写，
+			// 不能以 AV_NOPTS_VALUE 调用（那表示写出全部剩余音频，会破坏交织）
+			const int64_t clock = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts != AV_NOPTS_VALUE ? pkt->pts : lastDts;
+			if (clock != AV_NOPTS_VALUE)
+				ret = write_audio_until(clock, videoOut->time_base);
+			if (ret < 0) {
+				av_packet_unref(pkt);
+				break;
+			}
+			pkt->stream_index = videoOut->index;
+			pkt->pos = -1;
+			ret = av_interleaved_write_frame(out, pkt);
+		}
+	}
+	if (ret >= 0)
+		ret = write_audio_until(AV_NOPTS_VALUE, videoOut->time_base);
+
+	if (headerWritten) {
+		int trailer = av_write_trailer(out);
+		if (ret >= 0)
+			ret = trailer;
+	}
+	if (ret < 0)
+		log_error("FFmpeg: Failed to concatenate segments into '%s': %s", outputFile, ffmpeg_error_string(ret).c_str());
+	if (out) {
+		if (!(out->oformat->flags & AVFMT_NOFILE))
+			avio_closep(&out->pb);
+		avformat_free_context(out);
+	}
+	avformat_close_input(&seg);
+	avformat_close_input(&source);
+	av_packet_free(&pkt);
+	av_packet_free(&audioPkt);
+	return ret < 0 ? ret : 0;
+}
+
+#endif // ANONYMIZATION_WITH_FFMPEG
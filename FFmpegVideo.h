@@ -0,0 +1,163 @@
+#ifndef FFMPEG_VIDEO_H
+#define FFMPEG_VIDEO_H
+
+// 基于 libavformat/libavcodec 的视频读写后端，仅在定义 ANONYMIZATION_WITH_FFMPEG 时编译
+#ifdef ANONYMIZATION_WITH_FFMPEG
+
+#include <string>
+#include <vector>
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVStream;
+struct AVPacket;
+struct AVFrame;
+struct AVCodecParameters;
+struct SwsContext;
+
+/**
+ * @brief 视频编码参数
+ */
+struct FFmpegEncodeConfig {
+	std::string encoder;     // 编码器名称，如 "libx264"、"libx265"
+	std::string preset;      // x264/x265 preset，为空使用编码器默认值
+	int crf = 23;            // 恒定质量因子，<0 表示使用编码器默认值
+	int threads = 0;         // 编码线程数，0 表示自动
+	bool copyAudio = true;   // 是否原样复制音频流
+	bool copyVideo = false;  // 视频流也原样复制（GOP 直通），此时不打开编码器
+};
+
+/**
+ * @brief 解封装 + 帧级多线程解码，输出 YUV420P 帧
+ */
+class FFmpegReader
+{
+public:
+	FFmpegReader();
+	~FFmpegReader();
+	FFmpegReader(const FFmpegReader&) = delete;
+	FFmpegReader& operator=(const FFmpegReader&) = delete;
+
+	bool open(const char* path, int decodeThreads);
+	void close();
+
+	// 读取下一个数据包（任意流），结束返回 AVERROR_EOF
+	int read_packet(AVPacket* pkt);
+	// 把视频包送入解码器，pkt 为 nullptr 表示冲刷
+	int send_packet(const AVPacket* pkt);
+	// 取出一帧解码结果，统一为 YUV420P；没有可用帧返回 AVERROR(EAGAIN)/AVERROR_EOF
+	int receive_frame(AVFrame* frame);
+	// 从头重新定位到不晚于 timestamp（视频流时间基）的关键帧
+	bool seek(long long timestamp);
+	// 清空解码器内部状态，之后可从新的关键帧重新送包
+	void flush();
+
+	AVFormatContext* format_context() const { return this->fmt; }
+	AVStream* video_stream() const;
+	int video_stream_index() const { return this->videoIndex; }
+	int width() const;
+	int height() const;
+	double fps() const;
+	long long frame_count() const;
+	const char* codec_name() const;
+
+private:
+	AVFormatContext* fmt;
+	AVCodecContext* dec;
+	SwsContext* sws;
+	AVFrame* decoded;
+	int videoIndex;
+};
+
+/**
+ * @brief 编码 + 封装，视频重新编码，音频流原样复制
+ */
+class FFmpegWriter
+{
+public:
+	FFmpegWriter();
+	~FFmpegWriter();
+	FFmpegWriter(const FFmpegWriter&) = delete;
+	FFmpegWriter& operator=(const FFmpegWriter&) = delete;
+
+	bool open(const char* path, const FFmpegReader& input, const FFmpegEncodeConfig& config);
+	// 编码一帧（pts 为输入视频流时间基），frame 为 nullptr 表示冲刷编码器
+	int write_frame(AVFrame* frame);
+	// 原样写入输入文件中的数据包（音频复制），自动换算时间基
+	int write_copied_packet(AVPacket* pkt);
+	// 冲刷编码器并写文件尾
+	int finish();
+	void close();
+
+	bool has_output_stream(int inputStreamIndex) const;
+
+private:
+	int drain_encoder();
+
+	AVFormatContext* fmt;
+	AVCodecContext* enc;
+	AVStream* videoOut;
+	AVPacket* pkt;
+	const AVFormatContext* inputFmt;
+	int inputVideoIndex;
+	std::vector<int> streamMap;   // 输入流下标 -> 输出流下标，-1 表示丢弃
+	bool headerWritten;
+	bool finished;
+	long long lastPts;
+	long long frameDuration;      // 一帧在编码器时间基下的时长
+};
+
+/**
+ * @brief 独立的视频编码器，编码结果以数据包形式返回而不直接写文件
+ * 参数集带内输出（不设置全局头），profile/level 沿用输入，用于把重新编码的片段拼接进原始码流
+ */
+class FFmpegEncoder
+{
+public:
+	FFmpegEncoder();
+	~FFmpegEncoder();
+	FFmpegEncoder(const FFmpegEncoder&) = delete;
+	FFmpegEncoder& operator=(const FFmpegEncoder&) = delete;
+
+	// maxBFrames/gopSize < 0 或 0 时使用编码器默认值
+	bool open(const FFmpegReader& input, const FFmpegEncodeConfig& config, int maxBFrames, int gopSize);
+	// 编码一帧，frame 为 nullptr 表示冲刷；产生的数据包追加到 out，由调用者释放
+	int encode(const AVFrame* frame, std::vector<AVPacket*>& out);
+	void close();
+
+private:
+	AVCodecContext* enc;
+	AVPacket* pkt;
+};
+
+// 输入为 avcC/hvcC 封装时返回 NAL 长度字段字节数，Annex B 输入返回 0
+int ffmpeg_nal_length_size(const AVCodecParameters* par);
+// 把编码器输出的 Annex B 数据包原地转换为长度前缀格式；nalLengthSize 为 0 时不做处理
+int ffmpeg_annexb_to_length_prefixed(AVPacket* pkt, int nalLengthSize);
+// 编码器输出的 Annex B 关键帧包中的参数集（SPS/PPS，H.265 另含 VPS）是否都与输入 extradata 中的逐字节一致；
+// 不一致的片段不能直接拼接进沿用输入 extradata 的码流
+bool ffmpeg_parameter_sets_match(const AVCodecParameters* par, const AVPacket* pkt);
+
+/**
+ * @brief 视频流关键帧位置（仅解封装，不解码）
+ */
+struct FFmpegKeyframe {
+	long long pts;           // 视频流时间基，缺失时为 dts
+	long long packetIndex;   // 在视频流中的包序号
+};
+
+// 扫描视频流全部关键帧，totalPackets 返回视频包总数
+bool ffmpeg_scan_keyframes(const char* path, std::vector<FFmpegKeyframe>& keyframes, long long& totalPackets);
+
+// 把若干只含视频的分段文件按顺序不重新编码地拼接为 outputFile；
+// startPts[i] 为第 i 段首帧在源视频流时间基下的时间戳，用于对齐各段时间轴；
+// copyAudio 时从 sourcePath 复制音频流并按时间戳交织。各段 extradata 不一致时返回 AVERROR(EINVAL)
+int ffmpeg_concat_segments(const std::vector<std::string>& segments, const std::vector<long long>& startPts,
+                           const char* sourcePath, const char* outputFile, bool copyAudio);
+
+// 把 FFmpeg 错误码转换为可读字符串
+std::string ffmpeg_error_string(int errnum);
+
+#endif // ANONYMIZATION_WITH_FFMPEG
+
+#endif // FFMPEG_VIDEO_H
@@ -0,0 +1,230 @@
+#include "FrameConvert.h"
+#include "log/log.h"
+#include "SimdKernels.h"
+#include <opencv2/imgproc.hpp>
+#include <cstring>
+
+int image_frame_to_bgr(const ImageFrame* image, cv::Mat& frame_bgr) {
+    // --- Convert ImageFrame To cv::Mat (BGR) ---
+    switch (image->format) {
+        case IMG_FORMAT_BGR:
+            if (image->strides[0] < image->width * 3) {
+                log_error("image_frame_to_bgr: BGR stride[0] (%d) is less than width*channels (%d).", image->strides[0], image->width * 3);
+                return INVALID_PARAMETER;
+            }
+            frame_bgr = cv::Mat(image->height, image->width, CV_8UC3, image->data[0], image->strides[0]);
+            break;
+
+        case IMG_FORMAT_RGB: // New case
+            if (image->strides[0] < image->width * 3) {
+                log_error("image_frame_to_bgr: RGB stride[0] (%d) is less than width*channels (%d).", image->strides[0], image->width * 3);
+                return INVALID_PARAMETER;
+            }
+            {
+                cv::Mat rgbMat(image->height, image->width, CV_8UC3, image->data[0], image->strides[0]);
+                cv::cvtColor(rgbMat, frame_bgr, cv::COLOR_RGB2BGR);
+            }
+            break;
+
+        case IMG_FORMAT_ARGB:
+            if (image->strides[0] < image->width * 4) {
+                log_error("image_frame_to_bgr: ARGB stride[0] (%d) is less than width*channels (%d).", image->strides[0], image->width * 4);
+                return INVALID_PARAMETER;
+            }
+            {
+                cv::Mat bgraMat(image->height, image->width, CV_8UC4, image->data[0], image->strides[0]);
+                if (bgraMat.empty()) {
+                    log_error("image_frame_to_bgr: Failed to create BGRA cv::Mat from ImageFrame.");
+                    return LOAD_IMAGE_ERROR;
+                }
+                cv::cvtColor(bgraMat, frame_bgr, cv::COLOR_BGRA2BGR);
+            }
+            break;
+
+        case IMG_FORMAT_GRAY: // New case
+            if (image->strides[0] < image->width) {
+                log_error("image_frame_to_bgr: GRAY stride[0] (%d) is less than width (%d).", image->strides[0], image->width);
+                return INVALID_PARAMETER;
+            }
+            {
+                cv::Mat grayMat(image->height, image->width, CV_8UC1, image->data[0], image->strides[0]);
+                cv::cvtColor(grayMat, frame_bgr, cv::COLOR_GRAY2BGR);
+            }
+            break;
+
+        case IMG_FORMAT_YUV420P:
+            if (!image->data[0] || !image->data[1] || !image->data[2]) {
+                log_error("image_frame_to_bgr: YUV420P data planes are not all valid.");
+                return INVALID_PARAMETER;
+            }
+            if (image->strides[0] < image->width || image->strides[1] < image->width / 2 || image->strides[2] < image->width / 2) {
+                log_error("image_frame_to_bgr: YUV420P strides are invalid for the given width.");
+                return INVALID_PARAMETER;
+            }
+            {
+                cv::Mat yuvMat(image->height * 3 / 2, image->width, CV_8UC1);
+                uint8_t* dst_y = yuvMat.data;
+                uint8_t* dst_u = dst_y + static_cast<size_t>(image->height) * image->width;
+                uint8_t* dst_v = dst_u + static_cast<size_t>(image->height / 2) * (image->width / 2);
+                // Copy Y, U, and V planes row by row to handle custom strides
+                for (int r = 0; r < image->height; ++r) memcpy(dst_y + r * image->width, image->data[0] + r * image->strides[0], image->width);
+                for (int r = 0; r < image->height / 2; ++r) memcpy(dst_u + r * (image->width / 2), image->data[1] + r * image->strides[1], image->width / 2);
+                for (int r = 0; r < image->height / 2; ++r) memcpy(dst_v + r * (image->width / 2), image->data[2] + r * image->strides[2], image->width / 2);
+                cv::cvtColor(yuvMat, frame_bgr, cv::COLOR_YUV2BGR_I420);
+            }
+            break;
+
+        case IMG_FORMAT_YUV420SP: { // New case (assuming NV12: Y plane, then interleaved UV plane)
+            if (!image->data[0] || !image->data[1]) {
+                log_error("image_frame_to_bgr: YUV420SP data planes are not valid.");
+                return INVALID_PARAMETER;
+            }
+            if (image->strides[0] < image->width || image->strides[1] < image->width) { // UV stride is usually width
+                log_error("image_frame_to_bgr: YUV420SP strides are invalid for the given width.");
+                return INVALID_PARAMETER;
+            }
+            cv::Mat yuvMat(image->height * 3 / 2, image->width, CV_8UC1);
+            // Copy Y plane
+            for (int r = 0; r < image->height; ++r) {
+                memcpy(yuvMat.data + r * image->width, image->data[0] + r * image->strides[0], image->width);
+            }
+            // Copy interleaved UV plane
+            uint8_t* dst_uv = yuvMat.data + static_cast<size_t>(image->height) * image->width;
+            for (int r = 0; r < image->height / 2; ++r) {
+                memcpy(dst_uv + r * image->width, image->data[1] + r * image->strides[1], image->width);
+            }
+            cv::cvtColor(yuvMat, frame_bgr, cv::COLOR_YUV2BGR_NV12);
+            break;
+        }
+
+        default:
+            log_error("image_frame_to_bgr: Unsupported input image format: %d", static_cast<int>(image->format));
+            return UNSUPPORTED_FORMAT;
+    }
+
+    if (frame_bgr.empty()) {
+        log_error("image_frame_to_bgr: Failed to convert ImageFrame to BGR cv::Mat. Input format was %d.", static_cast<int>(image->format));
+        return LOAD_IMAGE_ERROR;
+    }
+    return ANO_OK;
+}
+
+int bgr_to_image_frame(const cv::Mat& frame_bgr, ImageFrame* image) {
+    switch (image->format) {
+        case IMG_FORMAT_BGR:
+            if (static_cast<int>(frame_bgr.step[0]) != image->strides[0] || frame_bgr.data != image->data[0]) {
+                if (image->strides[0] < frame_bgr.cols * frame_bgr.channels()) return -2; // SAVE_IMAGE_ERROR
+                for (int i = 0; i < frame_bgr.rows; ++i) {
+                    memcpy(image->data[0] + i * image->strides[0], frame_bgr.data + i * frame_bgr.step[0], static_cast<size_t>(frame_bgr.cols) * frame_bgr.channels());
+                }
+            }
+            break;
+
+        case IMG_FORMAT_RGB: { // New case
+            cv::Mat rgbImage;
+            cv::cvtColor(frame_bgr, rgbImage, cv::COLOR_BGR2RGB);
+            if (image->strides[0] < rgbImage.cols * rgbImage.channels()) return -2; // SAVE_IMAGE_ERROR
+            for (int i = 0; i < rgbImage.rows; ++i) {
+                memcpy(image->data[0] + i * image->strides[0], rgbImage.data + i * rgbImage.step[0], static_cast<size_t>(rgbImage.cols) * rgbImage.channels());
+            }
+            break;
+        }
+
+        case IMG_FORMAT_ARGB: {
+            cv::Mat bgraImage;
+            cv::cvtColor(frame_bgr, bgraImage, cv::COLOR_BGR2BGRA);
+            if (bgraImage.empty()) return -1; // INTERNAL_ERROR
+            if (image->strides[0] < bgraImage.cols * bgraImage.channels()) return -2; // SAVE_IMAGE_ERROR
+            for (int i = 0; i < bgraImage.rows; ++i) {
+                memcpy(image->data[0] + i * image->strides[0], bgraImage.data + i * bgraImage.step[0], static_cast<size_t>(bgraImage.cols) * bgraImage.channels());
+            }
+            break;
+        }
+
+        case IMG_FORMAT_GRAY: { // New case
+            cv::Mat grayImage;
+            cv::cvtColor(frame_bgr, grayImage, cv::COLOR_BGR2GRAY);
+            if (image->strides[0] < grayImage.cols) return -2; // SAVE_IMAGE_ERROR
+            for (int i = 0; i < grayImage.rows; ++i) {
+                memcpy(image->data[0] + i * image->strides[0], grayImage.data + i * grayImage.step[0], grayImage.cols);
+            }
+            break;
+        }
+
+        case IMG_FORMAT_YUV420P: {
+            cv::Mat yuv_I420_out;
+            cv::cvtColor(frame_bgr, yuv_I420_out, cv::COLOR_BGR2YUV_I420);
+            if (yuv_I420_out.empty()) return -1; // INTERNAL_ERROR
+            uint8_t* src_y = yuv_I420_out.data;
+            uint8_t* src_u = src_y + static_cast<size_t>(image->width) * image->height;
+            int chroma_w = image->width / 2;
+            int chroma_h = image->height / 2;
+            uint8_t* src_v = src_u + static_cast<size_t>(chroma_w) * chroma_h;
+            if (image->strides[0] < image->width || image->strides[1] < chroma_w || image->strides[2] < chroma_w) return -2; // SAVE_IMAGE_ERROR
+            // Copy Y, U, and V planes back to the ImageFrame buffers
+            for (int r = 0; r < image->height; ++r) memcpy(image->data[0] + r * image->strides[0], src_y + r * image->width, image->width);
+            for (int r = 0; r < chroma_h; ++r) memcpy(image->data[1] + r * image->strides[1], src_u + r * chroma_w, chroma_w);
+            for (int r = 0; r < chroma_h; ++r) memcpy(image->data[2] + r * image->strides[2], src_v + r * chroma_w, chroma_w);
+            break;
+        }
+
+        case IMG_FORMAT_YUV420SP: { // New case (assuming NV12)
+            cv::Mat yuv_NV12_out;
+            // OpenCV doesn't have a direct BGR to NV12. A common way is BGR -> I420 -> NV12.
+            cv::Mat yuv_I420_temp;
+            cv::cvtColor(frame_bgr, yuv_I420_temp, cv::COLOR_BGR2YUV_I420);
+            if (yuv_I420_temp.empty()) return -1; // INTERNAL_ERROR
+
+            // Copy Y plane directly
+            uint8_t* src_y = yuv_I420_temp.data;
+             if (image->strides[0] < image->width) return -2; // SAVE_IMAGE_ERROR
+            for (int r = 0; r < image->height; ++r) {
+                memcpy(image->data[0] + r * image->strides[0], src_y + r * image->width, image->width);
+            }
+
+            // Interleave U and V planes into the UV plane of the ImageFrame
+            uint8_t* src_u = src_y + static_cast<size_t>(image->width) * image->height;
+            int chroma_w = image->width / 2;
+            int chroma_h = image->height / 2;
+            uint8_t* src_v = src_u + static_cast<size_t>(chroma_w) * chroma_h;
+            if (image->strides[1] < image->width) return -2; // SAVE_IMAGE_ERROR
+            for (int r = 0; r < chroma_h; ++r) {
+                simd_interleave_uv(src_u + r * chroma_w, src_v + r * chroma_w, image->data[1] + r * image->strides[1], chroma_w);
+            }
+            break;
+        }
+
+        default:
+            log_error("bgr_to_image_frame: Unsupported output format: %d", static_cast<int>(image->format));
+            return UNSUPPORTED_FORMAT;
+    }
+
+    return ANO_OK;
+}
+
+int image_frame_layout(ImageFormat format, int width, int height, int rowBytes[4], int rows[4]) {
+    for (int i = 0; i < 4; ++i) rowBytes[i] = rows[i] = 0;
+    switch (format) {
+        case IMG_FORMAT_ARGB:
+            rowBytes[0] = width * 4; rows[0] = height;
+            return 1;
+        case IMG_FORMAT_RGB:
+        case IMG_FORMAT_BGR:
+            rowBytes[0] = width * 3; rows[0] = height;
+            return 1;
+        case IMG_FORMAT_GRAY:
+            rowBytes[0] = width; rows[0] = height;
+            return 1;
+        case IMG_FORMAT_YUV420P:
+            rowBytes[0] = width; rows[0] = height;
+            rowBytes[1] = rowBytes[2] = width / 2;
+            rows[1] = rows[2] = height / 2;
+            return 3;
+        case IMG_FORMAT_YUV420SP:
+            rowBytes[0] = width; rows[0] = height;
+            rowBytes[1] = width; rows[1] = height / 2;
+            return 2;
+        default:
+            return 0;
+    }
+}
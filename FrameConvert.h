@@ -0,0 +1,17 @@
+#ifndef FRAME_CONVERT_H
+#define FRAME_CONVERT_H
+
+#include "Anonymization.h"
+#include <opencv2/core.hpp>
+
+// ImageFrame 与 BGR cv::Mat 之间的转换，mem_anonymization 与流式会话共用
+
+// 任意支持的格式转换为 BGR；输入为 BGR 时直接引用原数据，不拷贝
+int image_frame_to_bgr(const ImageFrame* image, cv::Mat& frame_bgr);
+// BGR 写回 image 原有的格式和缓冲区
+int bgr_to_image_frame(const cv::Mat& frame_bgr, ImageFrame* image);
+
+// 按格式计算紧凑排列时各平面的每行字节数和行数，返回平面数，不支持的格式返回 0
+int image_frame_layout(ImageFormat format, int width, int height, int rowBytes[4], int rows[4]);
+
+#endif // FRAME_CONVERT_H
@@ -0,0 +1,285 @@
+#include "ImageBatch.h"
+#include "YOLOv8_face.h"
+#include "PerfStats.h"
+#include "Trace.h"
+#include "log/log.h"
+#include <opencv2/imgcodecs.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <dirent.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct BatchImage {
+    size_t index;
+    cv::Mat image;
+    Clock::time_point start;
+    int boxCount;
+};
+
+class ImageBatchJob
+{
+public:
+    ImageBatchJob(const std::vector<std::string>& inputs, const std::vector<std::string>& outputs,
+                  const BatchOptions& options, std::vector<BatchFileResult>& results)
+        : inputs(inputs), outputs(outputs), options(options), results(results),
+          capacity(static_cast<size_t>(options.detectors * options.maxBatchSize * 2)),
+          nextInput(0), decoding(0), completed(0) {
+    }
+
+    int run(const YOLOv8_face& source) {
+        this->perf = source.perf_counters();
+        std::vector<std::unique_ptr<YOLOv8_face>> models;
+        for (int i = 0; i < this->options.detectors; ++i) {
+            std::unique_ptr<YOLOv8_face> model(new YOLOv8_face());
+            if (model->clone_from(source) != 0) {
+                log_error("batch_image_anonymization: Failed to load model for detector %d.", i);
+                return MODEL_FORMAT_ERROR;
+            }
+            models.push_back(std::move(model));
+        }
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < models.size(); ++i)
+            threads.emplace_back(&ImageBatchJob::detect_loop, this, std::ref(*models[i]));
+        for (int i = 0; i < this->options.workers; ++i)
+            threads.emplace_back(&ImageBatchJob::io_loop, this);
+        for (std::thread& thread : threads) thread.join();
+        return ANO_OK;
+    }
+
+private:
+    void complete(size_t index, int result, int boxCount, Clock::time_point start) {
+        BatchFileResult& r = this->results[index];
+        r.result = result;
+        r.boxCount = boxCount;
+        r.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->completed++;
+        }
+        this->changed.notify_all();
+    }
+
+    void encode(BatchImage& item) {
+        const std::string& path = this->outputs[item.index];
+        std::vector<int> params;
+        if (this->options.jpegQuality > 0) {
+            params.push_back(cv::IMWRITE_JPEG_QUALITY);
+            params.push_back(this->options.jpegQuality);
+        }
+        bool written = false;
+        try {
+            PerfTimer timer(this->perf, PERF_STAGE_ENCODE);
+            written = cv::imwrite(path, item.image, params);
+        } catch (const cv::Exception& e) {
+            log_error("batch_image_anonymization: OpenCV exception during imwrite for '%s': %s", path.c_str(), e.what());
+        }
+        if (!written) log_error("batch_image_anonymization: Failed to save image to '%s'.", path.c_str());
+        item.image.release();
+        this->complete(item.index, written ? ANO_OK : SAVE_IMAGE_ERROR, item.boxCount, item.start);
+    }
+
+    // 优先编码已检测完的图片，否则读取下一个文件；待检测队列满时边等边编码，避免与检测线程互相等待
+    void io_loop() {
+        const size_t total = this->inputs.size();
+        trace_set_thread_name("batch io");
+        std::unique_lock<std::mutex> lock = trace_lock(this->mutex, "batch_mutex");
+        while (true) {
+            {
+                TraceScope idle("wait_work", "wait");
+                this->changed.wait(lock, [&]() {
+                    return !this->detected.empty() || this->nextInput < total || this->completed == total;
+                });
+            }
+            if (!this->detected.empty()) {
+                BatchImage item = std::move(this->detected.front());
+                this->detected.pop_front();
+                lock.unlock();
+                this->encode(item);
+                lock.lock();
+                continue;
+            }
+            if (this->nextInput >= total) break;
+
+            BatchImage item;
+            item.index = this->nextInput++;
+            item.boxCount = 0;
+            this->decoding++;
+            lock.unlock();
+
+            const std::string& path = this->inputs[item.index];
+            item.start = Clock::now();
+            try {
+                PerfTimer timer(this->perf, PERF_STAGE_DECODE);
+                item.image = cv::imread(path, cv::IMREAD_COLOR);
+            } catch (const cv::Exception& e) {
+                log_error("batch_image_anonymization: OpenCV exception during imread for '%s': %s", path.c_str(), e.what());
+            }
+
+            lock.lock();
+            if (item.image.empty()) {
+                log_error("batch_image_anonymization: Failed to load image from '%s'.", path.c_str());
+                this->decoding--;
+                lock.unlock();
+                this->complete(item.index, LOAD_IMAGE_ERROR, 0, item.start);
+                lock.lock();
+                continue;
+            }
+            while (this->pending.size() >= this->capacity) {
+                if (!this->detected.empty()) {
+                    BatchImage done = std::move(this->detected.front());
+                    this->detected.pop_front();
+                    lock.unlock();
+                    this->encode(done);
+                    lock.lock();
+                    continue;
+                }
+                TraceScope stall("wait_queue_space", "wait");
+                this->changed.wait(lock);
+            }
+            this->pending.push_back(std::move(item));
+            this->decoding--;
+            this->changed.notify_all();
+        }
+    }
+
+    void detect_loop(YOLOv8_face& model) {
+        const size_t total = this->inputs.size();
+        const size_t maxBatch = static_cast<size_t>(this->options.maxBatchSize);
+        std::vector<BatchImage> batch;
+        std::vector<cv::Mat> images;
+        std::vector<std::vector<cv::Rect>> boxes;
+        std::vector<std::vector<float>> confidences;
+        trace_set_thread_name("batch detect");
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock = trace_lock(this->mutex, "batch_mutex");
+                TraceScope idle("wait_batch", "wait");
+                auto producing = [&]() { return this->nextInput < total || this->decoding > 0; };
+                this->changed.wait(lock, [&]() { return !this->pending.empty() || !producing(); });
+                if (this->pending.empty()) break;
+                // 还有图片在解码时稍等片刻凑批
+                if (this->pending.size() < maxBatch && producing())
+                    this->changed.wait_for(lock, std::chrono::milliseconds(5), [&]() { return this->pending.size() >= maxBatch || !producing(); });
+                while (!this->pending.empty() && batch.size() < maxBatch) {
+                    batch.push_back(std::move(this->pending.front()));
+                    this->pending.pop_front();
+                }
+            }
+            this->changed.notify_all();
+
+            images.clear();
+            for (const BatchImage& item : batch) images.push_back(item.image);
+            try {
+                model.detect_boxes_batch(images, boxes, confidences);
+                for (size_t i = 0; i < batch.size(); ++i) {
+                    batch[i].boxCount = static_cast<int>(boxes[i].size());
+                    if (!boxes[i].empty() && this->options.blurType != BLUR_TYPE_NONE)
+                        model.redact(batch[i].image, boxes[i], this->options.blurType);
+                }
+            } catch (const std::exception& e) {
+                log_error("batch_image_anonymization: Exception during detection of %zu images: %s", batch.size(), e.what());
+                for (BatchImage& item : batch) {
+                    this->complete(item.index, INTERNAL_ERROR, 0, item.start);
+                    item.image.release();
+                }
+                batch.clear();
+                continue;
+            }
+
+            {
+                std::unique_lock<std::mutex> lock = trace_lock(this->mutex, "batch_mutex");
+                for (BatchImage& item : batch) this->detected.push_back(std::move(item));
+            }
+            batch.clear();
+            this->changed.notify_all();
+        }
+    }
+
+    const std::vector<std::string>& inputs;
+    const std::vector<std::string>& outputs;
+    const BatchOptions& options;
+    std::vector<BatchFileResult>& results;
+    const size_t capacity;                 // 待检测队列上限，限制同时驻留内存的解码图像数
+    PerfCounters* perf = nullptr;          // 句柄的性能统计，与检测实例共享
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<BatchImage> pending;        // 已解码、待检测
+    std::deque<BatchImage> detected;       // 已脱敏、待编码
+    size_t nextInput;
+    size_t decoding;                       // 正在解码的线程数
+    size_t completed;
+};
+
+} // namespace
+
+int run_image_batch(const YOLOv8_face& source,
+                    const std::vector<std::string>& inputs,
+                    const std::vector<std::string>& outputs,
+                    const BatchOptions& options,
+                    std::vector<BatchFileResult>& results) {
+    results.assign(inputs.size(), BatchFileResult());
+    if (inputs.empty()) return ANO_OK;
+
+    const Clock::time_point start = Clock::now();
+    ImageBatchJob job(inputs, outputs, options, results);
+    int ret = job.run(source);
+    if (ret != ANO_OK) return ret;
+
+    size_t failed = 0;
+    for (const BatchFileResult& r : results) {
+        if (r.result != ANO_OK) failed++;
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    log_info("batch_image_anonymization: %zu images (%zu failed) in %.2f s, %.1f images/s, workers: %d, detectors: %d, max batch: %d.",
+             inputs.size(), failed, seconds, seconds > 0 ? inputs.size() / seconds : 0.0,
+             options.workers, options.detectors, options.maxBatchSize);
+    return ANO_OK;
+}
+
+bool list_directory_images(const char* directory, const char* patterns, std::vector<std::string>& names) {
+    names.clear();
+    std::vector<std::string> globs;
+    std::stringstream ss(patterns);
+    std::string glob;
+    while (std::getline(ss, glob, ';')) {
+        if (!glob.empty()) globs.push_back(glob);
+    }
+
+    DIR* dir = opendir(directory);
+    if (dir == nullptr) {
+        log_error("directory_image_anonymization: Cannot open directory '%s'.", directory);
+        return false;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        bool matched = false;
+        for (const std::string& g : globs) {
+            if (fnmatch(g.c_str(), name.c_str(), FNM_CASEFOLD) == 0) {
+                matched = true;
+                break;
+            }
+        }
+        if (!matched) continue;
+        struct stat st;
+        const std::string path = std::string(directory) + "/" + name;
+        if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) names.push_back(name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    return true;
+}
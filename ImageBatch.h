@@ -0,0 +1,26 @@
+#ifndef IMAGE_BATCH_H
+#define IMAGE_BATCH_H
+
+#include "Anonymization.h"
+
+#include <string>
+#include <vector>
+
+class YOLOv8_face;
+
+/**
+ * @brief 批量图片脱敏：解码/编码线程与检测线程组成流水线
+ * workers 个 I/O 线程读取并解码图片放入有界的待检测队列，优先把已检测完的图片编码写出；
+ * detectors 个检测线程各持有一份模型，每次从队列取至多 maxBatchSize 张合批推理并脱敏。
+ * results 与 inputs 一一对应，单个文件失败不影响其他文件
+ */
+int run_image_batch(const YOLOv8_face& source,
+                    const std::vector<std::string>& inputs,
+                    const std::vector<std::string>& outputs,
+                    const BatchOptions& options,
+                    std::vector<BatchFileResult>& results);
+
+// 列出目录下文件名匹配 patterns（以 ';' 分隔的通配符，不区分大小写）的普通文件，按文件名排序，不递归
+bool list_directory_images(const char* directory, const char* patterns, std::vector<std::string>& names);
+
+#endif // IMAGE_BATCH_H
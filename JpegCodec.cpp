@@ -0,0 +1,724 @@
+#include "JpegCodec.h"
+
+#ifdef ANONYMIZATION_WITH_LIBJPEG
+
+#include "Anonymization.h"
+#include "YOLOv8_face.h"
+#include "log/log.h"
+#include <opencv2/imgcodecs.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+
+#include <jpeglib.h>
+
+#ifndef JCS_EXTENSIONS
+#error "The JPEG fast path requires libjpeg-turbo (JCS_EXT_BGR output)."
+#endif
+
+namespace {
+
+// libjpeg 默认出错时 exit()，改为 longjmp 回调用处；警告不输出到 stderr
+struct JpegErrorManager {
+    jpeg_error_mgr pub;
+    jmp_buf jump;
+    char message[JMSG_LENGTH_MAX];
+};
+
+void jpeg_error_exit(j_common_ptr cinfo) {
+    JpegErrorManager* err = reinterpret_cast<JpegErrorManager*>(cinfo->err);
+    (*cinfo->err->format_message)(cinfo, err->message);
+    longjmp(err->jump, 1);
+}
+
+void jpeg_output_message(j_common_ptr) {
+}
+
+void init_error_manager(JpegErrorManager& jerr) {
+    jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = jpeg_error_exit;
+    jerr.pub.output_message = jpeg_output_message;
+    jerr.message[0] = '\0';
+}
+
+unsigned read_u16(const uint8_t* p, bool bigEndian) {
+    return bigEndian ? (p[0] << 8) | p[1] : (p[1] << 8) | p[0];
+}
+
+unsigned read_u32(const uint8_t* p, bool bigEndian) {
+    return bigEndian ? (static_cast<unsigned>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3]
+                     : (static_cast<unsigned>(p[3]) << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+}
+
+// 解析 APP1 中 EXIF IFD0 的 Orientation 标签，没有或解析失败返回 1
+int exif_orientation(const uint8_t* data, size_t size) {
+    size_t pos = 2;
+    while (pos + 4 <= size && data[pos] == 0xFF) {
+        const uint8_t marker = data[pos + 1];
+        if (marker == 0xDA || marker == 0xD9) break;   // 扫描数据开始，后面不会再有 APP 段
+        const size_t length = read_u16(data + pos + 2, true);
+        if (length < 2 || pos + 2 + length > size) break;
+        const uint8_t* seg = data + pos + 4;
+        const size_t segSize = length - 2;
+        if (marker == 0xE1 && segSize >= 14 && memcmp(seg, "Exif\0\0", 6) == 0) {
+            const uint8_t* tiff = seg + 6;
+            const size_t tiffSize = segSize - 6;
+            const bool bigEndian = tiff[0] == 'M';
+            const size_t ifd = read_u32(tiff + 4, bigEndian);
+            if (ifd + 2 > tiffSize) return 1;
+            const unsigned entries = read_u16(tiff + ifd, bigEndian);
+            for (unsigned i = 0; i < entries; ++i) {
+                const size_t entry = ifd + 2 + static_cast<size_t>(i) * 12;
+                if (entry + 12 > tiffSize) break;
+                if (read_u16(tiff + entry, bigEndian) == 0x0112) {
+                    const int value = static_cast<int>(read_u16(tiff + entry + 8, bigEndian));
+                    return value >= 1 && value <= 8 ? value : 1;
+                }
+            }
+            return 1;
+        }
+        pos += 2 + length;
+    }
+    return 1;
+}
+
+/*
+ * 输出中保留的 APPn/COM 段：只保留影响解码和显示颜色的 JFIF（APP0）、ICC 配置（APP2）和 Adobe（APP14）。
+ * EXIF/XMP（APP1）中有未脱敏的缩略图和 GPS 等信息，JFXX 扩展也可能带缩略图，注释段内容不可控，一律丢弃
+ */
+bool keep_marker_segment(int marker, const uint8_t* payload, size_t length) {
+    if (marker == JPEG_APP0) return length >= 5 && memcmp(payload, "JFIF", 5) == 0;
+    if (marker == JPEG_APP0 + 2) return length >= 12 && memcmp(payload, "ICC_PROFILE", 12) == 0;
+    if (marker == JPEG_APP0 + 14) return length >= 5 && memcmp(payload, "Adobe", 5) == 0;
+    return !(marker == JPEG_COM || (marker >= JPEG_APP0 && marker <= JPEG_APP0 + 15));
+}
+
+bool has_jpeg_extension(const char* path) {
+    std::string ext = path;
+    const size_t dot = ext.find_last_of('.');
+    if (dot == std::string::npos) return false;
+    ext = ext.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == "jpg" || ext == "jpeg";
+}
+
+// 正向 DCT 基函数 c[u][x] = C(u)/2 * cos((2x+1)uπ/16)
+struct DctTable {
+    float c[8][8];
+    DctTable() {
+        for (int u = 0; u < 8; ++u) {
+            const double scale = u == 0 ? std::sqrt(0.125) : 0.5;
+            for (int x = 0; x < 8; ++x) c[u][x] = static_cast<float>(scale * std::cos((2 * x + 1) * u * M_PI / 16.0));
+        }
+    }
+};
+
+// 8x8 电平偏移后的样本做正向 DCT 并用量化表量化，系数为自然顺序
+void forward_dct_quantize(const float samples[8][8], const JQUANT_TBL* quant, JCOEF* coef) {
+    static const DctTable table;
+    float tmp[8][8];
+    for (int y = 0; y < 8; ++y) {
+        for (int u = 0; u < 8; ++u) {
+            float sum = 0;
+            for (int x = 0; x < 8; ++x) sum += table.c[u][x] * samples[y][x];
+            tmp[y][u] = sum;
+        }
+    }
+    for (int v = 0; v < 8; ++v) {
+        for (int u = 0; u < 8; ++u) {
+            float sum = 0;
+            for (int y = 0; y < 8; ++y) sum += table.c[v][y] * tmp[y][u];
+            coef[v * 8 + u] = static_cast<JCOEF>(std::lround(sum / quant->quantval[v * 8 + u]));
+        }
+    }
+}
+
+/**
+ * @brief 持有原图的 DCT 系数，按 MCU 对齐的矩形解码像素、重新量化写回，最后整体输出
+ * 每个调用 libjpeg 的成员函数各自设置 setjmp，出错时不跨越带析构的局部对象
+ */
+class JpegBlockRedactor
+{
+public:
+    JpegBlockRedactor(const uint8_t* data, size_t size)
+        : data(data), size(size), created(false), coefficients(nullptr), mcuWidth(0), mcuHeight(0) {
+        init_error_manager(this->srcErr);
+        this->src.err = &this->srcErr.pub;
+    }
+
+    ~JpegBlockRedactor() {
+        if (this->created) jpeg_destroy_decompress(&this->src);
+    }
+
+    // 读取全部 DCT 系数和需要保留的 APPn 段；不支持的色彩空间返回 false
+    bool read() {
+        if (setjmp(this->srcErr.jump)) {
+            log_error("jpeg_redact_blocks: %s", this->srcErr.message);
+            return false;
+        }
+        jpeg_create_decompress(&this->src);
+        this->created = true;
+        jpeg_mem_src(&this->src, this->data, static_cast<unsigned long>(this->size));
+        for (int m : {0, 2, 14}) jpeg_save_markers(&this->src, JPEG_APP0 + m, 0xFFFF);
+        jpeg_read_header(&this->src, TRUE);
+        const bool ycc = this->src.jpeg_color_space == JCS_YCbCr && this->src.num_components == 3;
+        const bool gray = this->src.jpeg_color_space == JCS_GRAYSCALE && this->src.num_components == 1;
+        if (!ycc && !gray) return false;
+        this->coefficients = jpeg_read_coefficients(&this->src);
+        this->mcuWidth = this->src.max_h_samp_factor * DCTSIZE;
+        this->mcuHeight = this->src.max_v_samp_factor * DCTSIZE;
+        return true;
+    }
+
+    int width() const { return static_cast<int>(this->src.image_width); }
+    int height() const { return static_cast<int>(this->src.image_height); }
+    int mcu_width() const { return this->mcuWidth; }
+    int mcu_height() const { return this->mcuHeight; }
+
+    // 解码 MCU 对齐的矩形 rect 为 BGR，超出图像的部分按边缘像素复制；bgr 由调用者按 rect 大小分配，
+    // rowBuffer 至少 width()*3 字节
+    bool decode_region(const cv::Rect& rect, cv::Mat& bgr, uint8_t* rowBuffer) {
+        jpeg_decompress_struct cinfo;
+        JpegErrorManager jerr;
+        init_error_manager(jerr);
+        cinfo.err = &jerr.pub;
+        const int validWidth = std::min(rect.width, this->width() - rect.x);
+        const int validHeight = std::min(rect.height, this->height() - rect.y);
+        if (setjmp(jerr.jump)) {
+            log_error("jpeg_redact_blocks: %s", jerr.message);
+            jpeg_destroy_decompress(&cinfo);
+            return false;
+        }
+        jpeg_create_decompress(&cinfo);
+        jpeg_mem_src(&cinfo, this->data, static_cast<unsigned long>(this->size));
+        jpeg_read_header(&cinfo, TRUE);
+        cinfo.out_color_space = JCS_EXT_BGR;
+        jpeg_start_decompress(&cinfo);
+        // 裁剪起点会被调整到 iMCU 边界，rect 本身已对齐，这里只会扩大宽度
+        JDIMENSION xoffset = static_cast<JDIMENSION>(rect.x);
+        JDIMENSION cropWidth = static_cast<JDIMENSION>(validWidth);
+        jpeg_crop_scanline(&cinfo, &xoffset, &cropWidth);
+        if (rect.y > 0) jpeg_skip_scanlines(&cinfo, static_cast<JDIMENSION>(rect.y));
+        const size_t skip = static_cast<size_t>(rect.x - static_cast<int>(xoffset)) * 3;
+        for (int r = 0; r < validHeight; ++r) {
+            JSAMPROW row = rowBuffer;
+            jpeg_read_scanlines(&cinfo, &row, 1);
+            memcpy(bgr.ptr<uchar>(r), rowBuffer + skip, static_cast<size_t>(validWidth) * 3);
+        }
+        jpeg_abort_decompress(&cinfo);
+        jpeg_destroy_decompress(&cinfo);
+
+        for (int r = 0; r < rect.height; ++r) {
+            uchar* dst = bgr.ptr<uchar>(r);
+            if (r >= validHeight) memcpy(dst, bgr.ptr<uchar>(validHeight - 1), static_cast<size_t>(rect.width) * 3);
+            for (int x = validWidth; x < rect.width; ++x) memcpy(dst + x * 3, dst + (validWidth - 1) * 3, 3);
+        }
+        return true;
+    }
+
+    // 把 rect 范围内的像素按各分量的采样率下采样、正向 DCT、用原量化表量化后覆盖对应块
+    bool encode_region(const cv::Rect& rect, const cv::Mat& bgr) {
+        if (setjmp(this->srcErr.jump)) {
+            log_error("jpeg_redact_blocks: %s", this->srcErr.message);
+            return false;
+        }
+        for (int c = 0; c < this->src.num_components; ++c) {
+            jpeg_component_info* comp = &this->src.comp_info[c];
+            const int rx = this->src.max_h_samp_factor / comp->h_samp_factor;
+            const int ry = this->src.max_v_samp_factor / comp->v_samp_factor;
+            const int bx0 = rect.x / (DCTSIZE * rx);
+            const int by0 = rect.y / (DCTSIZE * ry);
+            const int bx1 = std::min((rect.x + rect.width) / (DCTSIZE * rx), static_cast<int>(comp->width_in_blocks));
+            const int by1 = std::min((rect.y + rect.height) / (DCTSIZE * ry), static_cast<int>(comp->height_in_blocks));
+            for (int by = by0; by < by1; ++by) {
+                JBLOCKARRAY rows = (*this->src.mem->access_virt_barray)(
+                    reinterpret_cast<j_common_ptr>(&this->src), this->coefficients[c], static_cast<JDIMENSION>(by), 1, TRUE);
+                for (int bx = bx0; bx < bx1; ++bx) {
+                    float samples[8][8];
+                    for (int i = 0; i < 8; ++i) {
+                        for (int j = 0; j < 8; ++j) {
+                            // 分量样本覆盖 rx*ry 个全分辨率像素，取平均后转换到 YCbCr
+                            const int px = (bx * DCTSIZE + j) * rx - rect.x;
+                            const int py = (by * DCTSIZE + i) * ry - rect.y;
+                            float b = 0, g = 0, r = 0;
+                            for (int dy = 0; dy < ry; ++dy) {
+                                const uchar* p = bgr.ptr<uchar>(py + dy) + px * 3;
+                                for (int dx = 0; dx < rx; ++dx, p += 3) {
+                                    b += p[0];
+                                    g += p[1];
+                                    r += p[2];
+                                }
+                            }
+                            const float n = static_cast<float>(rx * ry);
+                            b /= n;
+                            g /= n;
+                            r /= n;
+                            float value;
+                            if (c == 0) value = 0.299f * r + 0.587f * g + 0.114f * b;
+                            else if (c == 1) value = -0.168736f * r - 0.331264f * g + 0.5f * b + 128.f;
+                            else value = 0.5f * r - 0.418688f * g - 0.081312f * b + 128.f;
+                            samples[i][j] = value - 128.f;
+                        }
+                    }
+                    forward_dct_quantize(samples, comp->quant_table, rows[0][bx]);
+                }
+            }
+        }
+        return true;
+    }
+
+    bool write(std::vector<uint8_t>& output) {
+        jpeg_compress_struct dst;
+        JpegErrorManager jerr;
+        init_error_manager(jerr);
+        dst.err = &jerr.pub;
+        unsigned char* buffer = nullptr;
+        unsigned long bufferSize = 0;
+        if (setjmp(jerr.jump)) {
+            log_error("jpeg_redact_blocks: %s", jerr.message);
+            jpeg_destroy_compress(&dst);
+            free(buffer);
+            return false;
+        }
+        jpeg_create_compress(&dst);
+        jpeg_mem_dest(&dst, &buffer, &bufferSize);
+        jpeg_copy_critical_parameters(&this->src, &dst);
+        jpeg_write_coefficients(&dst, this->coefficients);
+        for (jpeg_saved_marker_ptr m = this->src.marker_list; m != nullptr; m = m->next) {
+            if (!keep_marker_segment(m->marker, m->data, m->data_length)) continue;
+            // JFIF/Adobe 段由 libjpeg 按参数自动写出，避免重复（与 jpegtran 相同）
+            if (dst.write_JFIF_header && m->marker == JPEG_APP0 && m->data_length >= 5 && memcmp(m->data, "JFIF", 5) == 0) continue;
+            if (dst.write_Adobe_marker && m->marker == JPEG_APP0 + 14 && m->data_length >= 5 && memcmp(m->data, "Adobe", 5) == 0) continue;
+            jpeg_write_marker(&dst, m->marker, m->data, m->data_length);
+        }
+        jpeg_finish_compress(&dst);
+        jpeg_destroy_compress(&dst);
+        output.assign(buffer, buffer + bufferSize);
+        free(buffer);
+        return true;
+    }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    jpeg_decompress_struct src;
+    JpegErrorManager srcErr;
+    bool created;
+    jvirt_barray_ptr* coefficients;
+    int mcuWidth;
+    int mcuHeight;
+};
+
+// 每个框扩展到 MCU 网格，相互重叠的矩形合并，直到两两不重叠
+std::vector<cv::Rect> merge_mcu_regions(const std::vector<cv::Rect>& boxes, int width, int height, int mcuWidth, int mcuHeight) {
+    const int alignedWidth = (width + mcuWidth - 1) / mcuWidth * mcuWidth;
+    const int alignedHeight = (height + mcuHeight - 1) / mcuHeight * mcuHeight;
+    std::vector<cv::Rect> regions;
+    for (const cv::Rect& box : boxes) {
+        const cv::Rect clipped = box & cv::Rect(0, 0, width, height);
+        if (clipped.width <= 0 || clipped.height <= 0) continue;
+        const int x0 = clipped.x / mcuWidth * mcuWidth;
+        const int y0 = clipped.y / mcuHeight * mcuHeight;
+        const int x1 = std::min((clipped.x + clipped.width + mcuWidth - 1) / mcuWidth * mcuWidth, alignedWidth);
+        const int y1 = std::min((clipped.y + clipped.height + mcuHeight - 1) / mcuHeight * mcuHeight, alignedHeight);
+        regions.push_back(cv::Rect(x0, y0, x1 - x0, y1 - y0));
+    }
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < regions.size() && !merged; ++i) {
+            for (size_t j = i + 1; j < regions.size(); ++j) {
+                if ((regions[i] & regions[j]).width > 0) {
+                    regions[i] = regions[i] | regions[j];
+                    regions.erase(regions.begin() + static_cast<std::ptrdiff_t>(j));
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+    return regions;
+}
+
+} // namespace
+
+bool read_file_bytes(const char* path, std::vector<uint8_t>& data) {
+    FILE* fp = fopen(path, "rb");
+    if (fp == nullptr) return false;
+    bool ok = fseek(fp, 0, SEEK_END) == 0;
+    const long size = ok ? ftell(fp) : -1;
+    ok = size >= 0 && fseek(fp, 0, SEEK_SET) == 0;
+    if (ok) {
+        data.resize(static_cast<size_t>(size));
+        ok = data.empty() || fread(data.data(), 1, data.size(), fp) == data.size();
+    }
+    fclose(fp);
+    return ok;
+}
+
+bool write_file_bytes(const char* path, const uint8_t* data, size_t size) {
+    FILE* fp = fopen(path, "wb");
+    if (fp == nullptr) return false;
+    bool ok = fwrite(data, 1, size, fp) == size;
+    ok = fclose(fp) == 0 && ok;
+    return ok;
+}
+
+bool jpeg_is_jpeg(const uint8_t* data, size_t size) {
+    return size > 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+}
+
+bool jpeg_read_info(const uint8_t* data, size_t size, JpegInfo& info) {
+    jpeg_decompress_struct cinfo;
+    JpegErrorManager jerr;
+    init_error_manager(jerr);
+    cinfo.err = &jerr.pub;
+    if (setjmp(jerr.jump)) {
+        log_debug("jpeg_read_info: %s", jerr.message);
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, data, static_cast<unsigned long>(size));
+    jpeg_read_header(&cinfo, TRUE);
+    info.width = static_cast<int>(cinfo.image_width);
+    info.height = static_cast<int>(cinfo.image_height);
+    info.components = cinfo.num_components;
+    const bool supported = cinfo.jpeg_color_space != JCS_CMYK && cinfo.jpeg_color_space != JCS_YCCK;
+    jpeg_destroy_decompress(&cinfo);
+    info.orientation = exif_orientation(data, size);
+    return supported;
+}
+
+bool jpeg_decode_bgr(const uint8_t* data, size_t size, int scaleDenom, cv::Mat& bgr) {
+    jpeg_decompress_struct cinfo;
+    JpegErrorManager jerr;
+    init_error_manager(jerr);
+    cinfo.err = &jerr.pub;
+    if (setjmp(jerr.jump)) {
+        log_error("jpeg_decode_bgr: %s", jerr.message);
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, data, static_cast<unsigned long>(size));
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_EXT_BGR;
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = static_cast<unsigned>(scaleDenom);
+    if (scaleDenom > 1) {
+        // 缩小图只用于检测，选择更快的 IDCT 和上采样
+        cinfo.dct_method = JDCT_IFAST;
+        cinfo.do_fancy_upsampling = FALSE;
+    }
+    jpeg_start_decompress(&cinfo);
+    bgr.create(static_cast<int>(cinfo.output_height), static_cast<int>(cinfo.output_width), CV_8UC3);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = bgr.ptr<uchar>(static_cast<int>(cinfo.output_scanline));
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+bool jpeg_strip_metadata(const uint8_t* data, size_t size, std::vector<uint8_t>& output) {
+    output.clear();
+    if (!jpeg_is_jpeg(data, size)) return false;
+    output.reserve(size);
+    output.insert(output.end(), data, data + 2);
+    size_t pos = 2;
+    while (true) {
+        // 段之间允许有填充的 0xFF
+        while (pos + 1 < size && data[pos] == 0xFF && data[pos + 1] == 0xFF) ++pos;
+        if (pos + 4 > size || data[pos] != 0xFF) return false;
+        const uint8_t marker = data[pos + 1];
+        const size_t length = read_u16(data + pos + 2, true);
+        if (length < 2 || pos + 2 + length > size) return false;
+        if (marker == 0xDA) {
+            // 扫描数据开始，其后的熵编码数据和后续段原样复制
+            output.insert(output.end(), data + pos, data + size);
+            return true;
+        }
+        if (keep_marker_segment(marker, data + pos + 4, length - 2)) {
+            output.insert(output.end(), data + pos, data + pos + 2 + length);
+        }
+        pos += 2 + length;
+    }
+}
+
+bool jpeg_redact_blocks(const uint8_t* data, size_t size, const std::vector<cv::Rect>& boxes,
+                        const JpegRedactFn& redact, std::vector<uint8_t>& output) {
+    JpegBlockRedactor redactor(data, size);
+    if (!redactor.read()) return false;
+
+    const std::vector<cv::Rect> regions = merge_mcu_regions(boxes, redactor.width(), redactor.height(),
+                                                            redactor.mcu_width(), redactor.mcu_height());
+    std::vector<uint8_t> rowBuffer(static_cast<size_t>(redactor.width()) * 3);
+    std::vector<cv::Rect> local;
+    cv::Mat patch;
+    long long touched = 0;
+    for (const cv::Rect& region : regions) {
+        patch.create(region.height, region.width, CV_8UC3);
+        if (!redactor.decode_region(region, patch, rowBuffer.data())) return false;
+        local.clear();
+        for (const cv::Rect& box : boxes) {
+            const cv::Rect inside = box & region;
+            if (inside.width > 0 && inside.height > 0) local.push_back(cv::Rect(box.x - region.x, box.y - region.y, box.width, box.height));
+        }
+        redact(patch, local);
+        if (!redactor.encode_region(region, patch)) return false;
+        touched += static_cast<long long>(region.width) * region.height;
+    }
+    if (!redactor.write(output)) return false;
+    log_debug("jpeg_redact_blocks: %zu regions re-encoded, %.1f%% of the image.", regions.size(),
+              100.0 * touched / (static_cast<double>(redactor.width()) * redactor.height()));
+    return true;
+}
+
+int jpeg_pick_scale(int width, int height, int minLongSide) {
+    const int longSide = std::max(width, height);
+    for (int denom = 8; denom > 1; denom /= 2) {
+        if ((longSide + denom - 1) / denom >= minLongSide) return denom;
+    }
+    return 1;
+}
+
+int jpeg_anonymize_buffer(YOLOv8_face& model, const uint8_t* data, size_t size, int blurType, bool jpegOutput,
+                          std::vector<uint8_t>& encoded, cv::Mat& image) {
+    encoded.clear();
+    image.release();
+    JpegInfo info;
+    if (!jpeg_is_jpeg(data, size) || !jpeg_read_info(data, size, info)) return UNSUPPORTED_FORMAT;
+    if (info.orientation != 1) {
+        // 通用路径按 EXIF 方向旋转后再处理，快速路径不旋转，交回通用路径保持输出一致
+        log_debug("jpeg_anonymize_buffer: EXIF orientation %d, using the generic path.", info.orientation);
+        return UNSUPPORTED_FORMAT;
+    }
+
+    const int denom = jpeg_pick_scale(info.width, info.height, model.input_size());
+    cv::Mat decoded;
+    if (!jpeg_decode_bgr(data, size, denom, decoded)) return UNSUPPORTED_FORMAT;
+
+    std::vector<cv::Rect> boxes;
+    std::vector<float> confidences;
+    try {
+        model.detect_boxes(decoded, boxes, confidences);
+    } catch (const std::exception& e) {
+        log_error("jpeg_anonymize_buffer: Exception during model detection: %s", e.what());
+        return INTERNAL_ERROR;
+    }
+    if (denom > 1) {
+        // 映射回全分辨率，四周多留一个缩小后的像素，覆盖取整误差
+        const double sx = static_cast<double>(info.width) / decoded.cols;
+        const double sy = static_cast<double>(info.height) / decoded.rows;
+        const cv::Rect bounds(0, 0, info.width, info.height);
+        for (cv::Rect& box : boxes) {
+            const int x0 = static_cast<int>((box.x - 1) * sx);
+            const int y0 = static_cast<int>((box.y - 1) * sy);
+            const int x1 = static_cast<int>((box.x + box.width + 1) * sx + 0.5);
+            const int y1 = static_cast<int>((box.y + box.height + 1) * sy + 0.5);
+            box = cv::Rect(x0, y0, x1 - x0, y1 - y0) & bounds;
+        }
+    }
+    log_info("jpeg_anonymize_buffer: %dx%d detected at 1/%d scale, %zu boxes.", info.width, info.height, denom, boxes.size());
+
+    const bool untouched = boxes.empty() || blurType == BLUR_TYPE_NONE;
+    if (jpegOutput) {
+        // 没有需要脱敏的区域时去掉元数据段后复制扫描数据；否则只重新编码目标所在的 MCU，其余系数不变，
+        // 两种情况都没有重新编码的画质损失。EXIF 缩略图、GPS 等与通用路径的 imwrite 一样不输出
+        if (untouched) {
+            if (jpeg_strip_metadata(data, size, encoded)) return ANO_OK;
+            encoded.clear();
+            log_debug("jpeg_anonymize_buffer: Unexpected segment layout, re-encoding the whole image.");
+        } else {
+            auto redact = [&](cv::Mat& patch, const std::vector<cv::Rect>& local) { model.redact(patch, local, blurType); };
+            if (jpeg_redact_blocks(data, size, boxes, redact, encoded)) return ANO_OK;
+            encoded.clear();
+            log_debug("jpeg_anonymize_buffer: Block re-encode not applicable, re-encoding the whole image.");
+        }
+    }
+
+    if (denom == 1) {
+        image = decoded;
+    } else if (!jpeg_decode_bgr(data, size, 1, image)) {
+        return LOAD_IMAGE_ERROR;
+    }
+    if (!untouched) model.redact(image, boxes, blurType);
+    return ANO_OK;
+}
+
+int jpeg_image_anonymization(YOLOv8_face& model, const char* inputFile, const char* outputFile, int blurType) {
+    std::vector<uint8_t> data;
+    if (!read_file_bytes(inputFile, data)) return UNSUPPORTED_FORMAT;
+
+    std::vector<uint8_t> encoded;
+    cv::Mat image;
+    int ret = jpeg_anonymize_buffer(model, data.data(), data.size(), blurType, has_jpeg_extension(outputFile), encoded, image);
+    if (ret != ANO_OK) return ret;
+
+    bool written = false;
+    if (!encoded.empty()) {
+        written = write_file_bytes(outputFile, encoded.data(), encoded.size());
+    } else {
+        try {
+            written = cv::imwrite(outputFile, image);
+        } catch (const cv::Exception& e) {
+            log_error("jpeg_image_anonymization: OpenCV exception during imwrite for '%s': %s", outputFile, e.what());
+        }
+    }
+    if (!written) {
+        log_error("jpeg_image_anonymization: Failed to save image to '%s'.", outputFile);
+        return SAVE_IMAGE_ERROR;
+    }
+    return ANO_OK;
+}
+
+namespace {
+
+// 逐行解码 JPEG 文件，不把整幅图像读入内存
+class JpegStripReader : public ImageStripReader
+{
+public:
+    ~JpegStripReader() override {
+        if (this->created) jpeg_destroy_decompress(&this->cinfo);
+        if (this->fp != nullptr) fclose(this->fp);
+    }
+
+    bool open(const char* path) {
+        this->fp = fopen(path, "rb");
+        if (this->fp == nullptr) return false;
+        init_error_manager(this->jerr);
+        this->cinfo.err = &this->jerr.pub;
+        if (setjmp(this->jerr.jump)) {
+            log_error("jpeg_open_strip_reader: '%s': %s", path, this->jerr.message);
+            return false;
+        }
+        jpeg_create_decompress(&this->cinfo);
+        this->created = true;
+        jpeg_stdio_src(&this->cinfo, this->fp);
+        jpeg_save_markers(&this->cinfo, JPEG_APP0 + 1, 0xFFFF);
+        jpeg_read_header(&this->cinfo, TRUE);
+        if (this->cinfo.jpeg_color_space == JCS_CMYK || this->cinfo.jpeg_color_space == JCS_YCCK) return false;
+        // 按行输出无法旋转，带 EXIF 旋转的文件交给整图路径
+        for (jpeg_saved_marker_ptr m = this->cinfo.marker_list; m != nullptr; m = m->next) {
+            if (m->marker != JPEG_APP0 + 1) continue;
+            std::vector<uint8_t> segment = {0xFF, 0xD8, 0xFF, 0xE1,
+                                            static_cast<uint8_t>((m->data_length + 2) >> 8),
+                                            static_cast<uint8_t>((m->data_length + 2) & 0xFF)};
+            segment.insert(segment.end(), m->data, m->data + m->data_length);
+            if (exif_orientation(segment.data(), segment.size()) != 1) return false;
+        }
+        this->cinfo.out_color_space = JCS_EXT_BGR;
+        jpeg_start_decompress(&this->cinfo);
+        return true;
+    }
+
+    int width() const override { return static_cast<int>(this->cinfo.output_width); }
+    int height() const override { return static_cast<int>(this->cinfo.output_height); }
+
+    bool read_rows(cv::Mat& rows) override {
+        if (setjmp(this->jerr.jump)) {
+            log_error("JpegStripReader: %s", this->jerr.message);
+            return false;
+        }
+        for (int r = 0; r < rows.rows; ++r) {
+            JSAMPROW row = rows.ptr<uchar>(r);
+            if (jpeg_read_scanlines(&this->cinfo, &row, 1) != 1) return false;
+        }
+        return true;
+    }
+
+private:
+    jpeg_decompress_struct cinfo;
+    JpegErrorManager jerr;
+    FILE* fp = nullptr;
+    bool created = false;
+};
+
+// 逐行编码 JPEG 文件；未调用 finish 就析构时删除不完整的输出文件
+class JpegStripWriter : public ImageStripWriter
+{
+public:
+    ~JpegStripWriter() override {
+        if (this->created) jpeg_destroy_compress(&this->cinfo);
+        if (this->fp != nullptr) {
+            fclose(this->fp);
+            remove(this->path.c_str());
+        }
+    }
+
+    bool open(const char* path, int width, int height, int quality) {
+        this->path = path;
+        this->fp = fopen(path, "wb");
+        if (this->fp == nullptr) return false;
+        init_error_manager(this->jerr);
+        this->cinfo.err = &this->jerr.pub;
+        if (setjmp(this->jerr.jump)) {
+            log_error("jpeg_open_strip_writer: '%s': %s", path, this->jerr.message);
+            return false;
+        }
+        jpeg_create_compress(&this->cinfo);
+        this->created = true;
+        jpeg_stdio_dest(&this->cinfo, this->fp);
+        this->cinfo.image_width = static_cast<JDIMENSION>(width);
+        this->cinfo.image_height = static_cast<JDIMENSION>(height);
+        this->cinfo.input_components = 3;
+        this->cinfo.in_color_space = JCS_EXT_BGR;
+        jpeg_set_defaults(&this->cinfo);
+        jpeg_set_quality(&this->cinfo, quality > 0 ? quality : 95, TRUE);
+        jpeg_start_compress(&this->cinfo, TRUE);
+        return true;
+    }
+
+    bool write_rows(const cv::Mat& rows) override {
+        if (setjmp(this->jerr.jump)) {
+            log_error("JpegStripWriter: %s", this->jerr.message);
+            return false;
+        }
+        for (int r = 0; r < rows.rows; ++r) {
+            JSAMPROW row = const_cast<uchar*>(rows.ptr<uchar>(r));
+            jpeg_write_scanlines(&this->cinfo, &row, 1);
+        }
+        return true;
+    }
+
+    bool finish() override {
+        if (setjmp(this->jerr.jump)) {
+            log_error("JpegStripWriter: %s", this->jerr.message);
+            return false;
+        }
+        jpeg_finish_compress(&this->cinfo);
+        const bool ok = fclose(this->fp) == 0;
+        this->fp = nullptr;
+        if (!ok) remove(this->path.c_str());
+        return ok;
+    }
+
+private:
+    jpeg_compress_struct cinfo;
+    JpegErrorManager jerr;
+    FILE* fp = nullptr;
+    bool created = false;
+    std::string path;
+};
+
+} // namespace
+
+std::unique_ptr<ImageStripReader> jpeg_open_strip_reader(const char* path) {
+    std::unique_ptr<JpegStripReader> reader(new JpegStripReader());
+    if (!reader->open(path)) return nullptr;
+    return reader;
+}
+
+std::unique_ptr<ImageStripWriter> jpeg_open_strip_writer(const char* path, int width, int height, int quality) {
+    std::unique_ptr<JpegStripWriter> writer(new JpegStripWriter());
+    if (!writer->open(path, width, height, quality)) return nullptr;
+    return writer;
+}
+
+#endif // ANONYMIZATION_WITH_LIBJPEG
@@ -0,0 +1,80 @@
+#ifndef JPEG_CODEC_H
+#define JPEG_CODEC_H
+
+// 基于 libjpeg-turbo 的 JPEG 快速路径，仅在定义 ANONYMIZATION_WITH_LIBJPEG 时编译
+#ifdef ANONYMIZATION_WITH_LIBJPEG
+
+#include "TiledImage.h"
+#include <opencv2/core.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class YOLOv8_face;
+
+/**
+ * @brief JPEG 文件头信息（只解析头部，不解码）
+ */
+struct JpegInfo {
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    int orientation = 1;     // EXIF 方向，1 表示无需旋转
+};
+
+bool read_file_bytes(const char* path, std::vector<uint8_t>& data);
+bool write_file_bytes(const char* path, const uint8_t* data, size_t size);
+
+bool jpeg_is_jpeg(const uint8_t* data, size_t size);
+// 读取头部；不支持的色彩空间（CMYK/YCCK）返回 false
+bool jpeg_read_info(const uint8_t* data, size_t size, JpegInfo& info);
+// 在 DCT 域按 1/scaleDenom 缩小解码为 BGR，scaleDenom 取 1/2/4/8
+bool jpeg_decode_bgr(const uint8_t* data, size_t size, int scaleDenom, cv::Mat& bgr);
+// 选择最大的缩小倍数，使缩小后的长边仍不小于 minLongSide
+int jpeg_pick_scale(int width, int height, int minLongSide);
+
+/**
+ * @brief 不解码，去掉 JPEG 中的元数据段后复制：SOS 之前只保留 JFIF（APP0）、ICC 配置（APP2）和 Adobe（APP14），
+ * EXIF/XMP（APP1，含未脱敏的缩略图和 GPS）、其他 APPn 和 COM 段丢弃，扫描数据原样复制。段结构错误时返回 false
+ */
+bool jpeg_strip_metadata(const uint8_t* data, size_t size, std::vector<uint8_t>& output);
+
+// 对一块 BGR 图像做脱敏，boxes 为该图像内的局部坐标
+typedef std::function<void(cv::Mat& patch, const std::vector<cv::Rect>& boxes)> JpegRedactFn;
+
+/**
+ * @brief 只重新编码与 boxes 相交的 MCU，其余 MCU 的 DCT 系数原样保留（类似 jpegtran 的无损变换）
+ * 相交的 MCU 合并成若干对齐到 MCU 网格的矩形，逐块解码、调用 redact、再正向 DCT 并用原量化表量化写回；
+ * 输出为基线顺序编码，只保留 JFIF/ICC/Adobe 段，EXIF/XMP（含缩略图、GPS）和注释段丢弃，
+ * 见 jpeg_strip_metadata。只支持 YCbCr 和灰度，不支持时返回 false
+ */
+bool jpeg_redact_blocks(const uint8_t* data, size_t size, const std::vector<cv::Rect>& boxes,
+                        const JpegRedactFn& redact, std::vector<uint8_t>& output);
+
+/**
+ * @brief 内存中 JPEG 的脱敏快速路径，jpegOutput 表示调用者需要 JPEG 输出
+ * 成功时 encoded 非空表示已得到 JPEG 输出；否则 image 为脱敏后的全分辨率 BGR 图像，由调用者按目标格式编码。
+ * 不是可处理的 JPEG（含需要旋转的 EXIF 方向）时返回 UNSUPPORTED_FORMAT
+ */
+int jpeg_anonymize_buffer(YOLOv8_face& model, const uint8_t* data, size_t size, int blurType, bool jpegOutput,
+                          std::vector<uint8_t>& encoded, cv::Mat& image);
+
+/**
+ * @brief 单张 JPEG 的脱敏快速路径：先按检测输入尺寸缩小解码并检测，
+ * 输出是 JPEG 时没有目标则用 jpeg_strip_metadata 去掉元数据段后复制扫描数据，有目标则只重新编码目标所在的 MCU，
+ * 两种情况都只保留 JFIF/ICC/Adobe 段，EXIF（含缩略图、GPS）、XMP 和注释段一律丢弃；
+ * 输出为其他格式时才做全分辨率解码、脱敏和编码。
+ * 输入不是可处理的 JPEG（含需要旋转的 EXIF 方向）时返回 UNSUPPORTED_FORMAT，由调用者走通用路径
+ */
+int jpeg_image_anonymization(YOLOv8_face& model, const char* inputFile, const char* outputFile, int blurType);
+
+// 分条带处理用的逐行读写；读取时 EXIF 方向不为 1 或色彩空间不支持返回 nullptr
+std::unique_ptr<ImageStripReader> jpeg_open_strip_reader(const char* path);
+std::unique_ptr<ImageStripWriter> jpeg_open_strip_writer(const char* path, int width, int height, int quality);
+
+#endif // ANONYMIZATION_WITH_LIBJPEG
+
+#endif // JPEG_CODEC_H
@@ -0,0 +1,336 @@
+#include "MultiStreamScheduler.h"
+#include "YOLOv8_face.h"
+#include "FrameConvert.h"
+#include "Trace.h"
+#include "log/log.h"
+
+#include <algorithm>
+#include <cstdio>
+
+/**
+ * @brief 一路已注册的流：各自的队列、检测调度状态和统计
+ * 除 scheduler/redactBoxes 外的成员都由调度器的互斥锁保护；busy 为 true 时该流的一帧正在某个批次中，
+ * 此时只有处理这一批的调度线程会访问 scheduler/redactBoxes
+ */
+struct MultiStreamScheduler::Stream {
+    Stream(int32_t id, const StreamRegistration& registration)
+        : id(id), registration(registration), scheduler(registration.detectInterval, registration.sceneCutThreshold),
+          busy(false), closed(false), framesIn(0), framesOut(0), framesDropped(0), framesProcessed(0),
+          latencySumMs(0), latencyMaxMs(0), batchSizeSum(0) {
+        this->slack = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::milli>(1000.0 / registration.targetFps / registration.priority));
+    }
+
+    std::chrono::steady_clock::time_point deadline() const { return this->input.front()->pushedAt + this->slack; }
+
+    int32_t id;
+    StreamRegistration registration;
+    std::chrono::steady_clock::duration slack;   // 送入到截止的时长
+    DetectionScheduler scheduler;
+    std::vector<cv::Rect> redactBoxes;
+
+    std::condition_variable outputChanged;
+    std::deque<std::unique_ptr<StreamFrame>> input;
+    std::deque<std::unique_ptr<StreamFrame>> output;
+    std::vector<std::unique_ptr<StreamFrame>> pool;
+    std::unique_ptr<StreamFrame> current;         // 最近一次 pull 返回给调用者的帧
+    bool busy;
+    bool closed;
+    long long framesIn;
+    long long framesOut;
+    long long framesDropped;
+    long long framesProcessed;
+    double latencySumMs;
+    double latencyMaxMs;
+    double batchSizeSum;
+};
+
+MultiStreamScheduler::MultiStreamScheduler(const MultiStreamOptions& options)
+    : options(options), nextStreamId(1), stopping(false) {
+}
+
+MultiStreamScheduler::~MultiStreamScheduler() {
+    this->stop();
+}
+
+int MultiStreamScheduler::start(const YOLOv8_face& source) {
+    for (int i = 0; i < this->options.detectorCount; ++i) {
+        std::unique_ptr<YOLOv8_face> model(new YOLOv8_face());
+        if (model->clone_from(source) != 0) {
+            log_error("open_multistream: Failed to load model for detector %d.", i);
+            return MODEL_FORMAT_ERROR;
+        }
+        this->models.push_back(std::move(model));
+    }
+    for (size_t i = 0; i < this->models.size(); ++i)
+        this->dispatchers.emplace_back(&MultiStreamScheduler::dispatcher_loop, this, i);
+    log_info("open_multistream: Scheduler started, detectors: %d, max batch: %d, batch timeout: %d ms.",
+             this->options.detectorCount, this->options.maxBatchSize, this->options.batchTimeoutMs);
+    return ANO_OK;
+}
+
+void MultiStreamScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->stopping) return;
+        this->stopping = true;
+        for (auto& entry : this->streams) entry.second->outputChanged.notify_all();
+    }
+    this->framesReady.notify_all();
+    for (std::thread& dispatcher : this->dispatchers) {
+        if (dispatcher.joinable()) dispatcher.join();
+    }
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (auto& entry : this->streams) {
+        const Stream& stream = *entry.second;
+        log_info("close_multistream: Stream %d closed. Frames in: %lld, out: %lld, dropped: %lld.",
+                 stream.id, stream.framesIn, stream.framesOut, stream.framesDropped);
+    }
+}
+
+std::shared_ptr<MultiStreamScheduler::Stream> MultiStreamScheduler::find(int32_t streamId) {
+    auto it = this->streams.find(streamId);
+    return it == this->streams.end() ? nullptr : it->second;
+}
+
+int MultiStreamScheduler::register_stream(const StreamRegistration& registration, int32_t* streamId) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->stopping) return INVALID_PARAMETER;
+    const int32_t id = this->nextStreamId++;
+    this->streams[id] = std::make_shared<Stream>(id, registration);
+    *streamId = id;
+    log_info("register_stream: Stream %d registered, priority: %d, target fps: %.1f, blur type: %d, detect interval: %d.",
+             id, registration.priority, registration.targetFps, static_cast<int>(registration.blurType), registration.detectInterval);
+    return ANO_OK;
+}
+
+int MultiStreamScheduler::unregister_stream(int32_t streamId) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::shared_ptr<Stream> stream = this->find(streamId);
+    if (!stream) {
+        log_error("unregister_stream: Unknown stream %d.", streamId);
+        return INVALID_PARAMETER;
+    }
+    // 正在批次中的帧由调度线程持有 shared_ptr，处理完后随流一起释放
+    stream->closed = true;
+    stream->input.clear();
+    this->streams.erase(streamId);
+    stream->outputChanged.notify_all();
+    log_info("unregister_stream: Stream %d unregistered. Frames in: %lld, out: %lld, dropped: %lld.",
+             stream->id, stream->framesIn, stream->framesOut, stream->framesDropped);
+    return ANO_OK;
+}
+
+int MultiStreamScheduler::push(int32_t streamId, const ImageFrame& frame, int64_t pts) {
+    std::unique_ptr<StreamFrame> copy;
+    std::shared_ptr<Stream> stream;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        stream = this->find(streamId);
+        if (!stream || this->stopping) {
+            log_error("multistream_push: Unknown stream %d.", streamId);
+            return INVALID_PARAMETER;
+        }
+        if (stream->pool.empty()) {
+            copy.reset(new StreamFrame());
+        } else {
+            copy = std::move(stream->pool.back());
+            stream->pool.pop_back();
+        }
+    }
+    // 在锁外复制像素，避免阻塞其他流和调度线程
+    const bool valid = copy->assign(frame);
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    if (!valid) {
+        log_error("multistream_push: Invalid frame (format %d, %dx%d) or strides on stream %d.",
+                  static_cast<int>(frame.format), frame.width, frame.height, streamId);
+        stream->pool.push_back(std::move(copy));
+        return INVALID_PARAMETER;
+    }
+    if (stream->closed) return INVALID_PARAMETER;
+    // 摄像头是实时源，待处理队列满时丢弃最旧的帧，不阻塞调用者
+    if (stream->input.size() >= static_cast<size_t>(stream->registration.maxQueueFrames)) {
+        stream->pool.push_back(std::move(stream->input.front()));
+        stream->input.pop_front();
+        stream->framesDropped++;
+    }
+    copy->pts = pts;
+    copy->pushedAt = std::chrono::steady_clock::now();
+    stream->input.push_back(std::move(copy));
+    stream->framesIn++;
+    lock.unlock();
+    this->framesReady.notify_all();
+    return ANO_OK;
+}
+
+int MultiStreamScheduler::pull(int32_t streamId, ImageFrame& frame, int64_t* pts, int timeoutMs) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    std::shared_ptr<Stream> stream = this->find(streamId);
+    if (!stream) {
+        log_error("multistream_pull: Unknown stream %d.", streamId);
+        return INVALID_PARAMETER;
+    }
+    auto ready = [&]() { return !stream->output.empty() || stream->closed || this->stopping; };
+    if (timeoutMs < 0) {
+        stream->outputChanged.wait(lock, ready);
+    } else if (!stream->outputChanged.wait_for(lock, std::chrono::milliseconds(timeoutMs), ready)) {
+        return STREAM_TIMEOUT;
+    }
+    if (stream->output.empty()) return STREAM_END;
+    if (stream->current) stream->pool.push_back(std::move(stream->current));
+    stream->current = std::move(stream->output.front());
+    stream->output.pop_front();
+    stream->framesOut++;
+    frame = stream->current->frame;
+    if (pts != nullptr) *pts = stream->current->pts;
+    return ANO_OK;
+}
+
+int MultiStreamScheduler::stats(int32_t streamId, StreamStats* stats) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::shared_ptr<Stream> stream = this->find(streamId);
+    if (!stream) {
+        log_error("get_stream_stats: Unknown stream %d.", streamId);
+        return INVALID_PARAMETER;
+    }
+    stats->framesIn = stream->framesIn;
+    stats->framesOut = stream->framesOut;
+    stats->framesDropped = stream->framesDropped;
+    stats->queuedFrames = static_cast<int32_t>(stream->input.size() + stream->output.size());
+    const double processed = static_cast<double>(stream->framesProcessed);
+    stats->avgLatencyMs = processed > 0 ? stream->latencySumMs / processed : 0.0;
+    stats->maxLatencyMs = stream->latencyMaxMs;
+    stats->avgBatchSize = processed > 0 ? stream->batchSizeSum / processed : 0.0;
+    return ANO_OK;
+}
+
+bool MultiStreamScheduler::collect_batch(std::unique_lock<std::mutex>& lock, std::vector<BatchItem>& batch) {
+    typedef std::chrono::steady_clock Clock;
+    std::vector<std::pair<Clock::time_point, std::shared_ptr<Stream>>> ready;
+    while (true) {
+        if (this->stopping) return false;
+        ready.clear();
+        Clock::time_point oldest = Clock::time_point::max();
+        for (auto& entry : this->streams) {
+            Stream& stream = *entry.second;
+            if (stream.busy || stream.input.empty()) continue;
+            ready.emplace_back(stream.deadline(), entry.second);
+            oldest = std::min(oldest, stream.input.front()->pushedAt);
+        }
+        if (ready.empty()) {
+            this->framesReady.wait(lock);
+            continue;
+        }
+        // 凑不满一批时，最多让最早送入的帧等待 batchTimeoutMs
+        if (ready.size() < static_cast<size_t>(this->options.maxBatchSize) && this->options.batchTimeoutMs > 0) {
+            const Clock::time_point flushAt = oldest + std::chrono::milliseconds(this->options.batchTimeoutMs);
+            if (Clock::now() < flushAt) {
+                this->framesReady.wait_until(lock, flushAt);
+                continue;
+            }
+        }
+        break;
+    }
+
+    // 最早到期的流优先
+    std::sort(ready.begin(), ready.end(),
+              [](const std::pair<Clock::time_point, std::shared_ptr<Stream>>& a,
+                 const std::pair<Clock::time_point, std::shared_ptr<Stream>>& b) { return a.first < b.first; });
+    const size_t count = std::min(ready.size(), static_cast<size_t>(this->options.maxBatchSize));
+    batch.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        BatchItem& item = batch[i];
+        item.stream = ready[i].second;
+        item.frame = std::move(item.stream->input.front());
+        item.stream->input.pop_front();
+        item.stream->busy = true;
+        item.converted = false;
+        item.detect = false;
+    }
+    return true;
+}
+
+void MultiStreamScheduler::run_batch(YOLOv8_face& model, std::vector<BatchItem>& batch) {
+    std::vector<cv::Mat> inputs;
+    std::vector<size_t> owners;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        BatchItem& item = batch[i];
+        item.converted = image_frame_to_bgr(&item.frame->frame, item.bgr) == ANO_OK;
+        if (!item.converted) continue;
+        item.detect = item.stream->scheduler.need_detect(item.bgr);
+        if (item.detect) {
+            inputs.push_back(item.bgr);
+            owners.push_back(i);
+        }
+    }
+
+    try {
+        if (!inputs.empty()) {
+            std::vector<std::vector<cv::Rect>> boxes;
+            std::vector<std::vector<float>> confidences;
+            model.detect_boxes_batch(inputs, boxes, confidences);
+            for (size_t k = 0; k < owners.size(); ++k)
+                batch[owners[k]].stream->scheduler.update_boxes(boxes[k]);
+        }
+    } catch (const std::exception& e) {
+        log_error("multistream: Exception during batched detection of %zu frames: %s", inputs.size(), e.what());
+    }
+
+    for (BatchItem& item : batch) {
+        if (!item.converted) continue;
+        Stream& stream = *item.stream;
+        stream.redactBoxes = stream.scheduler.carried_boxes();
+        if (stream.redactBoxes.empty() || stream.registration.blurType == BLUR_TYPE_NONE) continue;
+        try {
+            model.redact(item.bgr, stream.redactBoxes, stream.registration.blurType);
+            bgr_to_image_frame(item.bgr, &item.frame->frame);
+        } catch (const std::exception& e) {
+            log_error("multistream: Exception during redaction on stream %d frame pts %lld: %s",
+                      stream.id, static_cast<long long>(item.frame->pts), e.what());
+        }
+    }
+}
+
+void MultiStreamScheduler::dispatcher_loop(size_t index) {
+    YOLOv8_face& model = *this->models[index];
+    std::vector<BatchItem> batch;
+    char threadName[48];
+    snprintf(threadName, sizeof(threadName), "multistream dispatcher %zu", index);
+    trace_set_thread_name(threadName);
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock = trace_lock(this->mutex, "multistream_mutex");
+            TraceScope idle("wait_batch", "wait");
+            if (!this->collect_batch(lock, batch)) break;
+        }
+
+        this->run_batch(model, batch);
+
+        const auto done = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::mutex> lock = trace_lock(this->mutex, "multistream_mutex");
+            for (BatchItem& item : batch) {
+                Stream& stream = *item.stream;
+                stream.busy = false;
+                if (stream.closed) continue;
+                const double latencyMs = std::chrono::duration<double, std::milli>(done - item.frame->pushedAt).count();
+                stream.framesProcessed++;
+                stream.latencySumMs += latencyMs;
+                stream.latencyMaxMs = std::max(stream.latencyMaxMs, latencyMs);
+                stream.batchSizeSum += static_cast<double>(batch.size());
+                // 调用者取得太慢时丢弃最旧的结果，不能让一路拖住共享的调度线程
+                if (stream.output.size() >= static_cast<size_t>(stream.registration.maxQueueFrames)) {
+                    stream.pool.push_back(std::move(stream.output.front()));
+                    stream.output.pop_front();
+                    stream.framesDropped++;
+                }
+                stream.output.push_back(std::move(item.frame));
+                stream.outputChanged.notify_all();
+            }
+        }
+        batch.clear();
+        // 本批涉及的流空闲了，其余调度线程可以取它们的下一帧
+        this->framesReady.notify_all();
+    }
+}
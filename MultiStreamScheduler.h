@@ -0,0 +1,69 @@
+#ifndef MULTI_STREAM_SCHEDULER_H
+#define MULTI_STREAM_SCHEDULER_H
+
+#include "Anonymization.h"
+#include "DetectionScheduler.h"
+#include "StreamSession.h"
+#include <opencv2/core.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class YOLOv8_face;
+
+/**
+ * @brief 多路流调度器：各路摄像头的帧汇集到共享的检测实例上按批推理，结果再送回各自的流
+ * 每个检测实例对应一个调度线程，从所有就绪的流中按截止时间挑选帧组成一批（每路每批至多一帧，
+ * 保证同一路的帧按顺序处理），凑不满时最多等待 batchTimeoutMs。
+ * 帧的截止时间 = 送入时刻 + (1000 / targetFps) / priority，优先级高、帧率高的流更早被选中，
+ * 低优先级的帧随等待时间变长也会变成最早到期，不会被饿死
+ */
+struct MultiStreamScheduler {
+    explicit MultiStreamScheduler(const MultiStreamOptions& options);
+    ~MultiStreamScheduler();
+    MultiStreamScheduler(const MultiStreamScheduler&) = delete;
+    MultiStreamScheduler& operator=(const MultiStreamScheduler&) = delete;
+
+    // 为每个调度线程复制一份模型并启动
+    int start(const YOLOv8_face& source);
+    int register_stream(const StreamRegistration& registration, int32_t* streamId);
+    int unregister_stream(int32_t streamId);
+    int push(int32_t streamId, const ImageFrame& frame, int64_t pts);
+    int pull(int32_t streamId, ImageFrame& frame, int64_t* pts, int timeoutMs);
+    int stats(int32_t streamId, StreamStats* stats);
+    void stop();
+
+private:
+    struct Stream;
+    struct BatchItem {
+        std::shared_ptr<Stream> stream;
+        std::unique_ptr<StreamFrame> frame;
+        cv::Mat bgr;
+        bool converted;
+        bool detect;
+    };
+
+    std::shared_ptr<Stream> find(int32_t streamId);
+    // 在持锁状态下挑选一批帧，调度器停止时返回 false
+    bool collect_batch(std::unique_lock<std::mutex>& lock, std::vector<BatchItem>& batch);
+    void run_batch(YOLOv8_face& model, std::vector<BatchItem>& batch);
+    void dispatcher_loop(size_t index);
+
+    MultiStreamOptions options;
+    std::vector<std::unique_ptr<YOLOv8_face>> models;
+    std::vector<std::thread> dispatchers;
+
+    std::mutex mutex;
+    std::condition_variable framesReady;     // 有新帧送入或有流结束了一批
+    std::map<int32_t, std::shared_ptr<Stream>> streams;
+    int32_t nextStreamId;
+    bool stopping;
+};
+
+#endif // MULTI_STREAM_SCHEDULER_H
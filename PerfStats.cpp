@@ -0,0 +1,196 @@
+#include "PerfStats.h"
+#include "log/log.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const char* const kStageNames[PERF_STAGE_COUNT] = {
+    "decode", "convert", "letterbox", "forward", "proposals", "nms", "redact",
+    "writeback", "encode", "detect", "mem_total", "image_total", "video_total",
+};
+
+// Prometheus 直方图的 le 边界（秒）
+const double kExportBounds[] = { 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10 };
+
+int64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+const char* perf_stage_name(int stage) {
+    return stage >= 0 && stage < PERF_STAGE_COUNT ? kStageNames[stage] : "unknown";
+}
+
+PerfCounters::PerfCounters() {
+    this->reset();
+}
+
+int PerfCounters::bucket_index(uint64_t us) {
+    const uint64_t sub = 1u << kSubBits;
+    if (us < sub) return static_cast<int>(us);
+    const int msb = 63 - __builtin_clzll(us);
+    const int shift = msb - kSubBits;
+    const int index = (shift + 1) * static_cast<int>(sub) + static_cast<int>((us >> shift) & (sub - 1));
+    return std::min(index, kBuckets - 1);
+}
+
+double PerfCounters::bucket_low(int index) {
+    const int sub = 1 << kSubBits;
+    if (index < sub) return index;
+    const int shift = index / sub - 1;
+    return static_cast<double>(static_cast<uint64_t>(sub + index % sub) << shift);
+}
+
+double PerfCounters::bucket_high(int index) {
+    const int sub = 1 << kSubBits;
+    if (index < sub) return index + 1;
+    return bucket_low(index) + static_cast<double>(1ull << (index / sub - 1));
+}
+
+void PerfCounters::record(int stage, std::chrono::steady_clock::duration elapsed) {
+    if (stage < 0 || stage >= PERF_STAGE_COUNT) return;
+    Stage& s = this->stages[stage];
+    const uint64_t ns = static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    s.count.fetch_add(1, std::memory_order_relaxed);
+    s.totalNs.fetch_add(ns, std::memory_order_relaxed);
+    s.buckets[bucket_index(ns / 1000)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t prev = s.maxNs.load(std::memory_order_relaxed);
+    while (ns > prev && !s.maxNs.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {
+    }
+}
+
+void PerfCounters::reset() {
+    for (Stage& s : this->stages) {
+        s.count.store(0, std::memory_order_relaxed);
+        s.totalNs.store(0, std::memory_order_relaxed);
+        s.maxNs.store(0, std::memory_order_relaxed);
+        for (std::atomic<uint64_t>& b : s.buckets) b.store(0, std::memory_order_relaxed);
+    }
+    this->resetAt.store(steady_ns(), std::memory_order_relaxed);
+}
+
+void PerfCounters::snapshot(AnonymizationStats& stats) const {
+    memset(&stats, 0, sizeof(stats));
+    stats.elapsedSec = (steady_ns() - this->resetAt.load(std::memory_order_relaxed)) / 1e9;
+    uint64_t buckets[kBuckets];
+    for (int i = 0; i < PERF_STAGE_COUNT; ++i) {
+        const Stage& s = this->stages[i];
+        StageStats& out = stats.stages[i];
+        // 与正在进行的更新之间不加锁，各字段之间可能相差几次记录
+        uint64_t total = 0;
+        for (int b = 0; b < kBuckets; ++b) {
+            buckets[b] = s.buckets[b].load(std::memory_order_relaxed);
+            total += buckets[b];
+        }
+        out.count = s.count.load(std::memory_order_relaxed);
+        out.totalMs = s.totalNs.load(std::memory_order_relaxed) / 1e6;
+        out.maxMs = s.maxNs.load(std::memory_order_relaxed) / 1e6;
+        out.meanMs = out.count > 0 ? out.totalMs / static_cast<double>(out.count) : 0.0;
+        if (total == 0) continue;
+
+        const double quantiles[] = { 0.5, 0.9, 0.99 };
+        double* targets[] = { &out.p50Ms, &out.p90Ms, &out.p99Ms };
+        for (int q = 0; q < 3; ++q) {
+            const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(quantiles[q] * static_cast<double>(total) + 0.5));
+            uint64_t seen = 0;
+            for (int b = 0; b < kBuckets; ++b) {
+                seen += buckets[b];
+                if (seen >= rank) {
+                    // 取桶中点，不超过观测到的最大值
+                    *targets[q] = std::min((bucket_low(b) + bucket_high(b)) / 2 / 1000.0, out.maxMs);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void PerfCounters::write_prometheus(std::string& out, const std::string& label) const {
+    char line[256];
+    out += "# HELP anonymization_stage_duration_seconds Time spent in each processing stage.\n";
+    out += "# TYPE anonymization_stage_duration_seconds histogram\n";
+    for (int i = 0; i < PERF_STAGE_COUNT; ++i) {
+        const Stage& s = this->stages[i];
+        uint64_t buckets[kBuckets];
+        for (int b = 0; b < kBuckets; ++b) buckets[b] = s.buckets[b].load(std::memory_order_relaxed);
+        uint64_t cumulative = 0;
+        int b = 0;
+        for (double le : kExportBounds) {
+            const double leUs = le * 1e6;
+            while (b < kBuckets && bucket_high(b) <= leUs) cumulative += buckets[b++];
+            // 跨越 le 的细分桶按线性插值计入一部分
+            uint64_t partial = 0;
+            if (b < kBuckets && bucket_low(b) < leUs)
+                partial = static_cast<uint64_t>(buckets[b] * (leUs - bucket_low(b)) / (bucket_high(b) - bucket_low(b)));
+            snprintf(line, sizeof(line), "anonymization_stage_duration_seconds_bucket{handle=\"%s\",stage=\"%s\",le=\"%g\"} %llu\n",
+                     label.c_str(), kStageNames[i], le, static_cast<unsigned long long>(cumulative + partial));
+            out += line;
+        }
+        for (; b < kBuckets; ++b) cumulative += buckets[b];
+        snprintf(line, sizeof(line), "anonymization_stage_duration_seconds_bucket{handle=\"%s\",stage=\"%s\",le=\"+Inf\"} %llu\n",
+                 label.c_str(), kStageNames[i], static_cast<unsigned long long>(cumulative));
+        out += line;
+        snprintf(line, sizeof(line), "anonymization_stage_duration_seconds_sum{handle=\"%s\",stage=\"%s\"} %.9f\n",
+                 label.c_str(), kStageNames[i], s.totalNs.load(std::memory_order_relaxed) / 1e9);
+        out += line;
+        snprintf(line, sizeof(line), "anonymization_stage_duration_seconds_count{handle=\"%s\",stage=\"%s\"} %llu\n",
+                 label.c_str(), kStageNames[i], static_cast<unsigned long long>(cumulative));
+        out += line;
+    }
+    out += "# HELP anonymization_stage_duration_max_seconds Longest single duration of each stage since the last reset.\n";
+    out += "# TYPE anonymization_stage_duration_max_seconds gauge\n";
+    for (int i = 0; i < PERF_STAGE_COUNT; ++i) {
+        snprintf(line, sizeof(line), "anonymization_stage_duration_max_seconds{handle=\"%s\",stage=\"%s\"} %.9f\n",
+                 label.c_str(), kStageNames[i], this->stages[i].maxNs.load(std::memory_order_relaxed) / 1e9);
+        out += line;
+    }
+}
+
+PerfDumper::PerfDumper(const PerfCounters& counters, const std::string& path, int intervalMs, const std::string& label)
+    : counters(counters), path(path), intervalMs(intervalMs), label(label), stopping(false) {
+    this->thread = std::thread(&PerfDumper::run, this);
+}
+
+PerfDumper::~PerfDumper() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->changed.notify_all();
+    this->thread.join();
+}
+
+void PerfDumper::run() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    bool failed = false;
+    while (!this->stopping) {
+        lock.unlock();
+        const bool ok = this->dump();
+        if (!ok && !failed) log_warn("set_stats_dump: Failed to write '%s'.", this->path.c_str());
+        failed = !ok;
+        lock.lock();
+        this->changed.wait_for(lock, std::chrono::milliseconds(this->intervalMs), [this]() { return this->stopping; });
+    }
+    lock.unlock();
+    this->dump();   // 停止前写出最终值
+}
+
+bool PerfDumper::dump() {
+    std::string text;
+    this->counters.write_prometheus(text, this->label);
+    // textfile collector 要求原子替换，先写同目录下的临时文件再 rename
+    const std::string temp = this->path + ".tmp";
+    FILE* fp = fopen(temp.c_str(), "w");
+    if (fp == nullptr) return false;
+    bool ok = fwrite(text.data(), 1, text.size(), fp) == text.size();
+    ok = fclose(fp) == 0 && ok;
+    if (!ok || rename(temp.c_str(), this->path.c_str()) != 0) {
+        remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,102 @@
+#ifndef PERF_STATS_H
+#define PERF_STATS_H
+
+#include "Anonymization.h"
+#include "Trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+const char* perf_stage_name(int stage);
+
+/**
+ * @brief 每个句柄一份的分阶段计数器和延迟直方图
+ * 直方图按微秒对数分桶（每个 2 的幂区间分 8 个子桶），所有更新都是无锁的原子加，
+ * 句柄派生的并行工作实例共享同一份计数器
+ */
+class PerfCounters
+{
+public:
+    PerfCounters();
+
+    void record(int stage, std::chrono::steady_clock::duration elapsed);
+    void snapshot(AnonymizationStats& stats) const;
+    void reset();
+    // 写出 Prometheus 文本格式，label 为 handle 标签的值
+    void write_prometheus(std::string& out, const std::string& label) const;
+
+private:
+    static const int kSubBits = 3;
+    static const int kBuckets = 256;
+
+    static int bucket_index(uint64_t us);
+    static double bucket_low(int index);
+    static double bucket_high(int index);
+
+    struct Stage {
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> totalNs;
+        std::atomic<uint64_t> maxNs;
+        std::atomic<uint64_t> buckets[kBuckets];
+    };
+    Stage stages[PERF_STAGE_COUNT];
+    std::atomic<int64_t> resetAt;          // steady_clock 纳秒
+};
+
+/**
+ * @brief 作用域计时，counters 为 nullptr 且未开启时间线记录时不读时钟
+ * 开启时间线记录时同时写入一个以阶段命名的事件
+ */
+class PerfTimer
+{
+public:
+    PerfTimer(PerfCounters* counters, int stage)
+        : counters(counters), stage(stage), tracing(trace_enabled()) {
+        if (counters != nullptr || this->tracing) this->start = std::chrono::steady_clock::now();
+    }
+    ~PerfTimer() { this->stop(); }
+
+    void stop() {
+        if (this->counters == nullptr && !this->tracing) return;
+        const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        if (this->counters != nullptr) this->counters->record(this->stage, end - this->start);
+        if (this->tracing) trace_complete(perf_stage_name(this->stage), "stage", this->start, end);
+        this->counters = nullptr;
+        this->tracing = false;
+    }
+
+private:
+    PerfCounters* counters;
+    int stage;
+    bool tracing;
+    std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * @brief 后台线程按固定间隔把计数器写成 Prometheus 文本文件（写临时文件后 rename）
+ */
+class PerfDumper
+{
+public:
+    PerfDumper(const PerfCounters& counters, const std::string& path, int intervalMs, const std::string& label);
+    ~PerfDumper();
+
+private:
+    void run();
+    bool dump();
+
+    const PerfCounters& counters;
+    const std::string path;
+    const int intervalMs;
+    const std::string label;
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool stopping;
+    std::thread thread;
+};
+
+#endif // PERF_STATS_H
@@ -0,0 +1,140 @@
+#include "PngCodec.h"
+
+#ifdef ANONYMIZATION_WITH_LIBPNG
+
+#include "log/log.h"
+
+#include <cstdio>
+#include <string>
+
+#include <png.h>
+
+namespace {
+
+void png_error_fn(png_structp png, png_const_charp message) {
+    log_error("libpng: %s", message);
+    png_longjmp(png, 1);
+}
+
+void png_warning_fn(png_structp, png_const_charp) {
+}
+
+class PngStripReader : public ImageStripReader
+{
+public:
+    ~PngStripReader() override {
+        if (this->png != nullptr) png_destroy_read_struct(&this->png, this->info != nullptr ? &this->info : nullptr, nullptr);
+        if (this->fp != nullptr) fclose(this->fp);
+    }
+
+    bool open(const char* path) {
+        this->fp = fopen(path, "rb");
+        if (this->fp == nullptr) return false;
+        this->png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, png_error_fn, png_warning_fn);
+        if (this->png == nullptr) return false;
+        this->info = png_create_info_struct(this->png);
+        if (this->info == nullptr) return false;
+        if (setjmp(png_jmpbuf(this->png))) return false;
+        png_init_io(this->png, this->fp);
+        png_read_info(this->png, this->info);
+        if (png_get_interlace_type(this->png, this->info) != PNG_INTERLACE_NONE) {
+            log_debug("png_open_strip_reader: '%s' is interlaced.", path);
+            return false;
+        }
+        const int colorType = png_get_color_type(this->png, this->info);
+        png_set_expand(this->png);
+        png_set_strip_16(this->png);
+        png_set_strip_alpha(this->png);
+        if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA) png_set_gray_to_rgb(this->png);
+        png_set_bgr(this->png);
+        png_read_update_info(this->png, this->info);
+        if (png_get_channels(this->png, this->info) != 3 || png_get_bit_depth(this->png, this->info) != 8) return false;
+        this->imageWidth = static_cast<int>(png_get_image_width(this->png, this->info));
+        this->imageHeight = static_cast<int>(png_get_image_height(this->png, this->info));
+        return true;
+    }
+
+    int width() const override { return this->imageWidth; }
+    int height() const override { return this->imageHeight; }
+
+    bool read_rows(cv::Mat& rows) override {
+        if (setjmp(png_jmpbuf(this->png))) return false;
+        for (int r = 0; r < rows.rows; ++r) png_read_row(this->png, rows.ptr<png_byte>(r), nullptr);
+        return true;
+    }
+
+private:
+    FILE* fp = nullptr;
+    png_structp png = nullptr;
+    png_infop info = nullptr;
+    int imageWidth = 0;
+    int imageHeight = 0;
+};
+
+// 未调用 finish 就析构时删除不完整的输出文件
+class PngStripWriter : public ImageStripWriter
+{
+public:
+    ~PngStripWriter() override {
+        if (this->png != nullptr) png_destroy_write_struct(&this->png, this->info != nullptr ? &this->info : nullptr);
+        if (this->fp != nullptr) {
+            fclose(this->fp);
+            remove(this->path.c_str());
+        }
+    }
+
+    bool open(const char* path, int width, int height) {
+        this->path = path;
+        this->fp = fopen(path, "wb");
+        if (this->fp == nullptr) return false;
+        this->png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, png_error_fn, png_warning_fn);
+        if (this->png == nullptr) return false;
+        this->info = png_create_info_struct(this->png);
+        if (this->info == nullptr) return false;
+        if (setjmp(png_jmpbuf(this->png))) return false;
+        png_init_io(this->png, this->fp);
+        png_set_IHDR(this->png, this->info, static_cast<png_uint_32>(width), static_cast<png_uint_32>(height), 8,
+                     PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+        png_set_compression_level(this->png, 1);
+        png_write_info(this->png, this->info);
+        png_set_bgr(this->png);
+        return true;
+    }
+
+    bool write_rows(const cv::Mat& rows) override {
+        if (setjmp(png_jmpbuf(this->png))) return false;
+        for (int r = 0; r < rows.rows; ++r) png_write_row(this->png, rows.ptr<png_byte>(r));
+        return true;
+    }
+
+    bool finish() override {
+        if (setjmp(png_jmpbuf(this->png))) return false;
+        png_write_end(this->png, nullptr);
+        const bool ok = fclose(this->fp) == 0;
+        this->fp = nullptr;
+        if (!ok) remove(this->path.c_str());
+        return ok;
+    }
+
+private:
+    FILE* fp = nullptr;
+    png_structp png = nullptr;
+    png_infop info = nullptr;
+    std::string path;
+};
+
+} // namespace
+
+std::unique_ptr<ImageStripReader> png_open_strip_reader(const char* path) {
+    std::unique_ptr<PngStripReader> reader(new PngStripReader());
+    if (!reader->open(path)) return nullptr;
+    return reader;
+}
+
+std::unique_ptr<ImageStripWriter> png_open_strip_writer(const char* path, int width, int height) {
+    std::unique_ptr<PngStripWriter> writer(new PngStripWriter());
+    if (!writer->open(path, width, height)) return nullptr;
+    return writer;
+}
+
+#endif // ANONYMIZATION_WITH_LIBPNG
@@ -0,0 +1,18 @@
+#ifndef PNG_CODEC_H
+#define PNG_CODEC_H
+
+// 基于 libpng 的 PNG 逐行读写，仅在定义 ANONYMIZATION_WITH_LIBPNG 时编译
+#ifdef ANONYMIZATION_WITH_LIBPNG
+
+#include "TiledImage.h"
+
+#include <memory>
+
+// 输出统一为 8 位 BGR（调色板、灰度展开，16 位截断，丢弃 alpha）；隔行扫描的文件不能逐行读取，返回 nullptr
+std::unique_ptr<ImageStripReader> png_open_strip_reader(const char* path);
+// 写 8 位 RGB，为了吞吐使用较低的压缩级别
+std::unique_ptr<ImageStripWriter> png_open_strip_writer(const char* path, int width, int height);
+
+#endif // ANONYMIZATION_WITH_LIBPNG
+
+#endif // PNG_CODEC_H
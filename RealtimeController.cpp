@@ -0,0 +1,72 @@
+#include "RealtimeController.h"
+#include "log/log.h"
+
+#include <algorithm>
+
+// 按比例缩小网络输入边长，取 32 的倍数且不小于 160（YOLOv8_face::set_input_size 的要求）
+static int scaled_input_size(int base, int num, int den) {
+    return std::min(base, std::max(160, base * num / den / 32 * 32));
+}
+
+RealtimeController::RealtimeController(double targetMs, int baseInputSize, int baseDetectInterval, BlurType baseBlurType)
+    : current(0), targetMs(targetMs), latencyEwma(0), detectEwma(0), otherEwma(0),
+      overBudget(0), underBudget(0), sinceChange(0) {
+    const int interval = std::max(1, baseDetectInterval);
+    // 高斯模糊是最贵的脱敏方式，降级时换成马赛克；画框和不处理保持不变
+    const int cheapBlur = baseBlurType == BLUR_TYPE_GAUSSIAN ? BLUR_TYPE_MOSAIC : baseBlurType;
+    // 依次降低：输入尺寸（原尺寸、3/4、1/2）-> 检测间隔 -> 脱敏方式 -> 几乎只沿用旧框并扩大边距
+    const int full = baseInputSize;
+    const int medium = scaled_input_size(full, 3, 4);
+    const int small = scaled_input_size(full, 1, 2);
+    this->levels.push_back({full, interval, baseBlurType, 0.0f});
+    this->levels.push_back({medium, interval, baseBlurType, 0.0f});
+    this->levels.push_back({small, interval, baseBlurType, 0.0f});
+    this->levels.push_back({small, std::max(2, interval * 2), baseBlurType, 0.05f});
+    this->levels.push_back({small, std::max(4, interval * 4), cheapBlur, 0.1f});
+    this->levels.push_back({small, std::max(8, interval * 8), cheapBlur, 0.2f});
+}
+
+bool RealtimeController::update(double latencyMs, double detectMs, double otherMs) {
+    const double alpha = 0.2;
+    this->latencyEwma = this->latencyEwma <= 0 ? latencyMs : this->latencyEwma + alpha * (latencyMs - this->latencyEwma);
+    if (detectMs > 0)
+        this->detectEwma = this->detectEwma <= 0 ? detectMs : this->detectEwma + alpha * (detectMs - this->detectEwma);
+    this->otherEwma = this->otherEwma <= 0 ? otherMs : this->otherEwma + alpha * (otherMs - this->otherEwma);
+    this->sinceChange++;
+
+    // 平均每帧的处理耗时：检测开销按间隔摊薄
+    const double serviceMs = this->otherEwma + this->detectEwma / this->level().detectInterval;
+    const bool behind = this->latencyEwma > this->targetMs || serviceMs > this->targetMs;
+    const bool relaxed = this->latencyEwma < this->targetMs * 0.5 && serviceMs < this->targetMs * 0.5;
+    this->overBudget = behind ? this->overBudget + 1 : 0;
+    this->underBudget = relaxed ? this->underBudget + 1 : 0;
+    if (this->sinceChange < kCooldownFrames)
+        return false;
+
+    int next = this->current;
+    if (this->overBudget >= kStepDownPatience && this->current + 1 < this->level_count())
+        next = this->current + 1;
+    else if (this->underBudget >= kStepUpPatience && this->current > 0)
+        next = this->current - 1;
+    if (next == this->current)
+        return false;
+
+    log_info("RealtimeController: Level %d -> %d (latency %.1f ms, detect %.1f ms, other %.1f ms, target %.1f ms).",
+             this->current, next, this->latencyEwma, this->detectEwma, this->otherEwma, this->targetMs);
+    this->current = next;
+    this->overBudget = 0;
+    this->underBudget = 0;
+    this->sinceChange = 0;
+    return true;
+}
+
+void RealtimeController::enlarge_boxes(std::vector<cv::Rect>& boxes, float margin, cv::Size frameSize) {
+    if (margin <= 0)
+        return;
+    const cv::Rect bounds(0, 0, frameSize.width, frameSize.height);
+    for (cv::Rect& box : boxes) {
+        int dx = static_cast<int>(box.width * margin);
+        int dy = static_cast<int>(box.height * margin);
+        box = cv::Rect(box.x - dx, box.y - dy, box.width + 2 * dx, box.height + 2 * dy) & bounds;
+    }
+}
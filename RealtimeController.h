@@ -0,0 +1,60 @@
+#ifndef REALTIME_CONTROLLER_H
+#define REALTIME_CONTROLLER_H
+
+#include "Anonymization.h"
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * @brief 实时模式下的一档处理质量
+ */
+struct RealtimeLevel {
+    int inputSize;        // 网络输入边长
+    int detectInterval;   // 完整检测间隔，中间帧沿用上一次的框
+    int blurType;         // 脱敏方式
+    float boxMargin;      // 沿用的框向四周扩大的比例，补偿目标在两次检测之间的移动
+};
+
+/**
+ * @brief 按延迟目标在线调节处理质量
+ * 逐帧记录端到端延迟（从送入到处理完成，含排队）和各阶段耗时，用指数滑动平均平滑；
+ * 连续超出目标时降一档，长期低于目标一半时升一档，两次调整之间有冷却期避免来回抖动
+ */
+class RealtimeController
+{
+public:
+    // baseInputSize 为模型当前的网络输入边长（YOLOv8_face::input_size()），最高一档使用它
+    RealtimeController(double targetMs, int baseInputSize, int baseDetectInterval, BlurType baseBlurType);
+
+    const RealtimeLevel& level() const { return this->levels[this->current]; }
+    int level_index() const { return this->current; }
+    int level_count() const { return static_cast<int>(this->levels.size()); }
+
+    // 记录一帧：latencyMs 为端到端延迟，detectMs 为本帧检测耗时（未检测为 0），otherMs 为颜色转换与脱敏耗时；
+    // 档位发生变化时返回 true
+    bool update(double latencyMs, double detectMs, double otherMs);
+
+    double latency_ms() const { return this->latencyEwma; }
+    double detect_ms() const { return this->detectEwma; }
+    double other_ms() const { return this->otherEwma; }
+
+    // 把框向四周扩大 margin 倍宽高，并裁剪到图像范围内
+    static void enlarge_boxes(std::vector<cv::Rect>& boxes, float margin, cv::Size frameSize);
+
+private:
+    static const int kStepDownPatience = 3;   // 连续超时多少帧后降档
+    static const int kStepUpPatience = 60;    // 连续宽裕多少帧后升档
+    static const int kCooldownFrames = 15;    // 两次调整之间至少间隔的帧数
+
+    std::vector<RealtimeLevel> levels;
+    int current;
+    double targetMs;
+    double latencyEwma;
+    double detectEwma;
+    double otherEwma;
+    int overBudget;
+    int underBudget;
+    int sinceChange;
+};
+
+#endif // REALTIME_CONTROLLER_H
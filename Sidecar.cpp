@@ -0,0 +1,215 @@
+#include "Sidecar.h"
+#include "log/log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+const char* const kSidecarMagic = "anonymization-detections";
+const int kSidecarVersion = 1;
+const size_t kFlushBytes = 64 * 1024;
+
+void append_json_string(std::string& out, const std::string& text) {
+    out += '"';
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+
+const char* skip_space(const char* p) {
+    while (*p == ' ' || *p == '\t') ++p;
+    return p;
+}
+
+// 返回 "key" 之后冒号后面的位置，找不到时返回 nullptr
+const char* find_value(const std::string& line, const char* key) {
+    const std::string quoted = std::string("\"") + key + "\"";
+    const size_t pos = line.find(quoted);
+    if (pos == std::string::npos) return nullptr;
+    const char* p = skip_space(line.c_str() + pos + quoted.size());
+    return *p == ':' ? skip_space(p + 1) : nullptr;
+}
+
+bool read_number(const char*& p, double& value) {
+    char* end = nullptr;
+    value = strtod(p, &end);
+    if (end == p) return false;
+    p = skip_space(end);
+    return std::isfinite(value);
+}
+
+// 解析 [[x,y,w,h,...],...]，每个框至少 4 个数
+bool parse_boxes(const char* p, std::vector<cv::Rect>& boxes) {
+    if (*p != '[') return false;
+    p = skip_space(p + 1);
+    if (*p == ']') return true;
+    while (true) {
+        if (*p != '[') return false;
+        p = skip_space(p + 1);
+        double values[4] = {0, 0, 0, 0};
+        int count = 0;
+        while (*p != ']') {
+            double value = 0;
+            if (!read_number(p, value)) return false;
+            if (count < 4) values[count] = value;
+            ++count;
+            if (*p == ',') p = skip_space(p + 1);
+            else if (*p != ']') return false;
+        }
+        if (count < 4 || values[2] < 0 || values[3] < 0) return false;
+        boxes.emplace_back(static_cast<int>(std::lround(values[0])), static_cast<int>(std::lround(values[1])),
+                           static_cast<int>(std::lround(values[2])), static_cast<int>(std::lround(values[3])));
+        p = skip_space(p + 1);
+        if (*p == ']') return true;
+        if (*p != ',') return false;
+        p = skip_space(p + 1);
+    }
+}
+
+} // namespace
+
+SidecarWriter::~SidecarWriter() {
+    if (this->fp != nullptr) this->close();
+}
+
+bool SidecarWriter::open(const char* path, const char* source, const char* className) {
+    this->fp = fopen(path, "w");
+    if (this->fp == nullptr) {
+        log_error("sidecar: Failed to open '%s' for writing: %s", path, strerror(errno));
+        return false;
+    }
+    this->path = path;
+    this->source = source;
+    this->className = className;
+    this->buffer.reserve(kFlushBytes + 1024);
+    return true;
+}
+
+void SidecarWriter::write_header(int width, int height, double fps) {
+    this->buffer += "{\"sidecar\":\"";
+    this->buffer += kSidecarMagic;
+    this->buffer += "\",\"version\":" + std::to_string(kSidecarVersion) + ",\"source\":";
+    append_json_string(this->buffer, this->source);
+    char line[160];
+    snprintf(line, sizeof(line), ",\"width\":%d,\"height\":%d,\"fps\":%.3f,\"classes\":[", width, height, fps);
+    this->buffer += line;
+    append_json_string(this->buffer, this->className);
+    this->buffer += "],\"box\":[\"x\",\"y\",\"w\",\"h\",\"score\",\"class\"]}\n";
+}
+
+void SidecarWriter::write_frame(long long frameIndex, double timestampMs, bool detected,
+                                const std::vector<cv::Rect>& boxes, const std::vector<float>& confidences) {
+    if (boxes.empty()) return;
+    char item[128];
+    snprintf(item, sizeof(item), "{\"frame\":%lld,\"ts_ms\":%.3f,\"detected\":%d,\"boxes\":[", frameIndex, timestampMs, detected ? 1 : 0);
+    this->buffer += item;
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        // 复用帧的框与最近一次检测相同，置信度沿用该次检测的结果
+        const float score = i < confidences.size() ? confidences[i] : -1.f;
+        snprintf(item, sizeof(item), "%s[%d,%d,%d,%d,%.3f,0]", i > 0 ? "," : "", boxes[i].x, boxes[i].y, boxes[i].width, boxes[i].height, score);
+        this->buffer += item;
+    }
+    this->buffer += "]}\n";
+    ++this->frames;
+    if (this->buffer.size() >= kFlushBytes) this->flush();
+}
+
+void SidecarWriter::flush() {
+    if (this->fp != nullptr && !this->buffer.empty()
+        && fwrite(this->buffer.data(), 1, this->buffer.size(), this->fp) != this->buffer.size()) {
+        this->failed = true;
+    }
+    this->buffer.clear();
+}
+
+bool SidecarWriter::close() {
+    if (this->fp == nullptr) return false;
+    this->flush();
+    if (fclose(this->fp) != 0) this->failed = true;
+    this->fp = nullptr;
+    if (this->failed) log_error("sidecar: Failed to write '%s'.", this->path.c_str());
+    return !this->failed;
+}
+
+int SidecarBoxes::load(const char* path) {
+    this->path = path;
+    std::ifstream in(path);
+    if (!in) {
+        log_error("sidecar: Cannot open '%s'.", path);
+        return SIDECAR_ERROR;
+    }
+    std::string line;
+    bool hasHeader = false;
+    for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+        const size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos) continue;
+
+        const char* p = find_value(line, "sidecar");
+        if (p != nullptr) {
+            double version = 0, width = 0, height = 0;
+            const char* v = find_value(line, "version");
+            const char* w = find_value(line, "width");
+            const char* h = find_value(line, "height");
+            const std::string magic = std::string("\"") + kSidecarMagic + "\"";
+            if (strncmp(p, magic.c_str(), magic.size()) != 0 || v == nullptr || !read_number(v, version)
+                || w == nullptr || !read_number(w, width) || h == nullptr || !read_number(h, height)) {
+                log_error("sidecar: '%s' line %d: Invalid header.", path, lineNo);
+                return SIDECAR_ERROR;
+            }
+            if (static_cast<int>(version) > kSidecarVersion) {
+                log_error("sidecar: '%s' has version %d, this SDK reads up to %d.", path, static_cast<int>(version), kSidecarVersion);
+                return SIDECAR_ERROR;
+            }
+            this->width = static_cast<int>(width);
+            this->height = static_cast<int>(height);
+            hasHeader = true;
+            continue;
+        }
+
+        double frame = 0;
+        const char* f = find_value(line, "frame");
+        const char* b = find_value(line, "boxes");
+        std::vector<cv::Rect> parsed;
+        if (f == nullptr || !read_number(f, frame) || frame < 0 || b == nullptr || !parse_boxes(b, parsed)) {
+            log_error("sidecar: '%s' line %d: Expected {\"frame\":N,...,\"boxes\":[[x,y,w,h,...],...]}.", path, lineNo);
+            return SIDECAR_ERROR;
+        }
+        const long long index = static_cast<long long>(frame);
+        std::vector<cv::Rect>& boxes = this->frames[index];
+        boxes.insert(boxes.end(), parsed.begin(), parsed.end());
+        this->boxCount += parsed.size();
+        this->lastFrame = std::max(this->lastFrame, index);
+    }
+    if (!hasHeader) {
+        log_error("sidecar: '%s' has no header line.", path);
+        return SIDECAR_ERROR;
+    }
+    log_info("sidecar: Loaded %zu boxes in %zu frames from '%s'.", this->boxCount, this->frames.size(), path);
+    return ANO_OK;
+}
+
+bool SidecarBoxes::matches(int width, int height) const {
+    if (this->width == width && this->height == height) return true;
+    log_error("sidecar: '%s' was recorded at %dx%d, input is %dx%d.", this->path.c_str(), this->width, this->height, width, height);
+    return false;
+}
+
+const std::vector<cv::Rect>& SidecarBoxes::boxes(long long frameIndex) const {
+    auto it = this->frames.find(frameIndex);
+    return it == this->frames.end() ? this->none : it->second;
+}
@@ -0,0 +1,74 @@
+#ifndef SIDECAR_H
+#define SIDECAR_H
+
+#include "Anonymization.h"
+#include <opencv2/core.hpp>
+
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * 检测结果旁路文件（JSON Lines）。第一行为文件头，之后每个有目标的帧一行，没有目标的帧不写：
+ *   {"sidecar":"anonymization-detections","version":1,"source":"in.mp4","width":1920,"height":1080,"fps":25.000,
+ *    "classes":["face"],"box":["x","y","w","h","score","class"]}
+ *   {"frame":12,"ts_ms":480.000,"detected":1,"boxes":[[812,344,96,118,0.913,0]]}
+ * frame 为从 0 开始的解码帧号（图片为 0），ts_ms 为显示时间戳，detected 为 0 表示该帧的框复用自之前的检测。
+ * 回放按 frame 取框，只要求每个框前 4 个数为 x、y、w、h，行顺序不限，同一帧的多行合并，便于人工增删
+ */
+
+/**
+ * @brief 顺序写出旁路文件，帧行先在内存中攒批再写盘
+ */
+class SidecarWriter
+{
+public:
+    ~SidecarWriter();
+    bool open(const char* path, const char* source, const char* className);
+    // 写文件头，读到视频/图片尺寸后调用一次
+    void write_header(int width, int height, double fps);
+    void write_frame(long long frameIndex, double timestampMs, bool detected,
+                     const std::vector<cv::Rect>& boxes, const std::vector<float>& confidences);
+    // 写出剩余内容并关闭，有写入错误时返回 false
+    bool close();
+    long long frames_written() const { return this->frames; }
+
+private:
+    void flush();
+
+    FILE* fp = nullptr;
+    std::string path;
+    std::string source;
+    std::string className;
+    std::string buffer;
+    long long frames = 0;
+    bool failed = false;
+};
+
+/**
+ * @brief 整个旁路文件读入内存，按帧号查框
+ */
+class SidecarBoxes
+{
+public:
+    // 成功返回 ANO_OK，文件无法打开或格式错误返回 SIDECAR_ERROR
+    int load(const char* path);
+    // 文件头中的尺寸与输入一致时返回 true，不一致时记录日志
+    bool matches(int width, int height) const;
+    // 该帧的框，没有时返回空
+    const std::vector<cv::Rect>& boxes(long long frameIndex) const;
+    long long last_frame() const { return this->lastFrame; }
+    size_t box_count() const { return this->boxCount; }
+
+private:
+    std::string path;
+    int width = 0;
+    int height = 0;
+    long long lastFrame = -1;
+    size_t boxCount = 0;
+    std::unordered_map<long long, std::vector<cv::Rect>> frames;
+    std::vector<cv::Rect> none;
+};
+
+#endif // SIDECAR_H
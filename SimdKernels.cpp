@@ -0,0 +1,254 @@
+#include "SimdKernels.h"
+#include "log/log.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+struct KernelTable {
+    const char* name;
+    void (*interleave_uv)(const uint8_t* u, const uint8_t* v, uint8_t* uv, int count);
+    int (*score_scan)(const float* scores, int count, float threshold, int* indices);
+};
+
+// ---------------- scalar ----------------
+
+void interleave_uv_scalar(const uint8_t* u, const uint8_t* v, uint8_t* uv, int count) {
+    for (int i = 0; i < count; ++i) {
+        uv[2 * i] = u[i];
+        uv[2 * i + 1] = v[i];
+    }
+}
+
+// 逐个检查 [begin, count)，命中的下标接在 indices[n] 之后，返回新的个数
+inline int scan_range(const float* scores, int begin, int count, float threshold, int* indices, int n) {
+    for (int i = begin; i < count; ++i) {
+        if (scores[i] > threshold) indices[n++] = i;
+    }
+    return n;
+}
+
+int score_scan_scalar(const float* scores, int count, float threshold, int* indices) {
+    return scan_range(scores, 0, count, threshold, indices, 0);
+}
+
+// 比较结果的位掩码展开为下标
+inline int append_mask(unsigned mask, int base, int* indices, int n) {
+    while (mask != 0) {
+        indices[n++] = base + __builtin_ctz(mask);
+        mask &= mask - 1;
+    }
+    return n;
+}
+
+#ifdef SIMD_X86
+// 各版本用函数级 target 属性编译，库本身仍按基线指令集构建，只在 CPU 支持时才会调用
+
+// ---------------- sse4.2 ----------------
+
+__attribute__((target("sse4.2")))
+void interleave_uv_sse42(const uint8_t* u, const uint8_t* v, uint8_t* uv, int count) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(u + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + 2 * i), _mm_unpacklo_epi8(a, b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(uv + 2 * i + 16), _mm_unpackhi_epi8(a, b));
+    }
+    interleave_uv_scalar(u + i, v + i, uv + 2 * i, count - i);
+}
+
+__attribute__((target("sse4.2")))
+int score_scan_sse42(const float* scores, int count, float threshold, int* indices) {
+    const __m128 t = _mm_set1_ps(threshold);
+    int n = 0, i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const unsigned mask = static_cast<unsigned>(_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(scores + i), t)));
+        n = append_mask(mask, i, indices, n);
+    }
+    return scan_range(scores, i, count, threshold, indices, n);
+}
+
+// ---------------- avx2 ----------------
+
+__attribute__((target("avx2")))
+void interleave_uv_avx2(const uint8_t* u, const uint8_t* v, uint8_t* uv, int count) {
+    int i = 0;
+    for (; i + 32 <= count; i += 32) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(u + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i));
+        // unpack 在 128 位通道内进行，再按通道重排成连续输出
+        const __m256i lo = _mm256_unpacklo_epi8(a, b);
+        const __m256i hi = _mm256_unpackhi_epi8(a, b);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + 2 * i), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(uv + 2 * i + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    interleave_uv_scalar(u + i, v + i, uv + 2 * i, count - i);
+}
+
+__attribute__((target("avx2")))
+int score_scan_avx2(const float* scores, int count, float threshold, int* indices) {
+    const __m256 t = _mm256_set1_ps(threshold);
+    int n = 0, i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(scores + i), t, _CMP_GT_OQ)));
+        n = append_mask(mask, i, indices, n);
+    }
+    return scan_range(scores, i, count, threshold, indices, n);
+}
+
+// ---------------- avx512 ----------------
+
+__attribute__((target("avx512f,avx512bw")))
+void interleave_uv_avx512(const uint8_t* u, const uint8_t* v, uint8_t* uv, int count) {
+    const __m512i first = _mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11);
+    const __m512i second = _mm512_setr_epi64(4, 5, 12, 13, 6, 7, 14, 15);
+    int i = 0;
+    for (; i + 64 <= count; i += 64) {
+        const __m512i a = _mm512_loadu_si512(u + i);
+        const __m512i b = _mm512_loadu_si512(v + i);
+        const __m512i lo = _mm512_unpacklo_epi8(a, b);
+        const __m512i hi = _mm512_unpackhi_epi8(a, b);
+        _mm512_storeu_si512(uv + 2 * i, _mm512_permutex2var_epi64(lo, first, hi));
+        _mm512_storeu_si512(uv + 2 * i + 64, _mm512_permutex2var_epi64(lo, second, hi));
+    }
+    interleave_uv_scalar(u + i, v + i, uv + 2 * i, count - i);
+}
+
+__attribute__((target("avx512f")))
+int score_scan_avx512(const float* scores, int count, float threshold, int* indices) {
+    const __m512 t = _mm512_set1_ps(threshold);
+    const __m512i step = _mm512_set1_epi32(16);
+    __m512i lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    int n = 0, i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __mmask16 mask = _mm512_cmp_ps_mask(_mm512_loadu_ps(scores + i), t, _CMP_GT_OQ);
+        // 命中的下标直接压缩写出
+        _mm512_mask_compressstoreu_epi32(indices + n, mask, lane);
+        n += __builtin_popcount(mask);
+        lane = _mm512_add_epi32(lane, step);
+    }
+    return scan_range(scores, i, count, threshold, indices, n);
+}
+#endif // SIMD_X86
+
+#ifdef SIMD_NEON
+// ---------------- neon（aarch64 基线，无需运行时检测） ----------------
+
+void interleave_uv_neon(const uint8_t* u, const uint8_t* v, uint8_t* uv, int count) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x2_t pair;
+        pair.val[0] = vld1q_u8(u + i);
+        pair.val[1] = vld1q_u8(v + i);
+        vst2q_u8(uv + 2 * i, pair);
+    }
+    interleave_uv_scalar(u + i, v + i, uv + 2 * i, count - i);
+}
+
+int score_scan_neon(const float* scores, int count, float threshold, int* indices) {
+    const float32x4_t t = vdupq_n_f32(threshold);
+    int n = 0, i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const uint32x4_t gt = vcgtq_f32(vld1q_f32(scores + i), t);
+        // 绝大多数候选框低于阈值，整组都未命中时直接跳过
+        if (vmaxvq_u32(gt) == 0) continue;
+        for (int k = 0; k < 4; ++k) {
+            if (scores[i + k] > threshold) indices[n++] = i + k;
+        }
+    }
+    return scan_range(scores, i, count, threshold, indices, n);
+}
+#endif // SIMD_NEON
+
+const KernelTable kScalar = { "scalar", interleave_uv_scalar, score_scan_scalar };
+#ifdef SIMD_X86
+const KernelTable kSse42 = { "sse4.2", interleave_uv_sse42, score_scan_sse42 };
+const KernelTable kAvx2 = { "avx2", interleave_uv_avx2, score_scan_avx2 };
+const KernelTable kAvx512 = { "avx512", interleave_uv_avx512, score_scan_avx512 };
+#endif
+#ifdef SIMD_NEON
+const KernelTable kNeon = { "neon", interleave_uv_neon, score_scan_neon };
+#endif
+
+// 当前 CPU 支持的版本，从低到高
+int supported_tables(const KernelTable* tables[8]) {
+    int n = 0;
+    tables[n++] = &kScalar;
+#ifdef SIMD_X86
+    // __builtin_cpu_supports 同时检查操作系统是否保存 AVX/AVX-512 寄存器状态
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) tables[n++] = &kSse42;
+    if (__builtin_cpu_supports("avx2")) tables[n++] = &kAvx2;
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) tables[n++] = &kAvx512;
+#endif
+#ifdef SIMD_NEON
+    tables[n++] = &kNeon;
+#endif
+    return n;
+}
+
+const KernelTable* find_table(const char* name) {
+    const KernelTable* tables[8];
+    const int n = supported_tables(tables);
+    if (strcmp(name, "auto") == 0) return tables[n - 1];
+    for (int i = 0; i < n; ++i) {
+        if (strcmp(tables[i]->name, name) == 0) return tables[i];
+    }
+    return nullptr;
+}
+
+// 加载时选择；环境变量只在加载时读取一次
+const KernelTable* select_table() {
+    const char* forced = getenv("ANONYMIZATION_SIMD");
+    if (forced != nullptr && forced[0] != '\0') {
+        const KernelTable* table = find_table(forced);
+        if (table != nullptr) return table;
+    }
+    return find_table("auto");
+}
+
+std::atomic<const KernelTable*> g_kernels(select_table());
+
+inline const KernelTable* kernels() {
+    return g_kernels.load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+void simd_interleave_uv(const uint8_t* u, const uint8_t* v, uint8_t* uv, int count) {
+    kernels()->interleave_uv(u, v, uv, count);
+}
+
+int simd_score_scan(const float* scores, int count, float threshold, int* indices) {
+    return kernels()->score_scan(scores, count, threshold, indices);
+}
+
+const char* simd_variant_name() {
+    return kernels()->name;
+}
+
+bool simd_force_variant(const char* name) {
+    const KernelTable* table = find_table(name);
+    if (table == nullptr) return false;
+    g_kernels.store(table, std::memory_order_relaxed);
+    log_info("simd: Using %s kernels.", table->name);
+    return true;
+}
+
+int simd_supported_variants(const char* names[8]) {
+    const KernelTable* tables[8];
+    const int n = supported_tables(tables);
+    for (int i = 0; i < n; ++i) names[i] = tables[i]->name;
+    return n;
+}
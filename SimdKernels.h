@@ -0,0 +1,24 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <cstdint>
+
+/*
+ * SDK 自己的像素/后处理内核，按指令集提供多个版本（scalar、sse4.2、avx2、avx512、neon），
+ * 库加载时按 CPUID 选择当前 CPU 支持的最高版本，环境变量 ANONYMIZATION_SIMD 或 set_simd_variant 可强制指定。
+ * 缩放、颜色转换、高斯模糊等由 OpenCV 完成，OpenCV 自身也按 CPU 运行时分派；平面拷贝用 memcpy，由 glibc 分派
+ */
+
+// 交织 U/V 平面为 NV12 的 UV 平面：uv[2i] = u[i]，uv[2i+1] = v[i]
+void simd_interleave_uv(const uint8_t* u, const uint8_t* v, uint8_t* uv, int count);
+// 找出 scores[i] > threshold 的下标，按升序写入 indices（容量至少 count），返回个数
+int simd_score_scan(const float* scores, int count, float threshold, int* indices);
+
+// 当前使用的版本名
+const char* simd_variant_name();
+// 强制使用指定版本，"auto" 恢复自动选择；名称未知或 CPU 不支持时返回 false
+bool simd_force_variant(const char* name);
+// 当前 CPU 支持的版本，按从低到高写入 names，返回个数（最多 8 个）
+int simd_supported_variants(const char* names[8]);
+
+#endif // SIMD_KERNELS_H
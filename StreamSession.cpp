@@ -0,0 +1,348 @@
+#include "StreamSession.h"
+#include "YOLOv8_face.h"
+#include "FrameConvert.h"
+#include "Trace.h"
+#include "log/log.h"
+
+#include <chrono>
+#include <new>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+bool StreamFrame::allocate(ImageFormat format, int width, int height) {
+    int rowBytes[4], rows[4];
+    int planes = image_frame_layout(format, width, height, rowBytes, rows);
+    if (planes == 0 || width <= 0 || height <= 0) return false;
+    size_t total = 0;
+    for (int i = 0; i < planes; ++i) total += static_cast<size_t>(rowBytes[i]) * rows[i];
+    this->buffer.resize(total);
+    memset(&this->frame, 0, sizeof(this->frame));
+    this->frame.format = format;
+    this->frame.width = width;
+    this->frame.height = height;
+    uint8_t* p = this->buffer.data();
+    for (int i = 0; i < planes; ++i) {
+        this->frame.data[i] = p;
+        this->frame.strides[i] = rowBytes[i];
+        p += static_cast<size_t>(rowBytes[i]) * rows[i];
+    }
+    return true;
+}
+
+bool StreamFrame::assign(const ImageFrame& src) {
+    if (!this->allocate(src.format, src.width, src.height)) return false;
+    int rowBytes[4], rows[4];
+    int planes = image_frame_layout(src.format, src.width, src.height, rowBytes, rows);
+    for (int i = 0; i < planes; ++i) {
+        if (src.data[i] == nullptr || src.strides[i] < rowBytes[i]) return false;
+        for (int r = 0; r < rows[i]; ++r) {
+            memcpy(this->frame.data[i] + static_cast<size_t>(r) * rowBytes[i], src.data[i] + static_cast<size_t>(r) * src.strides[i], rowBytes[i]);
+        }
+    }
+    return true;
+}
+
+StreamSession::StreamSession(const StreamOptions& options)
+    : options(options), scheduler(options.detectInterval, options.sceneCutThreshold),
+      inputEnded(false), stopping(false), processing(false), framesIn(0), framesOut(0), framesDropped(0) {
+}
+
+StreamSession::~StreamSession() {
+    this->stop();
+}
+
+int StreamSession::start(const YOLOv8_face& source) {
+    this->model.reset(new YOLOv8_face());
+    if (this->model->clone_from(source) != 0) {
+        log_error("open_stream: Failed to load model for the stream session.");
+        return MODEL_FORMAT_ERROR;
+    }
+    if (this->options.latencyTargetMs > 0) {
+        this->realtime.reset(new RealtimeController(this->options.latencyTargetMs, this->model->input_size(),
+                                                     this->options.detectInterval, this->options.blurType));
+        this->apply_realtime_level();
+    }
+    this->worker = std::thread(&StreamSession::worker_loop, this);
+    log_info("open_stream: Session started, blur type: %d, detect interval: %d, queue: %d frames, drop when full: %d, latency target: %.1f ms.",
+             static_cast<int>(this->options.blurType), this->options.detectInterval, this->options.maxQueueFrames, this->options.dropWhenFull,
+             this->options.latencyTargetMs);
+    return ANO_OK;
+}
+
+void StreamSession::stop() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->stopping) return;
+        this->stopping = true;
+    }
+    this->inputChanged.notify_all();
+    this->outputChanged.notify_all();
+    if (this->worker.joinable()) this->worker.join();
+    log_info("close_stream: Session closed. Frames in: %lld, out: %lld, dropped: %lld.", this->framesIn, this->framesOut, this->framesDropped);
+}
+
+void StreamSession::end() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->inputEnded = true;
+    }
+    this->inputChanged.notify_all();
+    this->outputChanged.notify_all();
+}
+
+std::unique_ptr<StreamFrame> StreamSession::acquire_frame() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->pool.empty()) return std::unique_ptr<StreamFrame>(new StreamFrame());
+    std::unique_ptr<StreamFrame> frame = std::move(this->pool.back());
+    this->pool.pop_back();
+    return frame;
+}
+
+void StreamSession::release_frame(std::unique_ptr<StreamFrame> frame) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->pool.push_back(std::move(frame));
+}
+
+// 等待条件成立，timeoutMs < 0 一直等待；返回条件是否成立
+template <typename Predicate>
+static bool wait_for(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, int timeoutMs, Predicate pred) {
+    if (timeoutMs < 0) {
+        cv.wait(lock, pred);
+        return true;
+    }
+    return cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), pred);
+}
+
+int StreamSession::enqueue(std::unique_ptr<StreamFrame> frame, int timeoutMs) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    if (this->inputEnded || this->stopping) {
+        log_error("push_frame: Stream already ended.");
+        this->pool.push_back(std::move(frame));
+        return INVALID_PARAMETER;
+    }
+    const size_t capacity = static_cast<size_t>(this->options.maxQueueFrames);
+    if (this->input.size() >= capacity) {
+        if (this->options.dropWhenFull) {
+            // 实时源宁可丢掉最旧的待处理帧，也不让延迟累积
+            this->pool.push_back(std::move(this->input.front()));
+            this->input.pop_front();
+            this->framesDropped++;
+            log_debug("push_frame: Input queue full, dropped oldest frame (%lld dropped so far).", this->framesDropped);
+        } else if (!wait_for(this->inputChanged, lock, timeoutMs, [&]() { return this->input.size() < capacity || this->stopping; })) {
+            this->pool.push_back(std::move(frame));
+            return STREAM_TIMEOUT;
+        }
+        if (this->stopping) {
+            this->pool.push_back(std::move(frame));
+            return INVALID_PARAMETER;
+        }
+    }
+    frame->pushedAt = std::chrono::steady_clock::now();
+    this->input.push_back(std::move(frame));
+    this->framesIn++;
+    lock.unlock();
+    this->inputChanged.notify_all();
+    return ANO_OK;
+}
+
+int StreamSession::push(const ImageFrame& frame, int64_t pts, int timeoutMs) {
+    std::unique_ptr<StreamFrame> copy = this->acquire_frame();
+    bool valid = false;
+    try {
+        valid = copy->assign(frame);
+    } catch (const std::bad_alloc&) {
+        log_error("push_frame: Failed to allocate a %dx%d frame buffer.", frame.width, frame.height);
+        this->release_frame(std::move(copy));
+        return MEMORY_ALLOCATION_ERROR;
+    }
+    if (!valid) {
+        log_error("push_frame: Invalid frame (format %d, %dx%d) or strides.", static_cast<int>(frame.format), frame.width, frame.height);
+        this->release_frame(std::move(copy));
+        return INVALID_PARAMETER;
+    }
+    copy->pts = pts;
+    return this->enqueue(std::move(copy), timeoutMs);
+}
+
+int StreamSession::push_fd(int fd, ImageFormat format, int width, int height, int64_t pts, int timeoutMs) {
+    std::unique_ptr<StreamFrame> frame = this->acquire_frame();
+    bool valid = false;
+    try {
+        valid = frame->allocate(format, width, height);
+    } catch (const std::bad_alloc&) {
+        log_error("push_frame_fd: Failed to allocate a %dx%d frame buffer.", width, height);
+        this->release_frame(std::move(frame));
+        return MEMORY_ALLOCATION_ERROR;
+    }
+    if (!valid) {
+        log_error("push_frame_fd: Unsupported format %d or invalid size %dx%d.", static_cast<int>(format), width, height);
+        this->release_frame(std::move(frame));
+        return INVALID_PARAMETER;
+    }
+    size_t got = 0;
+    while (got < frame->buffer.size()) {
+        ssize_t n = read(fd, frame->buffer.data() + got, frame->buffer.size() - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += static_cast<size_t>(n);
+    }
+    if (got != frame->buffer.size()) {
+        if (got > 0) log_error("push_frame_fd: Truncated frame, read %zu of %zu bytes.", got, frame->buffer.size());
+        this->release_frame(std::move(frame));
+        return got == 0 ? STREAM_END : LOAD_IMAGE_ERROR;
+    }
+    frame->pts = pts;
+    return this->enqueue(std::move(frame), timeoutMs);
+}
+
+int StreamSession::pull(ImageFrame& frame, int64_t* pts, int timeoutMs) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    auto ready = [&]() {
+        return !this->output.empty() || this->stopping ||
+               (this->inputEnded && this->input.empty() && !this->processing);
+    };
+    if (!wait_for(this->outputChanged, lock, timeoutMs, ready)) return STREAM_TIMEOUT;
+    if (this->output.empty()) return STREAM_END;
+    if (this->current) this->pool.push_back(std::move(this->current));
+    this->current = std::move(this->output.front());
+    this->output.pop_front();
+    this->framesOut++;
+    frame = this->current->frame;
+    if (pts != nullptr) *pts = this->current->pts;
+    lock.unlock();
+    this->outputChanged.notify_all();
+    return ANO_OK;
+}
+
+void StreamSession::apply_realtime_level() {
+    const RealtimeLevel& level = this->realtime->level();
+    // 模型不支持的输入尺寸会被拒绝，此时保持当前尺寸
+    this->model->set_input_size(level.inputSize);
+    this->scheduler.set_detect_interval(level.detectInterval);
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// YUV420P/NV12 直接在原平面上检测和脱敏（只在网络输入分辨率上做颜色转换），
+// 不做整帧 BGR 往返，未脱敏的像素保持原样
+void StreamSession::process_yuv(ImageFrame& image, int blurType, float margin, double& detectMs) {
+    const int cw = image.width / 2, ch = image.height / 2;
+    cv::Mat y(image.height, image.width, CV_8UC1, image.data[0], image.strides[0]);
+    cv::Mat u, v, uv;
+    if (image.format == IMG_FORMAT_YUV420P) {
+        u = cv::Mat(ch, cw, CV_8UC1, image.data[1], image.strides[1]);
+        v = cv::Mat(ch, cw, CV_8UC1, image.data[2], image.strides[2]);
+    } else {
+        // NV12 的 UV 交错平面拆成两个半分辨率平面，脱敏后再合并回原缓冲区
+        uv = cv::Mat(ch, cw, CV_8UC2, image.data[1], image.strides[1]);
+        cv::extractChannel(uv, this->chromaU, 0);
+        cv::extractChannel(uv, this->chromaV, 1);
+        u = this->chromaU;
+        v = this->chromaV;
+    }
+    bool detected = false;
+    if (this->scheduler.need_detect_luma(y)) {
+        const auto detectStart = std::chrono::steady_clock::now();
+        this->model->detect_boxes_i420(y, u, v, this->boxes, this->confidences);
+        this->scheduler.update_boxes(this->boxes);
+        detectMs = elapsed_ms(detectStart, std::chrono::steady_clock::now());
+        detected = true;
+    }
+    this->redactBoxes = this->scheduler.carried_boxes();
+    // 沿用旧框的帧按当前档位扩大边距，补偿目标在两次检测之间的移动
+    if (!detected) RealtimeController::enlarge_boxes(this->redactBoxes, margin, y.size());
+    if (this->redactBoxes.empty() || blurType == BLUR_TYPE_NONE) return;
+    this->model->redact_i420(y, u, v, this->redactBoxes, blurType);
+    if (!uv.empty()) {
+        const cv::Mat planes[2] = { u, v };
+        cv::merge(planes, 2, uv);
+    }
+}
+
+// 打包格式（BGR/RGB/ARGB/GRAY）转换为 BGR 检测和脱敏，有框时再写回
+void StreamSession::process_bgr(ImageFrame& image, int blurType, float margin, double& detectMs) {
+    cv::Mat bgr;
+    if (image_frame_to_bgr(&image, bgr) != ANO_OK) return;
+    bool detected = false;
+    if (this->scheduler.need_detect(bgr)) {
+        const auto detectStart = std::chrono::steady_clock::now();
+        this->model->detect_boxes(bgr, this->boxes, this->confidences);
+        this->scheduler.update_boxes(this->boxes);
+        detectMs = elapsed_ms(detectStart, std::chrono::steady_clock::now());
+        detected = true;
+    }
+    this->redactBoxes = this->scheduler.carried_boxes();
+    if (!detected) RealtimeController::enlarge_boxes(this->redactBoxes, margin, bgr.size());
+    if (!this->redactBoxes.empty() && blurType != BLUR_TYPE_NONE) {
+        this->model->redact(bgr, this->redactBoxes, blurType);
+        bgr_to_image_frame(bgr, &image);
+    }
+}
+
+void StreamSession::process(StreamFrame& frame) {
+    const auto start = std::chrono::steady_clock::now();
+    int blurType = this->options.blurType;
+    float margin = 0.0f;
+    if (this->realtime) {
+        blurType = this->realtime->level().blurType;
+        margin = this->realtime->level().boxMargin;
+    }
+
+    double detectMs = 0;
+    ImageFrame& image = frame.frame;
+    const bool yuv = (image.format == IMG_FORMAT_YUV420P || image.format == IMG_FORMAT_YUV420SP)
+                     && image.width % 2 == 0 && image.height % 2 == 0;
+    try {
+        if (yuv) this->process_yuv(image, blurType, margin, detectMs);
+        else this->process_bgr(image, blurType, margin, detectMs);
+    } catch (const std::exception& e) {
+        log_error("stream: Exception during model detection on frame pts %lld: %s", static_cast<long long>(frame.pts), e.what());
+    }
+
+    if (this->realtime) {
+        const auto end = std::chrono::steady_clock::now();
+        const double totalMs = elapsed_ms(start, end);
+        if (this->realtime->update(elapsed_ms(frame.pushedAt, end), detectMs, totalMs - detectMs))
+            this->apply_realtime_level();
+    }
+}
+
+void StreamSession::worker_loop() {
+    const size_t capacity = static_cast<size_t>(this->options.maxQueueFrames);
+    trace_set_thread_name("stream worker");
+    while (true) {
+        std::unique_ptr<StreamFrame> frame;
+        {
+            std::unique_lock<std::mutex> lock = trace_lock(this->mutex, "stream_mutex");
+            TraceScope idle("wait_input", "wait");
+            this->inputChanged.wait(lock, [&]() { return !this->input.empty() || this->inputEnded || this->stopping; });
+            if (this->stopping || this->input.empty()) break;
+            frame = std::move(this->input.front());
+            this->input.pop_front();
+            this->processing = true;
+        }
+        this->inputChanged.notify_all();
+
+        trace_set_frame(frame->pts);
+        this->process(*frame);
+        trace_set_frame(-1);
+
+        std::unique_lock<std::mutex> lock = trace_lock(this->mutex, "stream_mutex");
+        // 待取出队列满时等待消费者，反压到待处理队列
+        {
+            TraceScope stall("wait_output", "wait");
+            this->outputChanged.wait(lock, [&]() { return this->output.size() < capacity || this->stopping; });
+        }
+        this->processing = false;
+        if (this->stopping) break;
+        this->output.push_back(std::move(frame));
+        lock.unlock();
+        this->outputChanged.notify_all();
+    }
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->processing = false;
+    this->outputChanged.notify_all();
+}
@@ -0,0 +1,88 @@
+#ifndef STREAM_SESSION_H
+#define STREAM_SESSION_H
+
+#include "Anonymization.h"
+#include "DetectionScheduler.h"
+#include "RealtimeController.h"
+#include <opencv2/core.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class YOLOv8_face;
+
+/**
+ * @brief 会话持有的一帧图像，平面紧凑排列在 buffer 中
+ */
+struct StreamFrame {
+    ImageFrame frame;
+    std::vector<uint8_t> buffer;
+    int64_t pts = 0;
+    std::chrono::steady_clock::time_point pushedAt;   // 送入时刻，实时模式用于计算端到端延迟
+
+    // 按格式和分辨率分配缓冲区并填好 frame 的平面指针，不支持的格式返回 false
+    bool allocate(ImageFormat format, int width, int height);
+    // 复制 src 的全部平面（按 src 的 stride 逐行拷贝）
+    bool assign(const ImageFrame& src);
+};
+
+/**
+ * @brief push/pull 流式会话：后台线程逐帧检测并脱敏，跨帧保留检测调度状态
+ * 待处理队列和待取出队列都有上限，消费者跟不上时生产者等待或丢弃最旧的待处理帧，延迟有界
+ */
+struct StreamSession {
+    explicit StreamSession(const StreamOptions& options);
+    ~StreamSession();
+    StreamSession(const StreamSession&) = delete;
+    StreamSession& operator=(const StreamSession&) = delete;
+
+    // 复制模型配置并启动工作线程
+    int start(const YOLOv8_face& source);
+    int push(const ImageFrame& frame, int64_t pts, int timeoutMs);
+    int push_fd(int fd, ImageFormat format, int width, int height, int64_t pts, int timeoutMs);
+    int pull(ImageFrame& frame, int64_t* pts, int timeoutMs);
+    void end();
+    void stop();
+
+private:
+    std::unique_ptr<StreamFrame> acquire_frame();
+    // 未入队的帧在所有出错路径上都要放回复用池
+    void release_frame(std::unique_ptr<StreamFrame> frame);
+    int enqueue(std::unique_ptr<StreamFrame> frame, int timeoutMs);
+    void worker_loop();
+    void process(StreamFrame& frame);
+    void process_yuv(ImageFrame& image, int blurType, float margin, double& detectMs);
+    void process_bgr(ImageFrame& image, int blurType, float margin, double& detectMs);
+    void apply_realtime_level();
+
+    StreamOptions options;
+    std::unique_ptr<YOLOv8_face> model;
+    DetectionScheduler scheduler;
+    std::vector<cv::Rect> boxes;
+    std::vector<float> confidences;
+    std::vector<cv::Rect> redactBoxes;
+    cv::Mat chromaU, chromaV;                          // NV12 帧拆开的 U/V 平面，跨帧复用
+    std::unique_ptr<RealtimeController> realtime;      // 仅在设置了 latencyTargetMs 时创建
+
+    std::mutex mutex;
+    std::condition_variable inputChanged;    // 待处理队列有新帧或有空位
+    std::condition_variable outputChanged;   // 待取出队列有新帧或有空位
+    std::deque<std::unique_ptr<StreamFrame>> input;
+    std::deque<std::unique_ptr<StreamFrame>> output;
+    std::vector<std::unique_ptr<StreamFrame>> pool;   // 复用的帧缓冲
+    std::unique_ptr<StreamFrame> current;             // 最近一次 pull 返回给调用者的帧
+    bool inputEnded;
+    bool stopping;
+    bool processing;                                   // 工作线程手上有一帧
+    long long framesIn;
+    long long framesOut;
+    long long framesDropped;
+    std::thread worker;
+};
+
+#endif // STREAM_SESSION_H
@@ -0,0 +1,236 @@
+#include "TiledImage.h"
+#include "YOLOv8_face.h"
+#include "JpegCodec.h"
+#include "PngCodec.h"
+#include "log/log.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum StripFormat { STRIP_FORMAT_UNKNOWN, STRIP_FORMAT_JPEG, STRIP_FORMAT_PNG };
+
+StripFormat sniff_file_format(const char* path) {
+    unsigned char head[8] = {0};
+    FILE* fp = fopen(path, "rb");
+    if (fp == nullptr) return STRIP_FORMAT_UNKNOWN;
+    const size_t n = fread(head, 1, sizeof(head), fp);
+    fclose(fp);
+    if (n >= 3 && head[0] == 0xFF && head[1] == 0xD8 && head[2] == 0xFF) return STRIP_FORMAT_JPEG;
+    if (n == 8 && memcmp(head, "\x89PNG\r\n\x1a\n", 8) == 0) return STRIP_FORMAT_PNG;
+    return STRIP_FORMAT_UNKNOWN;
+}
+
+StripFormat format_from_extension(const char* path) {
+    std::string ext = path;
+    const size_t dot = ext.find_last_of('.');
+    if (dot == std::string::npos) return STRIP_FORMAT_UNKNOWN;
+    ext = ext.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    if (ext == "jpg" || ext == "jpeg") return STRIP_FORMAT_JPEG;
+    if (ext == "png") return STRIP_FORMAT_PNG;
+    return STRIP_FORMAT_UNKNOWN;
+}
+
+std::unique_ptr<ImageStripReader> open_reader(StripFormat format, const char* path) {
+#ifdef ANONYMIZATION_WITH_LIBJPEG
+    if (format == STRIP_FORMAT_JPEG) return jpeg_open_strip_reader(path);
+#endif
+#ifdef ANONYMIZATION_WITH_LIBPNG
+    if (format == STRIP_FORMAT_PNG) return png_open_strip_reader(path);
+#endif
+    (void)format;
+    (void)path;
+    return nullptr;
+}
+
+std::unique_ptr<ImageStripWriter> open_writer(StripFormat format, const char* path, int width, int height, int quality) {
+#ifdef ANONYMIZATION_WITH_LIBJPEG
+    if (format == STRIP_FORMAT_JPEG) return jpeg_open_strip_writer(path, width, height, quality);
+#endif
+#ifdef ANONYMIZATION_WITH_LIBPNG
+    if (format == STRIP_FORMAT_PNG) return png_open_strip_writer(path, width, height);
+#endif
+    (void)format;
+    (void)path;
+    (void)width;
+    (void)height;
+    (void)quality;
+    return nullptr;
+}
+
+double iou(const cv::Rect& a, const cv::Rect& b) {
+    const double inter = (a & b).area();
+    const double uni = a.area() + b.area() - inter;
+    return uni > 0 ? inter / uni : 0.0;
+}
+
+// 相邻分块重叠区内的同一目标会被检测两次，IoU 较大的框合并为并集，保证覆盖完整
+void merge_tile_boxes(std::vector<cv::Rect>& boxes) {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < boxes.size() && !merged; ++i) {
+            for (size_t j = i + 1; j < boxes.size(); ++j) {
+                if (iou(boxes[i], boxes[j]) > 0.3) {
+                    boxes[i] = boxes[i] | boxes[j];
+                    boxes.erase(boxes.begin() + static_cast<std::ptrdiff_t>(j));
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// 上一条带已脱敏、且向下没有延伸的框不再处理，避免重叠行被模糊两次；
+// 上一条带只看到上半部分的目标向下延伸，必须完整脱敏
+bool covered_by(const cv::Rect& box, const std::vector<cv::Rect>& previous) {
+    for (const cv::Rect& p : previous) {
+        if (box.y + box.height <= p.y + p.height && (box & p).area() >= 0.9 * box.area()) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int tiled_image_anonymization(YOLOv8_face& model, const char* inputFile, const char* outputFile,
+                              int blurType, const ImageOptions& options) {
+    if (options.tileMode < 0) return UNSUPPORTED_FORMAT;
+    const StripFormat inputFormat = sniff_file_format(inputFile);
+    const StripFormat outputFormat = format_from_extension(outputFile);
+    std::unique_ptr<ImageStripReader> reader = open_reader(inputFormat, inputFile);
+    if (!reader) {
+        if (options.tileMode > 0) log_warn("tiled_image_anonymization: '%s' cannot be read in strips, using the generic path.", inputFile);
+        return UNSUPPORTED_FORMAT;
+    }
+    const int width = reader->width();
+    const int height = reader->height();
+    const double megapixels = static_cast<double>(width) * height / 1e6;
+    if (options.tileMode == 0 && megapixels < options.tileThresholdMP) return UNSUPPORTED_FORMAT;
+    if (model.has_roi()) {
+        // 检测区域按整幅图像归一化，分块检测时无法正确应用
+        log_warn("tiled_image_anonymization: Detection regions are set, using the generic path for '%s'.", inputFile);
+        return UNSUPPORTED_FORMAT;
+    }
+    if (outputFormat == STRIP_FORMAT_UNKNOWN) {
+        log_warn("tiled_image_anonymization: '%s' cannot be written in strips (JPEG/PNG only), using the generic path.", outputFile);
+        return UNSUPPORTED_FORMAT;
+    }
+
+    const int overlap = options.tileOverlap;
+    const size_t rowBytes = static_cast<size_t>(width) * 3;
+    // 条带缓冲区 + 保留行的原始副本和脱敏副本
+    const long long limitRows = static_cast<long long>(options.memoryLimitMB) * 1024 * 1024 / static_cast<long long>(rowBytes);
+    const long long budgetRows = limitRows - 2LL * overlap;
+    const int bandRows = static_cast<int>(std::min<long long>(std::min(options.tileSize, height), budgetRows));
+    // 碰到条带底边的目标可能被截断，其所在行暂不写出、留到下一条带；最多保留半个条带，保证每个条带都有进展
+    const int maxKeep = static_cast<int>(std::max<long long>(overlap, std::min<long long>(bandRows / 2, (limitRows - bandRows) / 2)));
+    if (bandRows <= overlap && bandRows < height) {
+        log_error("tiled_image_anonymization: memoryLimitMB %d is too small for a %d pixel wide image with %d rows of overlap.",
+                  options.memoryLimitMB, width, overlap);
+        return MEMORY_ALLOCATION_ERROR;
+    }
+    std::unique_ptr<ImageStripWriter> writer = open_writer(outputFormat, outputFile, width, height, options.jpegQuality);
+    if (!writer) {
+        log_error("tiled_image_anonymization: Failed to open '%s' for writing.", outputFile);
+        return SAVE_IMAGE_ERROR;
+    }
+    log_info("tiled_image_anonymization: '%s' %dx%d (%.0f MP), band %d rows, tile %d, overlap %d, max kept rows %d.",
+             inputFile, width, height, megapixels, bandRows, options.tileSize, overlap, maxKeep);
+
+    cv::Mat band(bandRows, width, CV_8UC3);
+    cv::Mat overlapOriginal(std::max(maxKeep, 1), width, CV_8UC3);
+    cv::Mat overlapRedacted(std::max(maxKeep, 1), width, CV_8UC3);
+    std::vector<cv::Rect> boxes, tileBoxes, previous;
+    std::vector<float> confidences;
+    int y0 = 0;           // 条带首行在整幅图像中的行号
+    int filled = 0;       // 条带中已有的行数
+    int carried = 0;      // 条带顶部从上一条带保留下来的行数
+    long long totalBoxes = 0;
+    bool warnedTall = false;
+    const int stride = std::max(1, options.tileSize - overlap);
+    while (true) {
+        const int rows = std::min(bandRows, height - y0);
+        if (rows > filled) {
+            cv::Mat fresh = band.rowRange(filled, rows);
+            if (!reader->read_rows(fresh)) {
+                log_error("tiled_image_anonymization: Failed to decode rows %d-%d of '%s'.", y0 + filled, y0 + rows, inputFile);
+                return LOAD_IMAGE_ERROR;
+            }
+            filled = rows;
+        }
+        const bool last = y0 + rows >= height;
+
+        // 重叠行已被上一条带脱敏，检测时换回原始像素
+        if (carried > 0) {
+            band.rowRange(0, carried).copyTo(overlapRedacted.rowRange(0, carried));
+            overlapOriginal.rowRange(0, carried).copyTo(band.rowRange(0, carried));
+        }
+        boxes.clear();
+        try {
+            for (int x = 0; x < width; x += stride) {
+                const cv::Rect tile(x, 0, std::min(options.tileSize, width - x), rows);
+                model.detect_boxes(band(tile), tileBoxes, confidences);
+                for (const cv::Rect& b : tileBoxes) boxes.push_back(cv::Rect(b.x + x, b.y + y0, b.width, b.height));
+                if (x + options.tileSize >= width) break;
+            }
+        } catch (const std::exception& e) {
+            log_error("tiled_image_anonymization: Exception during model detection: %s", e.what());
+            return INTERNAL_ERROR;
+        }
+        merge_tile_boxes(boxes);
+
+        // 至少保留 tileOverlap 行：不高于 tileOverlap、跨过写出边界的目标完整位于本条带内。
+        // 碰到条带底边的框可能只是目标的上半部分，从框顶开始都不写出，下一条带检测到完整目标后再脱敏
+        int keep = last ? 0 : overlap;
+        if (!last) {
+            for (const cv::Rect& b : boxes) {
+                if (b.y + b.height < y0 + rows - 1 || y0 + rows - b.y <= keep) continue;
+                if (y0 + rows - b.y > maxKeep && !warnedTall) {
+                    log_warn("tiled_image_anonymization: A target at row %d is taller than %d rows and crosses a band boundary of '%s', "
+                             "raise tileOverlap or memoryLimitMB.", b.y, maxKeep, inputFile);
+                    warnedTall = true;
+                }
+                keep = std::min(maxKeep, y0 + rows - b.y);
+            }
+        }
+        const int emit = rows - keep;
+        if (!last) band.rowRange(emit, rows).copyTo(overlapOriginal.rowRange(0, keep));
+        if (carried > 0) overlapRedacted.rowRange(0, carried).copyTo(band.rowRange(0, carried));
+
+        std::vector<cv::Rect> local;
+        for (const cv::Rect& b : boxes) {
+            if (covered_by(b, previous)) continue;
+            local.push_back(cv::Rect(b.x, b.y - y0, b.width, b.height));
+        }
+        totalBoxes += static_cast<long long>(local.size());
+        if (!local.empty() && blurType != BLUR_TYPE_NONE) {
+            cv::Mat view = band.rowRange(0, rows);
+            model.redact(view, local, blurType);
+        }
+
+        if (!writer->write_rows(band.rowRange(0, emit))) {
+            log_error("tiled_image_anonymization: Failed to write rows %d-%d of '%s'.", y0, y0 + emit, outputFile);
+            return SAVE_IMAGE_ERROR;
+        }
+        if (last) break;
+
+        // 保留行移到条带顶部（目标地址在前，逐行前移不会覆盖未读的数据）
+        for (int r = 0; r < keep; ++r) memmove(band.ptr<uchar>(r), band.ptr<uchar>(emit + r), rowBytes);
+        previous = boxes;
+        y0 += emit;
+        filled = keep;
+        carried = keep;
+    }
+    if (!writer->finish()) {
+        log_error("tiled_image_anonymization: Failed to finish '%s'.", outputFile);
+        return SAVE_IMAGE_ERROR;
+    }
+    log_info("tiled_image_anonymization: '%s' saved, %lld boxes redacted.", outputFile, totalBoxes);
+    return ANO_OK;
+}
@@ -0,0 +1,47 @@
+#ifndef TILED_IMAGE_H
+#define TILED_IMAGE_H
+
+#include "Anonymization.h"
+#include <opencv2/core.hpp>
+
+#include <memory>
+
+class YOLOv8_face;
+
+/**
+ * @brief 按行顺序流式读取图像，每次读出若干行 BGR
+ */
+class ImageStripReader
+{
+public:
+    virtual ~ImageStripReader() {}
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+    // 读取 rows.rows 行到 rows（CV_8UC3，宽度为 width()）
+    virtual bool read_rows(cv::Mat& rows) = 0;
+};
+
+/**
+ * @brief 按行顺序流式写出图像
+ */
+class ImageStripWriter
+{
+public:
+    virtual ~ImageStripWriter() {}
+    virtual bool write_rows(const cv::Mat& rows) = 0;
+    // 写完全部行后调用，写文件尾
+    virtual bool finish() = 0;
+};
+
+/**
+ * @brief 超大图像分条带处理：按行流式解码一个条带，在条带内分块（带重叠）检测，脱敏后立即写出，
+ * 每个条带末尾至少 tileOverlap 行留到下一条带：不高于 tileOverlap、跨过写出边界的目标完整位于当前条带内，在当前条带脱敏；
+ * 碰到条带底边的框（可能被截断）从框顶起都不写出，最多保留半个条带，由下一条带检测完整目标。
+ * 更高的目标只有在截断部分也被检测到时才能完整脱敏，因此 tileOverlap 应不小于最大目标高度。内存只与图像宽度和条带高度有关。
+ * 支持的输入输出格式取决于编译选项（WITH_LIBJPEG: JPEG，WITH_LIBPNG: PNG）；
+ * 格式不支持、自动模式下图像不够大、设置了检测区域或 JPEG 带 EXIF 旋转时返回 UNSUPPORTED_FORMAT，由调用者走通用路径
+ */
+int tiled_image_anonymization(YOLOv8_face& model, const char* inputFile, const char* outputFile,
+                              int blurType, const ImageOptions& options);
+
+#endif // TILED_IMAGE_H
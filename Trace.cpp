@@ -0,0 +1,204 @@
+#include "Trace.h"
+#include "log/log.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+std::atomic<bool> g_trace_enabled(false);
+
+namespace {
+
+// 每个线程最多保留的事件数（每个事件 40 字节），超出后丢弃并在停止时报告
+const size_t kMaxEventsPerThread = 1 << 20;
+
+struct TraceEvent {
+    const char* name;
+    const char* category;
+    int64_t startNs;        // steady_clock 纳秒
+    int64_t durNs;
+    int64_t frame;
+};
+
+struct TraceBuffer {
+    std::mutex mutex;       // 只在开始/停止记录时与所属线程竞争
+    std::vector<TraceEvent> events;
+    std::string name;
+    long tid = 0;
+    uint64_t dropped = 0;
+    bool exited = false;
+};
+
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    std::string path;
+    int64_t originNs = 0;
+};
+
+TraceRegistry& registry() {
+    static TraceRegistry instance;
+    return instance;
+}
+
+int64_t to_ns(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+// 线程退出后缓冲区仍由注册表持有，已记录的事件照常写出
+struct ThreadSlot {
+    std::shared_ptr<TraceBuffer> buffer;
+    int64_t frame = -1;
+    char name[64] = {0};
+
+    ~ThreadSlot() {
+        if (!this->buffer) return;
+        std::lock_guard<std::mutex> lock(this->buffer->mutex);
+        this->buffer->exited = true;
+    }
+};
+
+thread_local ThreadSlot t_slot;
+
+TraceBuffer& thread_buffer() {
+    if (!t_slot.buffer) {
+        std::shared_ptr<TraceBuffer> buffer = std::make_shared<TraceBuffer>();
+        buffer->tid = static_cast<long>(syscall(SYS_gettid));
+        buffer->name = t_slot.name;
+        buffer->events.reserve(4096);
+        TraceRegistry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.buffers.push_back(buffer);
+        t_slot.buffer = buffer;
+    }
+    return *t_slot.buffer;
+}
+
+void write_json_string(FILE* fp, const std::string& s) {
+    fputc('"', fp);
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') fprintf(fp, "\\%c", c);
+        else if (c < 0x20) fprintf(fp, "\\u%04x", c);
+        else fputc(c, fp);
+    }
+    fputc('"', fp);
+}
+
+} // namespace
+
+bool trace_start(const char* path) {
+    TraceRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (g_trace_enabled.load(std::memory_order_relaxed)) return false;
+    // 丢弃上次停止之后才写入的零星事件和已退出线程的缓冲区
+    std::vector<std::shared_ptr<TraceBuffer>> alive;
+    for (const std::shared_ptr<TraceBuffer>& buffer : r.buffers) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        if (buffer->exited) continue;
+        buffer->events.clear();
+        buffer->dropped = 0;
+        alive.push_back(buffer);
+    }
+    r.buffers.swap(alive);
+    r.path = path;
+    r.originNs = to_ns(std::chrono::steady_clock::now());
+    g_trace_enabled.store(true, std::memory_order_release);
+    log_info("trace: Recording timeline to '%s'.", path);
+    return true;
+}
+
+bool trace_stop() {
+    TraceRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (!g_trace_enabled.load(std::memory_order_relaxed)) return false;
+    g_trace_enabled.store(false, std::memory_order_release);
+
+    const int pid = getpid();
+    FILE* fp = fopen(r.path.c_str(), "w");
+    if (fp == nullptr) {
+        log_error("trace: Failed to open '%s' for writing.", r.path.c_str());
+    } else {
+        fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"anonymization\"}}", pid);
+    }
+    size_t total = 0;
+    uint64_t dropped = 0;
+    std::vector<std::shared_ptr<TraceBuffer>> alive;
+    std::vector<TraceEvent> events;
+    for (const std::shared_ptr<TraceBuffer>& buffer : r.buffers) {
+        std::string name;
+        long tid;
+        {
+            // 取走事件后再写文件，不在持有线程缓冲区锁时做 I/O
+            std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+            events.clear();
+            events.swap(buffer->events);
+            name = buffer->name;
+            tid = buffer->tid;
+            dropped += buffer->dropped;
+            buffer->dropped = 0;
+            if (!buffer->exited) alive.push_back(buffer);
+        }
+        if (fp == nullptr || events.empty()) continue;
+        if (!name.empty()) {
+            fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%ld,\"args\":{\"name\":", pid, tid);
+            write_json_string(fp, name);
+            fprintf(fp, "}}");
+        }
+        for (const TraceEvent& e : events) {
+            // 开始记录之前就已开始的区间从记录起点截断
+            int64_t start = e.startNs - r.originNs;
+            int64_t dur = e.durNs;
+            if (start < 0) {
+                dur += start;
+                start = 0;
+                if (dur < 0) continue;
+            }
+            fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%ld,\"ts\":%.3f,\"dur\":%.3f",
+                    e.name, e.category, pid, tid, start / 1000.0, dur / 1000.0);
+            if (e.frame >= 0) fprintf(fp, ",\"args\":{\"frame\":%lld}", static_cast<long long>(e.frame));
+            fputs("}", fp);
+            total++;
+        }
+    }
+    r.buffers.swap(alive);
+    std::vector<TraceEvent>().swap(events);
+
+    if (dropped > 0) log_warn("trace: %llu events dropped, per-thread limit is %zu.", static_cast<unsigned long long>(dropped), kMaxEventsPerThread);
+    if (fp == nullptr) return false;
+    fprintf(fp, "\n]}\n");
+    const bool ok = !ferror(fp);
+    if (fclose(fp) != 0 || !ok) {
+        log_error("trace: Failed to write '%s'.", r.path.c_str());
+        return false;
+    }
+    log_info("trace: Wrote %zu events to '%s'.", total, r.path.c_str());
+    return true;
+}
+
+void trace_complete(const char* name, const char* category,
+                    std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    if (!trace_enabled()) return;
+    TraceBuffer& buffer = thread_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (buffer.events.size() >= kMaxEventsPerThread) {
+        buffer.dropped++;
+        return;
+    }
+    buffer.events.push_back(TraceEvent{ name, category, to_ns(start), to_ns(end) - to_ns(start), t_slot.frame });
+}
+
+void trace_set_frame(int64_t frame) {
+    t_slot.frame = frame;
+}
+
+void trace_set_thread_name(const char* name) {
+    snprintf(t_slot.name, sizeof(t_slot.name), "%s", name);
+    if (!t_slot.buffer) return;
+    std::lock_guard<std::mutex> lock(t_slot.buffer->mutex);
+    t_slot.buffer->name = t_slot.name;
+}
@@ -0,0 +1,64 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+/*
+ * 处理流水线时间线，输出 Chrome trace-event JSON（Perfetto / chrome://tracing 可直接打开）
+ * 事件先写入各线程自己的缓冲区，trace_stop 时统一写文件；未开启时每个计时点只多一次原子读
+ */
+
+extern std::atomic<bool> g_trace_enabled;
+
+inline bool trace_enabled() {
+    return g_trace_enabled.load(std::memory_order_relaxed);
+}
+
+// 开始记录，path 为 trace_stop 时写出的文件；已在记录时返回 false
+bool trace_start(const char* path);
+// 停止记录并写出文件，写文件失败或未开启时返回 false
+bool trace_stop();
+
+// 记录一个完整事件，name 和 category 必须是静态字符串
+void trace_complete(const char* name, const char* category,
+                    std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+// 当前线程正在处理的帧号，之后的事件都带上该帧号，-1 表示不带
+void trace_set_frame(int64_t frame);
+// 当前线程在时间线中显示的名称
+void trace_set_thread_name(const char* name);
+
+/**
+ * @brief 作用域事件，用于等待队列、空闲等不计入性能统计的区间
+ */
+class TraceScope
+{
+public:
+    TraceScope(const char* name, const char* category)
+        : name(trace_enabled() ? name : nullptr), category(category) {
+        if (this->name != nullptr) this->start = std::chrono::steady_clock::now();
+    }
+    ~TraceScope() {
+        if (this->name != nullptr) trace_complete(this->name, this->category, this->start, std::chrono::steady_clock::now());
+    }
+
+private:
+    const char* name;
+    const char* category;
+    std::chrono::steady_clock::time_point start;
+};
+
+// 加锁，锁被占用时把等待时间记为 lock 事件，未被占用时不产生事件
+template <typename Mutex>
+std::unique_lock<Mutex> trace_lock(Mutex& mutex, const char* name) {
+    std::unique_lock<Mutex> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        TraceScope scope(name, "lock");
+        lock.lock();
+    }
+    return lock;
+}
+
+#endif // TRACE_H
@@ -0,0 +1,1061 @@
+#include "VideoPipeline.h"
+#include "YOLOv8_face.h"
+#include "DetectionScheduler.h"
+#include "PerfStats.h"
+#include "Trace.h"
+#include "Sidecar.h"
+#include "log/log.h"
+#include <opencv2/opencv.hpp>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef ANONYMIZATION_WITH_FFMPEG
+#include "FFmpegVideo.h"
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+#endif
+
+VideoProgressReporter::VideoProgressReporter(const VideoOptions& opts)
+    : callback(opts.progressCallback), userData(opts.progressUserData), cancelFlag(opts.cancelFlag),
+      intervalNs(std::max(0LL, static_cast<long long>(opts.progressIntervalMs)) * 1000000LL),
+      total(0), done(0), resumed(0), nextReportNs(0), cancelRequested(false), lastReportDone(0) {
+    this->start = this->lastReport = std::chrono::steady_clock::now();
+}
+
+void VideoProgressReporter::set_total(long long totalFrames) {
+    long long expected = 0;
+    if (totalFrames > 0) this->total.compare_exchange_strong(expected, totalFrames);
+}
+
+void VideoProgressReporter::add_resumed(long long frames) {
+    this->resumed += frames;
+    this->done += frames;
+}
+
+bool VideoProgressReporter::cancelled() const {
+    // 标志由其他线程写入，volatile 不保证可见性，按原子操作读取
+    return this->cancelRequested || (this->cancelFlag != nullptr && __atomic_load_n(this->cancelFlag, __ATOMIC_ACQUIRE) != 0);
+}
+
+void VideoProgressReporter::restart() {
+    std::lock_guard<std::mutex> lock(this->callbackMutex);
+    this->done = 0;
+    this->resumed = 0;
+    this->nextReportNs = 0;
+    this->lastReportDone = 0;
+    this->start = this->lastReport = std::chrono::steady_clock::now();
+}
+
+bool VideoProgressReporter::advance(long long frames) {
+    this->done += frames;
+    if (this->callback != nullptr) {
+        // 只有抢到本次上报时间点的线程执行回调，其余线程不等待
+        auto now = std::chrono::steady_clock::now();
+        long long elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - this->start).count();
+        long long due = this->nextReportNs.load();
+        if (elapsedNs >= due && this->nextReportNs.compare_exchange_strong(due, elapsedNs + this->intervalNs)) {
+            this->report(now);
+        }
+    }
+    return !this->cancelled();
+}
+
+void VideoProgressReporter::finish() {
+    if (this->callback != nullptr) this->report(std::chrono::steady_clock::now());
+}
+
+void VideoProgressReporter::report(std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(this->callbackMutex);
+    VideoProgress info;
+    info.framesDone = this->done;
+    info.totalFrames = this->total;
+    double window = std::chrono::duration<double>(now - this->lastReport).count();
+    double elapsed = std::chrono::duration<double>(now - this->start).count();
+    info.fps = window > 0 ? (info.framesDone - this->lastReportDone) / window : 0.0;
+    // 剩余时间按本次运行的平均速度估算，续跑复用的帧不计入速度
+    double average = elapsed > 0 ? (info.framesDone - this->resumed) / elapsed : 0.0;
+    info.etaSeconds = (info.totalFrames > 0 && average > 0)
+        ? std::max(0.0, (info.totalFrames - info.framesDone) / average) : -1.0;
+    this->lastReport = now;
+    this->lastReportDone = info.framesDone;
+    if (this->callback(&info, this->userData) != 0) this->cancelRequested = true;
+}
+
+int run_video_opencv(YOLOv8_face& model, const char* inputFile, const char* outputFile,
+                     BlurType blurType, const VideoOptions& opts, VideoProgressReporter& progress, VideoJobResult& result,
+                     const VideoSidecar& sidecar) {
+    cv::VideoCapture videoCapture;
+    try {
+        if (!videoCapture.open(inputFile)) {
+            log_error("video_anonymization: Failed to open input video: %s", inputFile);
+            return LOAD_VIDEO_ERROR;
+        }
+    } catch (const cv::Exception& e) {
+        log_error("video_anonymization: OpenCV exception during video open for '%s': %s", inputFile, e.what());
+        return LOAD_VIDEO_ERROR;
+    }
+
+
+    int frameWidth = static_cast<int>(videoCapture.get(cv::CAP_PROP_FRAME_WIDTH));
+    int frameHeight = static_cast<int>(videoCapture.get(cv::CAP_PROP_FRAME_HEIGHT));
+    double fps = videoCapture.get(cv::CAP_PROP_FPS);
+    int inputFourcc = static_cast<int>(videoCapture.get(cv::CAP_PROP_FOURCC));
+    long long totalFrames = static_cast<long long>(videoCapture.get(cv::CAP_PROP_FRAME_COUNT));
+
+
+    char fourcc_str[5] = {0};
+    memcpy(fourcc_str, &inputFourcc, 4);
+    log_info("video_anonymization: Input video props - W:%d, H:%d, FPS:%.2f, FourCC:%s, TotalFrames:%lld (approx)",
+             frameWidth, frameHeight, fps, fourcc_str, totalFrames > 0 ? totalFrames : -1);
+
+    if (frameWidth <= 0 || frameHeight <= 0 || fps <= 0) {
+        log_error("video_anonymization: Invalid video properties from input file '%s'. W:%d, H:%d, FPS:%.2f",
+                  inputFile, frameWidth, frameHeight, fps);
+        videoCapture.release();
+        return LOAD_VIDEO_ERROR;
+    }
+    if (sidecar.replay != nullptr && !sidecar.replay->matches(frameWidth, frameHeight)) {
+        videoCapture.release();
+        return SIDECAR_ERROR;
+    }
+    // 只检测时不打开输出，逐帧记录检测框
+    const bool detectOnly = sidecar.record != nullptr;
+    if (detectOnly) sidecar.record->write_header(frameWidth, frameHeight, fps);
+
+    cv::VideoWriter videoWriter;
+    // 尝试使用原始 FourCC，如果失败，则回退到 XVID
+    int outputFourcc = inputFourcc;
+    if (detectOnly) {
+        log_info("video_anonymization: Detect-only pass, no output video.");
+    } else if (!videoWriter.open(outputFile, outputFourcc, fps, cv::Size(frameWidth, frameHeight), true)) {
+        log_warn("video_anonymization: Failed to open VideoWriter with original FourCC '%s'. Trying XVID.", fourcc_str);
+        outputFourcc = cv::VideoWriter::fourcc('X', 'V', 'I', 'D'); // Common fallback
+        if (!videoWriter.open(outputFile, outputFourcc, fps, cv::Size(frameWidth, frameHeight), true)) {
+            log_error("video_anonymization: Failed to open VideoWriter for output file '%s' with FourCC XVID.", outputFile);
+            videoCapture.release();
+            return SAVE_VIDEO_ERROR;
+        }
+        log_info("video_anonymization: VideoWriter opened with fallback FourCC XVID for '%s'.", outputFile);
+    } else {
+        log_info("video_anonymization: VideoWriter opened with FourCC '%s' for '%s'.", fourcc_str, outputFile);
+    }
+
+
+    cv::Mat frame;
+    long long currentFrameCount = 0;
+    int processedFrames = 0;
+    long long detectedFrames = 0;
+    DetectionScheduler scheduler(opts.detectInterval, opts.sceneCutThreshold);
+    std::vector<cv::Rect> boxes;
+    std::vector<float> confidences;
+    const int logInterval = (totalFrames > 200 || totalFrames <= 0) ? 100 : (totalFrames / 2 > 0 ? totalFrames / 2 : 1) ; // 每 100 帧或总帧数的一半记录一次日志
+    bool cancelled = false;
+    progress.set_total(totalFrames);
+
+    while (true) {
+        trace_set_frame(currentFrameCount);
+        try {
+            PerfTimer timer(model.perf_counters(), PERF_STAGE_DECODE);
+            if (!videoCapture.read(frame)) {
+                if (currentFrameCount < totalFrames && totalFrames > 0) { // 如果帧数少于预期
+                    log_warn("video_anonymization: Early end of stream. Expected %lld frames, read %lld.", totalFrames, currentFrameCount);
+                } else {
+                    log_info("video_anonymization: End of video stream after %lld frames.", currentFrameCount);
+                }
+                break;
+            }
+        } catch (const cv::Exception& e) {
+            log_error("video_anonymization: OpenCV exception during videoCapture.read(): %s. Processed %d frames.", e.what(), processedFrames);
+            break; // 发生读取错误则停止
+        }
+
+        if (frame.empty()) { // 双重检查，以防 read 返回 true 但帧为空
+            log_warn("video_anonymization: videoCapture.read() returned true but frame is empty at frame %lld.", currentFrameCount);
+            break;
+        }
+        currentFrameCount++;
+
+        // 从旁路文件回放时不做检测
+        bool fullDetect = sidecar.replay == nullptr && scheduler.need_detect(frame);
+        if (scheduler.is_scene_cut()) {
+            double timestampMs = videoCapture.get(cv::CAP_PROP_POS_MSEC);
+            if (timestampMs <= 0) timestampMs = (currentFrameCount - 1) * 1000.0 / fps;
+            result.sceneCuts.push_back(timestampMs);
+            log_debug("video_anonymization: Scene cut at frame %lld (%.1f ms), score %.3f.", currentFrameCount, timestampMs, scheduler.scene_score());
+        }
+
+        try {
+            if (fullDetect) {
+                model.detect_boxes(frame, boxes, confidences);
+                scheduler.update_boxes(boxes);
+                detectedFrames++;
+            }
+            if (sidecar.replay != nullptr) {
+                model.redact(frame, sidecar.replay->boxes(currentFrameCount - 1), blurType);
+            } else if (detectOnly) {
+                double timestampMs = videoCapture.get(cv::CAP_PROP_POS_MSEC);
+                if (timestampMs <= 0) timestampMs = (currentFrameCount - 1) * 1000.0 / fps;
+                sidecar.record->write_frame(currentFrameCount - 1, timestampMs, fullDetect, scheduler.carried_boxes(), confidences);
+            } else {
+                model.redact(frame, scheduler.carried_boxes(), blurType);
+            }
+        } catch (const std::exception& e) {
+            log_error("video_anonymization: Exception during model detection on frame %lld: %s", currentFrameCount, e.what());
+            // 可以选择跳过此帧或中止处理
+            continue; // 跳过此帧
+        } catch (...) {
+            log_error("video_anonymization: Unknown exception during model detection on frame %lld.", currentFrameCount);
+            continue; // 跳过此帧
+        }
+
+
+        try {
+            if (!detectOnly) {
+                PerfTimer timer(model.perf_counters(), PERF_STAGE_ENCODE);
+                videoWriter.write(frame);
+            }
+            processedFrames++;
+        } catch (const cv::Exception& e) {
+            log_error("video_anonymization: OpenCV exception during videoWriter.write() for frame %lld: %s", currentFrameCount, e.what());
+            // 写入失败，可能需要中止
+            break;
+        }
+
+
+        if (currentFrameCount % logInterval == 0) {
+             if (totalFrames > 0) {
+                log_info("video_anonymization: Processed %lld / %lld frames (%.2f%%)...", currentFrameCount, totalFrames, (static_cast<double>(currentFrameCount) / totalFrames) * 100.0);
+             } else {
+                log_info("video_anonymization: Processed %lld frames...", currentFrameCount);
+             }
+        }
+        if (!progress.advance()) {
+            log_info("video_anonymization: Cancelled after %lld frames.", currentFrameCount);
+            cancelled = true;
+            break;
+        }
+    }
+    trace_set_frame(-1);
+    progress.finish();
+
+    log_info("video_anonymization: Releasing video resources. Total frames read: %lld. Frames successfully processed and written: %d. Full detections: %lld. Scene cuts: %zu.",
+             currentFrameCount, processedFrames, detectedFrames, result.sceneCuts.size());
+    videoCapture.release();
+    videoWriter.release();
+    result.framesRead = currentFrameCount;
+    result.framesWritten = processedFrames;
+    result.detectedFrames = detectedFrames;
+
+    if (cancelled) {
+        return OPERATION_CANCELLED;
+    } else if (processedFrames > 0) {
+        log_info("video_anonymization: Video processing completed for '%s'. %d frames saved to '%s'.", inputFile, processedFrames, outputFile);
+        return ANO_OK;
+    } else if (currentFrameCount > 0 && processedFrames == 0) {
+        log_warn("video_anonymization: Video '%s' had frames (%lld), but none were successfully written to '%s'.", inputFile, currentFrameCount, outputFile);
+        return SAVE_VIDEO_ERROR; // 或更具体的错误
+    } else {
+        log_warn("video_anonymization: No frames were read or processed from video '%s'.", inputFile);
+        return LOAD_VIDEO_ERROR;
+    }
+}
+
+#ifdef ANONYMIZATION_WITH_FFMPEG
+
+namespace {
+
+// 按参数和输入编码选择编码器：AUTO 时 H.265 输入保持 H.265，其余统一 H.264
+std::string select_encoder(VideoCodec codec, const char* inputCodec) {
+    if (codec == VIDEO_CODEC_H265) return "libx265";
+    if (codec == VIDEO_CODEC_H264) return "libx264";
+    return std::string(inputCodec) == "hevc" ? "libx265" : "libx264";
+}
+
+// 用 cv::Mat 头直接引用 AVFrame 的三个平面，不拷贝数据
+struct I420View {
+    cv::Mat y, u, v;
+    explicit I420View(AVFrame* frame)
+        : y(frame->height, frame->width, CV_8UC1, frame->data[0], frame->linesize[0]),
+          u((frame->height + 1) / 2, (frame->width + 1) / 2, CV_8UC1, frame->data[1], frame->linesize[1]),
+          v((frame->height + 1) / 2, (frame->width + 1) / 2, CV_8UC1, frame->data[2], frame->linesize[2]) {}
+};
+
+} // end anonymous namespace
+
+int run_video_ffmpeg(YOLOv8_face& model, const char* inputFile, const char* outputFile,
+                     BlurType blurType, const VideoOptions& opts, VideoProgressReporter& progress, VideoJobResult& result,
+                     const VideoSidecar& sidecar) {
+    return run_video_ffmpeg_segment(model, inputFile, outputFile, blurType, opts, VideoSegment(), progress, result, sidecar);
+}
+
+int run_video_ffmpeg_segment(YOLOv8_face& model, const char* inputFile, const char* outputFile,
+                             BlurType blurType, const VideoOptions& opts, const VideoSegment& segment,
+                             VideoProgressReporter& progress, VideoJobResult& result,
+                             const VideoSidecar& sidecar) {
+    FFmpegReader reader;
+    if (!reader.open(inputFile, opts.decodeThreads)) {
+        log_error("video_anonymization: Failed to open input video: %s", inputFile);
+        return LOAD_VIDEO_ERROR;
+    }
+    if (sidecar.replay != nullptr && !sidecar.replay->matches(reader.width(), reader.height())) return SIDECAR_ERROR;
+    // 只检测时不打开输出，逐帧记录检测框
+    const bool detectOnly = sidecar.record != nullptr;
+    if (detectOnly) sidecar.record->write_header(reader.width(), reader.height(), reader.fps());
+    const bool partial = !segment.whole_file();
+    if (partial && segment.seekTs != VideoSegment::kUnbounded && !reader.seek(segment.seekTs)) {
+        return LOAD_VIDEO_ERROR;
+    }
+
+    FFmpegEncodeConfig config;
+    config.encoder = select_encoder(opts.codec, reader.codec_name());
+    config.preset = std::string(opts.preset, strnlen(opts.preset, sizeof(opts.preset)));
+    config.crf = opts.crf;
+    config.threads = opts.encodeThreads;
+    // 分段输出只含视频，音频在拼接时从原文件统一复制
+    config.copyAudio = !partial && opts.copyAudio != 0;
+
+    FFmpegWriter writer;
+    if (!detectOnly && !writer.open(outputFile, reader, config)) {
+        log_error("video_anonymization: Failed to open output video '%s' with encoder %s.", outputFile, config.encoder.c_str());
+        return SAVE_VIDEO_ERROR;
+    }
+
+    AVPacket* pkt = av_packet_alloc();
+    AVFrame* frame = av_frame_alloc();
+    if (!pkt || !frame) {
+        av_packet_free(&pkt);
+        av_frame_free(&frame);
+        return MEMORY_ALLOCATION_ERROR;
+    }
+
+    const AVRational timeBase = reader.video_stream()->time_base;
+    const double fps = reader.fps();
+    const long long totalFrames = reader.frame_count();
+    const int logInterval = (totalFrames > 200 || totalFrames <= 0) ? 100 : (totalFrames / 2 > 0 ? totalFrames / 2 : 1);
+    DetectionScheduler scheduler(opts.detectInterval, opts.sceneCutThreshold);
+    std::vector<cv::Rect> boxes;
+    std::vector<float> confidences;
+    int ret = ANO_OK;
+    bool reachedEnd = false;
+    if (!partial) progress.set_total(totalFrames);
+    // 解码耗时按送包计（帧级多线程解码时 send_packet 在流水线满时阻塞），编码按送帧计
+    PerfCounters* perf = model.perf_counters();
+
+    // 处理解码器当前可以吐出的全部帧
+    auto drain_frames = [&]() -> bool {
+        while (reader.receive_frame(frame) >= 0) {
+            // 解码按显示顺序输出，越过分段终点后即可停止
+            if (segment.endPts != VideoSegment::kUnbounded && frame->pts != AV_NOPTS_VALUE && frame->pts >= segment.endPts) {
+                av_frame_unref(frame);
+                reachedEnd = true;
+                return false;
+            }
+            // 分段起点之前的重叠帧只用于预热检测调度状态，不输出
+            const bool warmup = segment.startPts != VideoSegment::kUnbounded && frame->pts != AV_NOPTS_VALUE && frame->pts < segment.startPts;
+            if (warmup) {
+                try {
+                    I420View view(frame);
+                    if (scheduler.need_detect_luma(view.y)) {
+                        model.detect_boxes_i420(view.y, view.u, view.v, boxes, confidences);
+                        scheduler.update_boxes(boxes);
+                    }
+                } catch (const std::exception& e) {
+                    log_warn("video_anonymization: Exception during warm-up detection: %s", e.what());
+                }
+                av_frame_unref(frame);
+                continue;
+            }
+            result.framesRead++;
+            trace_set_frame(result.framesRead - 1);
+            bool fullDetect = false;
+            try {
+                I420View view(frame);
+                const double timestampMs = frame->pts != AV_NOPTS_VALUE ? frame->pts * av_q2d(timeBase) * 1000.0
+                                                                        : (result.framesRead - 1) * 1000.0 / fps;
+                // 从旁路文件回放时不做检测
+                fullDetect = sidecar.replay == nullptr && scheduler.need_detect_luma(view.y);
+                if (scheduler.is_scene_cut()) {
+                    result.sceneCuts.push_back(timestampMs);
+                    log_debug("video_anonymization: Scene cut at frame %lld (%.1f ms), score %.3f.", result.framesRead, timestampMs, scheduler.scene_score());
+                }
+                if (fullDetect) {
+                    model.detect_boxes_i420(view.y, view.u, view.v, boxes, confidences);
+                    scheduler.update_boxes(boxes);
+                    result.detectedFrames++;
+                }
+                const std::vector<cv::Rect>& redactBoxes = sidecar.replay != nullptr ? sidecar.replay->boxes(result.framesRead - 1)
+                                                                                      : scheduler.carried_boxes();
+                if (detectOnly) {
+                    sidecar.record->write_frame(result.framesRead - 1, timestampMs, fullDetect, redactBoxes, confidences);
+                } else if (!redactBoxes.empty() && blurType != BLUR_TYPE_NONE) {
+                    // 解码帧可能仍被解码器作为参考帧引用，写之前确保独占
+                    if (av_frame_make_writable(frame) < 0) {
+                        log_error("video_anonymization: Failed to make frame %lld writable.", result.framesRead);
+                        ret = MEMORY_ALLOCATION_ERROR;
+                        return false;
+                    }
+                    I420View writable(frame);
+                    model.redact_i420(writable.y, writable.u, writable.v, redactBoxes, blurType);
+                }
+            } catch (const std::exception& e) {
+                log_error("video_anonymization: Exception during model detection on frame %lld: %s", result.framesRead, e.what());
+                av_frame_unref(frame);
+                continue; // 跳过此帧
+            }
+
+            int err = 0;
+            if (!detectOnly) {
+                frame->pict_type = AV_PICTURE_TYPE_NONE;
+                PerfTimer encodeTimer(perf, PERF_STAGE_ENCODE);
+                err = writer.write_frame(frame);
+            }
+            av_frame_unref(frame);
+            if (err < 0) {
+                log_error("video_anonymization: Failed to encode frame %lld: %s", result.framesRead, ffmpeg_error_string(err).c_str());
+                ret = SAVE_VIDEO_ERROR;
+                return false;
+            }
+            result.framesWritten++;
+
+            if (result.framesRead % logInterval == 0) {
+                if (totalFrames > 0 && !partial) {
+                    log_info("video_anonymization: Processed %lld / %lld frames (%.2f%%)...", result.framesRead, totalFrames, (static_cast<double>(result.framesRead) / totalFrames) * 100.0);
+                } else {
+                    log_info("video_anonymization: Processed %lld frames...", result.framesRead);
+                }
+            }
+            if (!progress.advance()) {
+                log_info("video_anonymization: Cancelled after %lld frames.", result.framesRead);
+                ret = OPERATION_CANCELLED;
+                return false;
+            }
+        }
+        return true;
+    };
+
+    bool ok = true;
+    while (ok) {
+        int err = reader.read_packet(pkt);
+        if (err == AVERROR_EOF) {
+            reader.send_packet(nullptr);
+            ok = drain_frames();
+            break;
+        }
+        if (err < 0) {
+            log_error("video_anonymization: Read error after %lld frames: %s", result.framesRead, ffmpeg_error_string(err).c_str());
+            break;
+        }
+        if (pkt->stream_index == reader.video_stream_index()) {
+            PerfTimer decodeTimer(perf, PERF_STAGE_DECODE);
+            reader.send_packet(pkt);
+            decodeTimer.stop();
+            av_packet_unref(pkt);
+            ok = drain_frames();
+        } else if (!detectOnly && writer.write_copied_packet(pkt) < 0) {
+            log_warn("video_anonymization: Failed to copy packet of stream %d.", pkt->stream_index);
+        }
+        av_packet_unref(pkt);
+    }
+
+    trace_set_frame(-1);
+    int finishErr = detectOnly ? 0 : writer.finish();
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+    if (finishErr < 0 && ret == ANO_OK) {
+        log_error("video_anonymization: Failed to finalize '%s': %s", outputFile, ffmpeg_error_string(finishErr).c_str());
+        ret = SAVE_VIDEO_ERROR;
+    }
+
+    log_info("video_anonymization: FFmpeg backend done%s. Frames read: %lld, written: %lld, full detections: %lld, scene cuts: %zu.",
+             partial ? " (segment)" : "", result.framesRead, result.framesWritten, result.detectedFrames, result.sceneCuts.size());
+    if (!partial) progress.finish();
+    if (ret != ANO_OK) return ret;
+    if (result.framesWritten > 0) return ANO_OK;
+    return result.framesRead > 0 ? SAVE_VIDEO_ERROR : LOAD_VIDEO_ERROR;
+}
+
+namespace {
+
+// 按包序号把视频均分为 count 段，每个切点落在离均分点最近的关键帧上；返回各段起始关键帧下标
+std::vector<size_t> plan_cuts_by_count(const std::vector<FFmpegKeyframe>& keyframes, long long totalPackets, int count) {
+    std::vector<size_t> cuts(1, 0);
+    for (int k = 1; k < count; ++k) {
+        const long long target = totalPackets * k / count;
+        size_t best = cuts.back();
+        for (size_t i = cuts.back() + 1; i < keyframes.size(); ++i) {
+            if (best == cuts.back() || std::llabs(keyframes[i].packetIndex - target) < std::llabs(keyframes[best].packetIndex - target))
+                best = i;
+            if (keyframes[i].packetIndex >= target) break;
+        }
+        if (best != cuts.back()) cuts.push_back(best);
+    }
+    return cuts;
+}
+
+// 每隔 interval（视频流时间基）在其后第一个关键帧处切一段
+std::vector<size_t> plan_cuts_by_interval(const std::vector<FFmpegKeyframe>& keyframes, long long interval) {
+    std::vector<size_t> cuts(1, 0);
+    for (size_t i = 1; i < keyframes.size(); ++i) {
+        if (keyframes[i].pts - keyframes[cuts.back()].pts >= interval) cuts.push_back(i);
+    }
+    return cuts;
+}
+
+/**
+ * 长视频检查点，文本格式，每完成一段追加一行并落盘：
+ *   ANONYMIZATION_CHECKPOINT 1
+ *   fingerprint <输入文件、模型、检测区域与参数指纹的哈希>
+ *   segments <段数> <各段起点 pts...>
+ *   done <段号> <读帧数> <写帧数> <检测帧数> <场景切换数> <场景切换时间点(ms)...>
+ * 检测调度状态不落盘，续跑时由各段起点前的重叠帧重新预热
+ */
+class VideoCheckpoint {
+public:
+    VideoCheckpoint(const std::string& path, const std::string& fingerprint, const std::vector<long long>& startPts)
+        : path(path), fingerprint(fingerprint), startPts(startPts), done(startPts.size(), false), results(startPts.size()) {}
+
+    // 读取已有检查点；文件不存在返回 ANO_OK 且 loaded() 为 false，与当前任务不匹配返回 CHECKPOINT_MISMATCH
+    int load() {
+        std::ifstream in(this->path);
+        if (!in) return ANO_OK;
+        std::string line, tag;
+        int version = 0;
+        if (!std::getline(in, line) || !(std::istringstream(line) >> tag >> version) ||
+            tag != "ANONYMIZATION_CHECKPOINT" || version != 1) {
+            log_error("video_anonymization: '%s' is not a valid checkpoint.", this->path.c_str());
+            return CHECKPOINT_MISMATCH;
+        }
+        bool fingerprintOk = false, planOk = false;
+        while (std::getline(in, line)) {
+            std::istringstream ss(line);
+            if (!(ss >> tag)) continue;
+            if (tag == "fingerprint") {
+                std::string value;
+                fingerprintOk = static_cast<bool>(ss >> value) && value == this->fingerprint;
+            } else if (tag == "segments") {
+                size_t n = 0;
+                std::vector<long long> pts;
+                long long p;
+                if (ss >> n) while (pts.size() < n && ss >> p) pts.push_back(p);
+                planOk = n == pts.size() && pts == this->startPts;
+            } else if (tag == "done") {
+                // 进程在写入途中被杀时最后一行可能不完整，解析失败的行直接忽略
+                size_t index = 0, cuts = 0;
+                VideoJobResult r;
+                if (!(ss >> index >> r.framesRead >> r.framesWritten >> r.detectedFrames >> cuts) || index >= this->done.size()) continue;
+                double t;
+                while (r.sceneCuts.size() < cuts && ss >> t) r.sceneCuts.push_back(t);
+                if (r.sceneCuts.size() != cuts) continue;
+                this->done[index] = true;
+                this->results[index] = r;
+            }
+        }
+        if (!fingerprintOk || !planOk) {
+            log_error("video_anonymization: Checkpoint '%s' was written for a different input or options.", this->path.c_str());
+            return CHECKPOINT_MISMATCH;
+        }
+        this->isLoaded = true;
+        return ANO_OK;
+    }
+
+    // 新建检查点，覆盖旧文件
+    bool create() {
+        FILE* fp = fopen(this->path.c_str(), "w");
+        if (!fp) {
+            log_error("video_anonymization: Failed to create checkpoint '%s'.", this->path.c_str());
+            return false;
+        }
+        fprintf(fp, "ANONYMIZATION_CHECKPOINT 1\nfingerprint %s\nsegments %zu", this->fingerprint.c_str(), this->startPts.size());
+        for (long long p : this->startPts) fprintf(fp, " %lld", p);
+        fprintf(fp, "\n");
+        bool ok = sync_and_close(fp);
+        this->isLoaded = ok;
+        return ok;
+    }
+
+    // 记录一段已完成并立即落盘，可被多个工作线程调用
+    bool mark_done(size_t index, const VideoJobResult& r) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->done[index] = true;
+        this->results[index] = r;
+        FILE* fp = fopen(this->path.c_str(), "a");
+        if (!fp) return false;
+        fprintf(fp, "done %zu %lld %lld %lld %zu", index, r.framesRead, r.framesWritten, r.detectedFrames, r.sceneCuts.size());
+        for (double t : r.sceneCuts) fprintf(fp, " %.3f", t);
+        fprintf(fp, "\n");
+        return sync_and_close(fp);
+    }
+
+    void remove() { std::remove(this->path.c_str()); }
+    bool loaded() const { return this->isLoaded; }
+    bool is_done(size_t index) const { return this->done[index]; }
+    const VideoJobResult& result(size_t index) const { return this->results[index]; }
+    void reset(size_t index) { this->done[index] = false; this->results[index] = VideoJobResult(); }
+
+private:
+    static bool sync_and_close(FILE* fp) {
+        bool ok = fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+        return fclose(fp) == 0 && ok;
+    }
+
+    std::string path;
+    std::string fingerprint;
+    std::vector<long long> startPts;
+    std::vector<bool> done;
+    std::vector<VideoJobResult> results;
+    std::mutex mutex;
+    bool isLoaded = false;
+};
+
+// 输入文件大小、修改时间、模型与检测区域以及影响输出的参数组成的指纹，任何一项变化都不能续跑，
+// 否则已完成的分段与之后的分段按不同设置处理。指纹中含模型路径和多边形坐标，写入检查点前取 64 位哈希
+std::string job_fingerprint(const char* inputFile, BlurType blurType, const VideoOptions& opts, const YOLOv8_face& model) {
+    struct stat st;
+    if (stat(inputFile, &st) != 0) return std::string();
+    std::ostringstream ss;
+    ss << st.st_size << '|' << static_cast<long long>(st.st_mtime) << '|' << static_cast<int>(blurType)
+       << '|' << opts.detectInterval << '|' << opts.sceneCutThreshold << '|' << static_cast<int>(opts.codec)
+       << '|' << opts.crf << '|' << std::string(opts.preset, strnlen(opts.preset, sizeof(opts.preset)))
+       << '|' << opts.encodeThreads << '|' << opts.copyAudio << '|' << opts.gopPassthrough
+       << '|' << opts.segmentOverlapFrames << '|' << opts.checkpointIntervalSec << '|' << model.identity();
+    // FNV-1a
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : ss.str()) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    char text[24];
+    snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+    return text;
+}
+
+bool file_exists(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+} // end anonymous namespace
+
+int run_video_ffmpeg_segmented(YOLOv8_face& model, const char* inputFile, const char* outputFile,
+                               BlurType blurType, const VideoOptions& opts, bool resume, VideoProgressReporter& progress,
+                               VideoJobResult& result) {
+    const bool checkpointing = opts.checkpointIntervalSec > 0;
+    if (resume && !checkpointing) {
+        log_error("video_anonymization: Resume requires checkpointIntervalSec > 0.");
+        return INVALID_PARAMETER;
+    }
+    std::vector<FFmpegKeyframe> keyframes;
+    long long totalPackets = 0;
+    if (!ffmpeg_scan_keyframes(inputFile, keyframes, totalPackets)) {
+        log_error("video_anonymization: Failed to scan keyframes of '%s'.", inputFile);
+        return LOAD_VIDEO_ERROR;
+    }
+    long long frameDuration = 1;
+    AVRational timeBase;
+    {
+        FFmpegReader probe;
+        if (!probe.open(inputFile, 1)) return LOAD_VIDEO_ERROR;
+        const double fps = probe.fps();
+        timeBase = probe.video_stream()->time_base;
+        progress.set_total(probe.frame_count());
+        if (fps > 0) frameDuration = std::max<long long>(1, av_rescale_q(1, av_d2q(1.0 / fps, 1 << 20), timeBase));
+    }
+
+    // 开启检查点时按时间间隔切段，保证每段都足够短；否则按并行数均分
+    const std::vector<size_t> cuts = checkpointing
+        ? plan_cuts_by_interval(keyframes, av_rescale_q(opts.checkpointIntervalSec, AVRational{1, 1}, timeBase))
+        : plan_cuts_by_count(keyframes, totalPackets, std::max(1, opts.segmentWorkers));
+    const size_t segmentCount = cuts.size();
+    if (segmentCount < 2 && !checkpointing) {
+        log_info("video_anonymization: Only one segment available in '%s', processing serially.", inputFile);
+        return run_video_ffmpeg(model, inputFile, outputFile, blurType, opts, progress, result);
+    }
+
+    const long long overlap = std::max(0, opts.segmentOverlapFrames) * frameDuration;
+    std::vector<VideoSegment> segments(segmentCount);
+    std::vector<std::string> paths(segmentCount);
+    std::vector<long long> startPts(segmentCount);
+    for (size_t i = 0; i < segmentCount; ++i) {
+        const long long start = keyframes[cuts[i]].pts;
+        if (i > 0) {
+            segments[i].startPts = start;
+            segments[i].seekTs = start - overlap;
+        }
+        if (i + 1 < segmentCount) segments[i].endPts = keyframes[cuts[i + 1]].pts;
+        startPts[i] = start;
+        paths[i] = std::string(outputFile) + ".seg" + std::to_string(i) + ".nut";
+    }
+
+    VideoCheckpoint checkpoint(std::string(outputFile) + ".ckpt", job_fingerprint(inputFile, blurType, opts, model), startPts);
+    if (checkpointing) {
+        if (resume) {
+            int err = checkpoint.load();
+            if (err != ANO_OK) return err;
+            if (!checkpoint.loaded()) log_info("video_anonymization: No checkpoint found for '%s', starting from the beginning.", outputFile);
+        }
+        // 记录为已完成但分段文件丢失的段需要重做
+        for (size_t i = 0; checkpoint.loaded() && i < segmentCount; ++i) {
+            if (checkpoint.is_done(i) && !file_exists(paths[i])) checkpoint.reset(i);
+        }
+        if (!checkpoint.loaded() && !checkpoint.create()) return SAVE_VIDEO_ERROR;
+    }
+
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < segmentCount; ++i) {
+        if (!checkpointing || !checkpoint.is_done(i)) pending.push_back(i);
+    }
+    if (resume) log_info("video_anonymization: Resuming '%s': %zu of %zu segments already done.", inputFile, segmentCount - pending.size(), segmentCount);
+    for (size_t i = 0; checkpointing && i < segmentCount; ++i) {
+        if (checkpoint.is_done(i)) progress.add_resumed(checkpoint.result(i).framesWritten);
+    }
+
+    // 每个工作线程一个检测器实例；模型在主线程中加载，避免并发初始化网络
+    const size_t workerCount = std::min(pending.size(), static_cast<size_t>(std::max(1, opts.segmentWorkers)));
+    std::vector<std::unique_ptr<YOLOv8_face>> models;
+    for (size_t w = 1; w < workerCount; ++w) {
+        models.emplace_back(new YOLOv8_face());
+        models.back()->clone_from(model);
+    }
+    VideoOptions segOpts = opts;
+    const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    const int perWorker = std::max(1, static_cast<int>(hw / std::max<size_t>(1, workerCount)));
+    if (segOpts.decodeThreads <= 0) segOpts.decodeThreads = perWorker;
+    if (segOpts.encodeThreads <= 0) segOpts.encodeThreads = perWorker;
+    log_info("video_anonymization: Processing '%s' in %zu segments with %zu workers, %d decode / %d encode threads each.",
+             inputFile, segmentCount, workerCount, segOpts.decodeThreads, segOpts.encodeThreads);
+
+    std::vector<VideoJobResult> results(segmentCount);
+    std::vector<int> rets(segmentCount, ANO_OK);
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < workerCount; ++w) {
+        YOLOv8_face* workerModel = w == 0 ? &model : models[w - 1].get();
+        threads.emplace_back([&, workerModel, w]() {
+            char threadName[32];
+            snprintf(threadName, sizeof(threadName), "segment worker %zu", w);
+            trace_set_thread_name(threadName);
+            for (size_t k = next++; k < pending.size() && !failed && !progress.cancelled(); k = next++) {
+                const size_t i = pending[k];
+                rets[i] = run_video_ffmpeg_segment(*workerModel, inputFile, paths[i].c_str(), blurType,
+                                                   segOpts, segments[i], progress, results[i]);
+                if (rets[i] != ANO_OK) {
+                    failed = true;
+                } else if (checkpointing && !checkpoint.mark_done(i, results[i])) {
+                    log_warn("video_anonymization: Failed to update checkpoint after segment %zu.", i);
+                }
+            }
+        });
+    }
+    for (std::thread& t : threads) t.join();
+    progress.finish();
+
+    int ret = ANO_OK;
+    for (size_t i = 0; i < segmentCount; ++i) {
+        const VideoJobResult& r = checkpointing && checkpoint.is_done(i) ? checkpoint.result(i) : results[i];
+        result.framesRead += r.framesRead;
+        result.framesWritten += r.framesWritten;
+        result.detectedFrames += r.detectedFrames;
+        result.sceneCuts.insert(result.sceneCuts.end(), r.sceneCuts.begin(), r.sceneCuts.end());
+        if (rets[i] != ANO_OK && ret == ANO_OK) {
+            if (rets[i] != OPERATION_CANCELLED) log_error("video_anonymization: Segment %zu failed with error %d.", i, rets[i]);
+            ret = rets[i];
+        }
+    }
+    std::sort(result.sceneCuts.begin(), result.sceneCuts.end());
+    if (ret == ANO_OK && progress.cancelled()) ret = OPERATION_CANCELLED;   // 取消时尚未开始的段
+    if (ret != ANO_OK) {
+        // 已完成的分段和检查点保留，供 video_anonymization_resume 续跑
+        if (checkpointing) {
+            log_info("video_anonymization: Checkpoint kept at '%s.ckpt'.", outputFile);
+        } else {
+            for (const std::string& path : paths) std::remove(path.c_str());
+        }
+        return ret;
+    }
+
+    int err = ffmpeg_concat_segments(paths, startPts, inputFile, outputFile, opts.copyAudio != 0);
+    if (err == AVERROR(EINVAL)) {
+        // 各段编码器输出的参数集不同（编码器版本或配置差异），退回整段串行处理
+        log_warn("video_anonymization: Segments cannot be joined without re-encoding, falling back to serial processing.");
+        for (const std::string& path : paths) std::remove(path.c_str());
+        if (checkpointing) checkpoint.remove();
+        result = VideoJobResult();
+        progress.restart();
+        return run_video_ffmpeg(model, inputFile, outputFile, blurType, opts, progress, result);
+    }
+    if (err < 0) return SAVE_VIDEO_ERROR;   // 分段文件保留，续跑时只需重新拼接
+    for (const std::string& path : paths) std::remove(path.c_str());
+    if (checkpointing) checkpoint.remove();
+
+    log_info("video_anonymization: Segmented processing done. Segments: %zu, frames written: %lld, full detections: %lld, scene cuts: %zu.",
+             segmentCount, result.framesWritten, result.detectedFrames, result.sceneCuts.size());
+    return ANO_OK;
+}
+
+namespace {
+
+void free_packets(std::vector<AVPacket*>& packets) {
+    for (AVPacket*& p : packets) av_packet_free(&p);
+    packets.clear();
+}
+
+// GOP 内帧数与包数不一致（开放 GOP 或解码错误），无法按 GOP 直通
+const int kGopMismatch = -1;
+// 重新编码片段的参数集与输入 extradata 不一致，不能拼接进原始码流
+const int kParamSetMismatch = -2;
+
+} // end anonymous namespace
+
+int run_video_ffmpeg_passthrough(YOLOv8_face& model, const char* inputFile, const char* outputFile,
+                                 BlurType blurType, const VideoOptions& opts, VideoProgressReporter& progress, VideoJobResult& result) {
+    FFmpegReader reader;
+    if (!reader.open(inputFile, opts.decodeThreads)) {
+        log_error("video_anonymization: Failed to open input video: %s", inputFile);
+        return LOAD_VIDEO_ERROR;
+    }
+    const std::string inputCodec = reader.codec_name();
+    if (inputCodec != "h264" && inputCodec != "hevc") {
+        log_warn("video_anonymization: GOP passthrough needs H.264/H.265 input, got %s. Re-encoding every frame.", inputCodec.c_str());
+        reader.close();
+        return run_video_ffmpeg(model, inputFile, outputFile, blurType, opts, progress, result);
+    }
+    if ((opts.codec == VIDEO_CODEC_H264 && inputCodec != "h264") || (opts.codec == VIDEO_CODEC_H265 && inputCodec != "hevc")) {
+        log_warn("video_anonymization: GOP passthrough keeps the input codec %s, requested output codec ignored.", inputCodec.c_str());
+    }
+
+    FFmpegEncodeConfig config;
+    config.encoder = inputCodec == "hevc" ? "libx265" : "libx264";
+    config.preset = std::string(opts.preset, strnlen(opts.preset, sizeof(opts.preset)));
+    config.crf = opts.crf;
+    config.threads = opts.encodeThreads;
+    config.copyAudio = opts.copyAudio != 0;
+    config.copyVideo = true;
+
+    FFmpegWriter writer;
+    if (!writer.open(outputFile, reader, config)) {
+        log_error("video_anonymization: Failed to open output video '%s' for GOP passthrough.", outputFile);
+        return SAVE_VIDEO_ERROR;
+    }
+
+    AVPacket* pkt = av_packet_alloc();
+    AVFrame* frame = av_frame_alloc();
+    if (!pkt || !frame) {
+        av_packet_free(&pkt);
+        av_frame_free(&frame);
+        return MEMORY_ALLOCATION_ERROR;
+    }
+
+    const int videoIndex = reader.video_stream_index();
+    const AVRational timeBase = reader.video_stream()->time_base;
+    const double fps = reader.fps();
+    const int nalLengthSize = ffmpeg_nal_length_size(reader.video_stream()->codecpar);
+    progress.set_total(reader.frame_count());
+    DetectionScheduler scheduler(opts.detectInterval, opts.sceneCutThreshold);
+    std::vector<cv::Rect> boxes;
+    std::vector<float> confidences;
+    std::vector<AVPacket*> gop;                      // 当前 GOP 的原始视频包
+    std::vector<std::vector<cv::Rect>> frameBoxes;   // 当前 GOP 每帧需要脱敏的框
+    std::vector<AVPacket*> encoded;
+    bool sawKeyframe = false;
+
+    // 第一遍：解码整个 GOP 只做检测，记录每帧的框
+    auto analyze_gop = [&]() -> int {
+        frameBoxes.clear();
+        reader.flush();
+        auto drain = [&]() {
+            while (reader.receive_frame(frame) >= 0) {
+                result.framesRead++;
+                trace_set_frame(result.framesRead - 1);
+                I420View view(frame);
+                bool fullDetect = scheduler.need_detect_luma(view.y);
+                if (scheduler.is_scene_cut()) {
+                    double timestampMs = frame->pts != AV_NOPTS_VALUE ? frame->pts * av_q2d(timeBase) * 1000.0
+                                                                      : (result.framesRead - 1) * 1000.0 / fps;
+                    result.sceneCuts.push_back(timestampMs);
+                }
+                if (fullDetect) {
+                    try {
+                        model.detect_boxes_i420(view.y, view.u, view.v, boxes, confidences);
+                        scheduler.update_boxes(boxes);
+                        result.detectedFrames++;
+                    } catch (const std::exception& e) {
+                        log_error("video_anonymization: Exception during model detection on frame %lld: %s", result.framesRead, e.what());
+                    }
+                }
+                frameBoxes.push_back(scheduler.carried_boxes());
+                av_frame_unref(frame);
+            }
+        };
+        for (AVPacket* p : gop) {
+            PerfTimer timer(model.perf_counters(), PERF_STAGE_DECODE);
+            reader.send_packet(p);
+            timer.stop();
+            drain();
+        }
+        reader.send_packet(nullptr);
+        drain();
+        return frameBoxes.size() == gop.size() ? 0 : kGopMismatch;
+    };
+
+    // 第二遍：重新解码、脱敏并用新的编码器编码，首帧即 IDR，与 GOP 边界对齐
+    auto reencode_gop = [&]() -> int {
+        FFmpegEncoder encoder;
+        // 不使用 B 帧，解码顺序与显示顺序一致，才能沿用原始 DTS 序列
+        if (!encoder.open(reader, config, 0, static_cast<int>(gop.size()) + 1)) return SAVE_VIDEO_ERROR;
+        reader.flush();
+        size_t index = 0;
+        int err = 0;
+        auto drain = [&]() {
+            while (err >= 0 && reader.receive_frame(frame) >= 0) {
+                trace_set_frame(result.framesWritten + static_cast<long long>(index));
+                if (index < frameBoxes.size() && !frameBoxes[index].empty()) {
+                    if (av_frame_make_writable(frame) < 0) { err = AVERROR(ENOMEM); break; }
+                    I420View view(frame);
+                    model.redact_i420(view.y, view.u, view.v, frameBoxes[index], blurType);
+                }
+                frame->pict_type = index == 0 ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+                PerfTimer timer(model.perf_counters(), PERF_STAGE_ENCODE);
+                err = encoder.encode(frame, encoded);
+                timer.stop();
+                av_frame_unref(frame);
+                index++;
+            }
+        };
+        for (AVPacket* p : gop) {
+            PerfTimer timer(model.perf_counters(), PERF_STAGE_DECODE);
+            reader.send_packet(p);
+            timer.stop();
+            drain();
+        }
+        reader.send_packet(nullptr);
+        drain();
+        if (err >= 0) err = encoder.encode(nullptr, encoded);
+        if (err < 0) {
+            log_error("video_anonymization: Failed to re-encode GOP: %s", ffmpeg_error_string(err).c_str());
+            free_packets(encoded);
+            return SAVE_VIDEO_ERROR;
+        }
+
+        // 输出沿用输入的 extradata，片段带内的参数集必须与之一致，否则解码器会用原参数集解析新片段
+        if (encoded.empty() || !ffmpeg_parameter_sets_match(reader.video_stream()->codecpar, encoded[0])) {
+            free_packets(encoded);
+            return kParamSetMismatch;
+        }
+
+        // 沿用原 GOP 的 DTS 序列（升序），PTS 即原始帧时间戳
+        std::vector<int64_t> dts;
+        for (AVPacket* p : gop) dts.push_back(p->dts != AV_NOPTS_VALUE ? p->dts : p->pts);
+        std::sort(dts.begin(), dts.end());
+        for (size_t i = 0; i < encoded.size(); ++i) {
+            AVPacket* p = encoded[i];
+            if (i < dts.size() && dts[i] != AV_NOPTS_VALUE && (p->pts == AV_NOPTS_VALUE || dts[i] <= p->pts)) p->dts = dts[i];
+            else p->dts = p->pts;
+            if (i < gop.size()) p->duration = gop[i]->duration;
+            p->stream_index = videoIndex;
+            if (ffmpeg_annexb_to_length_prefixed(p, nalLengthSize) < 0 || writer.write_copied_packet(p) < 0) {
+                free_packets(encoded);
+                return SAVE_VIDEO_ERROR;
+            }
+        }
+        free_packets(encoded);
+        result.framesWritten += static_cast<long long>(gop.size());
+        return ANO_OK;
+    };
+
+    auto process_gop = [&]() -> int {
+        if (gop.empty()) return ANO_OK;
+        int ret = analyze_gop();
+        if (ret == kGopMismatch) return kGopMismatch;
+        bool dirty = false;
+        for (const auto& b : frameBoxes) dirty = dirty || !b.empty();
+        if (dirty && blurType != BLUR_TYPE_NONE) {
+            ret = reencode_gop();
+            result.gopsEncoded++;
+        } else {
+            // 没有任何需要脱敏的帧：原始数据包逐字节复制
+            for (AVPacket* p : gop) {
+                if (writer.write_copied_packet(p) < 0) { ret = SAVE_VIDEO_ERROR; break; }
+            }
+            result.framesWritten += static_cast<long long>(gop.size());
+            result.gopsCopied++;
+        }
+        if (ret == ANO_OK && !progress.advance(static_cast<long long>(gop.size()))) {
+            log_info("video_anonymization: Cancelled after %lld frames.", result.framesWritten);
+            ret = OPERATION_CANCELLED;
+        }
+        free_packets(gop);
+        return ret;
+    };
+
+    int ret = ANO_OK;
+    while (ret == ANO_OK) {
+        int err = reader.read_packet(pkt);
+        if (err == AVERROR_EOF) {
+            ret = process_gop();
+            break;
+        }
+        if (err < 0) {
+            log_error("video_anonymization: Read error after %lld frames: %s", result.framesRead, ffmpeg_error_string(err).c_str());
+            break;
+        }
+        if (pkt->stream_index == videoIndex) {
+            bool key = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
+            if (!sawKeyframe && !key) {
+                log_warn("video_anonymization: Dropping video packet before the first keyframe.");
+            } else {
+                if (key && !gop.empty()) ret = process_gop();
+                sawKeyframe = true;
+                gop.push_back(av_packet_clone(pkt));
+            }
+        } else if (writer.write_copied_packet(pkt) < 0) {
+            log_warn("video_anonymization: Failed to copy packet of stream %d.", pkt->stream_index);
+        }
+        av_packet_unref(pkt);
+    }
+
+    trace_set_frame(-1);
+    free_packets(gop);
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+
+    if (ret == kGopMismatch || ret == kParamSetMismatch) {
+        // 开放 GOP 的前导帧依赖上一个 GOP，无法单独直通；编码器产生的参数集与输入不同时片段也无法拼接，均整段重新编码
+        if (ret == kGopMismatch)
+            log_warn("video_anonymization: Input has open GOPs or undecodable frames, GOP passthrough disabled for '%s'.", inputFile);
+        else
+            log_warn("video_anonymization: Re-encoded GOP has different SPS/PPS than the input, GOP passthrough disabled for '%s'.", inputFile);
+        writer.close();
+        reader.close();
+        result = VideoJobResult();
+        progress.restart();
+        return run_video_ffmpeg(model, inputFile, outputFile, blurType, opts, progress, result);
+    }
+    int finishErr = writer.finish();
+    if (finishErr < 0 && ret == ANO_OK) {
+        log_error("video_anonymization: Failed to finalize '%s': %s", outputFile, ffmpeg_error_string(finishErr).c_str());
+        ret = SAVE_VIDEO_ERROR;
+    }
+    progress.finish();
+    log_info("video_anonymization: GOP passthrough done. Frames: %lld, GOPs copied: %lld, GOPs re-encoded: %lld, full detections: %lld.",
+             result.framesRead, result.gopsCopied, result.gopsEncoded, result.detectedFrames);
+    if (ret != ANO_OK) return ret;
+    return result.framesWritten > 0 ? ANO_OK : LOAD_VIDEO_ERROR;
+}
+
+#endif // ANONYMIZATION_WITH_FFMPEG
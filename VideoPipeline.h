@@ -0,0 +1,112 @@
+#ifndef VIDEO_PIPELINE_H
+#define VIDEO_PIPELINE_H
+
+#include "Anonymization.h"
+#include <vector>
+#include <string>
+#include <climits>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+
+class YOLOv8_face;
+class SidecarWriter;
+class SidecarBoxes;
+
+/**
+ * @brief 一次视频处理的统计结果
+ */
+struct VideoJobResult {
+    std::vector<double> sceneCuts;   // 场景切换时间点（毫秒）
+    long long framesRead = 0;
+    long long framesWritten = 0;
+    long long detectedFrames = 0;    // 执行了完整检测的帧数
+    long long gopsCopied = 0;        // GOP 直通：原样复制的 GOP 数
+    long long gopsEncoded = 0;       // GOP 直通：重新编码的 GOP 数
+};
+
+/**
+ * @brief 视频分段范围，时间戳为视频流时间基
+ * 从 seekTs 之前最近的关键帧开始解码，[seekTs, startPts) 的帧只用于预热检测状态，
+ * 输出 [startPts, endPts) 的帧
+ */
+struct VideoSegment {
+    static constexpr long long kUnbounded = LLONG_MIN;
+    long long seekTs = kUnbounded;
+    long long startPts = kUnbounded;
+    long long endPts = kUnbounded;
+    bool whole_file() const { return seekTs == kUnbounded && startPts == kUnbounded && endPts == kUnbounded; }
+};
+
+/**
+ * @brief 检测结果旁路：record 非空时只解码和检测，记录每帧使用的框，不输出视频；
+ * replay 非空时按帧号从旁路文件取框脱敏，不做检测
+ */
+struct VideoSidecar {
+    SidecarWriter* record = nullptr;
+    const SidecarBoxes* replay = nullptr;
+};
+
+/**
+ * @brief 进度回调与取消检查，分段并行时多个工作线程共享同一个实例
+ * 回调按 VideoOptions::progressIntervalMs 节流，且不会被并发调用
+ */
+class VideoProgressReporter {
+public:
+    explicit VideoProgressReporter(const VideoOptions& opts);
+    // 设置总帧数，只有第一次调用生效；未知时保持 0
+    void set_total(long long totalFrames);
+    // 记录 frames 帧处理完成；返回 false 表示已请求取消，调用者应在当前帧之后停止
+    bool advance(long long frames = 1);
+    // 续跑时复用的帧，计入进度但不计入速度
+    void add_resumed(long long frames);
+    bool cancelled() const;
+    // 处理方式回退、从头重做时清零计数
+    void restart();
+    // 结束时补一次回调
+    void finish();
+
+private:
+    void report(std::chrono::steady_clock::time_point now);
+
+    VideoProgressCallback callback;
+    void* userData;
+    const volatile int32_t* cancelFlag;
+    long long intervalNs;
+    std::atomic<long long> total;
+    std::atomic<long long> done;
+    std::atomic<long long> resumed;
+    std::atomic<long long> nextReportNs;
+    std::atomic<bool> cancelRequested;
+    std::mutex callbackMutex;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point lastReport;
+    long long lastReportDone;
+};
+
+// cv::VideoCapture/VideoWriter 路径，逐帧转换为 BGR
+int run_video_opencv(YOLOv8_face& model, const char* inputFile, const char* outputFile,
+                     BlurType blurType, const VideoOptions& opts, VideoProgressReporter& progress, VideoJobResult& result,
+                     const VideoSidecar& sidecar = VideoSidecar());
+
+#ifdef ANONYMIZATION_WITH_FFMPEG
+// libavformat/libavcodec 路径：多线程解码，帧保持 YUV420 直接检测和脱敏，音频原样复制
+int run_video_ffmpeg(YOLOv8_face& model, const char* inputFile, const char* outputFile,
+                     BlurType blurType, const VideoOptions& opts, VideoProgressReporter& progress, VideoJobResult& result,
+                     const VideoSidecar& sidecar = VideoSidecar());
+// 只处理一个分段并输出为不含音频的独立文件
+int run_video_ffmpeg_segment(YOLOv8_face& model, const char* inputFile, const char* outputFile,
+                             BlurType blurType, const VideoOptions& opts, const VideoSegment& segment,
+                             VideoProgressReporter& progress, VideoJobResult& result,
+                             const VideoSidecar& sidecar = VideoSidecar());
+// 在关键帧处切段，每段独立的检测器和编码器并行处理，最后不重新编码地拼接；
+// opts.checkpointIntervalSec > 0 时按时间切段并在 outputFile.ckpt 记录已完成的段，resume 时跳过这些段
+int run_video_ffmpeg_segmented(YOLOv8_face& model, const char* inputFile, const char* outputFile,
+                               BlurType blurType, const VideoOptions& opts, bool resume, VideoProgressReporter& progress,
+                               VideoJobResult& result);
+// 按 GOP 分析：无检测目标的 GOP 原样复制数据包，其余 GOP 重新编码（首帧对齐为 IDR）
+int run_video_ffmpeg_passthrough(YOLOv8_face& model, const char* inputFile, const char* outputFile,
+                                 BlurType blurType, const VideoOptions& opts, VideoProgressReporter& progress, VideoJobResult& result);
+#endif
+
+#endif // VIDEO_PIPELINE_H
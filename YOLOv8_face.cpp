@@ -1,5 +1,9 @@
 #include "YOLOv8_face.h"
 #include "log/log.h"
+#include "PerfStats.h"
+#include "SimdKernels.h"
+#include <algorithm>
+#include <sys/stat.h>
 
 YOLOv8_face::YOLOv8_face()
 {
@@ -9,12 +13,125 @@ YOLOv8_face::YOLOv8_face()
 int YOLOv8_face::set_YOLOv8_face_Info(string modelpath, float confThreshold, float nmsThreshold)
 {
     int res = 0;
+    this->modelPath = modelpath;
     this->confThreshold = confThreshold;
 	this->nmsThreshold = nmsThreshold;
 	this->net = readNet(modelpath);
     return res;
 }
 
+int YOLOv8_face::clone_from(const YOLOv8_face& other)
+{
+	int res = this->set_YOLOv8_face_Info(other.modelPath, other.confThreshold, other.nmsThreshold);
+	this->set_roi(other.roiInclude, other.roiExclude);
+	this->inpWidth = other.inpWidth;
+	this->inpHeight = other.inpHeight;
+	this->unsupportedSizes = other.unsupportedSizes;
+	this->perf = other.perf;
+	return res;
+}
+
+bool YOLOv8_face::set_input_size(int size)
+{
+	if (size < 160 || size > 1280 || size % 32 != 0)
+		return false;
+	if (std::find(this->unsupportedSizes.begin(), this->unsupportedSizes.end(), size) != this->unsupportedSizes.end())
+		return false;
+	this->inpWidth = size;
+	this->inpHeight = size;
+	return true;
+}
+
+bool YOLOv8_face::fallback_input_size(const cv::Exception& e)
+{
+	if (this->inpWidth == kDefaultInputSize && this->inpHeight == kDefaultInputSize)
+		return false;
+	log_warn("YOLOv8_face: Inference at input size %d failed (%s), falling back to %d.", this->inpWidth, e.what(), kDefaultInputSize);
+	this->unsupportedSizes.push_back(this->inpWidth);
+	this->inpWidth = kDefaultInputSize;
+	this->inpHeight = kDefaultInputSize;
+	return true;
+}
+
+void YOLOv8_face::set_roi(const vector<vector<Point2f>>& include, const vector<vector<Point2f>>& exclude)
+{
+	this->roiInclude = include;
+	this->roiExclude = exclude;
+	this->roiEnabled = !include.empty() || !exclude.empty();
+	// 掩码在下一次检测时按帧尺寸重新生成
+	this->roiMask.release();
+	this->roiMaskSize = Size();
+	this->roiBounds = Rect();
+}
+
+string YOLOv8_face::identity() const
+{
+	struct stat st;
+	const bool found = stat(this->modelPath.c_str(), &st) == 0;
+	ostringstream ss;
+	ss << this->modelPath << '|' << (found ? static_cast<long long>(st.st_size) : -1LL) << '|'
+	   << (found ? static_cast<long long>(st.st_mtime) : -1LL) << '|' << this->confThreshold << '|' << this->nmsThreshold
+	   << '|' << this->inpWidth << 'x' << this->inpHeight;
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		const vector<vector<Point2f>>& polygons = pass == 0 ? this->roiInclude : this->roiExclude;
+		ss << (pass == 0 ? "|include" : "|exclude");
+		for (const vector<Point2f>& polygon : polygons)
+		{
+			ss << ';';
+			for (const Point2f& p : polygon)
+				ss << p.x << ',' << p.y << ' ';
+		}
+	}
+	return ss.str();
+}
+
+const Mat& YOLOv8_face::roi_mask(Size frameSize)
+{
+	if (!this->roiMask.empty() && this->roiMaskSize == frameSize)
+		return this->roiMask;
+
+	auto to_pixels = [&](const vector<vector<Point2f>>& polys) {
+		vector<vector<Point>> out(polys.size());
+		for (size_t i = 0; i < polys.size(); ++i) {
+			for (const Point2f& p : polys[i]) {
+				int x = (int)std::lround(p.x * (frameSize.width - 1));
+				int y = (int)std::lround(p.y * (frameSize.height - 1));
+				out[i].push_back(Point(x, y));
+			}
+		}
+		return out;
+	};
+
+	const Rect frameRect(0, 0, frameSize.width, frameSize.height);
+	if (this->roiInclude.empty()) {
+		this->roiMask = Mat(frameSize, CV_8UC1, Scalar(255));
+		this->roiBounds = frameRect;
+	}
+	else {
+		this->roiMask = Mat(frameSize, CV_8UC1, Scalar(0));
+		vector<vector<Point>> polys = to_pixels(this->roiInclude);
+		fillPoly(this->roiMask, polys, Scalar(255));
+		Rect bounds;
+		for (size_t i = 0; i < polys.size(); ++i) {
+			if (polys[i].empty())
+				continue;
+			Rect r = boundingRect(polys[i]);
+			r.width += 1;
+			r.height += 1;
+			bounds = bounds.empty() ? r : (bounds | r);
+		}
+		this->roiBounds = bounds & frameRect;
+	}
+	if (!this->roiExclude.empty()) {
+		fillPoly(this->roiMask, to_pixels(this->roiExclude), Scalar(0));
+	}
+	this->roiMaskSize = frameSize;
+	log_info("YOLOv8_face: ROI mask built for %dx%d, inference region %dx%d at (%d,%d).",
+	         frameSize.width, frameSize.height, this->roiBounds.width, this->roiBounds.height, this->roiBounds.x, this->roiBounds.y);
+	return this->roiMask;
+}
+
 Mat YOLOv8_face::resize_image(Mat srcimg, int *newh, int *neww, int *padh, int *padw)
 {
 	int srch = srcimg.rows, srcw = srcimg.cols;
@@ -67,9 +184,24 @@ void YOLOv8_face::drawPred(float conf, int left, int top, int right, int bottom,
         frame(region).setTo(cv::Scalar::all(0)); // 将原图像该区域置为黑色
         blurredRegion.copyTo(frame(region)); // 将模糊后的图像复制回原图像的对应区域
     }
+    else if(blur_type == 3)
+    {
+        // 马赛克：先缩小再最近邻放大，开销远小于 51x51 高斯核
+        cv::Rect region(left, top, right - left, bottom - top);
+        mosaic(frame(region), kMosaicBlock);
+    }
 
 }
 
+void YOLOv8_face::mosaic(Mat region, int block)
+{
+	if (region.empty() || block <= 1)
+		return;
+	Mat small;
+	resize(region, small, Size(std::max(1, region.cols / block), std::max(1, region.rows / block)), 0, 0, INTER_AREA);
+	resize(small, region, region.size(), 0, 0, INTER_NEAREST);
+}
+
 void YOLOv8_face::softmax_(const float* x, float* y, int length)
 {
 	float sum = 0;
@@ -93,8 +225,13 @@ void YOLOv8_face::generate_proposal(Mat& out, vector<Rect>& boxes, vector<float>
 
     float* data = (float*)out.data;
 
-    for (int i = 0; i < num_proposals; ++i)
+    // 先按置信度阈值筛出候选下标，只解码命中的少数候选框
+    this->candidates.resize(num_proposals);
+    const int num_candidates = simd_score_scan(data + 4 * num_proposals, num_proposals, this->confThreshold, this->candidates.data());
+
+    for (int k = 0; k < num_candidates; ++k)
     {
+        const int i = this->candidates[k];
         float cx = data[0 * num_proposals + i];
         float cy = data[1 * num_proposals + i];
         float w = data[2 * num_proposals + i];
@@ -107,21 +244,16 @@ void YOLOv8_face::generate_proposal(Mat& out, vector<Rect>& boxes, vector<float>
         //float final_score = std::max(score1, score2);
 
         float final_score = data[4 * num_proposals + i];
-    
-        
 
-        if (final_score > this->confThreshold)
-        {
-            float xmin = max((cx - w / 2 - padw) * ratiow, 0.f);
-            float ymin = max((cy - h / 2 - padh) * ratioh, 0.f);
-            float xmax = min((cx + w / 2 - padw) * ratiow, float(imgw - 1));
-            float ymax = min((cy + h / 2 - padh) * ratioh, float(imgh - 1));
-            // log_info("num_proposals:%d, xmin=%.1f, ymin=%.1f, xmax=%.1f, ymax=%.1f, final_score=%.1f\n", i + 1, xmin, ymin, xmax, ymax, final_score);
-            Rect box = Rect(int(xmin), int(ymin), int(xmax - xmin), int(ymax - ymin));
-            boxes.push_back(box);
-            confidences.push_back(final_score);
-            landmarks.push_back(vector<Point>()); // 占位
-        }
+        float xmin = max((cx - w / 2 - padw) * ratiow, 0.f);
+        float ymin = max((cy - h / 2 - padh) * ratioh, 0.f);
+        float xmax = min((cx + w / 2 - padw) * ratiow, float(imgw - 1));
+        float ymax = min((cy + h / 2 - padh) * ratioh, float(imgh - 1));
+        // log_info("num_proposals:%d, xmin=%.1f, ymin=%.1f, xmax=%.1f, ymax=%.1f, final_score=%.1f\n", i + 1, xmin, ymin, xmax, ymax, final_score);
+        Rect box = Rect(int(xmin), int(ymin), int(xmax - xmin), int(ymax - ymin));
+        boxes.push_back(box);
+        confidences.push_back(final_score);
+        landmarks.push_back(vector<Point>()); // 占位
     }
 }
 
@@ -129,37 +261,332 @@ void YOLOv8_face::generate_proposal(Mat& out, vector<Rect>& boxes, vector<float>
 
 void YOLOv8_face::detect(Mat& srcimg, int blur_type)
 {
+    vector<Rect> boxes;
+    vector<float> confidences;
+    this->detect_boxes(srcimg, boxes, confidences);
+    this->redact(srcimg, boxes, blur_type);
+}
+
+bool YOLOv8_face::select_region(Size frameSize, Rect& region, const Mat*& mask)
+{
+    mask = nullptr;
+    region = Rect(0, 0, frameSize.width, frameSize.height);
+    if (this->roiEnabled) {
+        // 有检测区域时只把包含区域的外接矩形送入网络，同样的输入尺寸下目标占用更多像素
+        mask = &this->roi_mask(frameSize);
+        region = this->roiBounds;
+    }
+    return region.width > 0 && region.height > 0;
+}
+
+void YOLOv8_face::detect_boxes(const Mat& srcimg, vector<Rect>& kept_boxes, vector<float>& kept_confidences)
+{
+    kept_boxes.clear();
+    kept_confidences.clear();
+
+    const Mat* mask = nullptr;
+    Rect region;
+    if (!this->select_region(srcimg.size(), region, mask))
+        return;
+    const Mat input = (region.width == srcimg.cols && region.height == srcimg.rows) ? srcimg : srcimg(region);
+
+    PerfTimer timer(this->perf, PERF_STAGE_DETECT);
     int newh = 0, neww = 0, padh = 0, padw = 0;
-    Mat dst = this->resize_image(srcimg, &newh, &neww, &padh, &padw);
+    try {
+        Mat dst;
+        {
+            PerfTimer letterbox(this->perf, PERF_STAGE_LETTERBOX);
+            dst = this->resize_image(input, &newh, &neww, &padh, &padw);
+        }
+        this->infer(dst, srcimg.size(), region, mask, newh, neww, padh, padw, kept_boxes, kept_confidences);
+    }
+    catch (const cv::Exception& e) {
+        if (!this->fallback_input_size(e))
+            throw;
+        timer.stop();
+        this->detect_boxes(srcimg, kept_boxes, kept_confidences);
+    }
+}
+
+void YOLOv8_face::detect_boxes_i420(const Mat& y, const Mat& u, const Mat& v, vector<Rect>& kept_boxes, vector<float>& kept_confidences)
+{
+    kept_boxes.clear();
+    kept_confidences.clear();
+
+    const Mat* mask = nullptr;
+    Rect region;
+    if (!this->select_region(y.size(), region, mask))
+        return;
+    // 色度平面是亮度的一半，裁剪区域按 2 对齐
+    region.x &= ~1;
+    region.y &= ~1;
+    region.width = std::min(region.width + 1, y.cols - region.x) & ~1;
+    region.height = std::min(region.height + 1, y.rows - region.y) & ~1;
+    if (region.width <= 0 || region.height <= 0)
+        return;
+    const Rect chroma(region.x / 2, region.y / 2, region.width / 2, region.height / 2);
+
+    PerfTimer timer(this->perf, PERF_STAGE_DETECT);
+    int newh = 0, neww = 0, padh = 0, padw = 0;
+    try {
+        Mat dst;
+        {
+            PerfTimer letterbox(this->perf, PERF_STAGE_LETTERBOX);
+            dst = this->resize_image_i420(y(region), u(chroma), v(chroma), &newh, &neww, &padh, &padw);
+        }
+        this->infer(dst, y.size(), region, mask, newh, neww, padh, padw, kept_boxes, kept_confidences);
+    }
+    catch (const cv::Exception& e) {
+        if (!this->fallback_input_size(e))
+            throw;
+        timer.stop();
+        this->detect_boxes_i420(y, u, v, kept_boxes, kept_confidences);
+    }
+}
+
+Mat YOLOv8_face::resize_image_i420(const Mat& y, const Mat& u, const Mat& v, int *newh, int *neww, int *padh, int *padw)
+{
+	// 与 resize_image 相同的 letterbox 几何，但先在 YUV 平面上缩放，
+	// 只在网络输入分辨率上做一次颜色转换，避免整帧 YUV->BGR
+	int srch = y.rows, srcw = y.cols;
+	*newh = this->inpHeight;
+	*neww = this->inpWidth;
+	if (this->keep_ratio && srch != srcw) {
+		float hw_scale = (float)srch / srcw;
+		if (hw_scale > 1)
+			*neww = int(this->inpWidth / hw_scale);
+		else
+			*newh = (int)(this->inpHeight * hw_scale);
+	}
+	*newh = std::max(*newh & ~1, 2);
+	*neww = std::max(*neww & ~1, 2);
+
+	Mat i420(*newh * 3 / 2, *neww, CV_8UC1);
+	Mat dy = i420.rowRange(0, *newh);
+	resize(y, dy, Size(*neww, *newh), 0, 0, INTER_AREA);
+	// I420 的 U/V 平面在连续内存中按 (w/2)x(h/2) 紧密排列
+	Mat du(*newh / 2, *neww / 2, CV_8UC1, i420.ptr(*newh));
+	Mat dv(*newh / 2, *neww / 2, CV_8UC1, i420.ptr(*newh) + (size_t)(*newh / 2) * (*neww / 2));
+	resize(u, du, Size(*neww / 2, *newh / 2), 0, 0, INTER_AREA);
+	resize(v, dv, Size(*neww / 2, *newh / 2), 0, 0, INTER_AREA);
 
+	Mat dstimg;
+	cvtColor(i420, dstimg, COLOR_YUV2BGR_I420);
+	*padh = (this->inpHeight - *newh) / 2;
+	*padw = (this->inpWidth - *neww) / 2;
+	if (*padh > 0 || *padw > 0 || *newh != this->inpHeight || *neww != this->inpWidth) {
+		copyMakeBorder(dstimg, dstimg, *padh, this->inpHeight - *newh - *padh, *padw, this->inpWidth - *neww - *padw, BORDER_CONSTANT, 0);
+	}
+	return dstimg;
+}
+
+void YOLOv8_face::infer(const Mat& dst, Size frameSize, Rect region, const Mat* mask,
+                        int newh, int neww, int padh, int padw,
+                        vector<Rect>& kept_boxes, vector<float>& kept_confidences)
+{
     Mat blob;
-    blobFromImage(dst, blob, 1 / 255.0, Size(this->inpWidth, this->inpHeight), Scalar(0, 0, 0), true, false);
+    {
+        PerfTimer timer(this->perf, PERF_STAGE_LETTERBOX);
+        blobFromImage(dst, blob, 1 / 255.0, Size(this->inpWidth, this->inpHeight), Scalar(0, 0, 0), true, false);
+    }
     this->net.setInput(blob);
 
     vector<Mat> outs;
 
-    this->net.forward(outs, this->net.getUnconnectedOutLayersNames());
+    {
+        PerfTimer timer(this->perf, PERF_STAGE_FORWARD);
+        this->net.forward(outs, this->net.getUnconnectedOutLayersNames());
+    }
 
     // 只处理一个输出
+    this->postprocess(outs[0], frameSize, region, mask, newh, neww, padh, padw, kept_boxes, kept_confidences);
+}
+
+void YOLOv8_face::postprocess(Mat& out, Size frameSize, Rect region, const Mat* mask,
+                              int newh, int neww, int padh, int padw,
+                              vector<Rect>& kept_boxes, vector<float>& kept_confidences)
+{
     vector<Rect> boxes;
     vector<float> confidences;
     vector<vector<Point>> landmarks;
 
-    float ratioh = (float)srcimg.rows / newh;
-    float ratiow = (float)srcimg.cols / neww;
+    float ratioh = (float)region.height / newh;
+    float ratiow = (float)region.width / neww;
+
+    PerfTimer proposals(this->perf, PERF_STAGE_PROPOSALS);
+    generate_proposal(out, boxes, confidences, landmarks, region.height, region.width, ratioh, ratiow, padh, padw);
 
-    generate_proposal(outs[0], boxes, confidences, landmarks, srcimg.rows, srcimg.cols, ratioh, ratiow, padh, padw);
+    if (region.x != 0 || region.y != 0 || mask != nullptr) {
+        // 映射回原图坐标，并在 NMS 之前丢弃中心点落在检测区域之外的候选框
+        size_t n = 0;
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            Rect box = boxes[i];
+            box.x += region.x;
+            box.y += region.y;
+            if (mask != nullptr) {
+                int cx = std::min(box.x + box.width / 2, frameSize.width - 1);
+                int cy = std::min(box.y + box.height / 2, frameSize.height - 1);
+                if (mask->at<uchar>(cy, cx) == 0)
+                    continue;
+            }
+            boxes[n] = box;
+            confidences[n] = confidences[i];
+            ++n;
+        }
+        boxes.resize(n);
+        confidences.resize(n);
+    }
+
+    proposals.stop();
 
     // NMS去除重复框
     vector<int> indices;
-    NMSBoxes(boxes, confidences, this->confThreshold, this->nmsThreshold, indices);
+    {
+        PerfTimer timer(this->perf, PERF_STAGE_NMS);
+        NMSBoxes(boxes, confidences, this->confThreshold, this->nmsThreshold, indices);
+    }
 
+    kept_boxes.reserve(indices.size());
+    kept_confidences.reserve(indices.size());
     for (size_t i = 0; i < indices.size(); ++i)
     {
         int idx = indices[i];
-        Rect box = boxes[idx];
-        this->drawPred(confidences[idx], box.x, box.y,
+        kept_boxes.push_back(boxes[idx]);
+        kept_confidences.push_back(confidences[idx]);
+    }
+}
+
+void YOLOv8_face::detect_boxes_batch(const vector<Mat>& frames, vector<vector<Rect>>& kept_boxes, vector<vector<float>>& kept_confidences)
+{
+    kept_boxes.assign(frames.size(), vector<Rect>());
+    kept_confidences.assign(frames.size(), vector<float>());
+    if (frames.size() == 1 || this->batchUnsupported) {
+        for (size_t i = 0; i < frames.size(); ++i)
+            this->detect_boxes(frames[i], kept_boxes[i], kept_confidences[i]);
+        return;
+    }
+
+    // 逐帧做 letterbox，记下每帧的几何参数，再合成一个 NCHW blob 一次前向
+    struct Geometry { Rect region; const Mat* mask; int newh, neww, padh, padw; };
+    vector<Geometry> geometry;
+    vector<Mat> inputs;
+    vector<size_t> owners;
+    PerfTimer timer(this->perf, PERF_STAGE_DETECT);
+    PerfTimer letterbox(this->perf, PERF_STAGE_LETTERBOX);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        Geometry g = Geometry();
+        if (!this->select_region(frames[i].size(), g.region, g.mask))
+            continue;
+        const Mat input = (g.region.width == frames[i].cols && g.region.height == frames[i].rows) ? frames[i] : frames[i](g.region);
+        inputs.push_back(this->resize_image(input, &g.newh, &g.neww, &g.padh, &g.padw));
+        geometry.push_back(g);
+        owners.push_back(i);
+    }
+    if (inputs.empty())
+        return;
+
+    vector<Mat> outs;
+    bool failed = false;
+    try {
+        Mat blob;
+        blobFromImages(inputs, blob, 1 / 255.0, Size(this->inpWidth, this->inpHeight), Scalar(0, 0, 0), true, false);
+        letterbox.stop();
+        this->net.setInput(blob);
+        PerfTimer forward(this->perf, PERF_STAGE_FORWARD);
+        this->net.forward(outs, this->net.getUnconnectedOutLayersNames());
+    }
+    catch (const cv::Exception& e) {
+        // 异常可能是临时的（如内存不足），连续失败 kMaxBatchFailures 次才认为模型不支持批量推理
+        this->batchFailures++;
+        log_warn("YOLOv8_face: Batched inference of %zu frames failed (%d/%d): %s", inputs.size(), this->batchFailures, kMaxBatchFailures, e.what());
+        if (this->batchFailures >= kMaxBatchFailures)
+            this->batchUnsupported = true;
+        failed = true;
+    }
+    // 以 batch=1 导出的模型可能不报错而只输出一帧的结果，这种情况确定不支持批量推理
+    if (!failed && (outs.empty() || outs[0].dims != 3 || outs[0].size[0] != static_cast<int>(inputs.size()))) {
+        log_warn("YOLOv8_face: Model returned %d results for a batch of %zu frames, using per-frame inference.",
+                 outs.empty() || outs[0].dims < 1 ? 0 : outs[0].size[0], inputs.size());
+        this->batchUnsupported = true;
+        failed = true;
+    }
+    if (failed) {
+        letterbox.stop();
+        timer.stop();
+        for (size_t i = 0; i < frames.size(); ++i)
+            this->detect_boxes(frames[i], kept_boxes[i], kept_confidences[i]);
+        return;
+    }
+    this->batchFailures = 0;
+
+    Mat& out = outs[0];
+    int sliceSize[] = { 1, out.size[1], out.size[2] };
+    for (size_t k = 0; k < owners.size(); ++k) {
+        const size_t i = owners[k];
+        const Geometry& g = geometry[k];
+        Mat slice(3, sliceSize, CV_32F, out.ptr<float>(static_cast<int>(k)));
+        this->postprocess(slice, frames[i].size(), g.region, g.mask, g.newh, g.neww, g.padh, g.padw, kept_boxes[i], kept_confidences[i]);
+    }
+}
+
+void YOLOv8_face::redact(Mat& srcimg, const vector<Rect>& boxes, int blur_type)
+{
+    PerfTimer timer(this->perf, PERF_STAGE_REDACT);
+    const Rect bounds(0, 0, srcimg.cols, srcimg.rows);
+    for (size_t i = 0; i < boxes.size(); ++i)
+    {
+        // 复用的旧框可能落在当前帧之外，先裁剪到图像范围内
+        Rect box = boxes[i] & bounds;
+        if (box.width <= 0 || box.height <= 0)
+            continue;
+        this->drawPred(1.f, box.x, box.y,
                        box.x + box.width, box.y + box.height,
-                       srcimg, landmarks[idx], blur_type);
+                       srcimg, vector<Point>(), blur_type);
+    }
+}
+
+void YOLOv8_face::redact_i420(Mat& y, Mat& u, Mat& v, const vector<Rect>& boxes, int blur_type)
+{
+    PerfTimer timer(this->perf, PERF_STAGE_REDACT);
+    const Rect bounds(0, 0, y.cols, y.rows);
+    const Rect chromaBounds(0, 0, u.cols, u.rows);
+    for (size_t i = 0; i < boxes.size(); ++i)
+    {
+        Rect box = boxes[i] & bounds;
+        if (box.width <= 0 || box.height <= 0)
+            continue;
+        Rect cbox = Rect(box.x / 2, box.y / 2, (box.width + 1) / 2, (box.height + 1) / 2) & chromaBounds;
+
+        if (blur_type == 1)
+        {
+            // 画框：BT.601 下纯红色约为 Y=76 U=85 V=255
+            rectangle(y, box.tl(), box.br(), Scalar(76), 3);
+            if (cbox.width > 0 && cbox.height > 0)
+            {
+                rectangle(u, cbox.tl(), cbox.br(), Scalar(85), 2);
+                rectangle(v, cbox.tl(), cbox.br(), Scalar(255), 2);
+            }
+        }
+        else if (blur_type == 3)
+        {
+            mosaic(y(box), kMosaicBlock);
+            if (cbox.width > 0 && cbox.height > 0)
+            {
+                mosaic(u(cbox), kMosaicBlock / 2);
+                mosaic(v(cbox), kMosaicBlock / 2);
+            }
+        }
+        else if (blur_type == 2)
+        {
+            // 与 BGR 路径相同的 51x51 高斯核，色度平面按半分辨率使用 25x25
+            Mat region = y(box);
+            GaussianBlur(region.clone(), region, Size(51, 51), 0, 0);
+            if (cbox.width > 0 && cbox.height > 0)
+            {
+                Mat ur = u(cbox), vr = v(cbox);
+                GaussianBlur(ur.clone(), ur, Size(25, 25), 0, 0);
+                GaussianBlur(vr.clone(), vr, Size(25, 25), 0, 0);
+            }
+        }
     }
 }
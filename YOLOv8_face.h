@@ -9,23 +9,71 @@ using namespace cv;
 using namespace dnn;
 using namespace std;
 
+class PerfCounters;
+
 class YOLOv8_face
 {
 public:
 	YOLOv8_face();
 	int set_YOLOv8_face_Info(string modelpath, float confThreshold, float nmsThreshold);
+	// 按 other 的模型路径、阈值和检测区域加载一个独立实例，供并行工作线程使用
+	int clone_from(const YOLOv8_face& other);
 	void detect(Mat& frame, int blur_type);
+	void detect_boxes(const Mat& frame, vector<Rect>& boxes, vector<float>& confidences);  // 仅检测，返回 NMS 之后的框
+	// 多帧合成一个 batch 前向；模型不支持批量输入时自动退回逐帧
+	void detect_boxes_batch(const vector<Mat>& frames, vector<vector<Rect>>& boxes, vector<vector<float>>& confidences);
+	void redact(Mat& frame, const vector<Rect>& boxes, int blur_type);                      // 按给定框做脱敏
+	// I420 平面直接输入：在 YUV 上缩放后只对网络输入尺寸做颜色转换；脱敏直接写回各平面
+	void detect_boxes_i420(const Mat& y, const Mat& u, const Mat& v, vector<Rect>& boxes, vector<float>& confidences);
+	void redact_i420(Mat& y, Mat& u, Mat& v, const vector<Rect>& boxes, int blur_type);
+	// 设置检测区域，多边形顶点为归一化坐标 [0,1]；include 为空表示全图，两者都为空即取消限制
+	void set_roi(const vector<vector<Point2f>>& include, const vector<vector<Point2f>>& exclude);
+	bool has_roi() const { return this->roiEnabled; }
+	// 影响检测结果的全部配置（模型文件及其大小和修改时间、阈值、输入尺寸、检测区域），用于判断检查点能否续跑
+	string identity() const;
+	// 设置网络输入边长（32 的倍数），模型不支持该尺寸时推理会自动退回默认尺寸，之后该尺寸返回 false
+	bool set_input_size(int size);
+	int input_size() const { return this->inpWidth; }
+	// 分阶段性能计数器，由句柄设置，clone_from 得到的实例共享同一份；为 nullptr 时不计时
+	void set_perf_counters(PerfCounters* counters) { this->perf = counters; }
+	PerfCounters* perf_counters() const { return this->perf; }
+	static const int kDefaultInputSize = 640;
 private:
+	static const int kMaxBatchFailures = 3;
+	friend class YOLOv8FaceBench;          // bench/ 中的基准直接调用 letterbox、候选框解析等内部阶段
+	bool fallback_input_size(const cv::Exception& e);
+	const Mat& roi_mask(Size frameSize);   // 按帧尺寸懒生成掩码并缓存
+	bool roiEnabled = false;
+	vector<vector<Point2f>> roiInclude;
+	vector<vector<Point2f>> roiExclude;
+	Mat roiMask;
+	Size roiMaskSize;
+	Rect roiBounds;                        // 包含区域的外接矩形，检测前先裁剪到该区域
 	Mat resize_image(Mat srcimg, int *newh, int *neww, int *padh, int *padw);
+	Mat resize_image_i420(const Mat& y, const Mat& u, const Mat& v, int *newh, int *neww, int *padh, int *padw);
+	bool select_region(Size frameSize, Rect& region, const Mat*& mask);
+	void infer(const Mat& dst, Size frameSize, Rect region, const Mat* mask, int newh, int neww, int padh, int padw,
+	           vector<Rect>& boxes, vector<float>& confidences);
+	// 解析单帧网络输出 [1, 5, N]：映射回原图、按检测区域过滤并做 NMS
+	void postprocess(Mat& out, Size frameSize, Rect region, const Mat* mask, int newh, int neww, int padh, int padw,
+	                 vector<Rect>& boxes, vector<float>& confidences);
+	bool batchUnsupported = false;          // 模型的 batch 维固定为 1，只能逐帧推理
+	int batchFailures = 0;                  // 批量推理连续抛出异常的次数，达到上限才认为不支持
+	PerfCounters* perf = nullptr;
 	const bool keep_ratio = true;
-	const int inpWidth = 640;
-	const int inpHeight = 640;
+	int inpWidth = kDefaultInputSize;
+	int inpHeight = kDefaultInputSize;
+	vector<int> unsupportedSizes;          // 推理失败过的输入尺寸（模型导出时固定了输入形状）
+	string modelPath;
 	float confThreshold;
 	float nmsThreshold;
 	const int num_class = 1;  ///只有人脸这一个类别
 	const int reg_max = 16;
 	Net net;
+	static const int kMosaicBlock = 16;    // 马赛克块边长（亮度像素）
+	static void mosaic(Mat region, int block);
 	void softmax_(const float* x, float* y, int length);
+	vector<int> candidates;                // generate_proposal 中超过置信度阈值的下标，跨帧复用
 	void generate_proposal(Mat& out, vector<Rect>& boxes, vector<float>& confidences, vector<vector<Point>>& landmarks, int imgh, int imgw, float ratioh, float ratiow, int padh, int padw);
 	void drawPred(float conf, int left, int top, int right, int bottom, Mat& frame, vector<Point> landmark, int blur_type);
 };
@@ -0,0 +1,659 @@
+// 性能基准：各热点路径的微基准与端到端吞吐，输出 JSON 供不同构建之间比较
+// 用法见 ./anonymization_bench --help
+#include "Anonymization.h"
+#include "YOLOv8_face.h"
+#include "FrameConvert.h"
+#include "StreamSession.h"
+#include "SimdKernels.h"
+#include "log/log.h"
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+// 基准直接调用检测器的内部各阶段（letterbox、候选框解析、NMS）
+class YOLOv8FaceBench
+{
+public:
+    explicit YOLOv8FaceBench(YOLOv8_face& model) : model(model) {}
+
+    void set_thresholds(float conf, float nms) {
+        this->model.confThreshold = conf;
+        this->model.nmsThreshold = nms;
+    }
+    int input_size() const { return this->model.inpWidth; }
+    Mat letterbox(const Mat& frame, int& newh, int& neww, int& padh, int& padw) {
+        return this->model.resize_image(frame, &newh, &neww, &padh, &padw);
+    }
+    Mat letterbox_i420(const Mat& y, const Mat& u, const Mat& v, int& newh, int& neww, int& padh, int& padw) {
+        return this->model.resize_image_i420(y, u, v, &newh, &neww, &padh, &padw);
+    }
+    void proposals(Mat& out, Size frameSize, int newh, int neww, int padh, int padw, vector<Rect>& boxes, vector<float>& confidences) {
+        vector<vector<Point>> landmarks;
+        this->model.generate_proposal(out, boxes, confidences, landmarks, frameSize.height, frameSize.width,
+                                      static_cast<float>(frameSize.height) / newh, static_cast<float>(frameSize.width) / neww, padh, padw);
+    }
+    void postprocess(Mat& out, Size frameSize, int newh, int neww, int padh, int padw, vector<Rect>& boxes, vector<float>& confidences) {
+        this->model.postprocess(out, frameSize, Rect(0, 0, frameSize.width, frameSize.height), nullptr,
+                                newh, neww, padh, padw, boxes, confidences);
+    }
+    float conf_threshold() const { return this->model.confThreshold; }
+    float nms_threshold() const { return this->model.nmsThreshold; }
+
+private:
+    YOLOv8_face& model;
+};
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct BenchOptions {
+    double minTimeMs = 300;          // 每个用例至少运行的时间
+    int minIters = 5;                // 每个用例至少运行的次数
+    int targets = 8;                 // 每帧植入的目标数
+    int videoFrames = 90;            // 端到端视频用例的帧数
+    std::string filter;              // 只运行名称包含该子串的用例
+    std::vector<Size> sizes;
+    std::string modelDir;            // 为空时跳过需要模型的端到端用例
+    std::string targetImage;         // 植入的目标图像（如人脸照片），为空时画合成目标
+    std::string out;                 // JSON 输出文件，为空时写 stdout
+    std::string baseline;            // 与之比较的上一次 JSON 结果
+    double maxRegression = 10;       // 中位数变慢超过该百分比即判为回退
+    std::string simd;                // 强制使用的内核版本，为空时按 CPU 自动选择
+    bool list = false;
+};
+
+struct BenchResult {
+    std::string name;
+    std::string group;
+    Size size;
+    long long iterations = 0;
+    double itemsPerIter = 1;
+    double meanUs = 0, medianUs = 0, p90Us = 0, minUs = 0;
+    double itemsPerSec = 0;
+};
+
+class BenchRunner
+{
+public:
+    explicit BenchRunner(const BenchOptions& options) : options(options) {}
+
+    bool enabled(const std::string& name) const {
+        return this->options.filter.empty() || name.find(this->options.filter) != std::string::npos;
+    }
+
+    // setup 在每次计时之前执行（不计时），fn 为被测操作；itemsPerIter 用于换算吞吐（帧/秒）
+    void run(const std::string& name, Size size, const std::function<void()>& fn,
+             const std::function<void()>& setup = std::function<void()>(), double itemsPerIter = 1, int minIters = 0) {
+        if (!this->enabled(name)) return;
+        if (this->options.list) {
+            printf("%s\n", name.c_str());
+            return;
+        }
+        if (minIters <= 0) minIters = this->options.minIters;
+        if (setup) setup();
+        fn();   // 预热：首次调用的缓存、分配和懒初始化不计入
+        std::vector<double> samples;
+        double totalUs = 0;
+        while ((totalUs < this->options.minTimeMs * 1000 || static_cast<int>(samples.size()) < minIters) && samples.size() < 1000000) {
+            if (setup) setup();
+            const Clock::time_point start = Clock::now();
+            fn();
+            const double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+            samples.push_back(us);
+            totalUs += us;
+        }
+
+        BenchResult r;
+        r.name = name;
+        r.group = name.substr(0, name.find('/'));
+        r.size = size;
+        r.iterations = static_cast<long long>(samples.size());
+        r.itemsPerIter = itemsPerIter;
+        std::sort(samples.begin(), samples.end());
+        r.meanUs = totalUs / samples.size();
+        r.medianUs = samples[samples.size() / 2];
+        r.p90Us = samples[std::min(samples.size() - 1, samples.size() * 9 / 10)];
+        r.minUs = samples.front();
+        r.itemsPerSec = r.meanUs > 0 ? itemsPerIter * 1e6 / r.meanUs : 0;
+        fprintf(stderr, "%-48s %8lld it  median %10.1f us  p90 %10.1f us  %10.1f /s\n",
+                name.c_str(), r.iterations, r.medianUs, r.p90Us, r.itemsPerSec);
+        this->results.push_back(r);
+    }
+
+    void skip(const std::string& name, const std::string& reason) {
+        if (!this->enabled(name)) return;
+        if (this->options.list) {
+            printf("%s (skipped: %s)\n", name.c_str(), reason.c_str());
+            return;
+        }
+        fprintf(stderr, "%-48s skipped: %s\n", name.c_str(), reason.c_str());
+        this->skipped.push_back(std::make_pair(name, reason));
+    }
+
+    const BenchOptions& options;
+    std::vector<BenchResult> results;
+    std::vector<std::pair<std::string, std::string>> skipped;
+};
+
+const char* format_name(ImageFormat format) {
+    switch (format) {
+        case IMG_FORMAT_ARGB: return "ARGB";
+        case IMG_FORMAT_RGB: return "RGB";
+        case IMG_FORMAT_BGR: return "BGR";
+        case IMG_FORMAT_YUV420P: return "YUV420P";
+        case IMG_FORMAT_YUV420SP: return "YUV420SP";
+        case IMG_FORMAT_GRAY: return "GRAY";
+        default: return "UNKNOWN";
+    }
+}
+
+const char* blur_name(int blurType) {
+    switch (blurType) {
+        case BLUR_TYPE_NONE: return "none";
+        case BLUR_TYPE_RECTANGLE: return "rectangle";
+        case BLUR_TYPE_GAUSSIAN: return "gaussian";
+        case BLUR_TYPE_MOSAIC: return "mosaic";
+        default: return "unknown";
+    }
+}
+
+std::string size_name(Size size) {
+    return std::to_string(size.width) + "x" + std::to_string(size.height);
+}
+
+/**
+ * @brief 固定种子生成的合成帧：平滑渐变背景加少量噪声，按网格植入 targets 个目标
+ * 同样的参数总是生成同样的像素，结果可以在不同构建之间直接比较
+ */
+Mat make_frame(Size size, int targets, const Mat& patch, vector<Rect>& planted, int shift = 0) {
+    Mat frame(size, CV_8UC3);
+    for (int y = 0; y < size.height; ++y) {
+        uchar* row = frame.ptr<uchar>(y);
+        for (int x = 0; x < size.width; ++x) {
+            row[3 * x + 0] = static_cast<uchar>((x * 255) / std::max(1, size.width - 1));
+            row[3 * x + 1] = static_cast<uchar>((y * 255) / std::max(1, size.height - 1));
+            row[3 * x + 2] = static_cast<uchar>(((x + y) * 127) / std::max(1, size.width + size.height));
+        }
+    }
+    RNG rng(0x5eed);
+    Mat noise(size, CV_8UC3);
+    rng.fill(noise, RNG::UNIFORM, Scalar::all(0), Scalar::all(24));
+    frame += noise;
+
+    planted.clear();
+    const int cols = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(targets)))));
+    const int rows = std::max(1, (targets + cols - 1) / cols);
+    const int cellW = size.width / cols, cellH = size.height / rows;
+    const int side = std::max(16, std::min(cellW, cellH) * 3 / 5);
+    for (int i = 0; i < targets; ++i) {
+        const int cx = (i % cols) * cellW + cellW / 2 + shift;
+        const int cy = (i / cols) * cellH + cellH / 2;
+        Rect box(cx - side / 2, cy - side * 3 / 5, side, side * 6 / 5);
+        box &= Rect(0, 0, size.width, size.height);
+        if (box.area() <= 0) continue;
+        if (!patch.empty()) {
+            Mat resized;
+            resize(patch, resized, box.size(), 0, 0, INTER_AREA);
+            resized.copyTo(frame(box));
+        } else {
+            ellipse(frame, RotatedRect(Point2f(box.x + box.width / 2.f, box.y + box.height / 2.f), Size2f(box.width, box.height), 0),
+                    Scalar(120, 160, 210), FILLED);
+            circle(frame, Point(box.x + box.width * 3 / 10, box.y + box.height * 2 / 5), side / 12 + 1, Scalar(40, 40, 40), FILLED);
+            circle(frame, Point(box.x + box.width * 7 / 10, box.y + box.height * 2 / 5), side / 12 + 1, Scalar(40, 40, 40), FILLED);
+        }
+        planted.push_back(box);
+    }
+    return frame;
+}
+
+/**
+ * @brief 合成一份网络输出 [1, 5, N]：背景候选框分数低于阈值，每个目标周围有 dupPerTarget 个
+ * 抖动的高分候选框，NMS 的负载与真实检测相近
+ */
+Mat make_network_output(int inputSize, const vector<Rect>& letterboxed, int dupPerTarget) {
+    const int strides[] = { 8, 16, 32 };
+    int count = 0;
+    for (int s : strides) count += (inputSize / s) * (inputSize / s);
+    int dims[] = { 1, 5, count };
+    Mat out(3, dims, CV_32F);
+    float* data = out.ptr<float>();
+    RNG rng(0xbeef);
+    for (int i = 0; i < count; ++i) {
+        data[0 * count + i] = rng.uniform(0.f, static_cast<float>(inputSize));
+        data[1 * count + i] = rng.uniform(0.f, static_cast<float>(inputSize));
+        data[2 * count + i] = rng.uniform(4.f, 64.f);
+        data[3 * count + i] = rng.uniform(4.f, 64.f);
+        data[4 * count + i] = rng.uniform(0.f, 0.3f);
+    }
+    int next = 0;
+    for (const Rect& box : letterboxed) {
+        for (int k = 0; k < dupPerTarget && next < count; ++k, next += 97) {
+            const int i = next % count;
+            const float jitter = box.width * 0.05f;
+            data[0 * count + i] = box.x + box.width / 2.f + rng.uniform(-jitter, jitter);
+            data[1 * count + i] = box.y + box.height / 2.f + rng.uniform(-jitter, jitter);
+            data[2 * count + i] = box.width * rng.uniform(0.9f, 1.1f);
+            data[3 * count + i] = box.height * rng.uniform(0.9f, 1.1f);
+            data[4 * count + i] = rng.uniform(0.5f, 0.95f);
+        }
+    }
+    return out;
+}
+
+void bench_convert(BenchRunner& runner, const Mat& bgr, Size size) {
+    const ImageFormat formats[] = { IMG_FORMAT_ARGB, IMG_FORMAT_RGB, IMG_FORMAT_BGR, IMG_FORMAT_YUV420P, IMG_FORMAT_YUV420SP, IMG_FORMAT_GRAY };
+    for (ImageFormat format : formats) {
+        StreamFrame frame;
+        if (!frame.allocate(format, size.width, size.height) || bgr_to_image_frame(bgr, &frame.frame) != ANO_OK) {
+            runner.skip(std::string("convert/to_bgr/") + format_name(format) + "/" + size_name(size), "allocation failed");
+            continue;
+        }
+        Mat converted;
+        runner.run(std::string("convert/to_bgr/") + format_name(format) + "/" + size_name(size), size,
+                   [&]() { image_frame_to_bgr(&frame.frame, converted); });
+        runner.run(std::string("convert/from_bgr/") + format_name(format) + "/" + size_name(size), size,
+                   [&]() { bgr_to_image_frame(bgr, &frame.frame); });
+    }
+}
+
+void bench_letterbox(BenchRunner& runner, YOLOv8FaceBench& bench, const Mat& bgr, Size size) {
+    int newh = 0, neww = 0, padh = 0, padw = 0;
+    Mat dst;
+    runner.run("letterbox/bgr/" + size_name(size), size, [&]() { dst = bench.letterbox(bgr, newh, neww, padh, padw); });
+
+    Mat yuv;
+    cvtColor(bgr, yuv, COLOR_BGR2YUV_I420);
+    const int w = size.width & ~1, h = size.height & ~1;
+    if (w == size.width && h == size.height) {
+        Mat y = yuv.rowRange(0, h);
+        Mat u(h / 2, w / 2, CV_8UC1, yuv.ptr<uchar>(h));
+        Mat v(h / 2, w / 2, CV_8UC1, yuv.ptr<uchar>(h) + (w / 2) * (h / 2));
+        runner.run("letterbox/i420/" + size_name(size), size, [&]() { dst = bench.letterbox_i420(y, u, v, newh, neww, padh, padw); });
+    }
+
+    dst = bench.letterbox(bgr, newh, neww, padh, padw);
+    const int inp = bench.input_size();
+    Mat blob;
+    runner.run("blob/" + size_name(size), size, [&]() {
+        dnn::blobFromImage(dst, blob, 1 / 255.0, Size(inp, inp), Scalar(0, 0, 0), true, false);
+    });
+}
+
+void bench_postprocess(BenchRunner& runner, YOLOv8FaceBench& bench, const Mat& bgr, const vector<Rect>& planted, Size size) {
+    int newh = 0, neww = 0, padh = 0, padw = 0;
+    bench.letterbox(bgr, newh, neww, padh, padw);
+    const float scaleX = static_cast<float>(neww) / size.width, scaleY = static_cast<float>(newh) / size.height;
+    vector<Rect> letterboxed;
+    for (const Rect& b : planted)
+        letterboxed.push_back(Rect(static_cast<int>(b.x * scaleX) + padw, static_cast<int>(b.y * scaleY) + padh,
+                                   static_cast<int>(b.width * scaleX), static_cast<int>(b.height * scaleY)));
+    Mat out = make_network_output(bench.input_size(), letterboxed, 20);
+    const std::string suffix = "/targets" + std::to_string(planted.size()) + "/" + size_name(size);
+
+    vector<Rect> boxes;
+    vector<float> confidences;
+    runner.run("proposals" + suffix, size, [&]() {
+        boxes.clear();
+        confidences.clear();
+        bench.proposals(out, size, newh, neww, padh, padw, boxes, confidences);
+    });
+
+    boxes.clear();
+    confidences.clear();
+    bench.proposals(out, size, newh, neww, padh, padw, boxes, confidences);
+    vector<int> indices;
+    runner.run("nms" + suffix, size, [&]() {
+        dnn::NMSBoxes(boxes, confidences, bench.conf_threshold(), bench.nms_threshold(), indices);
+    });
+
+    vector<Rect> kept;
+    vector<float> keptConfidences;
+    runner.run("postprocess" + suffix, size, [&]() {
+        kept.clear();
+        keptConfidences.clear();
+        bench.postprocess(out, size, newh, neww, padh, padw, kept, keptConfidences);
+    });
+}
+
+// 各指令集版本的内核逐一计时，结束后恢复原来选择的版本
+void bench_kernels(BenchRunner& runner, const Mat& bgr, Size size) {
+    const int chromaW = size.width / 2, chromaH = size.height / 2;
+    Mat yuv;
+    cvtColor(bgr(Rect(0, 0, chromaW * 2, chromaH * 2)), yuv, COLOR_BGR2YUV_I420);
+    const uint8_t* u = yuv.ptr<uint8_t>(chromaH * 2);
+    const uint8_t* v = u + static_cast<size_t>(chromaW) * chromaH;
+    vector<uint8_t> uv(static_cast<size_t>(chromaW) * 2);
+
+    // 与 generate_proposal 相同的输入规模：640 输入时 8400 个候选框，约 1% 超过阈值
+    const int proposals = 8400;
+    vector<float> scores(proposals);
+    RNG rng(7);
+    for (float& score : scores) score = rng.uniform(0.f, 1.f) < 0.01f ? rng.uniform(0.5f, 0.95f) : rng.uniform(0.f, 0.3f);
+    vector<int> indices(proposals);
+
+    const std::string selected = simd_variant_name();
+    const char* variants[8];
+    const int count = simd_supported_variants(variants);
+    for (int k = 0; k < count; ++k) {
+        simd_force_variant(variants[k]);
+        runner.run(std::string("kernels/interleave_uv/") + variants[k] + "/" + size_name(size), size, [&]() {
+            for (int r = 0; r < chromaH; ++r)
+                simd_interleave_uv(u + r * chromaW, v + r * chromaW, uv.data(), chromaW);
+        });
+        runner.run(std::string("kernels/score_scan/") + variants[k] + "/" + size_name(size), size, [&]() {
+            simd_score_scan(scores.data(), proposals, 0.45f, indices.data());
+        });
+    }
+    simd_force_variant(selected.c_str());
+}
+
+void bench_redact(BenchRunner& runner, YOLOv8_face& model, const Mat& bgr, const vector<Rect>& planted, Size size) {
+    const int blurTypes[] = { BLUR_TYPE_RECTANGLE, BLUR_TYPE_GAUSSIAN, BLUR_TYPE_MOSAIC };
+    Mat work;
+    Mat yuv, yuvWork;
+    cvtColor(bgr, yuv, COLOR_BGR2YUV_I420);
+    const bool even = (size.width % 2 == 0) && (size.height % 2 == 0);
+    for (int blurType : blurTypes) {
+        const std::string suffix = std::string(blur_name(blurType)) + "/targets" + std::to_string(planted.size()) + "/" + size_name(size);
+        runner.run("redact/bgr/" + suffix, size,
+                   [&]() { model.redact(work, planted, blurType); },
+                   [&]() { bgr.copyTo(work); });
+        if (!even) continue;
+        const int w = size.width, h = size.height;
+        runner.run("redact/i420/" + suffix, size,
+                   [&]() {
+                       Mat y = yuvWork.rowRange(0, h);
+                       Mat u(h / 2, w / 2, CV_8UC1, yuvWork.ptr<uchar>(h));
+                       Mat v(h / 2, w / 2, CV_8UC1, yuvWork.ptr<uchar>(h) + (w / 2) * (h / 2));
+                       model.redact_i420(y, u, v, planted, blurType);
+                   },
+                   [&]() { yuv.copyTo(yuvWork); });
+    }
+}
+
+void bench_end_to_end(BenchRunner& runner, AnonymizationHandle handle, const std::string& tempDir,
+                      const Mat& patch, Size size) {
+    const int targets = runner.options.targets;
+    vector<Rect> planted;
+    const Mat bgr = make_frame(size, targets, patch, planted);
+    const ImageFormat formats[] = { IMG_FORMAT_BGR, IMG_FORMAT_YUV420P, IMG_FORMAT_YUV420SP, IMG_FORMAT_ARGB };
+    for (ImageFormat format : formats) {
+        StreamFrame pristine, work;
+        if (!pristine.allocate(format, size.width, size.height) || bgr_to_image_frame(bgr, &pristine.frame) != ANO_OK) continue;
+        runner.run(std::string("e2e/mem/") + format_name(format) + "/" + size_name(size), size,
+                   [&]() { mem_anonymization(handle, &work.frame, BLUR_TYPE_GAUSSIAN); },
+                   [&]() { work.assign(pristine.frame); });
+    }
+
+    const std::string input = tempDir + "/in_" + size_name(size) + ".jpg";
+    const std::string output = tempDir + "/out_" + size_name(size) + ".jpg";
+    if (imwrite(input, bgr)) {
+        runner.run("e2e/image/jpeg/" + size_name(size), size,
+                   [&]() { image_anonymization(handle, input.c_str(), output.c_str(), BLUR_TYPE_GAUSSIAN); });
+    }
+
+    // 目标逐帧平移的合成视频；帧数固定，吞吐按帧/秒计
+    const std::string video = tempDir + "/in_" + size_name(size) + ".avi";
+    const std::string videoOut = tempDir + "/out_" + size_name(size) + ".avi";
+    const std::string name = "e2e/video/avi/" + size_name(size);
+    if (!runner.enabled(name)) return;
+    VideoWriter writer(video, VideoWriter::fourcc('M', 'J', 'P', 'G'), 25, size, true);
+    if (!writer.isOpened()) {
+        runner.skip(name, "cannot write the synthetic MJPG video");
+        return;
+    }
+    for (int i = 0; i < runner.options.videoFrames; ++i) writer.write(make_frame(size, targets, patch, planted, (i * 4) % 64));
+    writer.release();
+    runner.run(name, size,
+               [&]() { video_anonymization(handle, video.c_str(), videoOut.c_str(), BLUR_TYPE_GAUSSIAN); },
+               std::function<void()>(), runner.options.videoFrames, 1);
+}
+
+void write_json_string(FILE* fp, const std::string& s) {
+    fputc('"', fp);
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') fprintf(fp, "\\%c", c);
+        else if (c < 0x20) fprintf(fp, "\\u%04x", c);
+        else fputc(c, fp);
+    }
+    fputc('"', fp);
+}
+
+// 每个结果单独一行，方便 diff 和 load_baseline 逐行解析
+void write_json(FILE* fp, const BenchRunner& runner) {
+    char host[256] = {0};
+    gethostname(host, sizeof(host) - 1);
+    const time_t now = time(nullptr);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    fprintf(fp, "{\n\"schema\": 1,\n\"sdk_version\": ");
+    write_json_string(fp, get_version());
+    fprintf(fp, ",\n\"compiler\": ");
+    write_json_string(fp, __VERSION__);
+    fprintf(fp, ",\n\"opencv\": ");
+    write_json_string(fp, CV_VERSION);
+    fprintf(fp, ",\n\"host\": ");
+    write_json_string(fp, host);
+    fprintf(fp, ",\n\"timestamp\": \"%s\",\n\"cpu_threads\": %u,\n", stamp, std::thread::hardware_concurrency());
+#ifdef __OPTIMIZE__
+    const bool optimized = true;
+#else
+    const bool optimized = false;
+#endif
+#ifdef ANONYMIZATION_WITH_FFMPEG
+    const bool ffmpeg = true;
+#else
+    const bool ffmpeg = false;
+#endif
+#ifdef ANONYMIZATION_WITH_LIBJPEG
+    const bool libjpeg = true;
+#else
+    const bool libjpeg = false;
+#endif
+    fprintf(fp, "\"build\": {\"optimized\": %s, \"ffmpeg\": %s, \"libjpeg\": %s},\n",
+            optimized ? "true" : "false", ffmpeg ? "true" : "false", libjpeg ? "true" : "false");
+    fprintf(fp, "\"simd\": ");
+    write_json_string(fp, simd_variant_name());
+    fprintf(fp, ",\n");
+    fprintf(fp, "\"min_time_ms\": %.0f,\n\"targets\": %d,\n\"results\": [\n", runner.options.minTimeMs, runner.options.targets);
+    for (size_t i = 0; i < runner.results.size(); ++i) {
+        const BenchResult& r = runner.results[i];
+        fprintf(fp, "{\"name\": ");
+        write_json_string(fp, r.name);
+        fprintf(fp, ", \"group\": ");
+        write_json_string(fp, r.group);
+        fprintf(fp, ", \"width\": %d, \"height\": %d, \"iterations\": %lld, \"items_per_iter\": %.0f, "
+                    "\"mean_us\": %.3f, \"median_us\": %.3f, \"p90_us\": %.3f, \"min_us\": %.3f, \"items_per_sec\": %.3f}%s\n",
+                r.size.width, r.size.height, r.iterations, r.itemsPerIter,
+                r.meanUs, r.medianUs, r.p90Us, r.minUs, r.itemsPerSec, i + 1 < runner.results.size() ? "," : "");
+    }
+    fprintf(fp, "],\n\"skipped\": [\n");
+    for (size_t i = 0; i < runner.skipped.size(); ++i) {
+        fprintf(fp, "{\"name\": ");
+        write_json_string(fp, runner.skipped[i].first);
+        fprintf(fp, ", \"reason\": ");
+        write_json_string(fp, runner.skipped[i].second);
+        fprintf(fp, "}%s\n", i + 1 < runner.skipped.size() ? "," : "");
+    }
+    fprintf(fp, "]\n}\n");
+}
+
+// 读取 write_json 写出的结果：name -> median_us
+bool load_baseline(const std::string& path, std::map<std::string, double>& medians) {
+    FILE* fp = fopen(path.c_str(), "r");
+    if (fp == nullptr) return false;
+    char line[4096];
+    while (fgets(line, sizeof(line), fp) != nullptr) {
+        const char* name = strstr(line, "{\"name\": \"");
+        const char* median = strstr(line, "\"median_us\": ");
+        if (name == nullptr || median == nullptr) continue;
+        name += strlen("{\"name\": \"");
+        const char* end = strchr(name, '"');
+        if (end == nullptr) continue;
+        medians[std::string(name, end)] = atof(median + strlen("\"median_us\": "));
+    }
+    fclose(fp);
+    return true;
+}
+
+// 与基线比较中位数，返回变慢超过阈值的用例数
+int compare_baseline(const BenchRunner& runner, const std::map<std::string, double>& baseline) {
+    int regressions = 0;
+    fprintf(stderr, "\n%-48s %12s %12s %8s\n", "case", "baseline us", "current us", "change");
+    for (const BenchResult& r : runner.results) {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end() || it->second <= 0) continue;
+        const double change = (r.medianUs / it->second - 1) * 100;
+        const bool regressed = change > runner.options.maxRegression;
+        regressions += regressed ? 1 : 0;
+        fprintf(stderr, "%-48s %12.1f %12.1f %+7.1f%%%s\n", r.name.c_str(), it->second, r.medianUs, change, regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+bool parse_sizes(const char* text, std::vector<Size>& sizes) {
+    sizes.clear();
+    std::string s(text);
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        const size_t comma = std::min(s.find(',', pos), s.size());
+        int w = 0, h = 0;
+        if (sscanf(s.substr(pos, comma - pos).c_str(), "%dx%d", &w, &h) != 2 || w < 16 || h < 16) return false;
+        sizes.push_back(Size(w, h));
+        pos = comma + 1;
+    }
+    return !sizes.empty();
+}
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --min-time MS         minimum measuring time per case (default 300)\n"
+            "  --min-iters N         minimum iterations per case (default 5)\n"
+            "  --sizes WxH,...       frame sizes (default 640x480,1280x720,1920x1080,3840x2160)\n"
+            "  --targets N           planted targets per frame (default 8)\n"
+            "  --filter STR          only run cases whose name contains STR\n"
+            "  --models DIR          model directory for end-to-end cases (bestface.onnx); skipped if absent\n"
+            "  --target-image FILE   image pasted as planted targets (e.g. a face crop)\n"
+            "  --video-frames N      frames of the synthetic video (default 90)\n"
+            "  --out FILE            write JSON results to FILE instead of stdout\n"
+            "  --baseline FILE       compare medians with a previous JSON result\n"
+            "  --max-regression PCT  exit with status 1 if a case is slower than baseline by PCT%% (default 10)\n"
+            "  --simd NAME           force kernel variant (scalar, sse4.2, avx2, avx512, neon); default picks by CPU\n"
+            "  --list                list case names and exit\n",
+            argv0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    parse_sizes("640x480,1280x720,1920x1080,3840x2160", options.sizes);
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--min-time" && hasValue) options.minTimeMs = atof(argv[++i]);
+        else if (arg == "--min-iters" && hasValue) options.minIters = std::max(1, atoi(argv[++i]));
+        else if (arg == "--targets" && hasValue) options.targets = std::max(0, atoi(argv[++i]));
+        else if (arg == "--filter" && hasValue) options.filter = argv[++i];
+        else if (arg == "--models" && hasValue) options.modelDir = argv[++i];
+        else if (arg == "--target-image" && hasValue) options.targetImage = argv[++i];
+        else if (arg == "--video-frames" && hasValue) options.videoFrames = std::max(1, atoi(argv[++i]));
+        else if (arg == "--out" && hasValue) options.out = argv[++i];
+        else if (arg == "--baseline" && hasValue) options.baseline = argv[++i];
+        else if (arg == "--max-regression" && hasValue) options.maxRegression = atof(argv[++i]);
+        else if (arg == "--simd" && hasValue) options.simd = argv[++i];
+        else if (arg == "--list") options.list = true;
+        else if (arg == "--sizes" && hasValue) {
+            if (!parse_sizes(argv[++i], options.sizes)) {
+                fprintf(stderr, "Invalid --sizes value: %s\n", argv[i]);
+                return 2;
+            }
+        } else {
+            usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 2;
+        }
+    }
+    log_set_level(LOG_WARN);
+    if (!options.simd.empty() && !simd_force_variant(options.simd.c_str())) {
+        fprintf(stderr, "Kernel variant %s is unknown or not supported by this CPU\n", options.simd.c_str());
+        return 2;
+    }
+
+    Mat patch;
+    if (!options.targetImage.empty()) {
+        patch = imread(options.targetImage, IMREAD_COLOR);
+        if (patch.empty()) {
+            fprintf(stderr, "Failed to read --target-image %s\n", options.targetImage.c_str());
+            return 2;
+        }
+    }
+
+    BenchRunner runner(options);
+    // 微基准不需要模型文件：阈值与 init 相同，网络输出用合成数据
+    YOLOv8_face model;
+    YOLOv8FaceBench bench(model);
+    bench.set_thresholds(0.45f, 0.5f);
+    for (Size size : options.sizes) {
+        vector<Rect> planted;
+        const Mat bgr = make_frame(size, options.targets, patch, planted);
+        bench_convert(runner, bgr, size);
+        bench_kernels(runner, bgr, size);
+        bench_letterbox(runner, bench, bgr, size);
+        bench_postprocess(runner, bench, bgr, planted, size);
+        bench_redact(runner, model, bgr, planted, size);
+    }
+
+    AnonymizationHandle handle = nullptr;
+    char tempDir[] = "/tmp/anonymization_bench.XXXXXX";
+    if (options.modelDir.empty() || options.list) {
+        for (Size size : options.sizes) runner.skip("e2e/" + size_name(size), "no --models directory");
+    } else if (init(options.modelDir.c_str(), RECOGNIZE_FACE, &handle) != ANO_OK) {
+        fprintf(stderr, "Failed to load models from %s\n", options.modelDir.c_str());
+        return 2;
+    } else if (mkdtemp(tempDir) == nullptr) {
+        fprintf(stderr, "Failed to create a temporary directory\n");
+        uninit(handle);
+        return 2;
+    } else {
+        for (Size size : options.sizes) bench_end_to_end(runner, handle, tempDir, patch, size);
+        uninit(handle);
+        const std::string cleanup = std::string("rm -rf '") + tempDir + "'";
+        if (system(cleanup.c_str()) != 0) fprintf(stderr, "Failed to remove %s\n", tempDir);
+    }
+    if (options.list) return 0;
+
+    FILE* fp = options.out.empty() ? stdout : fopen(options.out.c_str(), "w");
+    if (fp == nullptr) {
+        fprintf(stderr, "Failed to open %s\n", options.out.c_str());
+        return 2;
+    }
+    write_json(fp, runner);
+    if (fp != stdout) fclose(fp);
+
+    if (!options.baseline.empty()) {
+        std::map<std::string, double> baseline;
+        if (!load_baseline(options.baseline, baseline)) {
+            fprintf(stderr, "Failed to read baseline %s\n", options.baseline.c_str());
+            return 2;
+        }
+        const int regressions = compare_baseline(runner, baseline);
+        if (regressions > 0) {
+            fprintf(stderr, "%d case(s) regressed by more than %.1f%%\n", regressions, options.maxRegression);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,685 @@
+// 命令行批处理工具：按清单并行处理大量图片、视频，重跑时跳过已完成的输出，结束时输出 JSON 汇总
+// 用法见 ./anonymization_batch --help
+#include "Anonymization.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const char* const kImagePatterns = "*.jpg;*.jpeg;*.png;*.bmp;*.webp;*.tif;*.tiff";
+const char* const kVideoPatterns = "*.mp4;*.avi;*.mov;*.mkv;*.flv;*.wmv;*.mpg;*.mpeg;*.3gp";
+
+volatile int32_t g_cancel = 0;       // SIGINT/SIGTERM 置位：不再领取新任务，进行中的视频在当前帧处停止；只通过原子操作读写
+
+bool cancel_requested() {
+    return __atomic_load_n(&g_cancel, __ATOMIC_ACQUIRE) != 0;
+}
+
+struct CliOptions {
+    std::string modelDir;
+    std::string manifest;                // 清单文件，"-" 表示标准输入
+    std::string input;                   // 不用清单时的单个作业
+    std::string output;
+    RecognizeType recognizeType = RECOGNIZE_FACE;   // 清单中未指定时的默认值
+    BlurType blurType = BLUR_TYPE_GAUSSIAN;
+    int workers = 0;                     // 同时执行的任务数
+    int taskThreads = 0;                 // 每个图片任务的解码/编码线程数
+    int chunk = 256;                     // 每个图片任务的文件数
+    int jpegQuality = 0;
+    int checkpointSec = 0;               // >0 时视频按该间隔落检查点，中断后重跑从检查点续跑
+    bool force = false;                  // 不跳过已存在的输出
+    std::string summary;                 // JSON 汇总文件，为空时写 stdout
+    std::string logPath;
+    LOG_LEVEL logLevel = LOG_WARN;
+};
+
+// 清单中的一个作业：一个文件或一个目录
+struct Job {
+    int index = 0;
+    int line = 0;
+    std::string input;
+    std::string output;
+    RecognizeType recognizeType = RECOGNIZE_FACE;
+    BlurType blurType = BLUR_TYPE_GAUSSIAN;
+    std::string patterns;                // 目录作业的文件名通配符，为空时匹配所有支持的图片和视频
+    bool recursive = false;
+    std::string error;                   // 作业本身无法展开时的原因
+
+    int files = 0;
+    int completed = 0;
+    int skipped = 0;
+    int failed = 0;
+    long long boxes = 0;                 // 图片中检测到的目标数（视频接口不返回目标数）
+    double startSec = -1;                // 第一个任务开始、最后一个任务结束的时刻（相对程序启动）
+    double endSec = 0;
+    double busySec = 0;                  // 各任务耗时之和
+};
+
+struct FileItem {
+    std::string input;
+    std::string output;
+    long long bytes = 0;
+};
+
+// 工作线程领取的单位：一个视频，或同一作业中的一组图片
+struct Task {
+    Job* job = nullptr;
+    bool video = false;
+    std::vector<FileItem> files;
+};
+
+struct Failure {
+    int job = 0;
+    std::string input;
+    std::string output;
+    int code = 0;
+};
+
+const char* recognize_type_name(RecognizeType type) {
+    switch (type) {
+        case RECOGNIZE_FACE: return "face";
+        case RECOGNIZE_LICENSE_PLATE: return "plate";
+        case RECOGNIZE_ALL: return "all";
+    }
+    return "unknown";
+}
+
+bool parse_recognize_type(const std::string& name, RecognizeType& type) {
+    if (name == "face") type = RECOGNIZE_FACE;
+    else if (name == "plate") type = RECOGNIZE_LICENSE_PLATE;
+    else if (name == "all") type = RECOGNIZE_ALL;
+    else return false;
+    return true;
+}
+
+const char* blur_type_name(BlurType type) {
+    switch (type) {
+        case BLUR_TYPE_NONE: return "none";
+        case BLUR_TYPE_RECTANGLE: return "rectangle";
+        case BLUR_TYPE_GAUSSIAN: return "gaussian";
+        case BLUR_TYPE_MOSAIC: return "mosaic";
+    }
+    return "unknown";
+}
+
+bool parse_blur_type(const std::string& name, BlurType& type) {
+    if (name == "none") type = BLUR_TYPE_NONE;
+    else if (name == "rectangle") type = BLUR_TYPE_RECTANGLE;
+    else if (name == "gaussian") type = BLUR_TYPE_GAUSSIAN;
+    else if (name == "mosaic") type = BLUR_TYPE_MOSAIC;
+    else return false;
+    return true;
+}
+
+bool match_patterns(const std::string& name, const std::string& patterns) {
+    for (size_t pos = 0; pos <= patterns.size();) {
+        const size_t end = std::min(patterns.find(';', pos), patterns.size());
+        const std::string pattern = patterns.substr(pos, end - pos);
+        if (!pattern.empty() && fnmatch(pattern.c_str(), name.c_str(), FNM_CASEFOLD) == 0) return true;
+        pos = end + 1;
+    }
+    return false;
+}
+
+bool is_video(const std::string& path) {
+    const size_t slash = path.rfind('/');
+    return match_patterns(slash == std::string::npos ? path : path.substr(slash + 1), kVideoPatterns);
+}
+
+std::string dirname_of(const std::string& path) {
+    const size_t slash = path.rfind('/');
+    if (slash == std::string::npos) return ".";
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+std::string basename_of(const std::string& path) {
+    const size_t slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+bool is_directory(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool make_dirs(const std::string& path) {
+    if (path.empty() || is_directory(path)) return true;
+    if (!make_dirs(dirname_of(path))) return false;
+    return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+// 处理结果先写到同目录下的临时文件，成功后再改名，输出文件存在即表示已完整写出
+std::string temp_path(const std::string& output) {
+    const size_t slash = output.rfind('/');
+    return slash == std::string::npos ? ".~" + output : output.substr(0, slash + 1) + ".~" + output.substr(slash + 1);
+}
+
+bool output_completed(const std::string& output) {
+    struct stat st;
+    return stat(output.c_str(), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0;
+}
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::string json_escape(const std::string& text) {
+    std::string escaped;
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            escaped += buf;
+        } else {
+            escaped += static_cast<char>(c);
+        }
+    }
+    return escaped;
+}
+
+/*
+ * 清单格式：每行一个作业，'#' 开头为注释。含制表符的行按制表符分列，否则按空白分列：
+ *   输入 输出 [type=face|plate|all] [blur=none|rectangle|gaussian|mosaic] [pattern=*.jpg;*.mp4] [recursive=1]
+ * 输入为目录时输出也是目录，保持相对路径；输入为文件时输出可以是文件，也可以是已存在的目录或以 '/' 结尾
+ */
+bool parse_manifest(std::istream& in, const CliOptions& options, std::vector<Job>& jobs, std::string& error) {
+    std::string line;
+    for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        const size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[first] == '#') continue;
+
+        std::vector<std::string> fields;
+        if (line.find('\t') != std::string::npos) {
+            std::stringstream ss(line.substr(first));
+            for (std::string field; std::getline(ss, field, '\t');) {
+                if (!field.empty()) fields.push_back(field);
+            }
+        } else {
+            std::stringstream ss(line);
+            for (std::string field; ss >> field;) fields.push_back(field);
+        }
+        if (fields.size() < 2) {
+            error = "line " + std::to_string(lineNo) + ": expected an input and an output";
+            return false;
+        }
+
+        Job job;
+        job.index = static_cast<int>(jobs.size()) + 1;
+        job.line = lineNo;
+        job.input = fields[0];
+        job.output = fields[1];
+        job.recognizeType = options.recognizeType;
+        job.blurType = options.blurType;
+        for (size_t i = 2; i < fields.size(); ++i) {
+            const size_t eq = fields[i].find('=');
+            const std::string key = fields[i].substr(0, eq);
+            const std::string value = eq == std::string::npos ? std::string() : fields[i].substr(eq + 1);
+            bool ok = eq != std::string::npos;
+            if (key == "type") ok = ok && parse_recognize_type(value, job.recognizeType);
+            else if (key == "blur") ok = ok && parse_blur_type(value, job.blurType);
+            else if (key == "pattern") job.patterns = value;
+            else if (key == "recursive") job.recursive = value == "1" || value == "true";
+            else ok = false;
+            if (!ok) {
+                error = "line " + std::to_string(lineNo) + ": invalid field '" + fields[i] + "'";
+                return false;
+            }
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+void list_directory(const std::string& dir, const std::string& relative, const Job& job, std::vector<FileItem>& items) {
+    DIR* d = opendir(dir.c_str());
+    if (d == nullptr) return;
+    std::vector<std::string> names;
+    for (struct dirent* entry = readdir(d); entry != nullptr; entry = readdir(d)) {
+        if (entry->d_name[0] != '.') names.push_back(entry->d_name);   // 同时跳过本工具的临时文件
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+
+    const std::string patterns = job.patterns.empty() ? std::string(kImagePatterns) + ";" + kVideoPatterns : job.patterns;
+    for (const std::string& name : names) {
+        const std::string path = dir + "/" + name;
+        const std::string rel = relative.empty() ? name : relative + "/" + name;
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            if (job.recursive) list_directory(path, rel, job, items);
+        } else if (S_ISREG(st.st_mode) && match_patterns(name, patterns)) {
+            FileItem item;
+            item.input = path;
+            item.output = job.output + "/" + rel;
+            item.bytes = static_cast<long long>(st.st_size);
+            items.push_back(item);
+        }
+    }
+}
+
+void expand_job(Job& job, std::vector<FileItem>& items) {
+    struct stat st;
+    if (stat(job.input.c_str(), &st) != 0) {
+        job.error = "input not found";
+        return;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        list_directory(job.input, std::string(), job, items);
+        return;
+    }
+    FileItem item;
+    item.input = job.input;
+    item.output = job.output;
+    if (job.output.back() == '/' || is_directory(job.output)) {
+        item.output = (job.output.back() == '/' ? job.output : job.output + "/") + basename_of(job.input);
+    }
+    item.bytes = static_cast<long long>(st.st_size);
+    items.push_back(item);
+}
+
+// 按识别类型复用已初始化的句柄：任务结束归还，下一个同类型任务直接取用，不重复加载模型
+class HandlePool
+{
+public:
+    explicit HandlePool(const std::string& modelDir) : modelDir(modelDir) {}
+
+    ~HandlePool() {
+        for (auto& entry : this->idle) {
+            for (AnonymizationHandle handle : entry.second) uninit(handle);
+        }
+    }
+
+    int acquire(RecognizeType type, AnonymizationHandle& handle) {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            std::vector<AnonymizationHandle>& handles = this->idle[type];
+            if (!handles.empty()) {
+                handle = handles.back();
+                handles.pop_back();
+                return ANO_OK;
+            }
+        }
+        return init(this->modelDir.c_str(), type, &handle);
+    }
+
+    void release(RecognizeType type, AnonymizationHandle handle) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->idle[type].push_back(handle);
+    }
+
+private:
+    std::string modelDir;
+    std::mutex mutex;
+    std::map<int, std::vector<AnonymizationHandle>> idle;
+};
+
+class BatchRunner
+{
+public:
+    BatchRunner(const CliOptions& options, std::vector<Job>& jobs)
+        : options(options), jobs(jobs), pool(options.modelDir), start(Clock::now()) {}
+
+    void plan() {
+        std::vector<Task> videos, images;
+        for (Job& job : this->jobs) {
+            std::vector<FileItem> items;
+            expand_job(job, items);
+            if (!job.error.empty()) {
+                std::cerr << "[WARN] job " << job.index << " (line " << job.line << "): " << job.error << ": " << job.input << std::endl;
+                continue;
+            }
+            job.files = static_cast<int>(items.size());
+
+            Task imageTask;
+            imageTask.job = &job;
+            for (FileItem& item : items) {
+                if (item.input == item.output) {
+                    this->record_failure(job, item, INVALID_PARAMETER);
+                } else if (!this->options.force && output_completed(item.output)) {
+                    ++job.skipped;
+                } else if (is_video(item.input)) {
+                    Task task;
+                    task.job = &job;
+                    task.video = true;
+                    task.files.push_back(item);
+                    videos.push_back(task);
+                } else {
+                    imageTask.files.push_back(item);
+                    if (static_cast<int>(imageTask.files.size()) == this->options.chunk) {
+                        images.push_back(imageTask);
+                        imageTask.files.clear();
+                    }
+                }
+            }
+            if (!imageTask.files.empty()) images.push_back(imageTask);
+        }
+        // 最长的任务先开始，避免最后只剩一个长视频在跑
+        std::stable_sort(videos.begin(), videos.end(), [](const Task& a, const Task& b) {
+            return a.files[0].bytes > b.files[0].bytes;
+        });
+        this->tasks = videos;
+        this->tasks.insert(this->tasks.end(), images.begin(), images.end());
+        for (const Task& task : this->tasks) this->pendingFiles += static_cast<int>(task.files.size());
+    }
+
+    void run() {
+        fprintf(stderr, "%zu jobs, %d files to process in %zu tasks, %d workers\n", this->jobs.size(), this->pendingFiles, this->tasks.size(), this->options.workers);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < this->options.workers; ++i) {
+            threads.emplace_back([this]() {
+                for (size_t index = this->next++; index < this->tasks.size() && !cancel_requested(); index = this->next++) {
+                    this->run_task(this->tasks[index]);
+                }
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+        this->elapsedSec = seconds_since(this->start);
+    }
+
+    bool write_summary() const {
+        FILE* fp = this->options.summary.empty() ? stdout : fopen(this->options.summary.c_str(), "w");
+        if (!fp) {
+            std::cerr << "[ERROR] Failed to write " << this->options.summary << std::endl;
+            return false;
+        }
+        int files = 0, completed = 0, skipped = 0, failed = 0;
+        long long boxes = 0;
+        for (const Job& job : this->jobs) {
+            files += job.files;
+            completed += job.completed;
+            skipped += job.skipped;
+            failed += job.failed;
+            boxes += job.boxes;
+        }
+        fprintf(fp, "{\n\"sdk_version\": \"%s\",\n\"workers\": %d,\n\"task_threads\": %d,\n\"chunk\": %d,\n\"interrupted\": %s,\n\"elapsed_sec\": %.3f,\n",
+                get_version(), this->options.workers, this->options.taskThreads, this->options.chunk, cancel_requested() ? "true" : "false", this->elapsedSec);
+        fprintf(fp, "\"totals\": {\"files\": %d, \"completed\": %d, \"skipped\": %d, \"failed\": %d, \"pending\": %d, \"boxes\": %lld},\n",
+                files, completed, skipped, failed, files - completed - skipped - failed, boxes);
+        fprintf(fp, "\"jobs\": [\n");
+        for (size_t i = 0; i < this->jobs.size(); ++i) {
+            const Job& job = this->jobs[i];
+            const double elapsed = job.startSec >= 0 ? job.endSec - job.startSec : 0;
+            fprintf(fp, "{\"index\": %d, \"line\": %d, \"input\": \"%s\", \"output\": \"%s\", \"recognize_type\": \"%s\", \"blur\": \"%s\", "
+                        "\"files\": %d, \"completed\": %d, \"skipped\": %d, \"failed\": %d, \"pending\": %d, \"boxes\": %lld, "
+                        "\"start_sec\": %.3f, \"elapsed_sec\": %.3f, \"busy_sec\": %.3f, \"files_per_sec\": %.2f, \"error\": \"%s\"}%s\n",
+                    job.index, job.line, json_escape(job.input).c_str(), json_escape(job.output).c_str(),
+                    recognize_type_name(job.recognizeType), blur_type_name(job.blurType),
+                    job.files, job.completed, job.skipped, job.failed, job.files - job.completed - job.skipped - job.failed, job.boxes,
+                    std::max(0.0, job.startSec), elapsed, job.busySec, elapsed > 0 ? job.completed / elapsed : 0,
+                    json_escape(job.error).c_str(), i + 1 < this->jobs.size() ? "," : "");
+        }
+        fprintf(fp, "],\n\"failures\": [\n");
+        for (size_t i = 0; i < this->failures.size(); ++i) {
+            const Failure& f = this->failures[i];
+            fprintf(fp, "{\"job\": %d, \"input\": \"%s\", \"output\": \"%s\", \"error\": %d}%s\n", f.job,
+                    json_escape(f.input).c_str(), json_escape(f.output).c_str(), f.code, i + 1 < this->failures.size() ? "," : "");
+        }
+        fprintf(fp, "]\n}\n");
+        if (fp != stdout) fclose(fp);
+        return true;
+    }
+
+    bool all_succeeded() const {
+        if (cancel_requested()) return false;
+        for (const Job& job : this->jobs) {
+            if (!job.error.empty() || job.failed > 0) return false;
+        }
+        return true;
+    }
+
+private:
+    void record_failure(Job& job, const FileItem& item, int code) {
+        ++job.failed;
+        Failure failure;
+        failure.job = job.index;
+        failure.input = item.input;
+        failure.output = item.output;
+        failure.code = code;
+        this->failures.push_back(failure);
+    }
+
+    void run_task(Task& task) {
+        Job& job = *task.job;
+        const double taskStart = seconds_since(this->start);
+        std::vector<int> codes(task.files.size(), ANO_OK);
+        std::vector<int> boxes(task.files.size(), 0);
+
+        for (const FileItem& item : task.files) {
+            if (!make_dirs(dirname_of(item.output))) {
+                std::cerr << "[ERROR] Cannot create the output directory for " << item.output << ": " << strerror(errno) << std::endl;
+            }
+        }
+
+        AnonymizationHandle handle = nullptr;
+        const int ret = this->pool.acquire(job.recognizeType, handle);
+        if (ret != ANO_OK) {
+            std::fill(codes.begin(), codes.end(), ret);
+        } else {
+            if (task.video) codes[0] = this->run_video(handle, job, task.files[0]);
+            else this->run_images(handle, job, task.files, codes, boxes);
+            this->pool.release(job.recognizeType, handle);
+        }
+
+        const double taskEnd = seconds_since(this->start);
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (job.startSec < 0 || taskStart < job.startSec) job.startSec = taskStart;
+        job.endSec = std::max(job.endSec, taskEnd);
+        job.busySec += taskEnd - taskStart;
+        int ok = 0;
+        for (size_t i = 0; i < task.files.size(); ++i) {
+            if (codes[i] == ANO_OK) {
+                ++job.completed;
+                job.boxes += boxes[i];
+                ++ok;
+            } else if (codes[i] != OPERATION_CANCELLED) {
+                this->record_failure(job, task.files[i], codes[i]);
+            }
+        }
+        this->doneFiles += static_cast<int>(task.files.size());
+        // 进度写 stderr，stdout 留给 JSON 汇总
+        fprintf(stderr, "[%d/%d] job %d: %s %d/%zu ok in %.1f s\n", this->doneFiles, this->pendingFiles, job.index,
+               task.video ? basename_of(task.files[0].input).c_str() : "images", ok, task.files.size(), taskEnd - taskStart);
+    }
+
+    int run_video(AnonymizationHandle handle, const Job& job, const FileItem& item) {
+        const std::string temp = temp_path(item.output);
+        const std::string checkpoint = temp + ".ckpt";
+        VideoOptions vopts;
+        init_video_options(&vopts);
+        vopts.checkpointIntervalSec = this->options.checkpointSec;
+        vopts.cancelFlag = &g_cancel;
+
+        int ret;
+        if (this->options.checkpointSec > 0 && access(checkpoint.c_str(), F_OK) == 0) {
+            ret = video_anonymization_resume(handle, item.input.c_str(), temp.c_str(), job.blurType, &vopts);
+        } else {
+            ret = video_anonymization_ex(handle, item.input.c_str(), temp.c_str(), job.blurType, &vopts);
+        }
+        if (ret == ANO_OK) {
+            if (rename(temp.c_str(), item.output.c_str()) != 0) ret = SAVE_VIDEO_ERROR;
+            unlink(checkpoint.c_str());
+        } else if (ret != OPERATION_CANCELLED || this->options.checkpointSec <= 0) {
+            // 取消且有检查点时保留临时输出，下次运行续跑
+            unlink(temp.c_str());
+            unlink(checkpoint.c_str());
+        }
+        return ret;
+    }
+
+    void run_images(AnonymizationHandle handle, const Job& job, const std::vector<FileItem>& files, std::vector<int>& codes, std::vector<int>& boxes) {
+        std::vector<std::string> temps;
+        std::vector<const char*> inputs, outputs;
+        for (const FileItem& item : files) temps.push_back(temp_path(item.output));
+        for (size_t i = 0; i < files.size(); ++i) {
+            inputs.push_back(files[i].input.c_str());
+            outputs.push_back(temps[i].c_str());
+        }
+
+        // 检测实例由批量接口从句柄复制，任务内一个检测线程，解码/编码用 taskThreads 个线程
+        BatchOptions bopts;
+        init_batch_options(&bopts);
+        bopts.blurType = job.blurType;
+        bopts.workers = this->options.taskThreads;
+        bopts.detectors = 1;
+        bopts.jpegQuality = this->options.jpegQuality;
+        std::vector<BatchFileResult> results(files.size());
+        const int ret = batch_image_anonymization(handle, inputs.data(), outputs.data(), static_cast<int32_t>(files.size()),
+                                                  &bopts, results.data(), nullptr);
+        for (size_t i = 0; i < files.size(); ++i) {
+            codes[i] = ret != ANO_OK ? ret : results[i].result;
+            if (codes[i] == ANO_OK) {
+                boxes[i] = results[i].boxCount;
+                if (rename(temps[i].c_str(), files[i].output.c_str()) != 0) codes[i] = SAVE_IMAGE_ERROR;
+            } else {
+                unlink(temps[i].c_str());
+            }
+        }
+    }
+
+    const CliOptions& options;
+    std::vector<Job>& jobs;
+    HandlePool pool;
+    Clock::time_point start;
+    std::vector<Task> tasks;
+    std::atomic<size_t> next{0};
+    std::mutex mutex;                    // 保护作业统计、失败列表和进度
+    std::vector<Failure> failures;
+    int pendingFiles = 0;
+    int doneFiles = 0;
+    double elapsedSec = 0;
+};
+
+void on_signal(int) {
+    __atomic_store_n(&g_cancel, 1, __ATOMIC_RELEASE);
+}
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " --models DIR (--manifest FILE | --input PATH --output PATH) [options]\n"
+              << "  --models DIR            model directory\n"
+              << "  --manifest FILE         job manifest, one job per line (- reads stdin):\n"
+              << "                            INPUT OUTPUT [type=face|plate|all] [blur=none|rectangle|gaussian|mosaic]\n"
+              << "                                         [pattern=*.jpg;*.mp4] [recursive=1]\n"
+              << "  --input PATH            single job input file or directory (instead of --manifest)\n"
+              << "  --output PATH           single job output file or directory\n"
+              << "  --type NAME             default recognize type: face|plate|all (default face)\n"
+              << "  --blur NAME             default blur type: none|rectangle|gaussian|mosaic (default gaussian)\n"
+              << "  --workers N             tasks run concurrently (default core count / 4, at least 1)\n"
+              << "  --task-threads N        decode/encode threads per image task (default core count / workers)\n"
+              << "  --chunk N               images per task (default 256)\n"
+              << "  --jpeg-quality Q        output JPEG quality 1-100 (default SDK default)\n"
+              << "  --checkpoint-sec SEC    checkpoint videos every SEC seconds and resume them on rerun\n"
+              << "  --force                 reprocess files whose output already exists\n"
+              << "  --summary FILE          write the JSON summary to FILE instead of stdout\n"
+              << "  --log FILE              SDK log file (default stderr)\n"
+              << "  --log-level N           0 TRACE ... 5 FATAL (default 3 WARN)\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    CliOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--models" && hasValue) options.modelDir = argv[++i];
+        else if (arg == "--manifest" && hasValue) options.manifest = argv[++i];
+        else if (arg == "--input" && hasValue) options.input = argv[++i];
+        else if (arg == "--output" && hasValue) options.output = argv[++i];
+        else if (arg == "--workers" && hasValue) options.workers = std::max(1, atoi(argv[++i]));
+        else if (arg == "--task-threads" && hasValue) options.taskThreads = std::max(1, atoi(argv[++i]));
+        else if (arg == "--chunk" && hasValue) options.chunk = std::max(1, atoi(argv[++i]));
+        else if (arg == "--jpeg-quality" && hasValue) options.jpegQuality = std::min(100, std::max(0, atoi(argv[++i])));
+        else if (arg == "--checkpoint-sec" && hasValue) options.checkpointSec = std::max(0, atoi(argv[++i]));
+        else if (arg == "--force") options.force = true;
+        else if (arg == "--summary" && hasValue) options.summary = argv[++i];
+        else if (arg == "--log" && hasValue) options.logPath = argv[++i];
+        else if (arg == "--log-level" && hasValue) options.logLevel = static_cast<LOG_LEVEL>(std::min(5, std::max(0, atoi(argv[++i]))));
+        else if (arg == "--type" && hasValue) {
+            if (!parse_recognize_type(argv[++i], options.recognizeType)) {
+                std::cerr << "Unknown recognize type: " << argv[i] << std::endl;
+                return 2;
+            }
+        } else if (arg == "--blur" && hasValue) {
+            if (!parse_blur_type(argv[++i], options.blurType)) {
+                std::cerr << "Unknown blur type: " << argv[i] << std::endl;
+                return 2;
+            }
+        } else {
+            usage(argv[0]);
+            return arg == "--help" ? 0 : 2;
+        }
+    }
+    if (options.modelDir.empty() || options.manifest.empty() == (options.input.empty() || options.output.empty())) {
+        usage(argv[0]);
+        return 2;
+    }
+    const int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    if (options.workers <= 0) options.workers = std::max(1, cores / 4);
+    if (options.taskThreads <= 0) options.taskThreads = std::max(1, cores / options.workers);
+
+    std::vector<Job> jobs;
+    std::string error;
+    if (!options.manifest.empty()) {
+        std::ifstream file;
+        if (options.manifest != "-") {
+            file.open(options.manifest);
+            if (!file) {
+                std::cerr << "[ERROR] Cannot open manifest " << options.manifest << std::endl;
+                return 2;
+            }
+        }
+        if (!parse_manifest(options.manifest == "-" ? std::cin : file, options, jobs, error)) {
+            std::cerr << "[ERROR] " << options.manifest << ": " << error << std::endl;
+            return 2;
+        }
+    } else {
+        Job job;
+        job.index = 1;
+        job.input = options.input;
+        job.output = options.output;
+        job.recognizeType = options.recognizeType;
+        job.blurType = options.blurType;
+        job.recursive = true;
+        jobs.push_back(job);
+    }
+
+    set_log_filelevel(options.logPath.c_str(), options.logLevel);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    int ret;
+    {
+        BatchRunner runner(options, jobs);
+        runner.plan();
+        runner.run();
+        ret = runner.write_summary() && runner.all_succeeded() ? 0 : 1;
+    }
+    return ret;
+}
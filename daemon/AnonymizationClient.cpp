@@ -0,0 +1,399 @@
+// libAnonymizationClient.so：实现 Anonymization.h 中的核心接口，任务通过 Unix 域套接字交给 anonymizationd，
+// 帧数据放在每个句柄自己的共享内存环（memfd）中，守护进程映射同一块内存原地处理
+#include "AnonymizationClient.h"
+#include "DaemonProtocol.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static FILE *g_log_file = nullptr;
+
+namespace {
+
+const uint32_t kContextMagic = 0x434c4e54;   // "CLNT"
+const size_t kRingAlign = 64;
+
+/**
+ * @brief 共享内存环上的先进先出分配器：从 head 依次分配，释放时只做标记，
+ * tail 处连续已释放的块才真正回收；环尾放不下时用一个填充块跳回开头
+ */
+class RingAllocator
+{
+public:
+    void reset(uint8_t* base, size_t capacity) {
+        this->base = base;
+        this->capacity = capacity;
+        this->head = this->tail = 0;
+    }
+
+    void* alloc(size_t size) {
+        const size_t total = align(size) + kRingAlign;
+        if (size == 0 || total > this->capacity) return nullptr;
+        size_t pos = this->head % this->capacity;
+        if (pos + total > this->capacity) {
+            const size_t padding = this->capacity - pos;
+            if (this->used() + padding + total > this->capacity) return nullptr;
+            this->write_block(pos, padding, true);
+            this->head += padding;
+            pos = 0;
+        }
+        if (this->used() + total > this->capacity) return nullptr;
+        this->write_block(pos, total, false);
+        this->head += total;
+        return this->base + pos + kRingAlign;
+    }
+
+    void free(void* ptr) {
+        Block* block = reinterpret_cast<Block*>(static_cast<uint8_t*>(ptr) - kRingAlign);
+        block->freed = 1;
+        while (this->tail < this->head) {
+            const Block* first = reinterpret_cast<const Block*>(this->base + this->tail % this->capacity);
+            if (!first->freed) break;
+            this->tail += first->size;
+        }
+    }
+
+    bool contains(const void* ptr, size_t size) const {
+        const uint8_t* p = static_cast<const uint8_t*>(ptr);
+        return p >= this->base && p <= this->base + this->capacity && size <= static_cast<size_t>(this->base + this->capacity - p);
+    }
+
+    uint64_t offset_of(const void* ptr) const {
+        return static_cast<uint64_t>(static_cast<const uint8_t*>(ptr) - this->base);
+    }
+
+private:
+    struct Block {
+        uint64_t size;      // 含块头的总字节数
+        uint32_t freed;
+    };
+
+    static size_t align(size_t size) { return (size + kRingAlign - 1) & ~(kRingAlign - 1); }
+    size_t used() const { return static_cast<size_t>(this->head - this->tail); }
+
+    void write_block(size_t pos, size_t size, bool freed) {
+        Block* block = reinterpret_cast<Block*>(this->base + pos);
+        block->size = size;
+        block->freed = freed ? 1 : 0;
+    }
+
+    uint8_t* base = nullptr;
+    size_t capacity = 0;
+    uint64_t head = 0;      // 单调递增，取模得到位置
+    uint64_t tail = 0;
+};
+
+} // namespace
+
+// 客户端句柄：一条到守护进程的连接和一块共享内存环
+struct AnonymizationContext {
+    uint32_t magic = kContextMagic;
+    int fd = -1;
+    uint8_t* ring = nullptr;
+    size_t ringSize = 0;
+    std::mutex mutex;        // 同一句柄上的请求按顺序收发
+    RingAllocator allocator;
+};
+
+namespace {
+
+bool isValidHandle(AnonymizationHandle handle) {
+    if (handle == nullptr || handle->magic != kContextMagic) {
+        log_error("Invalid handle: handle is NULL or not a client handle.");
+        return false;
+    }
+    return true;
+}
+
+void close_context(AnonymizationContext* context) {
+    if (context->fd >= 0) close(context->fd);
+    if (context->ring != nullptr) munmap(context->ring, context->ringSize);
+    context->magic = 0;
+    delete context;
+}
+
+// 发送请求（可附带路径）并等待应答；连接断开时返回 DAEMON_UNAVAILABLE
+int round_trip(AnonymizationContext* context, const DaemonRequest& request, const std::string& paths) {
+    if (!daemon_send_all(context->fd, &request, sizeof(request))
+        || (!paths.empty() && !daemon_send_all(context->fd, paths.data(), paths.size()))) {
+        log_error("client: Lost connection to anonymizationd while sending.");
+        return DAEMON_UNAVAILABLE;
+    }
+    DaemonResponse response;
+    if (!daemon_recv_all(context->fd, &response, sizeof(response)) || response.magic != kDaemonMagic) {
+        log_error("client: Lost connection to anonymizationd while waiting for the result.");
+        return DAEMON_UNAVAILABLE;
+    }
+    return response.status;
+}
+
+// 守护进程的工作目录与调用者不同，相对路径按调用者的当前目录补全
+std::string absolute_path(const char* path) {
+    if (path[0] == '/') return path;
+    char cwd[4096];
+    if (getcwd(cwd, sizeof(cwd)) == nullptr) return path;
+    return std::string(cwd) + "/" + path;
+}
+
+int file_request(AnonymizationHandle handle, uint32_t op, const char* inputFile, const char* outputFile, BlurType blurType) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    if (inputFile == nullptr || outputFile == nullptr || inputFile[0] == '\0' || outputFile[0] == '\0') {
+        log_error("client: inputFile or outputFile is NULL or empty.");
+        return INVALID_PARAMETER;
+    }
+    std::string paths = absolute_path(inputFile);
+    paths.push_back('\0');
+    paths += absolute_path(outputFile);
+    paths.push_back('\0');
+    if (paths.size() > kDaemonMaxPathBytes) {
+        log_error("client: Paths are too long.");
+        return INVALID_PARAMETER;
+    }
+    DaemonRequest request;
+    memset(&request, 0, sizeof(request));
+    request.magic = kDaemonMagic;
+    request.op = op;
+    request.blurType = blurType;
+    request.pathBytes = static_cast<uint32_t>(paths.size());
+    std::lock_guard<std::mutex> lock(handle->mutex);
+    return round_trip(handle, request, paths);
+}
+
+} // namespace
+
+Anonymization_API const char* get_version() {
+    return "v1.1.0";
+}
+
+Anonymization_API int set_log_filelevel(IN const char* logPath, IN LOG_LEVEL logLevel) {
+    if (g_log_file) {
+        log_set_fp(stderr);
+        fclose(g_log_file);
+        g_log_file = nullptr;
+    }
+    log_set_level(logLevel);
+    if (logPath == nullptr || logPath[0] == '\0') {
+        log_set_fp(stderr);
+        return ANO_OK;
+    }
+    g_log_file = fopen(logPath, "a");
+    if (!g_log_file) {
+        log_set_fp(stderr);
+        log_error("Failed to open log file at path: %s. Logging to stderr.", logPath);
+        return LOAD_LOG_ERROR;
+    }
+    log_set_fp(g_log_file);
+    return ANO_OK;
+}
+
+Anonymization_API int set_log_stderr(IN bool enable) {
+    log_set_stderr(enable ? 1 : 0);
+    return ANO_OK;
+}
+
+Anonymization_API int init(IN const char* modelPathDir, IN RecognizeType recognizeType, OUT AnonymizationHandle *handle) {
+    if (handle == nullptr) {
+        log_error("init: Invalid parameter (handle is NULL).");
+        return INVALID_PARAMETER;
+    }
+    *handle = nullptr;
+    // 模型由守护进程加载，modelPathDir 仅为与 SDK 接口保持一致
+    (void)modelPathDir;
+
+    const char* socketEnv = getenv("ANONYMIZATION_DAEMON_SOCKET");
+    const std::string socketName = socketEnv != nullptr && socketEnv[0] != '\0' ? socketEnv : daemon_default_socket();
+    const char* socketPath = socketName.c_str();
+    const char* ringEnv = getenv("ANONYMIZATION_DAEMON_RING_MB");
+    const long ringMB = ringEnv != nullptr && atol(ringEnv) > 0 ? atol(ringEnv) : 64;
+
+    AnonymizationContext* context = new AnonymizationContext();
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socketPath);
+    context->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (context->fd < 0 || connect(context->fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+        log_error("init: Cannot connect to anonymizationd at %s: %s", socketPath, strerror(errno));
+        close_context(context);
+        return DAEMON_UNAVAILABLE;
+    }
+    // 帧数据和文件路径都会交给对端，只信任以本用户或 root 运行的守护进程，防止其他用户在该路径上冒充
+    struct ucred peer;
+    socklen_t peerLen = sizeof(peer);
+    if (getsockopt(context->fd, SOL_SOCKET, SO_PEERCRED, &peer, &peerLen) != 0) {
+        log_error("init: Cannot identify the process listening on %s: %s", socketPath, strerror(errno));
+        close_context(context);
+        return DAEMON_UNAVAILABLE;
+    }
+    if (peer.uid != getuid() && peer.uid != 0) {
+        log_error("init: %s is served by uid %d (pid %d), not by this user or root; refusing to connect.",
+                  socketPath, static_cast<int>(peer.uid), static_cast<int>(peer.pid));
+        close_context(context);
+        return DAEMON_UNAVAILABLE;
+    }
+
+    // 共享内存环：封住缩小操作后才交给守护进程
+    context->ringSize = static_cast<size_t>(ringMB) * 1024 * 1024;
+    const int ringFd = memfd_create("anonymization-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (ringFd < 0 || ftruncate(ringFd, static_cast<off_t>(context->ringSize)) != 0
+        || fcntl(ringFd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+        log_error("init: Failed to create a %ld MB shared memory ring: %s", ringMB, strerror(errno));
+        if (ringFd >= 0) close(ringFd);
+        close_context(context);
+        return MEMORY_ALLOCATION_ERROR;
+    }
+    void* mapped = mmap(nullptr, context->ringSize, PROT_READ | PROT_WRITE, MAP_SHARED, ringFd, 0);
+    if (mapped == MAP_FAILED) {
+        log_error("init: Failed to map the shared memory ring: %s", strerror(errno));
+        close(ringFd);
+        context->ring = nullptr;
+        close_context(context);
+        return MEMORY_ALLOCATION_ERROR;
+    }
+    context->ring = static_cast<uint8_t*>(mapped);
+    context->allocator.reset(context->ring, context->ringSize);
+
+    DaemonRequest request;
+    memset(&request, 0, sizeof(request));
+    request.magic = kDaemonMagic;
+    request.op = DAEMON_OP_HELLO;
+    request.version = kDaemonProtocolVersion;
+    request.recognizeType = recognizeType;
+    request.ringSize = context->ringSize;
+    const bool sent = daemon_send_with_fd(context->fd, &request, sizeof(request), ringFd);
+    close(ringFd);
+    DaemonResponse response;
+    if (!sent || !daemon_recv_all(context->fd, &response, sizeof(response)) || response.magic != kDaemonMagic) {
+        log_error("init: anonymizationd at %s closed the connection during the handshake.", socketPath);
+        close_context(context);
+        return DAEMON_UNAVAILABLE;
+    }
+    if (response.status != ANO_OK) {
+        log_error("init: anonymizationd rejected the client (error %d).", response.status);
+        close_context(context);
+        return response.status;
+    }
+    log_info("init: Connected to anonymizationd %.32s at %s, ring %ld MB.", response.version, socketPath, ringMB);
+    *handle = context;
+    return ANO_OK;
+}
+
+Anonymization_API int uninit(IN AnonymizationHandle handle) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    close_context(handle);
+    if (g_log_file) {
+        log_set_fp(stderr);
+        fclose(g_log_file);
+        g_log_file = nullptr;
+    }
+    return ANO_OK;
+}
+
+Anonymization_API int image_anonymization(IN AnonymizationHandle handle,
+                                          IN const char* inputFile,
+                                          OUT const char* outputFile,
+                                          IN BlurType blurType) {
+    return file_request(handle, DAEMON_OP_IMAGE, inputFile, outputFile, blurType);
+}
+
+Anonymization_API int video_anonymization(IN AnonymizationHandle handle,
+                                          IN const char* inputFile,
+                                          OUT const char* outputFile,
+                                          IN BlurType blurType) {
+    return file_request(handle, DAEMON_OP_VIDEO, inputFile, outputFile, blurType);
+}
+
+Anonymization_API int mem_anonymization(IN AnonymizationHandle handle,
+                                        IN_OUT ImageFrame *image,
+                                        IN BlurType blurType) {
+    if (!isValidHandle(handle)) return HANDLE_INVALID;
+    if (image == nullptr || image->width <= 0 || image->height <= 0) {
+        log_error("mem_anonymization: Invalid parameter - image is NULL or has invalid dimensions.");
+        return INVALID_PARAMETER;
+    }
+    int rowBytes[4], rows[4];
+    const int planes = daemon_frame_layout(image->format, image->width, image->height, rowBytes, rows);
+    if (planes == 0) {
+        log_error("mem_anonymization: Unsupported input image format: %d", static_cast<int>(image->format));
+        return UNSUPPORTED_FORMAT;
+    }
+
+    std::lock_guard<std::mutex> lock(handle->mutex);
+    // 各平面都在共享内存环中时直接传偏移；否则拷入一块临时区域，处理后再拷回
+    bool shared = true;
+    size_t compactBytes = 0;
+    for (int p = 0; p < planes; ++p) {
+        if (image->data[p] == nullptr || image->strides[p] < rowBytes[p]) {
+            log_error("mem_anonymization: Plane %d is NULL or its stride is less than %d.", p, rowBytes[p]);
+            return INVALID_PARAMETER;
+        }
+        const size_t span = static_cast<size_t>(image->strides[p]) * (rows[p] - 1) + rowBytes[p];
+        shared = shared && handle->allocator.contains(image->data[p], span);
+        compactBytes += static_cast<size_t>(rowBytes[p]) * rows[p];
+    }
+
+    DaemonRequest request;
+    memset(&request, 0, sizeof(request));
+    request.magic = kDaemonMagic;
+    request.op = DAEMON_OP_MEM;
+    request.blurType = blurType;
+    request.format = image->format;
+    request.width = image->width;
+    request.height = image->height;
+    for (int p = 0; p < 4; ++p) request.offsets[p] = kDaemonNoPlane;
+
+    uint8_t* staging = nullptr;
+    if (shared) {
+        for (int p = 0; p < planes; ++p) {
+            request.strides[p] = image->strides[p];
+            request.offsets[p] = handle->allocator.offset_of(image->data[p]);
+        }
+    } else {
+        staging = static_cast<uint8_t*>(handle->allocator.alloc(compactBytes));
+        if (staging == nullptr) {
+            log_error("mem_anonymization: Frame of %zu bytes does not fit in the shared memory ring.", compactBytes);
+            return MEMORY_ALLOCATION_ERROR;
+        }
+        uint8_t* dst = staging;
+        for (int p = 0; p < planes; ++p) {
+            request.strides[p] = rowBytes[p];
+            request.offsets[p] = handle->allocator.offset_of(dst);
+            for (int r = 0; r < rows[p]; ++r) memcpy(dst + static_cast<size_t>(r) * rowBytes[p], image->data[p] + static_cast<size_t>(r) * image->strides[p], rowBytes[p]);
+            dst += static_cast<size_t>(rowBytes[p]) * rows[p];
+        }
+    }
+
+    const int ret = round_trip(handle, request, std::string());
+    if (staging != nullptr) {
+        if (ret == ANO_OK) {
+            const uint8_t* src = staging;
+            for (int p = 0; p < planes; ++p) {
+                for (int r = 0; r < rows[p]; ++r) memcpy(image->data[p] + static_cast<size_t>(r) * image->strides[p], src + static_cast<size_t>(r) * rowBytes[p], rowBytes[p]);
+                src += static_cast<size_t>(rowBytes[p]) * rows[p];
+            }
+        }
+        handle->allocator.free(staging);
+    }
+    return ret;
+}
+
+Anonymization_API void* alloc_shared_frame(IN AnonymizationHandle handle, IN size_t size) {
+    if (!isValidHandle(handle)) return nullptr;
+    std::lock_guard<std::mutex> lock(handle->mutex);
+    return handle->allocator.alloc(size);
+}
+
+Anonymization_API void free_shared_frame(IN AnonymizationHandle handle, IN void* buffer) {
+    if (buffer == nullptr || !isValidHandle(handle)) return;
+    std::lock_guard<std::mutex> lock(handle->mutex);
+    handle->allocator.free(buffer);
+}
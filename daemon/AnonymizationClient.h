@@ -0,0 +1,39 @@
+#ifndef ANONYMIZATION_CLIENT_H
+#define ANONYMIZATION_CLIENT_H
+
+#include "../Anonymization.h"
+
+/*
+ * libAnonymizationClient.so：与 Anonymization.h 相同的 C 接口，任务转交本机的 anonymizationd 执行。
+ * 支持 get_version、set_log_filelevel、set_log_stderr、init、uninit、image_anonymization、
+ * mem_anonymization、video_anonymization，以及下面两个共享内存帧接口。
+ * 守护进程套接字默认 $XDG_RUNTIME_DIR/anonymizationd.sock，未设置时为 /run/anonymizationd/anonymizationd.sock，
+ * 可用环境变量 ANONYMIZATION_DAEMON_SOCKET 修改；监听者既不是本用户也不是 root 时 init 拒绝连接。
+ * 每个句柄的共享内存环默认 64 MB，可用 ANONYMIZATION_DAEMON_RING_MB 修改
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 在句柄的共享内存环中分配帧缓冲区；mem_anonymization 的各平面都位于其中时守护进程原地处理，不做拷贝
+ * 缓冲区按分配顺序回收，长期持有的缓冲区会阻塞其后的空间
+ * @param handle [in] 客户端句柄
+ * @param size [in] 字节数
+ * @return 缓冲区地址（64 字节对齐），空间不足返回 NULL
+ */
+Anonymization_API void* alloc_shared_frame(IN AnonymizationHandle handle, IN size_t size);
+
+/**
+ * @brief 释放 alloc_shared_frame 分配的缓冲区
+ * @param handle [in] 客户端句柄
+ * @param buffer [in] 缓冲区地址，可为 NULL
+ */
+Anonymization_API void free_shared_frame(IN AnonymizationHandle handle, IN void* buffer);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // ANONYMIZATION_CLIENT_H
@@ -0,0 +1,445 @@
+// anonymizationd：本机脱敏守护进程。模型和工作句柄只加载、预热一次，
+// 客户端进程链接 libAnonymizationClient.so，通过 Unix 域套接字提交任务，帧数据经共享内存环原地处理
+// 用法见 ./anonymizationd --help
+#include "../Anonymization.h"
+#include "DaemonProtocol.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+std::atomic<bool> g_stop(false);
+
+// 请求格式错误，连接已不可用
+const int kProtocolError = -1000;
+
+struct DaemonOptions {
+    std::string modelDir;
+    RecognizeType recognizeType = RECOGNIZE_FACE;
+    int workers = 2;                     // 同时处理任务的句柄数
+    std::string socketPath = daemon_default_socket();
+    int socketMode = 0660;
+    uint64_t maxRingMB = 1024;           // 单个客户端共享内存环的上限
+    std::string logPath;
+    LOG_LEVEL logLevel = LOG_INFO;
+};
+
+/**
+ * @brief 工作句柄池：启动时加载并预热，任务执行期间独占一个句柄
+ */
+class WorkerPool
+{
+public:
+    ~WorkerPool() {
+        for (AnonymizationHandle handle : this->all) uninit(handle);
+    }
+
+    int open(const DaemonOptions& options) {
+        for (int i = 0; i < options.workers; ++i) {
+            AnonymizationHandle handle = nullptr;
+            int ret = init(options.modelDir.c_str(), options.recognizeType, &handle);
+            if (ret != ANO_OK) return ret;
+            this->all.push_back(handle);
+            // 预热：首次前向时 DNN 才分配各层缓冲区
+            std::vector<uint8_t> pixels(640 * 640 * 3, 0);
+            ImageFrame frame;
+            memset(&frame, 0, sizeof(frame));
+            frame.format = IMG_FORMAT_BGR;
+            frame.width = 640;
+            frame.height = 640;
+            frame.strides[0] = 640 * 3;
+            frame.data[0] = pixels.data();
+            mem_anonymization(handle, &frame, BLUR_TYPE_GAUSSIAN);
+        }
+        this->idle = this->all;
+        return ANO_OK;
+    }
+
+    AnonymizationHandle acquire() {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->available.wait(lock, [this]() { return !this->idle.empty(); });
+        AnonymizationHandle handle = this->idle.back();
+        this->idle.pop_back();
+        return handle;
+    }
+
+    void release(AnonymizationHandle handle) {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->idle.push_back(handle);
+        }
+        this->available.notify_one();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable available;
+    std::vector<AnonymizationHandle> all;
+    std::vector<AnonymizationHandle> idle;
+};
+
+class WorkerLease
+{
+public:
+    explicit WorkerLease(WorkerPool& pool) : pool(pool), handle(pool.acquire()) {}
+    ~WorkerLease() { this->pool.release(this->handle); }
+    AnonymizationHandle get() const { return this->handle; }
+
+private:
+    WorkerPool& pool;
+    AnonymizationHandle handle;
+};
+
+struct Connection {
+    int fd = -1;
+    std::thread thread;
+    std::atomic<bool> done{false};
+};
+
+class ClientSession
+{
+public:
+    ClientSession(int fd, WorkerPool& pool, const DaemonOptions& options) : fd(fd), pool(pool), options(options) {}
+    ~ClientSession() {
+        if (this->ring != nullptr) munmap(this->ring, this->ringSize);
+    }
+
+    void run() {
+        struct ucred peer;
+        socklen_t peerLen = sizeof(peer);
+        if (getsockopt(this->fd, SOL_SOCKET, SO_PEERCRED, &peer, &peerLen) == 0) {
+            this->peerPid = peer.pid;
+            // 文件路径由守护进程以自身权限打开，只接受本身就有这些权限的客户端（同一用户或 root），
+            // 否则任何能连上套接字的用户都能借守护进程读写它本无权访问的文件
+            this->fileAccess = peer.uid == geteuid() || peer.uid == 0;
+            log_info("anonymizationd: Client connected, pid %d uid %d.", peer.pid, peer.uid);
+        }
+        if (!this->hello()) return;
+        DaemonRequest request;
+        while (daemon_recv_all(this->fd, &request, sizeof(request))) {
+            if (request.magic != kDaemonMagic) {
+                log_error("anonymizationd: Bad request from pid %d, closing connection.", this->peerPid);
+                return;
+            }
+            int status;
+            switch (request.op) {
+                case DAEMON_OP_MEM: status = this->mem(request); break;
+                case DAEMON_OP_IMAGE:
+                case DAEMON_OP_VIDEO: status = this->file(request); break;
+                default:
+                    log_error("anonymizationd: Unknown op %u from pid %d.", request.op, this->peerPid);
+                    status = INVALID_PARAMETER;
+                    break;
+            }
+            if (status == kProtocolError) return;
+            if (status < 0) status = INTERNAL_ERROR;   // 部分接口异常时返回 -1
+            if (!this->respond(status)) return;
+        }
+        log_info("anonymizationd: Client pid %d disconnected.", this->peerPid);
+    }
+
+private:
+    bool respond(int status) {
+        DaemonResponse response;
+        memset(&response, 0, sizeof(response));
+        response.magic = kDaemonMagic;
+        response.status = status;
+        snprintf(response.version, sizeof(response.version), "%s", get_version());
+        return daemon_send_all(this->fd, &response, sizeof(response));
+    }
+
+    bool hello() {
+        DaemonRequest request;
+        int ringFd = -1;
+        if (!daemon_recv_with_fd(this->fd, &request, sizeof(request), &ringFd)) return false;
+        int status = ANO_OK;
+        if (request.magic != kDaemonMagic || request.op != DAEMON_OP_HELLO || request.version != kDaemonProtocolVersion) {
+            log_error("anonymizationd: Client pid %d speaks an unsupported protocol.", this->peerPid);
+            status = INVALID_PARAMETER;
+        } else if (request.recognizeType != static_cast<int32_t>(this->options.recognizeType)) {
+            log_error("anonymizationd: Client pid %d asked for recognize type %d, daemon serves %d.",
+                      this->peerPid, request.recognizeType, static_cast<int>(this->options.recognizeType));
+            status = INVALID_PARAMETER;
+        } else if (ringFd < 0 || request.ringSize == 0 || request.ringSize > this->options.maxRingMB * 1024 * 1024) {
+            log_error("anonymizationd: Client pid %d sent no ring or a ring of %llu bytes.",
+                      this->peerPid, static_cast<unsigned long long>(request.ringSize));
+            status = INVALID_PARAMETER;
+        } else {
+            // 要求客户端封住缩小操作，否则它截断 memfd 后守护进程访问映射会收到 SIGBUS
+            struct stat st;
+            const int seals = fcntl(ringFd, F_GET_SEALS);
+            if (seals < 0 || (seals & F_SEAL_SHRINK) == 0 || fstat(ringFd, &st) != 0
+                || static_cast<uint64_t>(st.st_size) < request.ringSize) {
+                log_error("anonymizationd: Client pid %d ring is not a sealed memfd of the announced size.", this->peerPid);
+                status = INVALID_PARAMETER;
+            } else {
+                void* mapped = mmap(nullptr, request.ringSize, PROT_READ | PROT_WRITE, MAP_SHARED, ringFd, 0);
+                if (mapped == MAP_FAILED) {
+                    log_error("anonymizationd: Failed to map the ring of client pid %d: %s", this->peerPid, strerror(errno));
+                    status = MEMORY_ALLOCATION_ERROR;
+                } else {
+                    this->ring = static_cast<uint8_t*>(mapped);
+                    this->ringSize = request.ringSize;
+                }
+            }
+        }
+        if (ringFd >= 0) close(ringFd);
+        return this->respond(status) && status == ANO_OK;
+    }
+
+    int mem(const DaemonRequest& request) {
+        // 先限制尺寸，计算每行字节数时不会溢出
+        if (request.width <= 0 || request.height <= 0 || request.width > INT32_MAX / 4) {
+            log_error("anonymizationd: Invalid frame size %dx%d from pid %d.", request.width, request.height, this->peerPid);
+            return INVALID_PARAMETER;
+        }
+        int rowBytes[4], rows[4];
+        const int planes = daemon_frame_layout(request.format, request.width, request.height, rowBytes, rows);
+        if (planes == 0) return UNSUPPORTED_FORMAT;
+        ImageFrame frame;
+        memset(&frame, 0, sizeof(frame));
+        frame.format = static_cast<ImageFormat>(request.format);
+        frame.width = request.width;
+        frame.height = request.height;
+        for (int p = 0; p < planes; ++p) {
+            // 各平面必须完整落在共享内存环内；行数、行字节数为正（如 1 行高的 YUV420 色度平面为 0 行）后才计算末行位置
+            const uint64_t offset = request.offsets[p];
+            const int64_t stride = request.strides[p];
+            if (rows[p] <= 0 || rowBytes[p] <= 0) {
+                log_error("anonymizationd: Frame %dx%d from pid %d has an empty plane %d.", request.width, request.height, this->peerPid, p);
+                return INVALID_PARAMETER;
+            }
+            if (stride < rowBytes[p] || offset > this->ringSize
+                || static_cast<uint64_t>(stride) * static_cast<uint64_t>(rows[p] - 1) + static_cast<uint64_t>(rowBytes[p]) > this->ringSize - offset) {
+                log_error("anonymizationd: Plane %d of a frame from pid %d lies outside the ring.", p, this->peerPid);
+                return INVALID_PARAMETER;
+            }
+            frame.strides[p] = request.strides[p];
+            frame.data[p] = this->ring + offset;
+        }
+        WorkerLease worker(this->pool);
+        return mem_anonymization(worker.get(), &frame, static_cast<BlurType>(request.blurType));
+    }
+
+    int file(const DaemonRequest& request) {
+        if (request.pathBytes < 4 || request.pathBytes > kDaemonMaxPathBytes) return kProtocolError;
+        std::vector<char> paths(request.pathBytes + 1, '\0');
+        if (!daemon_recv_all(this->fd, paths.data(), request.pathBytes)) return kProtocolError;
+        const char* input = paths.data();
+        const size_t inputLen = strnlen(input, request.pathBytes);
+        if (inputLen + 1 >= request.pathBytes) return INVALID_PARAMETER;
+        const char* output = input + inputLen + 1;
+        if (input[0] != '/' || output[0] != '/') {
+            log_error("anonymizationd: Client pid %d sent relative paths.", this->peerPid);
+            return INVALID_PARAMETER;
+        }
+        if (!this->fileAccess) {
+            log_error("anonymizationd: Client pid %d runs as another user, file jobs are refused.", this->peerPid);
+            return INVALID_PARAMETER;
+        }
+        WorkerLease worker(this->pool);
+        const BlurType blurType = static_cast<BlurType>(request.blurType);
+        if (request.op == DAEMON_OP_IMAGE) return image_anonymization(worker.get(), input, output, blurType);
+        return video_anonymization(worker.get(), input, output, blurType);
+    }
+
+    int fd;
+    WorkerPool& pool;
+    const DaemonOptions& options;
+    int peerPid = 0;
+    bool fileAccess = false;             // 是否允许图片、视频文件任务，取不到对端凭据时不允许
+    uint8_t* ring = nullptr;
+    uint64_t ringSize = 0;
+};
+
+void on_signal(int) {
+    g_stop = true;
+}
+
+/**
+ * @brief 在 socketPath 上监听；bound 返回创建的套接字文件的设备号和 inode，退出时只删除自己创建的文件
+ * 路径上已有套接字时先尝试连接：能连上说明另一个 anonymizationd 正在运行，拒绝启动；
+ * 只有连接被拒绝（遗留的套接字文件）时才删除。路径上是其他类型的文件时也拒绝启动
+ */
+int open_listener(const DaemonOptions& options, struct stat& bound) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (options.socketPath.size() >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path is too long: %s\n", options.socketPath.c_str());
+        return -1;
+    }
+    memcpy(addr.sun_path, options.socketPath.c_str(), options.socketPath.size());
+    // 默认的系统目录属 root，不存在时创建（需要以 root 运行）
+    const std::string systemDir = kDaemonSystemSocketDir;
+    if (options.socketPath.compare(0, systemDir.size() + 1, systemDir + "/") == 0 && mkdir(systemDir.c_str(), 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Failed to create %s: %s (set XDG_RUNTIME_DIR or use --socket)\n", systemDir.c_str(), strerror(errno));
+        return -1;
+    }
+    struct stat existing;
+    if (lstat(options.socketPath.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            fprintf(stderr, "%s exists and is not a socket, refusing to replace it.\n", options.socketPath.c_str());
+            return -1;
+        }
+        const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const bool live = probe >= 0 && connect(probe, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0;
+        const int probeErrno = errno;
+        if (probe >= 0) close(probe);
+        if (live) {
+            fprintf(stderr, "Another anonymizationd is already listening on %s.\n", options.socketPath.c_str());
+            return -1;
+        }
+        if (probeErrno != ECONNREFUSED) {
+            fprintf(stderr, "Cannot check the existing socket %s: %s\n", options.socketPath.c_str(), strerror(probeErrno));
+            return -1;
+        }
+        // 上次异常退出遗留的套接字文件
+        unlink(options.socketPath.c_str());
+    }
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    // bind 按 umask 创建套接字文件，先设好 umask 使文件一出现就是目标权限，不留 bind 之后再 chmod 的窗口
+    const mode_t oldMask = umask(static_cast<mode_t>(~options.socketMode & 0777));
+    const bool ok = bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0;
+    const int bindErrno = errno;
+    umask(oldMask);
+    if (!ok || listen(fd, 64) != 0 || lstat(options.socketPath.c_str(), &bound) != 0) {
+        fprintf(stderr, "Failed to listen on %s: %s\n", options.socketPath.c_str(), strerror(ok ? errno : bindErrno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s --models DIR [options]\n"
+            "  --models DIR        model directory, as for init()\n"
+            "  --type NAME         face|plate|all (default face)\n"
+            "  --workers N         handles processing jobs concurrently (default 2)\n"
+            "  --socket PATH       Unix socket path (default $XDG_RUNTIME_DIR/%s, or %s/%s without XDG_RUNTIME_DIR)\n"
+            "  --socket-mode MODE  octal permissions of the socket (default 0660)\n"
+            "  --max-ring-mb MB    largest shared memory ring a client may register (default 1024)\n"
+            "  --log FILE          log file (default stderr)\n"
+            "  --log-level N       0 trace .. 5 fatal (default 2)\n",
+            argv0, kDaemonSocketName, kDaemonSystemSocketDir, kDaemonSocketName);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    DaemonOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--models" && hasValue) options.modelDir = argv[++i];
+        else if (arg == "--workers" && hasValue) options.workers = std::max(1, atoi(argv[++i]));
+        else if (arg == "--socket" && hasValue) options.socketPath = argv[++i];
+        else if (arg == "--socket-mode" && hasValue) options.socketMode = static_cast<int>(strtol(argv[++i], nullptr, 8));
+        else if (arg == "--max-ring-mb" && hasValue) options.maxRingMB = std::max(1LL, atoll(argv[++i]));
+        else if (arg == "--log" && hasValue) options.logPath = argv[++i];
+        else if (arg == "--log-level" && hasValue) options.logLevel = static_cast<LOG_LEVEL>(atoi(argv[++i]));
+        else if (arg == "--type" && hasValue) {
+            const std::string type = argv[++i];
+            if (type == "face") options.recognizeType = RECOGNIZE_FACE;
+            else if (type == "plate") options.recognizeType = RECOGNIZE_LICENSE_PLATE;
+            else if (type == "all") options.recognizeType = RECOGNIZE_ALL;
+            else {
+                usage(argv[0]);
+                return 2;
+            }
+        } else {
+            usage(argv[0]);
+            return arg == "--help" ? 0 : 2;
+        }
+    }
+    if (options.modelDir.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (options.logPath.empty()) log_set_level(options.logLevel);
+    else if (set_log_filelevel(options.logPath.c_str(), options.logLevel) != ANO_OK) return 1;
+
+    WorkerPool pool;
+    const int ret = pool.open(options);
+    if (ret != ANO_OK) {
+        fprintf(stderr, "Failed to load models from %s (error %d)\n", options.modelDir.c_str(), ret);
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_signal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    struct stat socketFile;
+    const int listenFd = open_listener(options, socketFile);
+    if (listenFd < 0) return 1;
+    log_info("anonymizationd: %s, %d workers, listening on %s.", get_version(), options.workers, options.socketPath.c_str());
+
+    std::list<std::unique_ptr<Connection>> connections;
+    while (!g_stop) {
+        struct pollfd pfd = { listenFd, POLLIN, 0 };
+        const int ready = poll(&pfd, 1, 500);
+        // 回收已断开的连接
+        for (auto it = connections.begin(); it != connections.end();) {
+            if ((*it)->done) {
+                (*it)->thread.join();
+                close((*it)->fd);
+                it = connections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (ready <= 0) continue;
+        const int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) continue;
+        std::unique_ptr<Connection> connection(new Connection());
+        connection->fd = fd;
+        Connection* c = connection.get();
+        c->thread = std::thread([c, &pool, &options]() {
+            ClientSession(c->fd, pool, options).run();
+            c->done = true;
+        });
+        connections.push_back(std::move(connection));
+    }
+
+    log_info("anonymizationd: Shutting down, %zu clients connected.", connections.size());
+    close(listenFd);
+    // 路径可能已被别的进程替换，只删除自己创建的套接字文件
+    struct stat current;
+    if (lstat(options.socketPath.c_str(), &current) == 0 && current.st_dev == socketFile.st_dev && current.st_ino == socketFile.st_ino)
+        unlink(options.socketPath.c_str());
+    // 正在执行的任务完成后各连接线程读到 EOF 退出
+    for (std::unique_ptr<Connection>& c : connections) shutdown(c->fd, SHUT_RDWR);
+    for (std::unique_ptr<Connection>& c : connections) {
+        c->thread.join();
+        close(c->fd);
+    }
+    log_flush();
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "DaemonProtocol.h"
+#include "../Anonymization.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+std::string daemon_default_socket() {
+    const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
+    if (runtimeDir != nullptr && runtimeDir[0] == '/') return std::string(runtimeDir) + "/" + kDaemonSocketName;
+    return std::string(kDaemonSystemSocketDir) + "/" + kDaemonSocketName;
+}
+
+bool daemon_send_all(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        const ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool daemon_recv_all(int fd, void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        const ssize_t n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool daemon_send_with_fd(int fd, const void* data, size_t size, int passFd) {
+    struct iovec iov;
+    iov.iov_base = const_cast<void*>(data);
+    iov.iov_len = size;
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &passFd, sizeof(int));
+
+    ssize_t n;
+    do {
+        n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) return false;
+    // 描述符随第一个字节送达，剩余部分按普通数据发送
+    return daemon_send_all(fd, static_cast<const char*>(data) + n, size - static_cast<size_t>(n));
+}
+
+bool daemon_recv_with_fd(int fd, void* data, size_t size, int* passFd) {
+    *passFd = -1;
+    struct iovec iov;
+    iov.iov_base = data;
+    iov.iov_len = size;
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n;
+    do {
+        n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) return false;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+            memcpy(passFd, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+    if ((msg.msg_flags & MSG_CTRUNC) != 0) {
+        if (*passFd >= 0) close(*passFd);
+        *passFd = -1;
+        return false;
+    }
+    return daemon_recv_all(fd, static_cast<char*>(data) + n, size - static_cast<size_t>(n));
+}
+
+int daemon_frame_layout(int format, int width, int height, int rowBytes[4], int rows[4]) {
+    for (int i = 0; i < 4; ++i) rowBytes[i] = rows[i] = 0;
+    switch (format) {
+        case IMG_FORMAT_ARGB:
+            rowBytes[0] = width * 4; rows[0] = height;
+            return 1;
+        case IMG_FORMAT_RGB:
+        case IMG_FORMAT_BGR:
+            rowBytes[0] = width * 3; rows[0] = height;
+            return 1;
+        case IMG_FORMAT_GRAY:
+            rowBytes[0] = width; rows[0] = height;
+            return 1;
+        case IMG_FORMAT_YUV420P:
+            rowBytes[0] = width; rows[0] = height;
+            rowBytes[1] = rowBytes[2] = width / 2;
+            rows[1] = rows[2] = height / 2;
+            return 3;
+        case IMG_FORMAT_YUV420SP:
+            rowBytes[0] = width; rows[0] = height;
+            rowBytes[1] = width; rows[1] = height / 2;
+            return 2;
+        default:
+            return 0;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef DAEMON_PROTOCOL_H
+#define DAEMON_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * 客户端库（libAnonymizationClient.so）与 anonymizationd 之间的消息格式，只用于本机，按本机字节序。
+ * 连接后客户端先发 HELLO，并通过 SCM_RIGHTS 附带共享内存环的 memfd；之后每个请求对应一个应答，
+ * 同一连接上按顺序处理。帧数据不经过套接字，请求中只带各平面在共享内存环中的偏移
+ */
+
+const uint32_t kDaemonMagic = 0x414e4f44;            // "ANOD"
+const uint32_t kDaemonProtocolVersion = 1;
+const char* const kDaemonSocketName = "anonymizationd.sock";
+const char* const kDaemonSystemSocketDir = "/run/anonymizationd";   // 属 root，以 root 运行的系统服务使用
+const uint64_t kDaemonNoPlane = UINT64_MAX;          // 未使用的平面
+const uint32_t kDaemonMaxPathBytes = 2 * 4096;
+
+enum DaemonOp {
+    DAEMON_OP_HELLO = 1,
+    DAEMON_OP_MEM = 2,
+    DAEMON_OP_IMAGE = 3,
+    DAEMON_OP_VIDEO = 4,
+};
+
+struct DaemonRequest {
+    uint32_t magic;
+    uint32_t op;
+    uint32_t version;        // HELLO：协议版本
+    int32_t recognizeType;   // HELLO：与守护进程加载的模型类型一致
+    uint64_t ringSize;       // HELLO：共享内存环字节数
+    int32_t blurType;
+    int32_t format;          // MEM：图像格式、尺寸与各平面的行跨度
+    int32_t width;
+    int32_t height;
+    int32_t strides[4];
+    uint64_t offsets[4];     // MEM：各平面在共享内存环中的偏移
+    uint32_t pathBytes;      // IMAGE/VIDEO：请求之后紧跟输入、输出两个以 '\0' 结尾的绝对路径，共 pathBytes 字节
+    uint32_t reserved;
+};
+
+struct DaemonResponse {
+    uint32_t magic;
+    int32_t status;          // ANO_OK 或错误码
+    char version[32];        // HELLO：守护进程的 SDK 版本
+};
+
+// 默认套接字路径：$XDG_RUNTIME_DIR/anonymizationd.sock（只有当前用户可写的目录），
+// 未设置 XDG_RUNTIME_DIR 时为 /run/anonymizationd/anonymizationd.sock；不放在 /tmp 等所有人可写的目录，避免被其他用户抢先占用
+std::string daemon_default_socket();
+
+// 阻塞读写，处理 EINTR 和短读写；对端关闭或出错时返回 false
+bool daemon_send_all(int fd, const void* data, size_t size);
+bool daemon_recv_all(int fd, void* data, size_t size);
+// 发送 data 并附带一个文件描述符
+bool daemon_send_with_fd(int fd, const void* data, size_t size, int passFd);
+// 接收 data 以及随之附带的文件描述符，没有附带时 *passFd 为 -1
+bool daemon_recv_with_fd(int fd, void* data, size_t size, int* passFd);
+
+// 按格式计算紧凑排列时各平面的每行字节数和行数，返回平面数，不支持的格式返回 0
+// 与 FrameConvert.h 中的 image_frame_layout 相同，客户端库不依赖 OpenCV，在此单独实现
+int daemon_frame_layout(int format, int width, int height, int rowBytes[4], int rows[4]);
+
+#endif // DAEMON_PROTOCOL_H
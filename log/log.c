@@ -6,19 +6,61 @@
  */
 
 #include "log.h"
+#include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#ifdef __ANDROID__
+#include <android/log.h>
+#endif
+
+#define LOG_QUEUE_SIZE 512            /* 2 的幂 */
+#define LOG_QUEUE_MASK (LOG_QUEUE_SIZE - 1)
+#define LOG_MSG_SIZE 1024
+#define LOG_NAP_MS 2                  /* 有日志时攒批的间隔 */
+#define LOG_IDLE_MS 200               /* 空闲时的最长等待，防止漏掉唤醒 */
+#define LOG_FULL_SPINS 16             /* 队列满时先让出 CPU 的次数，之后改为短暂睡眠 */
+#define LOG_FULL_SLEEP_US 100
+
+/*
+ * 有界 MPSC 队列（Vyukov）：生产者 CAS 抢占槽位，seq 标记槽位是否可写/可读。
+ * 第 pos 条记录所在槽位的 seq 为 (pos & ~MASK) 时可写，+1 时可读，零初始化即为空队列
+ */
+typedef struct {
+  unsigned long seq;
+  int level;
+  int line;
+  const char *file;
+  struct timespec ts;
+  char msg[LOG_MSG_SIZE];
+} log_record;
+
+enum { WORKER_RUNNING = 0, WORKER_NAPPING, WORKER_IDLE };
 
 static struct {
   void *udata;
   log_LockFn lock;
   FILE *fp;
-  int level;
-  int quiet;
+  int mirror;
 } L;
 
+int log_runtime_level = LOG_INFO;
+
+static log_record ring[LOG_QUEUE_SIZE];
+static unsigned long enqueue_pos;
+static unsigned long dequeue_pos;
+
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;  /* 保证同一时刻只有一个消费者 */
+static pthread_mutex_t wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t worker_once = PTHREAD_ONCE_INIT;
+static pthread_t worker;
+static int worker_started;
+static int worker_state = WORKER_RUNNING;
+static int worker_stop;
+
 static const char *level_names[] = {
   "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"
 };
@@ -34,13 +76,17 @@ static void default_lock(void *udata, int lock) {
 
 // 初始化函数
 static void log_init(void) __attribute__((constructor));
+static void log_shutdown(void) __attribute__((destructor));
 
 static void log_init(void) {
     L.udata = NULL;
     L.lock = default_lock;
     L.fp = stderr;
-    L.level = LOG_INFO;
-    L.quiet = 0;
+    L.mirror = 0;
+}
+
+static unsigned long lap_base(unsigned long pos) {
+  return pos & ~(unsigned long)LOG_QUEUE_MASK;
 }
 
 void log_set_udata(void *udata) {
@@ -51,74 +97,220 @@ void log_set_lock(log_LockFn fn) {
   L.lock = fn ? fn : default_lock;
 }
 
-void log_set_fp(FILE *fp) {
-  L.fp = fp;
+void log_set_level(int level) {
+  __atomic_store_n(&log_runtime_level, level, __ATOMIC_RELAXED);
 }
 
-void log_set_level(int level) {
-  L.level = level;
+void log_set_stderr(int enable) {
+  __atomic_store_n(&L.mirror, enable ? 1 : 0, __ATOMIC_RELAXED);
 }
 
 void log_set_quiet(int enable) {
-  L.quiet = enable;
+  log_set_stderr(!enable);
 }
 
-void log_log(int level, const char *file, int line, const char *fmt, ...) {
-  if (level < L.level) return;
-  
-  L.lock(L.udata, 1);
-  
-  /* Get current time */
-  time_t t = time(NULL);
-  struct tm *lt = localtime(&t);
-  char time_str[32];
-  strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", lt);
-  
-  /* Format the message */
-  va_list args;
-  char msg[1024];
-  
-  va_start(args, fmt);
-  vsnprintf(msg, sizeof(msg), fmt, args);
-  va_end(args);
-  
-  /* Determine max level name length */
-  size_t max_level_len = 0;
-  for (int i = 0; i < 6; i++) {
-    size_t len = strlen(level_names[i]);
-    if (len > max_level_len) {
-      max_level_len = len;
-    }
+static void write_line(const char *line, size_t len, int level) {
+  FILE *fp = L.fp;
+  if (fp) {
+    fwrite(line, 1, len, fp);
+  }
+  if (__atomic_load_n(&L.mirror, __ATOMIC_RELAXED) && fp != stderr) {
+#ifdef __ANDROID__
+    static const int priorities[] = {
+      ANDROID_LOG_VERBOSE, ANDROID_LOG_DEBUG, ANDROID_LOG_INFO,
+      ANDROID_LOG_WARN, ANDROID_LOG_ERROR, ANDROID_LOG_FATAL
+    };
+    __android_log_write(priorities[level], "Anonymization", line);
+#else
+    (void)level;
+    fwrite(line, 1, len, stderr);
+#endif
   }
-  
-  /* Build the full message */
-  char full_msg[2048];
+}
+
+static void write_record(const log_record *r) {
+  /* 同一秒内的日志复用格式化好的时间 */
+  static time_t cached_sec = (time_t)-1;
+  static char time_str[32];
+  if (r->ts.tv_sec != cached_sec) {
+    struct tm lt;
+    localtime_r(&r->ts.tv_sec, &lt);
+    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &lt);
+    cached_sec = r->ts.tv_sec;
+  }
+
+  char full_msg[LOG_MSG_SIZE + 256];
+  int len;
   #ifdef _WIN32
-    snprintf(full_msg, sizeof(full_msg), "%s %-*s %s:%d: %s\n",
-             time_str, (int)max_level_len, level_names[level],
-             file, line, msg);
+    len = snprintf(full_msg, sizeof(full_msg), "%s %-5s %s:%d: %s\n",
+                   time_str, level_names[r->level], r->file, r->line, r->msg);
   #else
-    snprintf(full_msg, sizeof(full_msg), "%s %s%-*s\x1b[0m %s:%d: %s\n",
-             time_str, level_colors[level], (int)max_level_len, level_names[level],
-             file, line, msg);
+    len = snprintf(full_msg, sizeof(full_msg), "%s %s%-5s\x1b[0m %s:%d: %s\n",
+                   time_str, level_colors[r->level], level_names[r->level],
+                   r->file, r->line, r->msg);
   #endif
-  
-  /* Write to file */
-  if (L.fp) {
-    fputs(full_msg, L.fp);
-    fflush(L.fp);
+  if (len < 0) return;
+  if ((size_t)len >= sizeof(full_msg)) {
+    len = (int)sizeof(full_msg) - 1;
+    full_msg[len - 1] = '\n';
   }
-  
-  /* Write to stderr */
-  if (!L.quiet) {
-    fputs(full_msg, stderr);
-    fflush(stderr);
+  write_line(full_msg, (size_t)len, r->level);
+}
+
+/* 写出已发布的记录，直到队列为空或到达 target（target 为 0 表示不限）；调用者持有 drain_lock */
+static unsigned long drain(unsigned long target, int wait_pending) {
+  unsigned long count = 0;
+  L.lock(L.udata, 1);
+  for (;;) {
+    unsigned long pos = __atomic_load_n(&dequeue_pos, __ATOMIC_RELAXED);
+    if (target && (long)(pos - target) >= 0) break;
+    log_record *r = &ring[pos & LOG_QUEUE_MASK];
+    if (__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) != lap_base(pos) + 1) {
+      /* 槽位已被抢占但还在格式化，flush 时等它写完 */
+      if (wait_pending && (long)(pos - __atomic_load_n(&enqueue_pos, __ATOMIC_ACQUIRE)) < 0) {
+        sched_yield();
+        continue;
+      }
+      break;
+    }
+    write_record(r);
+    __atomic_store_n(&r->seq, lap_base(pos) + LOG_QUEUE_SIZE, __ATOMIC_RELEASE);
+    __atomic_store_n(&dequeue_pos, pos + 1, __ATOMIC_RELEASE);
+    count++;
   }
-  
-  /* If fatal, abort */
-  if (level == LOG_FATAL) {
-    abort();
+  if (count && L.fp) {
+    fflush(L.fp);
   }
-  
   L.lock(L.udata, 0);
-}
\ No newline at end of file
+  return count;
+}
+
+static void *worker_main(void *arg) {
+  (void)arg;
+  int busy = 0;
+  for (;;) {
+    pthread_mutex_lock(&drain_lock);
+    busy = drain(0, 0) > 0;
+    pthread_mutex_unlock(&drain_lock);
+
+    pthread_mutex_lock(&wake_lock);
+    if (__atomic_load_n(&worker_stop, __ATOMIC_ACQUIRE)) {
+      pthread_mutex_unlock(&wake_lock);
+      break;
+    }
+    /* 刚写过日志时短暂等待攒批，生产者只在队列过半时唤醒；空闲时等待更久，第一条日志即唤醒 */
+    __atomic_store_n(&worker_state, busy ? WORKER_NAPPING : WORKER_IDLE, __ATOMIC_SEQ_CST);
+    unsigned long next = __atomic_load_n(&dequeue_pos, __ATOMIC_RELAXED);
+    if (busy || __atomic_load_n(&ring[next & LOG_QUEUE_MASK].seq, __ATOMIC_SEQ_CST) != lap_base(next) + 1) {
+      struct timespec deadline;
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      long ms = busy ? LOG_NAP_MS : LOG_IDLE_MS;
+      deadline.tv_sec += ms / 1000;
+      deadline.tv_nsec += (ms % 1000) * 1000000L;
+      if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+      }
+      pthread_cond_timedwait(&wake_cond, &wake_lock, &deadline);
+    }
+    __atomic_store_n(&worker_state, WORKER_RUNNING, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&wake_lock);
+  }
+  return NULL;
+}
+
+static void start_worker(void) {
+  if (pthread_create(&worker, NULL, worker_main, NULL) == 0) {
+    __atomic_store_n(&worker_started, 1, __ATOMIC_RELEASE);
+  }
+}
+
+static void wake_worker(void) {
+  pthread_mutex_lock(&wake_lock);
+  pthread_cond_signal(&wake_cond);
+  pthread_mutex_unlock(&wake_lock);
+}
+
+void log_flush(void) {
+  unsigned long target = __atomic_load_n(&enqueue_pos, __ATOMIC_ACQUIRE);
+  pthread_mutex_lock(&drain_lock);
+  drain(target, 1);
+  pthread_mutex_unlock(&drain_lock);
+}
+
+void log_set_fp(FILE *fp) {
+  log_flush();
+  pthread_mutex_lock(&drain_lock);
+  L.fp = fp;
+  pthread_mutex_unlock(&drain_lock);
+}
+
+static void log_shutdown(void) {
+  if (__atomic_load_n(&worker_started, __ATOMIC_ACQUIRE)) {
+    pthread_mutex_lock(&wake_lock);
+    __atomic_store_n(&worker_stop, 1, __ATOMIC_RELEASE);
+    pthread_cond_signal(&wake_cond);
+    pthread_mutex_unlock(&wake_lock);
+    pthread_join(worker, NULL);
+    __atomic_store_n(&worker_started, 0, __ATOMIC_RELEASE);
+  }
+  log_flush();
+}
+
+void log_log(int level, const char *file, int line, const char *fmt, ...) {
+  if (level < __atomic_load_n(&log_runtime_level, __ATOMIC_RELAXED)) return;
+  if (!__atomic_load_n(&worker_stop, __ATOMIC_ACQUIRE)) {
+    pthread_once(&worker_once, start_worker);
+  }
+
+  /* 抢占一个槽位；队列满时唤醒后台线程并退避等待空位，任何级别都不丢弃 */
+  log_record *r = NULL;
+  unsigned long pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+  int full_waits = 0;
+  for (;;) {
+    log_record *slot = &ring[pos & LOG_QUEUE_MASK];
+    long diff = (long)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - lap_base(pos));
+    if (diff == 0) {
+      if (__atomic_compare_exchange_n(&enqueue_pos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        r = slot;
+        break;
+      }
+    } else if (diff < 0) {
+      if (__atomic_load_n(&worker_started, __ATOMIC_ACQUIRE)) {
+        wake_worker();
+        if (full_waits++ < LOG_FULL_SPINS) {
+          sched_yield();
+        } else {
+          struct timespec nap = { 0, LOG_FULL_SLEEP_US * 1000L };
+          nanosleep(&nap, NULL);
+        }
+      } else {
+        log_flush();
+      }
+      pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+    } else {
+      pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+    }
+  }
+
+  va_list args;
+  r->level = level;
+  r->file = file;
+  r->line = line;
+  clock_gettime(CLOCK_REALTIME, &r->ts);
+  va_start(args, fmt);
+  vsnprintf(r->msg, sizeof(r->msg), fmt, args);
+  va_end(args);
+  __atomic_store_n(&r->seq, lap_base(pos) + 1, __ATOMIC_RELEASE);
+
+  if (level == LOG_FATAL || !__atomic_load_n(&worker_started, __ATOMIC_ACQUIRE)) {
+    /* FATAL 之后进程可能随即退出，同步写出；没有后台线程（创建失败或已退出）时也同步写出 */
+    log_flush();
+    return;
+  }
+  int state = __atomic_load_n(&worker_state, __ATOMIC_SEQ_CST);
+  if (state == WORKER_IDLE ||
+      (state == WORKER_NAPPING && pos - __atomic_load_n(&dequeue_pos, __ATOMIC_RELAXED) >= LOG_QUEUE_SIZE / 2)) {
+    wake_worker();
+  }
+}
@@ -9,10 +9,16 @@
 #define LOG_H
 #include <stdio.h>
 #include <stdarg.h>
-#ifdef __ANDROID__
-#include <android/log.h>
+#define LOG_VERSION "0.2.0"
+
+/*
+ * 低于该级别的日志调用在编译期整体去掉（参数也不会求值），发布版本可用 -DLOG_COMPILE_LEVEL=2
+ * 去掉 trace/debug。数值与 LOG_LEVEL 对应：0 TRACE，1 DEBUG，2 INFO，3 WARN，4 ERROR，5 FATAL
+ */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
 #endif
-#define LOG_VERSION "0.1.0"
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -28,52 +34,52 @@ extern "C"
         LOG_ERROR,
         LOG_FATAL
     } LOG_LEVEL;
-    void log_log(int level, const char *file, int line, const char *fmt, ...);
-#ifdef __ANDROID__
-#define LOGT(fmt...) __android_log_print(ANDROID_LOG_VERBOSE, "Anonymization", fmt)
-#define LOGD(fmt...) __android_log_print(ANDROID_LOG_DEBUG, "Anonymization", fmt)
-#define LOGI(fmt...) __android_log_print(ANDROID_LOG_INFO, "Anonymization", fmt)
-#define LOGW(fmt...) __android_log_print(ANDROID_LOG_WARN, "Anonymization", fmt)
-#define LOGE(fmt...) __android_log_print(ANDROID_LOG_ERROR, "Anonymization", fmt)
-#define LOGF(fmt...) __android_log_print(ANDROID_LOG_FATAL, "Anonymization", fmt)
-#else
-#define LOGT(fmt...) fprintf(stderr, fmt)
-#define LOGD(fmt...) fprintf(stderr, fmt)
-#define LOGI(fmt...) fprintf(stderr, fmt)
-#define LOGW(fmt...) fprintf(stderr, fmt)
-#define LOGE(fmt...) fprintf(stderr, fmt)
-#define LOGF(fmt...) fprintf(stderr, fmt)
+
+    /* 运行期级别，宏里先比较级别再调用 log_log，被过滤的日志不做任何格式化 */
+    extern int log_runtime_level;
+
+    /*
+     * 格式化消息后放入无锁环形队列立即返回，时间格式化和文件写入由后台线程完成；
+     * 队列满时等待后台线程腾出空位，不丢弃日志。
+     * FATAL 同步写出后返回。注意：原实现在 FATAL 之后调用 abort()，现在不再终止进程，需要终止的调用者自行 abort()
+     */
+    void log_log(int level, const char *file, int line, const char *fmt, ...)
+#if defined(__GNUC__)
+        __attribute__((format(printf, 4, 5)))
 #endif
+        ;
 
-#define log_trace(...)                                   \
-    log_log(LOG_TRACE, __FILE__, __LINE__, __VA_ARGS__); \
-    LOGT(__VA_ARGS__)
-#define log_debug(...)                                   \
-    log_log(LOG_DEBUG, __FILE__, __LINE__, __VA_ARGS__); \
-    LOGD(__VA_ARGS__)
+#define LOG_ENABLED(level) \
+    ((level) >= LOG_COMPILE_LEVEL && (level) >= __atomic_load_n(&log_runtime_level, __ATOMIC_RELAXED))
 
-#define log_info(...)                                   \
-    log_log(LOG_INFO, __FILE__, __LINE__, __VA_ARGS__); \
-    LOGI(__VA_ARGS__)
+#define LOG_AT(level, ...)                                    \
+    do                                                        \
+    {                                                         \
+        if (LOG_ENABLED(level))                               \
+            log_log((level), __FILE__, __LINE__, __VA_ARGS__); \
+    } while (0)
 
-#define log_warn(...)                                   \
-    log_log(LOG_WARN, __FILE__, __LINE__, __VA_ARGS__); \
-    LOGW(__VA_ARGS__)
-#define log_error(...)                                   \
-    log_log(LOG_ERROR, __FILE__, __LINE__, __VA_ARGS__); \
-    LOGE(__VA_ARGS__)
-#define log_fatal(...)                                   \
-    log_log(LOG_FATAL, __FILE__, __LINE__, __VA_ARGS__); \
-    LOGF(__VA_ARGS__)
+#define log_trace(...) LOG_AT(LOG_TRACE, __VA_ARGS__)
+#define log_debug(...) LOG_AT(LOG_DEBUG, __VA_ARGS__)
+#define log_info(...) LOG_AT(LOG_INFO, __VA_ARGS__)
+#define log_warn(...) LOG_AT(LOG_WARN, __VA_ARGS__)
+#define log_error(...) LOG_AT(LOG_ERROR, __VA_ARGS__)
+#define log_fatal(...) LOG_AT(LOG_FATAL, __VA_ARGS__)
 
     void log_set_udata(void *udata);
     void log_set_lock(log_LockFn fn);
+    /* 切换输出文件前先写完队列中的日志，返回后调用者可以安全关闭旧文件 */
     void log_set_fp(FILE *fp);
     void log_set_level(int level);
+    /* 是否同时输出到 stderr（Android 上为 logcat），默认关闭；输出文件本身是 stderr 时不重复输出 */
+    void log_set_stderr(int enable);
+    /* 兼容旧接口：quiet 为 0 等价于 log_set_stderr(1) */
     void log_set_quiet(int enable);
+    /* 阻塞直到调用前提交的日志全部写出 */
+    void log_flush(void);
 
 #ifdef __cplusplus
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
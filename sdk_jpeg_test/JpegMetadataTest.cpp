@@ -0,0 +1,170 @@
+#include "./../JpegCodec.h"
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <jpeglib.h>
+
+// JPEG 快速路径的元数据测试：输入带 EXIF 缩略图、GPS、XMP、注释和 ICC 配置，
+// 分块重编码（有目标）和直接复制（无目标）两条路径的输出中都不能留下缩略图和 GPS/XMP/注释，ICC 配置保留
+
+#ifndef ANONYMIZATION_WITH_LIBJPEG
+#error "Build the library and this test with WITH_LIBJPEG=1."
+#endif
+
+namespace {
+
+int g_failures = 0;
+
+void check(bool ok, const std::string& name) {
+    std::cout << (ok ? "[PASS] " : "[FAIL] ") << name << std::endl;
+    if (!ok) g_failures++;
+}
+
+// 用 libjpeg 编码一幅亮度为 value 的灰色 4:2:0 图像，markers 中的段在 SOF 之前写出
+std::vector<uint8_t> encode_jpeg(int width, int height, int value,
+                                 const std::vector<std::pair<int, std::vector<uint8_t>>>& markers) {
+    jpeg_compress_struct cinfo;
+    jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+    unsigned char* buffer = nullptr;
+    unsigned long size = 0;
+    jpeg_mem_dest(&cinfo, &buffer, &size);
+    cinfo.image_width = static_cast<JDIMENSION>(width);
+    cinfo.image_height = static_cast<JDIMENSION>(height);
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 90, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+    for (const auto& m : markers) jpeg_write_marker(&cinfo, m.first, m.second.data(), static_cast<unsigned>(m.second.size()));
+    std::vector<uint8_t> row(static_cast<size_t>(width) * 3, static_cast<uint8_t>(value));
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW p = row.data();
+        jpeg_write_scanlines(&cinfo, &p, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    std::vector<uint8_t> data(buffer, buffer + size);
+    free(buffer);
+    return data;
+}
+
+void put_u16(std::vector<uint8_t>& out, unsigned v) {
+    out.push_back(static_cast<uint8_t>(v & 0xFF));
+    out.push_back(static_cast<uint8_t>(v >> 8));
+}
+
+void put_u32(std::vector<uint8_t>& out, unsigned v) {
+    put_u16(out, v & 0xFFFF);
+    put_u16(out, v >> 16);
+}
+
+void put_entry(std::vector<uint8_t>& out, unsigned tag, unsigned type, unsigned count, unsigned value) {
+    put_u16(out, tag);
+    put_u16(out, type);
+    put_u32(out, count);
+    put_u32(out, value);
+}
+
+/*
+ * 小端 EXIF：IFD0 只有 GPS 指针，IFD1 指向内嵌的 JPEG 缩略图，GPS IFD 有一个纬度参考。
+ * 偏移相对 TIFF 头：IFD0 在 8（18 字节），IFD1 在 26（30 字节），GPS IFD 在 56（18 字节），缩略图在 74
+ */
+std::vector<uint8_t> make_exif(const std::vector<uint8_t>& thumbnail) {
+    std::vector<uint8_t> exif = {'E', 'x', 'i', 'f', 0, 0, 'I', 'I', 42, 0};
+    put_u32(exif, 8);
+    put_u16(exif, 1);
+    put_entry(exif, 0x8825, 4, 1, 56);          // GPSInfo
+    put_u32(exif, 26);                          // 下一个 IFD 为 IFD1
+    put_u16(exif, 2);
+    put_entry(exif, 0x0201, 4, 1, 74);          // JPEGInterchangeFormat
+    put_entry(exif, 0x0202, 4, 1, static_cast<unsigned>(thumbnail.size()));
+    put_u32(exif, 0);
+    put_u16(exif, 1);
+    put_entry(exif, 0x0001, 2, 2, 'N');         // GPSLatitudeRef = "N"
+    put_u32(exif, 0);
+    exif.insert(exif.end(), thumbnail.begin(), thumbnail.end());
+    return exif;
+}
+
+std::vector<uint8_t> bytes_of(const std::string& text, bool withNul) {
+    std::vector<uint8_t> out(text.begin(), text.end());
+    if (withNul) out.push_back(0);
+    return out;
+}
+
+bool contains(const std::vector<uint8_t>& data, const std::vector<uint8_t>& needle) {
+    return std::search(data.begin(), data.end(), needle.begin(), needle.end()) != data.end();
+}
+
+// 扫描数据中 0xFF 之后只会是 0x00 或 RSTn，整个文件里出现的 SOI 个数即内嵌 JPEG 的个数加 1
+int count_soi(const std::vector<uint8_t>& data) {
+    int count = 0;
+    for (size_t i = 0; i + 1 < data.size(); ++i) {
+        if (data[i] == 0xFF && data[i + 1] == 0xD8) count++;
+    }
+    return count;
+}
+
+// 统计 SOS 之前某个标记的段数
+int count_segments(const std::vector<uint8_t>& data, uint8_t marker) {
+    int count = 0;
+    for (size_t pos = 2; pos + 4 <= data.size() && data[pos] == 0xFF && data[pos + 1] != 0xDA;) {
+        if (data[pos + 1] == marker) count++;
+        pos += 2 + ((data[pos + 2] << 8) | data[pos + 3]);
+    }
+    return count;
+}
+
+void check_output(const std::vector<uint8_t>& output, const std::string& path) {
+    check(!output.empty(), path + ": output produced");
+    check(count_soi(output) == 1, path + ": no embedded thumbnail");
+    check(count_segments(output, 0xE1) == 0, path + ": no APP1 (EXIF/XMP) segment");
+    check(count_segments(output, 0xFE) == 0, path + ": no COM segment");
+    check(!contains(output, bytes_of("Exif", false)) && !contains(output, bytes_of("secret comment", false)),
+          path + ": no EXIF or comment bytes left");
+    check(count_segments(output, 0xE2) == 1 && contains(output, bytes_of("ICC_PROFILE", true)), path + ": ICC profile kept");
+    JpegInfo info;
+    cv::Mat decoded;
+    check(jpeg_read_info(output.data(), output.size(), info) && info.width == 64 && info.height == 48
+          && jpeg_decode_bgr(output.data(), output.size(), 1, decoded), path + ": output decodes");
+}
+
+} // namespace
+
+int main()
+{
+    // 缩略图亮度与原图相同，代表“未脱敏的原图”
+    const std::vector<uint8_t> thumbnail = encode_jpeg(16, 12, 200, {});
+    std::vector<uint8_t> icc = bytes_of("ICC_PROFILE", true);
+    icc.insert(icc.end(), {1, 1, 'f', 'a', 'k', 'e'});
+    const std::vector<uint8_t> input = encode_jpeg(64, 48, 200, {
+        {JPEG_APP0 + 1, make_exif(thumbnail)},
+        {JPEG_APP0 + 1, bytes_of("http://ns.adobe.com/xap/1.0/", true)},
+        {JPEG_APP0 + 2, icc},
+        {JPEG_COM, bytes_of("secret comment", false)},
+    });
+    check(count_soi(input) == 2 && count_segments(input, 0xE1) == 2, "input carries an EXIF thumbnail and XMP");
+
+    // 有目标：只重新编码框所在的 MCU
+    std::vector<uint8_t> redacted;
+    const std::vector<cv::Rect> boxes = {cv::Rect(16, 16, 16, 16)};
+    auto blackout = [](cv::Mat& patch, const std::vector<cv::Rect>&) {
+        for (int r = 0; r < patch.rows; ++r) memset(patch.ptr<uchar>(r), 0, static_cast<size_t>(patch.cols) * 3);
+    };
+    check(jpeg_redact_blocks(input.data(), input.size(), boxes, blackout, redacted), "jpeg_redact_blocks succeeds");
+    check_output(redacted, "jpeg_redact_blocks");
+
+    // 无目标：不解码，直接复制扫描数据
+    std::vector<uint8_t> stripped;
+    check(jpeg_strip_metadata(input.data(), input.size(), stripped), "jpeg_strip_metadata succeeds");
+    check_output(stripped, "jpeg_strip_metadata");
+
+    std::cout << (g_failures == 0 ? "All JPEG metadata checks passed." : "JPEG metadata checks failed.") << std::endl;
+    return g_failures == 0 ? 0 : 1;
+}
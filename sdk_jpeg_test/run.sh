@@ -0,0 +1,2 @@
+export LD_LIBRARY_PATH=./lib:$LD_LIBRARY_PATH
+./Anonymization_jpeg_test "$@"
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "AllocCounter.h"
+
+#include <atomic>
+#include <cerrno>
+#include <malloc.h>
+
+// glibc 导出的原始实现
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+
+namespace {
+
+// 只用常量初始化的原子量，在任何静态构造之前就可用
+std::atomic<uint64_t> g_allocs(0);
+std::atomic<uint64_t> g_frees(0);
+std::atomic<uint64_t> g_alloc_bytes(0);
+std::atomic<int64_t> g_live_bytes(0);
+std::atomic<int64_t> g_peak_bytes(0);
+
+// 以 malloc_usable_size 计量，分配和释放两边一致
+void on_alloc(void* ptr) {
+    if (ptr == nullptr) return;
+    const int64_t size = static_cast<int64_t>(malloc_usable_size(ptr));
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(static_cast<uint64_t>(size), std::memory_order_relaxed);
+    const int64_t live = g_live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = g_peak_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !g_peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+void on_free(void* ptr) {
+    if (ptr == nullptr) return;
+    g_frees.fetch_add(1, std::memory_order_relaxed);
+    g_live_bytes.fetch_sub(static_cast<int64_t>(malloc_usable_size(ptr)), std::memory_order_relaxed);
+}
+
+} // namespace
+
+extern "C" {
+
+void* malloc(size_t size) {
+    void* ptr = __libc_malloc(size);
+    on_alloc(ptr);
+    return ptr;
+}
+
+void* calloc(size_t count, size_t size) {
+    void* ptr = __libc_calloc(count, size);
+    on_alloc(ptr);
+    return ptr;
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (ptr == nullptr) return malloc(size);
+    if (size == 0) {
+        free(ptr);
+        return nullptr;
+    }
+    const int64_t oldSize = static_cast<int64_t>(malloc_usable_size(ptr));
+    void* result = __libc_realloc(ptr, size);
+    if (result == nullptr) return nullptr;   // 原块未释放
+    // 按一次释放加一次分配计
+    g_frees.fetch_add(1, std::memory_order_relaxed);
+    g_live_bytes.fetch_sub(oldSize, std::memory_order_relaxed);
+    on_alloc(result);
+    return result;
+}
+
+void free(void* ptr) {
+    on_free(ptr);
+    __libc_free(ptr);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    void* ptr = __libc_memalign(alignment, size);
+    on_alloc(ptr);
+    return ptr;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+    void* ptr = memalign(alignment, size);
+    if (ptr == nullptr && size != 0) return ENOMEM;
+    *out = ptr;
+    return 0;
+}
+
+} // extern "C"
+
+void alloc_snapshot(AllocSnapshot& snapshot) {
+    snapshot.allocs = g_allocs.load(std::memory_order_relaxed);
+    snapshot.frees = g_frees.load(std::memory_order_relaxed);
+    snapshot.allocBytes = g_alloc_bytes.load(std::memory_order_relaxed);
+    snapshot.liveBytes = g_live_bytes.load(std::memory_order_relaxed);
+    snapshot.peakBytes = g_peak_bytes.load(std::memory_order_relaxed);
+}
+
+void alloc_reset_peak() {
+    g_peak_bytes.store(g_live_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
@@ -0,0 +1,24 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * 进程级分配计数：AllocCounter.cpp 在可执行文件中重新定义 malloc/free 等函数，
+ * 动态链接时 libAnonymization.so、OpenCV、FFmpeg 的分配也都经过这里，再转给 glibc 的实现
+ */
+
+struct AllocSnapshot {
+    uint64_t allocs;        // 分配次数（malloc/calloc/realloc/memalign 等，含 operator new）
+    uint64_t frees;
+    uint64_t allocBytes;    // 累计分配字节数
+    int64_t liveBytes;      // 当前未释放的字节数
+    int64_t peakBytes;      // 上次 alloc_reset_peak 以来 liveBytes 的最大值
+};
+
+void alloc_snapshot(AllocSnapshot& snapshot);
+// 把峰值重置为当前的 liveBytes
+void alloc_reset_peak();
+
+#endif // ALLOC_COUNTER_H
@@ -0,0 +1,281 @@
+#include "./../Anonymization.h"
+#include "AllocCounter.h"
+#include "./../sdk_test_common/TestFrame.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <opencv2/opencv.hpp>
+
+// 内存占用与泄漏测试：
+//   init/uninit   反复创建销毁句柄，报告每次的分配次数、句柄常驻字节和峰值，销毁后仍增长即为泄漏
+//   mem/<格式>    每种格式连续处理多帧，报告每帧分配次数/字节和峰值，检查长时间运行的增长和每帧分配预算
+//   video         video_anonymization 按帧平均的分配次数，以及两次调用之间的增长
+// 任一检查不通过时退出码为 1
+
+struct LeakTestOptions {
+    std::string modelDir = "./model";
+    std::string image = "../sdk_mem_test/image/input.jpg";
+    std::string video;                   // 为空时不测视频
+    BlurType blurType = BLUR_TYPE_GAUSSIAN;
+    int warmupCycles = 2;                // 首次初始化时 OpenCV/DNN 的全局缓存、线程池不计入泄漏
+    int cycles = 20;
+    int warmupFrames = 5;
+    int frames = 200;
+    double maxLeakKB = 64;               // 预热之后允许的常驻字节增长
+    double maxAllocsPerFrame = 256;      // 每帧平均分配次数预算
+    double maxFrameMB = 0;               // 每帧平均分配字节预算，0 表示不检查
+    double maxPeakRssMB = 0;             // 整个进程的峰值 RSS 上限，0 表示不检查
+};
+
+struct PhaseResult {
+    std::string name;
+    long long calls = 0;
+    double allocsPerCall = 0;
+    double bytesPerCall = 0;
+    double peakMB = 0;                   // 调用期间比调用前多占用的最大字节数
+    double residentKB = 0;               // init 之后句柄常驻的字节数（仅 init/uninit）
+    double growthKB = 0;                 // 预热之后常驻字节的增长
+    double rssMB = 0;
+    bool passed = true;
+    std::string reason;
+};
+
+double proc_status_mb(const char* key) {
+    FILE* fp = fopen("/proc/self/status", "r");
+    if (!fp) return 0;
+    char line[256];
+    long kb = 0;
+    const size_t keyLen = strlen(key);
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, key, keyLen) == 0 && line[keyLen] == ':') {
+            kb = atol(line + keyLen + 1);
+            break;
+        }
+    }
+    fclose(fp);
+    return kb / 1024.0;
+}
+
+void check_growth(PhaseResult& r, const LeakTestOptions& options) {
+    if (r.growthKB > options.maxLeakKB) {
+        r.passed = false;
+        r.reason = "leaked " + std::to_string(static_cast<long long>(r.growthKB)) + " KB";
+    }
+}
+
+PhaseResult test_init_uninit(const LeakTestOptions& options) {
+    PhaseResult r;
+    r.name = "init/uninit";
+    AllocSnapshot before, after, afterInit;
+    int64_t baseline = 0;
+    double residentKB = 0, peakMB = 0;
+    uint64_t allocs = 0, bytes = 0;
+    for (int i = 0; i < options.warmupCycles + options.cycles; ++i) {
+        alloc_reset_peak();
+        alloc_snapshot(before);
+        AnonymizationHandle handle = nullptr;
+        if (init(options.modelDir.c_str(), RECOGNIZE_FACE, &handle) != ANO_OK) {
+            r.passed = false;
+            r.reason = "init failed";
+            return r;
+        }
+        alloc_snapshot(afterInit);
+        uninit(handle);
+        alloc_snapshot(after);
+        if (i < options.warmupCycles) {
+            baseline = after.liveBytes;
+            continue;
+        }
+        allocs += after.allocs - before.allocs;
+        bytes += after.allocBytes - before.allocBytes;
+        residentKB = std::max(residentKB, (afterInit.liveBytes - before.liveBytes) / 1024.0);
+        peakMB = std::max(peakMB, (after.peakBytes - before.liveBytes) / 1048576.0);
+    }
+    r.calls = options.cycles;
+    r.allocsPerCall = options.cycles > 0 ? static_cast<double>(allocs) / options.cycles : 0;
+    r.bytesPerCall = options.cycles > 0 ? static_cast<double>(bytes) / options.cycles : 0;
+    r.residentKB = residentKB;
+    r.peakMB = peakMB;
+    r.growthKB = (after.liveBytes - baseline) / 1024.0;
+    r.rssMB = proc_status_mb("VmRSS");
+    check_growth(r, options);
+    return r;
+}
+
+void check_frame_budget(PhaseResult& r, const LeakTestOptions& options) {
+    if (!r.passed) return;
+    if (r.allocsPerCall > options.maxAllocsPerFrame) {
+        r.passed = false;
+        r.reason = "allocs/frame over budget " + std::to_string(static_cast<long long>(options.maxAllocsPerFrame));
+    } else if (options.maxFrameMB > 0 && r.bytesPerCall / 1048576.0 > options.maxFrameMB) {
+        r.passed = false;
+        r.reason = "MB/frame over budget " + std::to_string(options.maxFrameMB);
+    }
+}
+
+PhaseResult test_mem_format(AnonymizationHandle handle, const cv::Mat& image, ImageFormat format, const char* formatName,
+                            const LeakTestOptions& options) {
+    PhaseResult r;
+    r.name = std::string("mem/") + formatName;
+    std::vector<uint8_t> pristine;
+    ImageFrame frame;
+    if (!make_frame(image, format, pristine, frame)) {
+        r.passed = false;
+        r.reason = "unsupported format";
+        return r;
+    }
+    std::vector<uint8_t> work(pristine.size());
+    ImageFrame local = rebase_frame(frame, pristine, work);
+
+    AllocSnapshot before, after;
+    int64_t baseline = 0;
+    uint64_t allocs = 0, bytes = 0;
+    double peakMB = 0;
+    for (int i = 0; i < options.warmupFrames + options.frames; ++i) {
+        memcpy(work.data(), pristine.data(), work.size());
+        alloc_reset_peak();
+        alloc_snapshot(before);
+        if (mem_anonymization(handle, &local, options.blurType) != ANO_OK) {
+            r.passed = false;
+            r.reason = "mem_anonymization failed";
+            return r;
+        }
+        alloc_snapshot(after);
+        if (i < options.warmupFrames) {
+            baseline = after.liveBytes;
+            continue;
+        }
+        allocs += after.allocs - before.allocs;
+        bytes += after.allocBytes - before.allocBytes;
+        peakMB = std::max(peakMB, (after.peakBytes - before.liveBytes) / 1048576.0);
+    }
+    r.calls = options.frames;
+    r.allocsPerCall = options.frames > 0 ? static_cast<double>(allocs) / options.frames : 0;
+    r.bytesPerCall = options.frames > 0 ? static_cast<double>(bytes) / options.frames : 0;
+    r.peakMB = peakMB;
+    r.growthKB = (after.liveBytes - baseline) / 1024.0;
+    r.rssMB = proc_status_mb("VmRSS");
+    check_growth(r, options);
+    check_frame_budget(r, options);
+    return r;
+}
+
+PhaseResult test_video(AnonymizationHandle handle, const LeakTestOptions& options) {
+    PhaseResult r;
+    r.name = "video";
+    const long long frames = video_frame_count(options.video);
+    if (frames <= 0) {
+        r.passed = false;
+        r.reason = "cannot read frame count";
+        return r;
+    }
+    const std::string output = "/tmp/sdk_leak_test_" + std::to_string(getpid()) + ".mp4";
+    // 第一次调用用于预热（编解码器、线程池），第二次计量
+    AllocSnapshot warm, before, after;
+    if (video_anonymization(handle, options.video.c_str(), output.c_str(), options.blurType) != ANO_OK) {
+        r.passed = false;
+        r.reason = "video_anonymization failed";
+        remove(output.c_str());
+        return r;
+    }
+    alloc_snapshot(warm);
+    alloc_reset_peak();
+    alloc_snapshot(before);
+    const int ret = video_anonymization(handle, options.video.c_str(), output.c_str(), options.blurType);
+    alloc_snapshot(after);
+    remove(output.c_str());
+    if (ret != ANO_OK) {
+        r.passed = false;
+        r.reason = "video_anonymization failed";
+        return r;
+    }
+    r.calls = frames;
+    r.allocsPerCall = static_cast<double>(after.allocs - before.allocs) / frames;
+    r.bytesPerCall = static_cast<double>(after.allocBytes - before.allocBytes) / frames;
+    r.peakMB = (after.peakBytes - before.liveBytes) / 1048576.0;
+    r.growthKB = (after.liveBytes - warm.liveBytes) / 1024.0;
+    r.rssMB = proc_status_mb("VmRSS");
+    check_growth(r, options);
+    check_frame_budget(r, options);
+    return r;
+}
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [options]\n"
+              << "  --models DIR              model directory (default ./model)\n"
+              << "  --image FILE              input image for mem_anonymization (default ../sdk_mem_test/image/input.jpg)\n"
+              << "  --video FILE              also measure video_anonymization with this file\n"
+              << "  --cycles N                measured init/uninit cycles (default 20, after 2 warm-up cycles)\n"
+              << "  --frames N                measured frames per format (default 200, after 5 warm-up frames)\n"
+              << "  --max-leak-kb KB          allowed growth of live bytes after warm-up (default 64)\n"
+              << "  --max-allocs-per-frame N  allocation count budget per frame (default 256)\n"
+              << "  --max-frame-mb MB         allocated bytes budget per frame (default 0, unchecked)\n"
+              << "  --max-peak-rss-mb MB      fail when the process peak RSS exceeds this (default 0, unchecked)\n";
+}
+
+int main(int argc, char** argv)
+{
+    LeakTestOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--models" && hasValue) options.modelDir = argv[++i];
+        else if (arg == "--image" && hasValue) options.image = argv[++i];
+        else if (arg == "--video" && hasValue) options.video = argv[++i];
+        else if (arg == "--cycles" && hasValue) options.cycles = std::max(1, atoi(argv[++i]));
+        else if (arg == "--frames" && hasValue) options.frames = std::max(1, atoi(argv[++i]));
+        else if (arg == "--max-leak-kb" && hasValue) options.maxLeakKB = atof(argv[++i]);
+        else if (arg == "--max-allocs-per-frame" && hasValue) options.maxAllocsPerFrame = atof(argv[++i]);
+        else if (arg == "--max-frame-mb" && hasValue) options.maxFrameMB = atof(argv[++i]);
+        else if (arg == "--max-peak-rss-mb" && hasValue) options.maxPeakRssMB = atof(argv[++i]);
+        else {
+            usage(argv[0]);
+            return arg == "--help" ? 0 : 2;
+        }
+    }
+
+    std::cout << "SDK Version: " << get_version() << std::endl;
+    set_log_filelevel("./sdk_leak_test.log", LOG_WARN);
+
+    cv::Mat image;
+    if (!load_test_image(options.image, image)) return 2;
+
+    std::vector<PhaseResult> results;
+    results.push_back(test_init_uninit(options));
+
+    AnonymizationHandle handle = nullptr;
+    if (init(options.modelDir.c_str(), RECOGNIZE_FACE, &handle) != ANO_OK) {
+        std::cerr << "[ERROR] init failed." << std::endl;
+        return 2;
+    }
+    const char* formatNames[] = { "ARGB", "RGB", "BGR", "YUV420P", "YUV420SP", "GRAY" };
+    for (int f = 0; f < IMG_FORMAT_END; ++f) {
+        results.push_back(test_mem_format(handle, image, static_cast<ImageFormat>(f), formatNames[f], options));
+    }
+    if (!options.video.empty()) results.push_back(test_video(handle, options));
+    uninit(handle);
+
+    bool passed = true;
+    printf("%-14s %8s %12s %12s %10s %12s %10s %8s  %s\n",
+           "phase", "calls", "allocs/call", "KB/call", "peak MB", "resident KB", "growth KB", "rss MB", "result");
+    for (const PhaseResult& r : results) {
+        printf("%-14s %8lld %12.1f %12.1f %10.2f %12.1f %10.1f %8.1f  %s%s%s\n",
+               r.name.c_str(), r.calls, r.allocsPerCall, r.bytesPerCall / 1024.0, r.peakMB, r.residentKB, r.growthKB, r.rssMB,
+               r.passed ? "PASS" : "FAIL", r.reason.empty() ? "" : ": ", r.reason.c_str());
+        passed = passed && r.passed;
+    }
+    const double peakRss = proc_status_mb("VmHWM");
+    printf("peak RSS: %.1f MB", peakRss);
+    if (options.maxPeakRssMB > 0) {
+        const bool ok = peakRss <= options.maxPeakRssMB;
+        printf(" (limit %.1f) %s", options.maxPeakRssMB, ok ? "PASS" : "FAIL");
+        passed = passed && ok;
+    }
+    printf("\n");
+    return passed ? 0 : 1;
+}
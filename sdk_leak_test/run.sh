@@ -0,0 +1,2 @@
+export LD_LIBRARY_PATH=./lib:$LD_LIBRARY_PATH
+./Anonymization_leak_test "$@"
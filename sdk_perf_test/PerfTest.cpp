@@ -0,0 +1,474 @@
+#include "./../Anonymization.h"
+#include "./../sdk_test_common/TestFrame.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <opencv2/opencv.hpp>
+
+// 并发扩展与长时间稳定性测试：
+//   扩展模式：依次用 1..N 个线程满负载调用 mem_anonymization / video_anonymization，
+//             输出每个线程数下的帧率、p50/p99 延迟和 CPU 占用
+//   浸泡模式（--soak-hours）：固定线程数长时间运行，定期记录 RSS、文件描述符数和吞吐，
+//             RSS 或文件描述符持续增长时以非零状态退出
+
+typedef std::chrono::steady_clock Clock;
+
+struct PerfTestOptions {
+    std::string modelDir = "./model";
+    std::string image = "../sdk_mem_test/image/input.jpg";
+    std::string video;                   // 为空时不测视频
+    ImageFormat format = IMG_FORMAT_BGR;
+    BlurType blurType = BLUR_TYPE_GAUSSIAN;
+    std::vector<int> threads;            // 扩展模式的线程数序列
+    double durationSec = 20;             // 扩展模式每个线程数的测量时长
+    bool shared = false;                 // 同时测试一个句柄被多个线程共享（多路流调度器）的情况
+    int sharedDetectors = 1;
+    double soakHours = 0;                // >0 进入浸泡模式
+    int soakThreads = 0;                 // 浸泡模式线程数，默认等于 CPU 核数
+    double reportIntervalSec = 60;
+    double maxRssDriftMB = 64;
+    std::string json;
+};
+
+// 一个测量窗口的结果
+struct WindowResult {
+    std::string kind;                    // mem / video / shared
+    int threads = 0;
+    double seconds = 0;
+    long long frames = 0;
+    double fps = 0;
+    double p50Ms = 0, p99Ms = 0;
+    double cpuCores = 0;                 // 平均占用的 CPU 核数（用户态 + 内核态）
+};
+
+// 浸泡模式的一次采样
+struct SoakSample {
+    double elapsedSec = 0;
+    double fps = 0;
+    double p50Ms = 0, p99Ms = 0;
+    double rssMB = 0;
+    int fds = 0;
+};
+
+// 每个工作线程一份，测量窗口之间由主线程取走
+struct WorkerStats {
+    std::atomic<long long> frames{0};
+    std::vector<double> latencies;       // 毫秒
+    std::atomic<bool> busy{false};       // 采样时与工作线程交接 latencies
+};
+
+double cpu_seconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+double rss_mb() {
+    FILE* fp = fopen("/proc/self/status", "r");
+    if (!fp) return 0;
+    char line[256];
+    long kb = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "VmRSS: %ld kB", &kb) == 1) break;
+    }
+    fclose(fp);
+    return kb / 1024.0;
+}
+
+int open_fds() {
+    DIR* dir = opendir("/proc/self/fd");
+    if (!dir) return -1;
+    int count = 0;
+    while (readdir(dir) != nullptr) count++;
+    closedir(dir);
+    return count - 3;   // . .. 以及 opendir 自己的描述符
+}
+
+double percentile(std::vector<double>& values, double q) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(q * (values.size() - 1) + 0.5);
+    return values[std::min(index, values.size() - 1)];
+}
+
+class LoadRunner {
+public:
+    LoadRunner(const PerfTestOptions& options, const std::vector<uint8_t>& pristine, const ImageFrame& frame, long long videoFrames)
+        : options(options), pristine(pristine), frame(frame), videoFrames(videoFrames) {}
+
+    // 启动 count 个工作线程；kind 为 mem / video / shared
+    bool start(const std::string& kind, int count) {
+        this->kind = kind;
+        this->stopping = false;
+        this->stats.clear();
+        for (int i = 0; i < count; ++i) this->stats.emplace_back(new WorkerStats());
+        if (kind == "shared") {
+            // 一个句柄 + 多路流调度器：各线程注册一路流，共享 sharedDetectors 个检测实例
+            if (init(this->options.modelDir.c_str(), RECOGNIZE_FACE, &this->sharedHandle) != ANO_OK) return false;
+            MultiStreamOptions msOptions;
+            init_multistream_options(&msOptions);
+            msOptions.detectorCount = this->options.sharedDetectors;
+            if (open_multistream(this->sharedHandle, &msOptions, &this->scheduler) != ANO_OK) return false;
+        } else {
+            // 每个线程独立的句柄，初始化不计入测量窗口
+            this->handles.assign(count, nullptr);
+            for (int i = 0; i < count; ++i) {
+                if (init(this->options.modelDir.c_str(), RECOGNIZE_FACE, &this->handles[i]) != ANO_OK) return false;
+            }
+        }
+        for (int i = 0; i < count; ++i) this->workers.emplace_back(&LoadRunner::worker, this, i);
+        return true;
+    }
+
+    void stop() {
+        this->stopping = true;
+        for (std::thread& t : this->workers) t.join();
+        this->workers.clear();
+        for (AnonymizationHandle h : this->handles) {
+            if (h) uninit(h);
+        }
+        this->handles.clear();
+        if (this->scheduler) close_multistream(this->scheduler);
+        this->scheduler = nullptr;
+        if (this->sharedHandle) uninit(this->sharedHandle);
+        this->sharedHandle = nullptr;
+    }
+
+    // 取走自上次调用以来的帧数和延迟样本
+    long long collect(std::vector<double>& latencies) {
+        long long frames = 0;
+        for (auto& s : this->stats) {
+            frames += s->frames.exchange(0);
+            bool expected = false;
+            while (!s->busy.compare_exchange_weak(expected, true)) {
+                expected = false;
+                std::this_thread::yield();
+            }
+            latencies.insert(latencies.end(), s->latencies.begin(), s->latencies.end());
+            s->latencies.clear();
+            s->busy = false;
+        }
+        return frames;
+    }
+
+    std::atomic<int> errors{0};
+
+private:
+    void record(WorkerStats& s, long long frames, double ms) {
+        bool expected = false;
+        while (!s.busy.compare_exchange_weak(expected, true)) {
+            expected = false;
+            std::this_thread::yield();
+        }
+        s.latencies.push_back(ms);
+        s.busy = false;
+        s.frames += frames;
+    }
+
+    void worker(int index) {
+        WorkerStats& s = *this->stats[index];
+        std::vector<uint8_t> work(this->pristine.size());
+        ImageFrame local = rebase_frame(this->frame, this->pristine, work);
+        const std::string videoOut = "/tmp/sdk_perf_test_" + std::to_string(getpid()) + "_" + std::to_string(index) + ".mp4";
+        int32_t streamId = -1;
+        if (this->kind == "shared") {
+            StreamRegistration registration;
+            init_stream_registration(&registration);
+            registration.blurType = this->options.blurType;
+            registration.detectInterval = 1;
+            if (register_stream(this->scheduler, &registration, &streamId) != ANO_OK) {
+                this->errors++;
+                return;
+            }
+        }
+        int64_t pts = 0;
+        while (!this->stopping) {
+            if (this->kind == "video") {
+                const Clock::time_point start = Clock::now();
+                int ret = video_anonymization(this->handles[index], this->options.video.c_str(), videoOut.c_str(), this->options.blurType);
+                if (ret != ANO_OK) this->errors++;
+                this->record(s, this->videoFrames, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+                continue;
+            }
+            memcpy(work.data(), this->pristine.data(), work.size());   // 每次从原始数据开始，不计时
+            const Clock::time_point start = Clock::now();
+            int ret;
+            if (this->kind == "shared") {
+                ImageFrame result;
+                ret = multistream_push(this->scheduler, streamId, &local, pts);
+                if (ret == ANO_OK) ret = multistream_pull(this->scheduler, streamId, &result, nullptr, -1);
+                pts++;
+            } else {
+                ret = mem_anonymization(this->handles[index], &local, this->options.blurType);
+            }
+            if (ret != ANO_OK) this->errors++;
+            this->record(s, 1, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+        if (streamId >= 0) unregister_stream(this->scheduler, streamId);
+        if (this->kind == "video") remove(videoOut.c_str());
+    }
+
+    const PerfTestOptions& options;
+    const std::vector<uint8_t>& pristine;
+    const ImageFrame frame;
+    const long long videoFrames;
+    std::string kind;
+    std::atomic<bool> stopping{false};
+    std::vector<std::unique_ptr<WorkerStats>> stats;
+    std::vector<std::thread> workers;
+    std::vector<AnonymizationHandle> handles;
+    AnonymizationHandle sharedHandle = nullptr;
+    MultiStreamHandle scheduler = nullptr;
+};
+
+// 运行一个测量窗口：先预热再计时
+bool run_window(LoadRunner& runner, const std::string& kind, int threads, double seconds, WindowResult& result) {
+    if (!runner.start(kind, threads)) {
+        std::cerr << "[ERROR] Failed to start " << kind << " load with " << threads << " threads." << std::endl;
+        runner.stop();
+        return false;
+    }
+    std::vector<double> latencies;
+    std::this_thread::sleep_for(std::chrono::duration<double>(std::min(5.0, seconds / 5)));
+    runner.collect(latencies);
+    latencies.clear();
+
+    const double cpuStart = cpu_seconds();
+    const Clock::time_point start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    const long long frames = runner.collect(latencies);
+    const double wall = std::chrono::duration<double>(Clock::now() - start).count();
+    const double cpu = cpu_seconds() - cpuStart;
+    runner.stop();
+
+    result.kind = kind;
+    result.threads = threads;
+    result.seconds = wall;
+    result.frames = frames;
+    result.fps = frames / wall;
+    result.p50Ms = percentile(latencies, 0.50);
+    result.p99Ms = percentile(latencies, 0.99);
+    result.cpuCores = cpu / wall;
+    return true;
+}
+
+void write_scale_json(const std::string& path, const std::vector<WindowResult>& results) {
+    FILE* fp = fopen(path.c_str(), "w");
+    if (!fp) {
+        std::cerr << "[ERROR] Failed to write " << path << std::endl;
+        return;
+    }
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    fprintf(fp, "{\n\"mode\": \"scale\",\n\"sdk_version\": \"%s\",\n\"cpu_threads\": %u,\n\"results\": [\n", get_version(), cores);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const WindowResult& r = results[i];
+        fprintf(fp, "{\"kind\": \"%s\", \"threads\": %d, \"seconds\": %.1f, \"frames\": %lld, \"fps\": %.2f, \"fps_per_thread\": %.2f, "
+                    "\"p50_ms\": %.2f, \"p99_ms\": %.2f, \"cpu_cores\": %.2f, \"cpu_util_pct\": %.1f, \"fps_per_core\": %.2f}%s\n",
+                r.kind.c_str(), r.threads, r.seconds, r.frames, r.fps, r.fps / r.threads, r.p50Ms, r.p99Ms,
+                r.cpuCores, r.cpuCores * 100 / cores, r.cpuCores > 0 ? r.fps / r.cpuCores : 0, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(fp, "]\n}\n");
+    fclose(fp);
+}
+
+int run_scale(const PerfTestOptions& options, LoadRunner& runner) {
+    std::vector<std::string> kinds = { "mem" };
+    if (options.shared) kinds.push_back("shared");
+    if (!options.video.empty()) kinds.push_back("video");
+
+    std::vector<WindowResult> results;
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    printf("%-8s %8s %10s %10s %10s %10s %10s %10s\n", "kind", "threads", "fps", "fps/thr", "p50 ms", "p99 ms", "cpu %", "fps/core");
+    for (const std::string& kind : kinds) {
+        for (int threads : options.threads) {
+            WindowResult r;
+            if (!run_window(runner, kind, threads, options.durationSec, r)) return 1;
+            printf("%-8s %8d %10.2f %10.2f %10.2f %10.2f %10.1f %10.2f\n", kind.c_str(), threads, r.fps, r.fps / threads,
+                   r.p50Ms, r.p99Ms, r.cpuCores * 100 / cores, r.cpuCores > 0 ? r.fps / r.cpuCores : 0);
+            fflush(stdout);
+            results.push_back(r);
+        }
+    }
+    if (!options.json.empty()) write_scale_json(options.json, results);
+    if (runner.errors > 0) {
+        std::cerr << "[FAIL] " << runner.errors << " calls returned an error." << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int run_soak(const PerfTestOptions& options, LoadRunner& runner) {
+    const int threads = options.soakThreads > 0 ? options.soakThreads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    const std::string kind = options.video.empty() ? "mem" : "video";
+    if (!runner.start(kind, threads)) {
+        std::cerr << "[ERROR] Failed to start soak load." << std::endl;
+        runner.stop();
+        return 1;
+    }
+    std::cout << "Soak: " << kind << " load, " << threads << " threads, " << options.soakHours << " h, sample every "
+              << options.reportIntervalSec << " s" << std::endl;
+    printf("%10s %10s %10s %10s %10s %8s\n", "elapsed s", "fps", "p50 ms", "p99 ms", "rss MB", "fds");
+
+    std::vector<SoakSample> samples;
+    std::vector<long long> hourFrames;
+    std::vector<double> latencies;
+    const Clock::time_point start = Clock::now();
+    Clock::time_point last = start;
+    const double total = options.soakHours * 3600;
+    while (std::chrono::duration<double>(Clock::now() - start).count() < total) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(options.reportIntervalSec));
+        const Clock::time_point now = Clock::now();
+        latencies.clear();
+        const long long frames = runner.collect(latencies);
+        SoakSample sample;
+        sample.elapsedSec = std::chrono::duration<double>(now - start).count();
+        sample.fps = frames / std::chrono::duration<double>(now - last).count();
+        sample.p50Ms = percentile(latencies, 0.50);
+        sample.p99Ms = percentile(latencies, 0.99);
+        sample.rssMB = rss_mb();
+        sample.fds = open_fds();
+        last = now;
+        const size_t hour = static_cast<size_t>(sample.elapsedSec / 3600);
+        if (hourFrames.size() <= hour) hourFrames.resize(hour + 1, 0);
+        hourFrames[hour] += frames;
+        samples.push_back(sample);
+        printf("%10.0f %10.2f %10.2f %10.2f %10.1f %8d\n", sample.elapsedSec, sample.fps, sample.p50Ms, sample.p99Ms, sample.rssMB, sample.fds);
+        fflush(stdout);
+    }
+    runner.stop();
+
+    // 第一次采样包含模型预热和缓冲区首次分配，漂移从第二次采样算起
+    double rssDrift = 0;
+    int fdDrift = 0;
+    if (samples.size() >= 3) {
+        rssDrift = samples.back().rssMB - samples[1].rssMB;
+        fdDrift = samples.back().fds - samples[1].fds;
+    }
+    const bool passed = rssDrift <= options.maxRssDriftMB && fdDrift <= 0 && runner.errors == 0;
+    printf("RSS drift: %.1f MB (limit %.1f), fd drift: %d, errors: %d -> %s\n",
+           rssDrift, options.maxRssDriftMB, fdDrift, runner.errors.load(), passed ? "PASS" : "FAIL");
+    for (size_t h = 0; h < hourFrames.size(); ++h) printf("hour %zu: %lld frames\n", h, hourFrames[h]);
+
+    if (!options.json.empty()) {
+        FILE* fp = fopen(options.json.c_str(), "w");
+        if (fp) {
+            fprintf(fp, "{\n\"mode\": \"soak\",\n\"kind\": \"%s\",\n\"threads\": %d,\n\"samples\": [\n", kind.c_str(), threads);
+            for (size_t i = 0; i < samples.size(); ++i) {
+                const SoakSample& s = samples[i];
+                fprintf(fp, "{\"elapsed_sec\": %.0f, \"fps\": %.2f, \"p50_ms\": %.2f, \"p99_ms\": %.2f, \"rss_mb\": %.1f, \"fds\": %d}%s\n",
+                        s.elapsedSec, s.fps, s.p50Ms, s.p99Ms, s.rssMB, s.fds, i + 1 < samples.size() ? "," : "");
+            }
+            fprintf(fp, "],\n\"frames_per_hour\": [");
+            for (size_t h = 0; h < hourFrames.size(); ++h) fprintf(fp, "%s%lld", h ? ", " : "", hourFrames[h]);
+            fprintf(fp, "],\n\"rss_drift_mb\": %.1f,\n\"fd_drift\": %d,\n\"errors\": %d,\n\"passed\": %s\n}\n",
+                    rssDrift, fdDrift, runner.errors.load(), passed ? "true" : "false");
+            fclose(fp);
+        }
+    }
+    return passed ? 0 : 1;
+}
+
+bool parse_format(const std::string& name, ImageFormat& format) {
+    const char* names[] = { "ARGB", "RGB", "BGR", "YUV420P", "YUV420SP", "GRAY" };
+    for (int i = 0; i < IMG_FORMAT_END; ++i) {
+        if (name == names[i]) {
+            format = static_cast<ImageFormat>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " [options]\n"
+              << "  --models DIR            model directory (default ./model)\n"
+              << "  --image FILE            input image for mem_anonymization (default ../sdk_mem_test/image/input.jpg)\n"
+              << "  --format NAME           ARGB|RGB|BGR|YUV420P|YUV420SP|GRAY (default BGR)\n"
+              << "  --video FILE            also drive video_anonymization with this file\n"
+              << "  --threads 1,2,4         thread counts to measure (default powers of two up to the core count)\n"
+              << "  --duration SEC          measuring time per thread count (default 20)\n"
+              << "  --shared                also measure one shared handle through the multistream scheduler\n"
+              << "  --shared-detectors N    detector instances of the shared scheduler (default 1)\n"
+              << "  --soak-hours H          soak mode: run for H hours and track RSS, fds and throughput\n"
+              << "  --soak-threads N        soak mode thread count (default core count)\n"
+              << "  --report-interval SEC   soak sampling interval (default 60)\n"
+              << "  --max-rss-drift MB      soak fails when RSS grows more than this (default 64)\n"
+              << "  --json FILE             write results as JSON\n";
+}
+
+int main(int argc, char** argv)
+{
+    PerfTestOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--models" && hasValue) options.modelDir = argv[++i];
+        else if (arg == "--image" && hasValue) options.image = argv[++i];
+        else if (arg == "--video" && hasValue) options.video = argv[++i];
+        else if (arg == "--duration" && hasValue) options.durationSec = std::max(1.0, atof(argv[++i]));
+        else if (arg == "--shared") options.shared = true;
+        else if (arg == "--shared-detectors" && hasValue) options.sharedDetectors = std::max(1, atoi(argv[++i]));
+        else if (arg == "--soak-hours" && hasValue) options.soakHours = atof(argv[++i]);
+        else if (arg == "--soak-threads" && hasValue) options.soakThreads = atoi(argv[++i]);
+        else if (arg == "--report-interval" && hasValue) options.reportIntervalSec = std::max(1.0, atof(argv[++i]));
+        else if (arg == "--max-rss-drift" && hasValue) options.maxRssDriftMB = atof(argv[++i]);
+        else if (arg == "--json" && hasValue) options.json = argv[++i];
+        else if (arg == "--format" && hasValue) {
+            if (!parse_format(argv[++i], options.format)) {
+                std::cerr << "Unknown format: " << argv[i] << std::endl;
+                return 2;
+            }
+        } else if (arg == "--threads" && hasValue) {
+            std::string list = argv[++i];
+            for (size_t pos = 0; pos < list.size();) {
+                size_t comma = std::min(list.find(',', pos), list.size());
+                int n = atoi(list.substr(pos, comma - pos).c_str());
+                if (n > 0) options.threads.push_back(n);
+                pos = comma + 1;
+            }
+        } else {
+            usage(argv[0]);
+            return arg == "--help" ? 0 : 2;
+        }
+    }
+    if (options.threads.empty()) {
+        const int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        for (int n = 1; n < cores; n *= 2) options.threads.push_back(n);
+        options.threads.push_back(cores);
+    }
+
+    std::cout << "SDK Version: " << get_version() << std::endl;
+    set_log_filelevel("./sdk_perf_test.log", LOG_WARN);
+
+    cv::Mat image;
+    if (!load_test_image(options.image, image)) return 2;
+    std::vector<uint8_t> pristine;
+    ImageFrame frame;
+    if (!make_frame(image, options.format, pristine, frame)) {
+        std::cerr << "[ERROR] Failed to prepare the input frame." << std::endl;
+        return 2;
+    }
+
+    long long videoFrames = 0;
+    if (!options.video.empty()) {
+        videoFrames = video_frame_count(options.video);
+        if (videoFrames <= 0) {
+            std::cerr << "[ERROR] Failed to read the frame count of " << options.video << std::endl;
+            return 2;
+        }
+    }
+
+    LoadRunner runner(options, pristine, frame, videoFrames);
+    return options.soakHours > 0 ? run_soak(options, runner) : run_scale(options, runner);
+}
@@ -0,0 +1,76 @@
+#include "TestFrame.h"
+#include <iostream>
+#include <cstring>
+#include <opencv2/opencv.hpp>
+
+bool load_test_image(const std::string& path, cv::Mat& image) {
+    image = cv::imread(path, cv::IMREAD_COLOR);
+    if (image.empty() || image.cols < 2 || image.rows < 2) {
+        std::cerr << "[ERROR] Failed to load image: " << path << std::endl;
+        return false;
+    }
+    image = image(cv::Rect(0, 0, image.cols & ~1, image.rows & ~1)).clone();
+    return true;
+}
+
+bool make_frame(const cv::Mat& bgr, ImageFormat format, std::vector<uint8_t>& buffer, ImageFrame& frame) {
+    memset(&frame, 0, sizeof(frame));
+    frame.width = bgr.cols;
+    frame.height = bgr.rows;
+    frame.format = format;
+    cv::Mat converted;
+    switch (format) {
+        case IMG_FORMAT_BGR: converted = bgr; break;
+        case IMG_FORMAT_RGB: cv::cvtColor(bgr, converted, cv::COLOR_BGR2RGB); break;
+        case IMG_FORMAT_ARGB: cv::cvtColor(bgr, converted, cv::COLOR_BGR2BGRA); break;
+        case IMG_FORMAT_GRAY: cv::cvtColor(bgr, converted, cv::COLOR_BGR2GRAY); break;
+        case IMG_FORMAT_YUV420P:
+        case IMG_FORMAT_YUV420SP: {
+            if (bgr.cols % 2 != 0 || bgr.rows % 2 != 0) return false;
+            cv::Mat i420;
+            cv::cvtColor(bgr, i420, cv::COLOR_BGR2YUV_I420);
+            const int w = bgr.cols, h = bgr.rows;
+            buffer.assign(i420.datastart, i420.dataend);
+            frame.data[0] = buffer.data();
+            frame.strides[0] = w;
+            if (format == IMG_FORMAT_YUV420P) {
+                frame.data[1] = frame.data[0] + w * h;
+                frame.data[2] = frame.data[1] + (w / 2) * (h / 2);
+                frame.strides[1] = frame.strides[2] = w / 2;
+            } else {
+                const uint8_t* u = i420.data + w * h;
+                const uint8_t* v = u + (w / 2) * (h / 2);
+                uint8_t* uv = buffer.data() + w * h;
+                for (int i = 0; i < (w / 2) * (h / 2); ++i) {
+                    uv[2 * i] = u[i];
+                    uv[2 * i + 1] = v[i];
+                }
+                frame.data[1] = uv;
+                frame.strides[1] = w;
+            }
+            return true;
+        }
+        default: return false;
+    }
+    const size_t rowBytes = converted.cols * converted.elemSize();
+    buffer.resize(rowBytes * converted.rows);
+    for (int r = 0; r < converted.rows; ++r) memcpy(buffer.data() + r * rowBytes, converted.ptr(r), rowBytes);
+    frame.data[0] = buffer.data();
+    frame.strides[0] = static_cast<int>(rowBytes);
+    return true;
+}
+
+ImageFrame rebase_frame(const ImageFrame& frame, const std::vector<uint8_t>& from, std::vector<uint8_t>& to) {
+    ImageFrame result = frame;
+    for (int i = 0; i < 4; ++i) {
+        if (frame.data[i] != nullptr) result.data[i] = to.data() + (frame.data[i] - from.data());
+    }
+    return result;
+}
+
+long long video_frame_count(const std::string& path) {
+    cv::VideoCapture capture(path);
+    if (!capture.isOpened()) return 0;
+    const long long frames = static_cast<long long>(capture.get(cv::CAP_PROP_FRAME_COUNT));
+    return frames > 0 ? frames : 0;
+}
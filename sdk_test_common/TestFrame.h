@@ -0,0 +1,23 @@
+#ifndef SDK_TEST_FRAME_H
+#define SDK_TEST_FRAME_H
+
+#include "./../Anonymization.h"
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+// sdk_perf_test 与 sdk_leak_test 共用的测试夹具：读取测试图像、按格式准备帧数据
+
+// 读取 BGR 测试图像并裁成偶数宽高（YUV 格式要求），失败时打印错误并返回 false
+bool load_test_image(const std::string& path, cv::Mat& image);
+
+// 按格式准备紧凑排列的帧数据，布局与 sdk_mem_test 相同；frame 的各平面指向 buffer
+bool make_frame(const cv::Mat& bgr, ImageFormat format, std::vector<uint8_t>& buffer, ImageFrame& frame);
+
+// 把 frame 的各平面指针从 from 缓冲区重定位到 to 缓冲区
+ImageFrame rebase_frame(const ImageFrame& frame, const std::vector<uint8_t>& from, std::vector<uint8_t>& to);
+
+// 读取视频帧数，打不开或帧数未知时返回 0
+long long video_frame_count(const std::string& path);
+
+#endif // SDK_TEST_FRAME_H